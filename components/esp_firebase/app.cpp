@@ -1,5 +1,8 @@
 
 #include <iostream>
+#include <ctype.h>
+#include <strings.h>
+#include <new>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -7,8 +10,11 @@
 #include "esp_log.h"
 #include "esp_tls.h"
 #include "esp_crt_bundle.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 
 #include "app.h"
+#include "gzip.h"
 
 
 
@@ -23,13 +29,29 @@
 #define HTTP_TAG "HTTP_CLIENT"
 #define FIREBASE_APP_TAG "FirebaseApp"
 
+// Planificador de renovación: 5 min antes de expirar menos hasta 2 min de jitter
+// (evita que varias placas renueven a la vez); reintentos 15 s .. 5 min
+#define AUTH_REFRESH_MARGIN_S 300
+#define AUTH_REFRESH_JITTER_S 120
+#define AUTH_RETRY_MIN_S 15
+#define AUTH_RETRY_MAX_S 300
+#define AUTH_TASK_STACK 8192
+
 // Prefer ESP-IDF certificate bundle over embedded certs
 
 
 
-static int output_len = 0; 
+
+// Campos de las respuestas de Identity Toolkit / Secure Token, compilados una vez
+static const Json::Pointer refresh_token_ptr("/refreshToken");
+static const Json::Pointer access_token_ptr("/access_token");
+static const Json::Pointer expires_in_ptr("/expires_in");
+static const Json::Pointer expires_in_alt_ptr("/expiresIn"); 
+static const Json::Pointer error_message_ptr("/error/message");
+// user_data es el http_context_t dueño del cliente: cada contexto lleva su propio estado
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
+    ESPFirebase::http_context_t* ctx = static_cast<ESPFirebase::http_context_t*>(evt->user_data);
 
     switch(evt->event_id) {
         case HTTP_EVENT_ERROR:
@@ -37,32 +59,46 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
             break;
         case HTTP_EVENT_ON_CONNECTED:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_CONNECTED");
-            memset(evt->user_data, 0, HTTP_RECV_BUFFER_SIZE);
-            output_len = 0;
+            // ON_DATA termina siempre en '\0': sin cuerpo que leer basta con vaciar el primer byte
+            if (ctx->discard_body) ctx->response_buffer[0] = '\0';
+            else memset(ctx->response_buffer, 0, HTTP_RECV_BUFFER_SIZE);
+            ctx->output_len = 0;
+            ctx->etag[0] = '\0';
             break;
         case HTTP_EVENT_HEADER_SENT:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_HEADER_SENT");
             break;
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+            // Sólo la forma en segundos; la forma HTTP-date se ignora (queda el backoff)
+            if (strcasecmp(evt->header_key, "Retry-After") == 0 && isdigit((unsigned char)evt->header_value[0])) {
+                ctx->retry_after_s = atoi(evt->header_value);
+            } else if (strcasecmp(evt->header_key, "ETag") == 0) {
+                snprintf(ctx->etag, sizeof(ctx->etag), "%s", evt->header_value);
+            }
             break;
         case HTTP_EVENT_REDIRECT:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_REDIRECT");
             break;
         case HTTP_EVENT_ON_FINISH:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_FINISH");
-            output_len = 0;
+            ctx->output_len = 0;
             break;
         case HTTP_EVENT_ON_DATA:
             ESP_LOGD(HTTP_TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            if (evt->user_data && evt->data && evt->data_len > 0) {
+            if (ctx && evt->data && evt->data_len > 0) {
+                ctx->rx_bytes += evt->data_len;
+                if (ctx->discard_body) {
+                    int status = esp_http_client_get_status_code(evt->client);
+                    if (status >= 200 && status < 300) break;
+                }
                 int capacity = HTTP_RECV_BUFFER_SIZE - 1; // deja 1 para terminador
-                int space = capacity - output_len;
+                int space = capacity - ctx->output_len;
                 if (space > 0) {
                     int to_copy = evt->data_len < space ? evt->data_len : space;
-                    memcpy((char*)evt->user_data + output_len, evt->data, to_copy);
-                    output_len += to_copy;
-                    ((char*)evt->user_data)[output_len] = '\0';
+                    memcpy(ctx->response_buffer + ctx->output_len, evt->data, to_copy);
+                    ctx->output_len += to_copy;
+                    ctx->response_buffer[ctx->output_len] = '\0';
                 }
             }
             break;
@@ -75,115 +111,440 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 
 namespace ESPFirebase {
 
-// TODO: protect this function from breaking 
-void FirebaseApp::firebaseClientInit(void)
+static http_error_class_t classifyError(esp_http_client_handle_t client, esp_err_t err, int status_code)
+{
+    if (err == ESP_OK) {
+        // 304 sólo llega a peticiones condicionales (if-none-match): es una respuesta válida
+        if ((status_code >= 200 && status_code < 300) || status_code == 304) return http_error_class_t::none;
+        if (status_code == 429) return http_error_class_t::throttled;
+        if (status_code >= 500 || status_code == 408) return http_error_class_t::server_error;
+        return http_error_class_t::client_error;
+    }
+    // Detalle de esp-tls: distingue DNS, socket y handshake
+    int tls_code = 0, tls_flags = 0;
+    esp_err_t tls_err = esp_http_client_get_and_clear_last_tls_error(client, &tls_code, &tls_flags);
+    switch (tls_err) {
+        case ESP_OK:
+            return http_error_class_t::transport;
+        case ESP_ERR_ESP_TLS_CANNOT_RESOLVE_HOSTNAME:
+            return http_error_class_t::dns;
+        case ESP_ERR_ESP_TLS_CANNOT_CREATE_SOCKET:
+        case ESP_ERR_ESP_TLS_FAILED_CONNECT_TO_HOST:
+        case ESP_ERR_ESP_TLS_SOCKET_SETOPT_FAILED:
+        case ESP_ERR_ESP_TLS_CONNECTION_TIMEOUT:
+            return http_error_class_t::transport;
+        default:
+            return http_error_class_t::tls;
+    }
+}
+
+static const char* errorClassName(http_error_class_t cls)
+{
+    switch (cls) {
+        case http_error_class_t::none: return "ok";
+        case http_error_class_t::transport: return "transporte";
+        case http_error_class_t::tls: return "tls";
+        case http_error_class_t::dns: return "dns";
+        case http_error_class_t::server_error: return "5xx";
+        case http_error_class_t::throttled: return "429";
+        case http_error_class_t::client_error: return "4xx";
+    }
+    return "?";
+}
+
+bool FirebaseApp::openContext(http_context_t& ctx)
 {   
+    ctx.response_buffer = new (std::nothrow) char[HTTP_RECV_BUFFER_SIZE];
+    if (!ctx.response_buffer) {
+        ESP_LOGE(FIREBASE_APP_TAG, "Sin memoria para el buffer de respuesta");
+        return false;
+    }
+    ctx.response_buffer[0] = '\0';
+    // CharReader guarda estado del parseo: uno por contexto
+    Json::CharReaderBuilder reader_builder;
+    Json::CharReaderBuilder::strictTrustedMode(&reader_builder.settings_);
+    ctx.json_reader = reader_builder.newCharReader();
+    ctx.output_len = 0;
+    ctx.retry_after_s = -1;
+    ctx.current_timeout_ms = FirebaseApp::default_timeout_ms;
+    ctx.discard_body = false;
+    ctx.rx_bytes = 0;
+    ctx.etag[0] = '\0';
+
     esp_http_client_config_t config = {};
     config.url = "https://google.com";    // you have to set this as https link of some sort so that it can init properly, you cant leave it empty
     config.event_handler = http_event_handler;
     // Use global certificate bundle (requires CONFIG_MBEDTLS_CERTIFICATE_BUNDLE)
     config.crt_bundle_attach = esp_crt_bundle_attach;
-    config.user_data = FirebaseApp::local_response_buffer;
+    config.user_data = &ctx;
     config.buffer_size_tx = 4096;
     config.buffer_size = HTTP_RECV_BUFFER_SIZE;
     // Timeout razonable (ms)
-    config.timeout_ms = 20000; // 20s
-    this->default_timeout_ms = config.timeout_ms;  // 20 s por defecto
+    config.timeout_ms = FirebaseApp::default_timeout_ms; // 20s
     // Deshabilitamos keep-alive: el server parece cerrar tras inactividad (~10 min) provocando RST en primer write
     config.keep_alive_enable = false;
-    FirebaseApp::client = esp_http_client_init(&config);
-    ESP_LOGD(FIREBASE_APP_TAG, "HTTP Client Initialized");
+    ctx.client = esp_http_client_init(&config);
+    if (!ctx.client) {
+        ESP_LOGE(FIREBASE_APP_TAG, "http_client_init fallo");
+        FirebaseApp::closeContext(ctx);
+        return false;
+    }
+    ESP_LOGD(FIREBASE_APP_TAG, "HTTP Client Initialized (ctx %d)", (int)(&ctx - FirebaseApp::pool));
+    return true;
+}
 
+void FirebaseApp::closeContext(http_context_t& ctx)
+{
+    if (ctx.client) esp_http_client_cleanup(ctx.client);
+    delete[] ctx.response_buffer;
+    delete ctx.json_reader;
+    ctx.client = nullptr;
+    ctx.response_buffer = nullptr;
+    ctx.json_reader = nullptr;
 }
 
+http_context_t* FirebaseApp::acquireContext(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    // Reentrante: la tarea que ya tiene un contexto lo sigue usando
+    xSemaphoreTake(FirebaseApp::pool_mutex, portMAX_DELAY);
+    for (http_context_t& ctx : FirebaseApp::pool) {
+        if (ctx.owner == self) {
+            ctx.depth++;
+            xSemaphoreGive(FirebaseApp::pool_mutex);
+            return &ctx;
+        }
+    }
+    xSemaphoreGive(FirebaseApp::pool_mutex);
+
+    xSemaphoreTake(FirebaseApp::pool_slots, portMAX_DELAY);
+    http_context_t* picked = nullptr;
+    xSemaphoreTake(FirebaseApp::pool_mutex, portMAX_DELAY);
+    for (http_context_t& ctx : FirebaseApp::pool) { // el 0 primero: ya está abierto
+        if (ctx.owner == nullptr) {
+            ctx.owner = self;
+            ctx.depth = 1;
+            picked = &ctx;
+            break;
+        }
+    }
+    xSemaphoreGive(FirebaseApp::pool_mutex);
+
+    if (picked && !picked->client && !FirebaseApp::openContext(*picked)) {
+        FirebaseApp::releaseContext(picked);
+        return nullptr;
+    }
+    return picked;
+}
+
+void FirebaseApp::releaseContext(http_context_t* ctx)
+{
+    if (!ctx) return;
+    if (ctx->depth > 1) { // sólo la dueña lo toca: no hace falta el mutex
+        ctx->depth--;
+        return;
+    }
+    // Los contextos extra no se quedan con ~32 KB de buffers mientras están ociosos
+    if (ctx != &FirebaseApp::pool[0]) FirebaseApp::closeContext(*ctx);
+    xSemaphoreTake(FirebaseApp::pool_mutex, portMAX_DELAY);
+    ctx->depth = 0;
+    ctx->owner = nullptr;
+    xSemaphoreGive(FirebaseApp::pool_mutex);
+    xSemaphoreGive(FirebaseApp::pool_slots);
+}
 
 esp_err_t FirebaseApp::setHeader(const char* header, const char* value)
 {
-    return esp_http_client_set_header(FirebaseApp::client, header, value);
+    ClientLease lease(this);
+    if (!lease.context()) return ESP_FAIL;
+    return esp_http_client_set_header(lease.context()->client, header, value);
+}
+
+http_ret_t FirebaseApp::performRequest(const char* url,
+                                       esp_http_client_method_t method,
+                                       const std::string& post_field)
+{
+    return FirebaseApp::performRequest(url, method, post_field.c_str(), post_field.length());
 }
 
 http_ret_t FirebaseApp::performRequest(const char* url,
                                        esp_http_client_method_t method,
-                                       std::string post_field)
+                                       const char* post_field,
+                                       size_t post_len)
 {
-    const int MAX_ATTEMPTS = 5; // 1 intento + 1 reintento
+    ClientLease lease(this);
+    http_context_t* ctx = lease.context();
+    if (!ctx) return {ESP_ERR_NO_MEM, -1, http_error_class_t::transport, 0};
+    esp_http_client_handle_t client = ctx->client;
+    const retry_policy_t& policy = FirebaseApp::retry_policy;
     esp_err_t err = ESP_FAIL;
     int status_code = -1;
+    http_error_class_t error_class = http_error_class_t::transport;
+
+    // Presupuesto total: nunca menos que un intento completo con el timeout vigente
+    int budget_ms = policy.deadline_ms > ctx->current_timeout_ms ? policy.deadline_ms : ctx->current_timeout_ms;
+    const int64_t deadline_us = esp_timer_get_time() + (int64_t)budget_ms * 1000;
+    ctx->rx_bytes = 0;
+
+    // Cuerpo grande: gzip una sola vez para todos los intentos (gz vive hasta el return)
+    const bool has_body = method == HTTP_METHOD_POST || method == HTTP_METHOD_PUT || method == HTTP_METHOD_PATCH;
+    const char* raw_field = post_field;
+    const size_t raw_len = post_len;
+    std::string gz;
+    bool gzip = has_body && FirebaseApp::compressBody(post_field, post_len, gz);
+    if (gzip) {
+        post_field = gz.data();
+        post_len = gz.size();
+    }
 
-    for (int attempt = 1; attempt <= MAX_ATTEMPTS; ++attempt) {
-        // Inicializa o reusa el cliente
-        if (FirebaseApp::client == nullptr) {
-            esp_http_client_config_t cfg = {};
-            cfg.url = url;
-            cfg.crt_bundle_attach = esp_crt_bundle_attach;
-            FirebaseApp::client = esp_http_client_init(&cfg);
-            if (!FirebaseApp::client) {
-                ESP_LOGE(FIREBASE_APP_TAG, "http_client_init fallo");
-                break;
-            }
-        } else {
-            esp_http_client_set_url(FirebaseApp::client, url);
-        }
+    for (int attempt = 1; attempt <= policy.max_attempts; ++attempt) {
+        esp_http_client_set_url(client, url);
+
+        // El intento no puede exceder lo que queda de presupuesto
+        int64_t remaining_ms = (deadline_us - esp_timer_get_time()) / 1000;
+        if (remaining_ms <= 0) break;
+        int attempt_timeout_ms = remaining_ms < ctx->current_timeout_ms ? (int)remaining_ms : ctx->current_timeout_ms;
+        esp_http_client_set_timeout_ms(client, attempt_timeout_ms);
 
-        if (esp_http_client_set_method(FirebaseApp::client, method) != ESP_OK) {
+        if (esp_http_client_set_method(client, method) != ESP_OK) {
             ESP_LOGE(FIREBASE_APP_TAG, "set_method fallo");
         }
 
         // Métodos con body
-        if (method == HTTP_METHOD_POST || method == HTTP_METHOD_PUT || method == HTTP_METHOD_PATCH) {
-            if (esp_http_client_set_post_field(FirebaseApp::client,
-                                               post_field.c_str(),
-                                               post_field.length()) != ESP_OK) {
+        if (has_body) {
+            if (esp_http_client_set_post_field(client,
+                                               post_field,
+                                               (int)post_len) != ESP_OK) {
                 ESP_LOGE(FIREBASE_APP_TAG, "set_post_field fallo");
             }
-            setHeader("content-type", "application/json");
+            esp_http_client_set_header(client, "content-type", "application/json");
+            if (gzip) esp_http_client_set_header(client, "Content-Encoding", "gzip");
         } else {
             // Métodos SIN body (DELETE/GET): limpiar payload y forzar Content-Length: 0
-            esp_http_client_set_post_field(FirebaseApp::client, "", 0);
-            esp_http_client_set_header(FirebaseApp::client, "Content-Length", "0");
+            esp_http_client_set_post_field(client, "", 0);
+            esp_http_client_set_header(client, "Content-Length", "0");
         }
 
-        err = esp_http_client_perform(FirebaseApp::client);
-        status_code = esp_http_client_get_status_code(FirebaseApp::client);
+        ctx->retry_after_s = -1;
+        err = esp_http_client_perform(client);
+        status_code = esp_http_client_get_status_code(client);
+        error_class = classifyError(client, err, status_code);
+        // Tras un error de transporte el cliente queda a medias (IDF retomaría el intercambio donde se
+        // cortó): el siguiente intento abre conexión nueva y vuelve a enviar la petición entera
+        if (err != ESP_OK) esp_http_client_close(client);
 
         // Aceptar cualquier 2xx como éxito (DELETE puede devolver 204)
-        if (err == ESP_OK && status_code >= 200 && status_code < 300) {
-            esp_http_client_close(FirebaseApp::client);
-            return {err, status_code};
+        if (error_class == http_error_class_t::none) {
+            esp_http_client_close(client);
+            esp_http_client_set_timeout_ms(client, ctx->current_timeout_ms);
+            if (gzip) esp_http_client_delete_header(client, "Content-Encoding");
+            return {err, status_code, error_class, ctx->rx_bytes};
         }
 
-        ESP_LOGE(FIREBASE_APP_TAG,
-                "request: url=%s\nmethod=%d\npost_field=%s",
-                url, method, post_field.c_str());
-        ESP_LOGE(FIREBASE_APP_TAG, "response=\n%s", local_response_buffer);
+        // Este endpoint no acepta cuerpos comprimidos. Se apaga y se repite al momento sin gzip;
+        // el reenvío no gasta intento (con max_attempts = 1 también sale el cuerpo plano)
+        if (gzip && gzipRejected(status_code)) {
+            FirebaseApp::rejectCompression(status_code);
+            esp_http_client_delete_header(client, "Content-Encoding");
+            gzip = false;
+            post_field = raw_field;
+            post_len = raw_len;
+            --attempt;
+            continue;
+        }
+
+        // Sin token (auth=) ni body: el body de login lleva la contraseña
+        const char* auth = strstr(url, "auth=");
+        if (auth) {
+            const char* rest = strchr(auth, '&');
+            ESP_LOGE(FIREBASE_APP_TAG, "request: url=%.*sauth=<%u B>%s method=%d body=%u B",
+                     (int)(auth - url), url, (unsigned)(rest ? rest - auth - 5 : strlen(auth) - 5),
+                     rest ? rest : "", method, (unsigned)post_len);
+        } else {
+            ESP_LOGE(FIREBASE_APP_TAG, "request: url=%.*s method=%d body=%u B",
+                     (int)(strchr(url, '?') ? strchr(url, '?') - url : strlen(url)), url, method, (unsigned)post_len);
+        }
+        ESP_LOGE(FIREBASE_APP_TAG, "response=\n%s", ctx->response_buffer);
+        ESP_LOGW(FIREBASE_APP_TAG, "Intento %d/%d fallo: clase=%s err=%s status=%d",
+                 attempt, policy.max_attempts, errorClassName(error_class), esp_err_to_name(err), status_code);
+
+        // 4xx no cambia al repetir la misma petición
+        if (error_class == http_error_class_t::client_error || attempt == policy.max_attempts) break;
+
+        // Full jitter: espera uniforme en [0, min(tope, base * 2^(intento-1))]
+        int64_t cap_ms = (int64_t)policy.base_delay_ms << (attempt - 1 < 20 ? attempt - 1 : 20);
+        if (cap_ms > policy.max_delay_ms) cap_ms = policy.max_delay_ms;
+        int64_t delay_ms = (int64_t)(esp_random() % (uint32_t)(cap_ms + 1));
+        if ((error_class == http_error_class_t::throttled || status_code == 503) && ctx->retry_after_s > 0) {
+            delay_ms = (int64_t)ctx->retry_after_s * 1000; // el servidor manda
+        }
+        if (esp_timer_get_time() + delay_ms * 1000 >= deadline_us) {
+            ESP_LOGW(FIREBASE_APP_TAG, "Sin presupuesto para reintentar (espera %lld ms)", (long long)delay_ms);
+            break;
+        }
 
         // Reintento: asegurar headers/estado del body correctos
-        if (method == HTTP_METHOD_POST || method == HTTP_METHOD_PUT || method == HTTP_METHOD_PATCH) {
-            setHeader("content-type", "application/json");
+        if (has_body) {
+            esp_http_client_set_header(client, "content-type", "application/json");
         } else {
-            esp_http_client_set_post_field(FirebaseApp::client, "", 0);
-            esp_http_client_set_header(FirebaseApp::client, "Content-Length", "0");
+            esp_http_client_set_post_field(client, "", 0);
+            esp_http_client_set_header(client, "Content-Length", "0");
         }
-        vTaskDelay(pdMS_TO_TICKS(500));
+        vTaskDelay(pdMS_TO_TICKS((uint32_t)delay_ms));
+    }
+    esp_http_client_set_timeout_ms(client, ctx->current_timeout_ms);
+    if (gzip) esp_http_client_delete_header(client, "Content-Encoding");
+    return {err, status_code, error_class, ctx->rx_bytes};
+}
+
+bool FirebaseApp::compressBody(const char* body, size_t len, std::string& out)
+{
+    const size_t threshold = FirebaseApp::compress_threshold;
+    if (threshold == 0 || len < threshold) return false;
+
+    const int64_t start_us = esp_timer_get_time();
+    GzipEncoder encoder(FirebaseApp::compress_window);
+    const bool ok = encoder.compress(body, len, out) && out.size() < len;
+    const int64_t cpu_us = esp_timer_get_time() - start_us;
+
+    xSemaphoreTake(FirebaseApp::compress_mutex, portMAX_DELAY);
+    compression_metrics_t& m = FirebaseApp::compression_metrics;
+    if (ok) m.compressed++;
+    else m.not_smaller++;
+    m.raw_bytes += len;
+    m.wire_bytes += ok ? out.size() : len;
+    m.cpu_us += cpu_us;
+    xSemaphoreGive(FirebaseApp::compress_mutex);
+
+    if (ok) {
+        ESP_LOGD(FIREBASE_APP_TAG, "gzip %u -> %u B en %lld us", (unsigned)len, (unsigned)out.size(), (long long)cpu_us);
     }
-    return {err, status_code};
+    return ok;
+}
+
+void FirebaseApp::rejectCompression(int status_code)
+{
+    ESP_LOGW(FIREBASE_APP_TAG, "%d con Content-Encoding: gzip -> compresión desactivada", status_code);
+    FirebaseApp::compress_threshold = 0;
+    xSemaphoreTake(FirebaseApp::compress_mutex, portMAX_DELAY);
+    FirebaseApp::compression_metrics.rejected++;
+    xSemaphoreGive(FirebaseApp::compress_mutex);
+}
+
+void FirebaseApp::setRequestCompression(size_t threshold, size_t window)
+{
+    FirebaseApp::compress_window = window;
+    FirebaseApp::compress_threshold = threshold;
+}
+
+compression_metrics_t FirebaseApp::getCompressionMetrics()
+{
+    xSemaphoreTake(FirebaseApp::compress_mutex, portMAX_DELAY);
+    compression_metrics_t m = FirebaseApp::compression_metrics;
+    xSemaphoreGive(FirebaseApp::compress_mutex);
+    return m;
 }
 
 
 void FirebaseApp::clearHTTPBuffer(void)
 {   
-    memset(FirebaseApp::local_response_buffer, 0, HTTP_RECV_BUFFER_SIZE);
-    output_len = 0;
+    ClientLease lease(this);
+    http_context_t* ctx = lease.context();
+    if (!ctx) return;
+    memset(ctx->response_buffer, 0, HTTP_RECV_BUFFER_SIZE);
+    ctx->output_len = 0;
+}
+
+esp_err_t FirebaseApp::deleteHeader(const char* header)
+{
+    ClientLease lease(this);
+    if (!lease.context()) return ESP_FAIL;
+    return esp_http_client_delete_header(lease.context()->client, header);
+}
+
+void FirebaseApp::setDiscardResponseBody(bool discard)
+{
+    ClientLease lease(this);
+    if (lease.context()) lease.context()->discard_body = discard;
+}
+
+const char* FirebaseApp::responseBuffer(void)
+{
+    ClientLease lease(this);
+    return lease.context() ? lease.context()->response_buffer : "";
+}
+
+const char* FirebaseApp::responseETag(void)
+{
+    ClientLease lease(this);
+    return lease.context() ? lease.context()->etag : "";
+}
+
+bool FirebaseApp::parseResponse(Json::Value& out)
+{
+    ClientLease lease(this);
+    if (!lease.context()) return false;
+    const char* begin = lease.context()->response_buffer;
+    const char* end = begin + strlen(begin);
+    return lease.context()->json_reader->parse(begin, end, &out, nullptr);
+}
+
+bool FirebaseApp::parseJson(const char* begin, const char* end, Json::Value& out)
+{
+    ClientLease lease(this);
+    if (!lease.context()) return false;
+    return lease.context()->json_reader->parse(begin, end, &out, nullptr);
+}
+
+bool FirebaseApp::parseResponseAt(const Json::Pointer& ptr, Json::Value& out)
+{
+    ClientLease lease(this);
+    if (!lease.context()) return false;
+    const char* begin = lease.context()->response_buffer;
+    const char* end = begin + strlen(begin);
+    return ptr.find(begin, end, *lease.context()->json_reader, &out);
 }
 
 void FirebaseApp::setHttpTimeoutMs(int ms) {
-    if (this->client) esp_http_client_set_timeout_ms(this->client, ms);
+    ClientLease lease(this);
+    if (!lease.context()) return;
+    lease.context()->current_timeout_ms = ms;
+    esp_http_client_set_timeout_ms(lease.context()->client, ms);
 }
 
 void FirebaseApp::restoreDefaultHttpTimeout() {
-    if (this->client) esp_http_client_set_timeout_ms(this->client, this->default_timeout_ms);
+    FirebaseApp::setHttpTimeoutMs(this->default_timeout_ms);
+}
+
+size_t FirebaseApp::authQueryLength(void) {
+    AuthLock auth(this);
+    return FirebaseApp::auth_query.size();
+}
+
+uint32_t FirebaseApp::appendAuthQuery(std::string& url) {
+    AuthLock auth(this);
+    url.append(FirebaseApp::auth_query);
+    return FirebaseApp::auth_generation;
 }
 
+uint32_t FirebaseApp::authGeneration(void) {
+    AuthLock auth(this);
+    return FirebaseApp::auth_generation;
+}
+
+void FirebaseApp::setRetryPolicy(const retry_policy_t& policy) {
+    this->retry_policy = policy;
+    if (this->retry_policy.max_attempts < 1) this->retry_policy.max_attempts = 1;
+}
+
+void FirebaseApp::useAuthEmulator(const char* origin) {
+    RefreshLock refresh(this); // las URL sólo se leen durante un login o una renovación
+    std::string base = origin;
+    FirebaseApp::register_url = base + "/identitytoolkit.googleapis.com/v1/accounts:signUp?key=" + FirebaseApp::api_key;
+    FirebaseApp::login_url = base + "/identitytoolkit.googleapis.com/v1/accounts:signInWithPassword?key=" + FirebaseApp::api_key;
+    FirebaseApp::auth_url = base + "/securetoken.googleapis.com/v1/token?key=" + FirebaseApp::api_key;
+}
 
 esp_err_t FirebaseApp::getRefreshToken(bool register_account)
 {
@@ -192,9 +553,12 @@ esp_err_t FirebaseApp::getRefreshToken(bool register_account)
     http_ret_t http_ret;
     
     std::string account_json = R"({"email":")";
-    account_json += FirebaseApp::user_account.user_email; 
-    account_json += + R"(", "password":")"; 
-    account_json += FirebaseApp::user_account.user_password;
+    {
+        AuthLock auth(this);
+        account_json += FirebaseApp::user_account.user_email; 
+        account_json += + R"(", "password":")"; 
+        account_json += FirebaseApp::user_account.user_password;
+    }
     account_json += R"(", "returnSecureToken": true})"; 
 
     FirebaseApp::setHeader("content-type", "application/json");
@@ -209,15 +573,12 @@ esp_err_t FirebaseApp::getRefreshToken(bool register_account)
 
     if (http_ret.err == ESP_OK && http_ret.status_code == 200)
     {
-        // std::cout << FirebaseApp::local_response_buffer << '\n';
-        const char* begin = FirebaseApp::local_response_buffer;
-        const char* end = begin + strlen(FirebaseApp::local_response_buffer);
-        Json::Reader reader;
         Json::Value data;
-        reader.parse(begin, end, data, false);
-        FirebaseApp::refresh_token = data["refreshToken"].asString();
+        FirebaseApp::parseResponseAt(refresh_token_ptr, data);
+        AuthLock auth(this);
+        FirebaseApp::refresh_token = data.asString();
 
-        ESP_LOGD(FIREBASE_APP_TAG, "Refresh Token=%s", FirebaseApp::refresh_token.c_str());
+        ESP_LOGD(FIREBASE_APP_TAG, "Refresh Token recibido (%u B)", (unsigned)FirebaseApp::refresh_token.size());
         return ESP_OK;
     }
     else 
@@ -225,67 +586,207 @@ esp_err_t FirebaseApp::getRefreshToken(bool register_account)
         return ESP_FAIL;
     }
 }
-esp_err_t FirebaseApp::getAuthToken()
+// El intercambio HTTPS va sin auth_mutex: las peticiones siguen con el token vigente y sólo
+// se bloquean lo que dura el cambio de token/query/expiración
+esp_err_t FirebaseApp::getAuthToken(bool* rejected)
 {
     http_ret_t http_ret;
+    if (rejected) *rejected = false;
 
     std::string token_post_data = R"({"grant_type": "refresh_token", "refresh_token":")";
-    token_post_data+= FirebaseApp::refresh_token + "\"}";
+    {
+        AuthLock auth(this);
+        token_post_data += FirebaseApp::refresh_token;
+    }
+    token_post_data += "\"}";
 
 
     FirebaseApp::setHeader("content-type", "application/json");
     http_ret = FirebaseApp::performRequest(FirebaseApp::auth_url.c_str(), HTTP_METHOD_POST, token_post_data);
     if (http_ret.err == ESP_OK && http_ret.status_code == 200)
     {
-        const char* begin = FirebaseApp::local_response_buffer;
-        const char* end = begin + strlen(FirebaseApp::local_response_buffer);
-        Json::Reader reader;
+        // Sólo se parsean los campos usados: los tokens de la respuesta ocupan varios KB
         Json::Value data;
-        reader.parse(begin, end, data, false);
-        FirebaseApp::auth_token = data["access_token"].asString();
+        FirebaseApp::parseResponseAt(access_token_ptr, data);
+        std::string token = data.asString();
+        std::string query;
+        query.reserve(5 + token.size());
+        query.append("auth=").append(token);
+        data = Json::Value();
+        int expires_in = 3600; // fallback 1h
         // expires_in llega como string en segundos
-        if (data.isMember("expires_in")) {
-            FirebaseApp::auth_expires_in = atoi(data["expires_in"].asCString());
-        } else if (data.isMember("expiresIn")) { // por si cambia el campo
-            FirebaseApp::auth_expires_in = atoi(data["expiresIn"].asCString());
-        } else {
-            FirebaseApp::auth_expires_in = 3600; // fallback 1h
+        if (FirebaseApp::parseResponseAt(expires_in_ptr, data) ||
+            FirebaseApp::parseResponseAt(expires_in_alt_ptr, data)) { // por si cambia el campo
+            expires_in = data.isString() ? atoi(data.asCString()) : data.asInt();
         }
-        FirebaseApp::auth_obtained_time = time(NULL);
+
+        AuthLock auth(this);
+        FirebaseApp::auth_token.swap(token);
+        FirebaseApp::auth_query.swap(query);
+        FirebaseApp::auth_expires_in = expires_in;
+        FirebaseApp::auth_obtained_us = esp_timer_get_time();
+        FirebaseApp::auth_generation++;
+        FirebaseApp::scheduleAuthRefresh();
 
         ESP_LOGI(FIREBASE_APP_TAG, "Auth Token acquired (expira en %d s)", FirebaseApp::auth_expires_in);
         return ESP_OK;
     }
     else {
+        // {"error":{"code":400,"message":"TOKEN_EXPIRED",...}}; red, 5xx o 429 no invalidan el refresh token
+        Json::Value message;
+        if (http_ret.err == ESP_OK && http_ret.status_code == 400 && FirebaseApp::parseResponseAt(error_message_ptr, message)
+            && message.isString()) {
+            const char* m = message.asCString();
+            bool invalid = strncmp(m, "INVALID_REFRESH_TOKEN", 21) == 0 || strncmp(m, "TOKEN_EXPIRED", 13) == 0;
+            if (rejected) *rejected = invalid;
+            ESP_LOGW(FIREBASE_APP_TAG, "securetoken 400: %s", m);
+        }
         return ESP_FAIL;
     }
 
     
 }
 
+void FirebaseApp::scheduleAuthRefresh(void)
+{
+    int lead_s = AUTH_REFRESH_MARGIN_S + (int)(esp_random() % (AUTH_REFRESH_JITTER_S + 1));
+    int refresh_in_s = FirebaseApp::auth_expires_in - lead_s;
+    if (refresh_in_s < FirebaseApp::auth_expires_in / 2) refresh_in_s = FirebaseApp::auth_expires_in / 2; // tokens cortos
+    FirebaseApp::auth_refresh_at_us = FirebaseApp::auth_obtained_us + (int64_t)refresh_in_s * 1000000;
+    ESP_LOGI(FIREBASE_APP_TAG, "Próxima renovación de token en %d s", refresh_in_s);
+
+    if (FirebaseApp::auth_task == nullptr) {
+        if (xTaskCreate(&FirebaseApp::authTask, "fb_auth", AUTH_TASK_STACK, this, 5, &this->auth_task) != pdPASS) {
+            FirebaseApp::auth_task = nullptr;
+            ESP_LOGE(FIREBASE_APP_TAG, "No se pudo crear la tarea de auth; sólo queda la renovación en petición");
+        }
+    } else {
+        xTaskNotifyGive(FirebaseApp::auth_task);
+    }
+}
+
+// Una sola renovación en vuelo: quien llega mientras tanto espera en refresh_mutex y, si el token
+// cambió (generation), usa el nuevo sin repetir el intercambio
+esp_err_t FirebaseApp::renewAuth(uint32_t auth_metrics_t::* origin, uint32_t generation)
+{
+    ClientLease lease(this);
+    RefreshLock refresh(this);
+    bool have_refresh_token;
+    {
+        AuthLock auth(this);
+        if (FirebaseApp::auth_generation != generation) return ESP_OK;
+        have_refresh_token = !FirebaseApp::refresh_token.empty();
+    }
+    FirebaseApp::countAuth(origin);
+    int64_t t0 = esp_timer_get_time();
+    bool rejected = !have_refresh_token;
+    esp_err_t err = have_refresh_token ? FirebaseApp::getAuthToken(&rejected) : ESP_FAIL;
+    FirebaseApp::clearHTTPBuffer();
+    // Sólo un refresh token rechazado pide login; un fallo de red se reintenta con el mismo
+    if (err != ESP_OK && rejected) {
+        if (have_refresh_token) ESP_LOGW(FIREBASE_APP_TAG, "Refresh token rechazado, intentando login completo");
+        FirebaseApp::countAuth(&auth_metrics_t::full_logins);
+        err = FirebaseApp::loginUserAccount(FirebaseApp::user_account);
+    }
+    int64_t latency_us = esp_timer_get_time() - t0;
+
+    xSemaphoreTake(FirebaseApp::auth_metrics_mutex, portMAX_DELAY);
+    auth_metrics_t& m = FirebaseApp::auth_metrics;
+    if (err == ESP_OK) m.refresh_ok++; else m.refresh_failed++;
+    m.last_latency_us = latency_us;
+    m.total_latency_us += latency_us;
+    if (latency_us > m.max_latency_us) m.max_latency_us = latency_us;
+    auth_metrics_t snapshot = m;
+    xSemaphoreGive(FirebaseApp::auth_metrics_mutex);
+    ESP_LOGI(FIREBASE_APP_TAG, "Renovación de token %s en %lld ms (ok=%u fallos=%u)",
+             err == ESP_OK ? "OK" : "fallida", (long long)(latency_us / 1000),
+             (unsigned)snapshot.refresh_ok, (unsigned)snapshot.refresh_failed);
+    return err;
+}
+
+void FirebaseApp::countAuth(uint32_t auth_metrics_t::* counter)
+{
+    xSemaphoreTake(FirebaseApp::auth_metrics_mutex, portMAX_DELAY);
+    FirebaseApp::auth_metrics.*counter += 1;
+    xSemaphoreGive(FirebaseApp::auth_metrics_mutex);
+}
+
+// Renueva en segundo plano antes de que expire el token, así las subidas no pagan un 401
+void FirebaseApp::authTask(void* arg)
+{
+    FirebaseApp* app = static_cast<FirebaseApp*>(arg);
+    int retry_s = AUTH_RETRY_MIN_S;
+    while (true) {
+        int64_t wait_us;
+        uint32_t generation;
+        {
+            AuthLock auth(app);
+            wait_us = app->auth_refresh_at_us - esp_timer_get_time();
+            generation = app->auth_generation;
+        }
+        if (wait_us <= 0) {
+            // Si otra tarea renovó mientras tanto, renewAuth no hace nada y ya hay nueva fecha
+            if (app->renewAuth(&auth_metrics_t::proactive, generation) == ESP_OK) {
+                retry_s = AUTH_RETRY_MIN_S; // getAuthToken ya reprogramó
+            } else {
+                AuthLock auth(app);
+                app->auth_refresh_at_us = esp_timer_get_time() + (int64_t)retry_s * 1000000;
+                retry_s = (retry_s * 2 > AUTH_RETRY_MAX_S) ? AUTH_RETRY_MAX_S : retry_s * 2;
+            }
+            continue;
+        }
+        // Espera acotada a 60 s: no desborda ticks y se reevalúa tras cada notificación
+        int64_t wait_ms = wait_us / 1000 + 1;
+        if (wait_ms > 60000) wait_ms = 60000;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((uint32_t)wait_ms));
+    }
+}
+
 FirebaseApp::FirebaseApp(const char* api_key)
     : api_key(api_key)
 {
     
-    FirebaseApp::local_response_buffer = new char[HTTP_RECV_BUFFER_SIZE];
+    FirebaseApp::auth_mutex = xSemaphoreCreateRecursiveMutex();
+    FirebaseApp::refresh_mutex = xSemaphoreCreateRecursiveMutex();
+    FirebaseApp::auth_metrics_mutex = xSemaphoreCreateMutex();
+    FirebaseApp::pool_mutex = xSemaphoreCreateMutex();
+    FirebaseApp::pool_slots = xSemaphoreCreateCounting(FIREBASE_HTTP_POOL_SIZE, FIREBASE_HTTP_POOL_SIZE);
+    FirebaseApp::pipeline_mutex = xSemaphoreCreateMutex();
+    FirebaseApp::compress_mutex = xSemaphoreCreateMutex();
     FirebaseApp::register_url += FirebaseApp::api_key; 
     FirebaseApp::login_url += FirebaseApp::api_key;
     FirebaseApp::auth_url += FirebaseApp::api_key;
-    firebaseClientInit();
+    FirebaseApp::openContext(FirebaseApp::pool[0]);
 }
 
 FirebaseApp::~FirebaseApp()
 {
-    delete[] FirebaseApp::local_response_buffer;
-    esp_http_client_cleanup(FirebaseApp::client);
+    if (FirebaseApp::auth_task) {
+        RefreshLock refresh(this); // no matar la tarea a mitad de una renovación
+        vTaskDelete(FirebaseApp::auth_task);
+        FirebaseApp::auth_task = nullptr;
+    }
+    for (http_context_t& ctx : FirebaseApp::pool) FirebaseApp::closeContext(ctx);
+    vSemaphoreDelete(FirebaseApp::auth_mutex);
+    vSemaphoreDelete(FirebaseApp::refresh_mutex);
+    vSemaphoreDelete(FirebaseApp::auth_metrics_mutex);
+    vSemaphoreDelete(FirebaseApp::pool_mutex);
+    vSemaphoreDelete(FirebaseApp::pool_slots);
+    vSemaphoreDelete(FirebaseApp::pipeline_mutex);
+    vSemaphoreDelete(FirebaseApp::compress_mutex);
 }
 
 esp_err_t FirebaseApp::registerUserAccount(const user_account_t& account)
 {
-    if (FirebaseApp::user_account.user_email != account.user_email || FirebaseApp::user_account.user_password != account.user_password)
+    ClientLease lease(this);
+    RefreshLock refresh(this);
     {
-        FirebaseApp::user_account.user_email = account.user_email;
-        FirebaseApp::user_account.user_password = account.user_password;
+        AuthLock auth(this);
+        if (FirebaseApp::user_account.user_email != account.user_email || FirebaseApp::user_account.user_password != account.user_password)
+        {
+            FirebaseApp::user_account.user_email = account.user_email;
+            FirebaseApp::user_account.user_password = account.user_password;
+        }
     }
     esp_err_t err = FirebaseApp::getRefreshToken(true);
     if (err != ESP_OK)
@@ -308,10 +809,15 @@ esp_err_t FirebaseApp::registerUserAccount(const user_account_t& account)
 
 esp_err_t FirebaseApp::loginUserAccount(const user_account_t& account)
 {
-    if (FirebaseApp::user_account.user_email != account.user_email || FirebaseApp::user_account.user_password != account.user_password)
+    ClientLease lease(this);
+    RefreshLock refresh(this);
     {
-        FirebaseApp::user_account.user_email = account.user_email;
-        FirebaseApp::user_account.user_password = account.user_password;
+        AuthLock auth(this);
+        if (FirebaseApp::user_account.user_email != account.user_email || FirebaseApp::user_account.user_password != account.user_password)
+        {
+            FirebaseApp::user_account.user_email = account.user_email;
+            FirebaseApp::user_account.user_password = account.user_password;
+        }
     }
     esp_err_t err = FirebaseApp::getRefreshToken(false);
     if (err != ESP_OK)
@@ -334,37 +840,41 @@ esp_err_t FirebaseApp::loginUserAccount(const user_account_t& account)
 
 esp_err_t FirebaseApp::refreshAuthIfNeeded()
 {
-    if (FirebaseApp::auth_token.empty()) {
-        ESP_LOGW(FIREBASE_APP_TAG, "No auth token yet, logging in again");
-        return FirebaseApp::loginUserAccount(FirebaseApp::user_account);
+    uint32_t generation;
+    bool no_token;
+    int remaining = 0;
+    {
+        AuthLock auth(this);
+        generation = FirebaseApp::auth_generation;
+        no_token = FirebaseApp::auth_token.empty();
+        if (!no_token) {
+            if (FirebaseApp::auth_expires_in <= 0) return ESP_OK; // sin info, confiar
+            int elapsed = (int)((esp_timer_get_time() - FirebaseApp::auth_obtained_us) / 1000000);
+            remaining = FirebaseApp::auth_expires_in - elapsed;
+        }
     }
-    time_t now = time(NULL);
-    if (FirebaseApp::auth_expires_in <= 0) return ESP_OK; // sin info, confiar
-    int elapsed = (int)(now - FirebaseApp::auth_obtained_time);
-    int remaining = FirebaseApp::auth_expires_in - elapsed;
-    if (remaining < 30) { // menos de 30s, renovar
+    if (no_token) {
+        ESP_LOGW(FIREBASE_APP_TAG, "No auth token yet, logging in again");
+    } else if (remaining < 30) { // la tarea de fondo no llegó a tiempo: renovar aquí
         ESP_LOGI(FIREBASE_APP_TAG, "Auth token a punto de expirar (%d s). Renovando...", remaining);
-        if (FirebaseApp::getAuthToken() == ESP_OK) {
-            FirebaseApp::clearHTTPBuffer();
-            return ESP_OK;
-        } else {
-            ESP_LOGW(FIREBASE_APP_TAG, "Fallo refresh directo, intentando login completo");
-            esp_err_t err = FirebaseApp::loginUserAccount(FirebaseApp::user_account);
-            return err;
-        }
+    } else {
+        return ESP_OK;
     }
-    return ESP_OK;
+    return FirebaseApp::renewAuth(&auth_metrics_t::on_demand, generation);
 }
 
-esp_err_t FirebaseApp::forceRefreshAuth()
+esp_err_t FirebaseApp::forceRefreshAuth(uint32_t generation)
 {
     ESP_LOGI(FIREBASE_APP_TAG, "Forzando refresh de auth token...");
-    if (FirebaseApp::getAuthToken() == ESP_OK) {
-        FirebaseApp::clearHTTPBuffer();
-        return ESP_OK;
-    }
-    ESP_LOGW(FIREBASE_APP_TAG, "Fallo refresh directo, intentando login completo");
-    return FirebaseApp::loginUserAccount(FirebaseApp::user_account);
+    return FirebaseApp::renewAuth(&auth_metrics_t::forced, generation);
+}
+
+auth_metrics_t FirebaseApp::getAuthMetrics()
+{
+    xSemaphoreTake(FirebaseApp::auth_metrics_mutex, portMAX_DELAY);
+    auth_metrics_t m = FirebaseApp::auth_metrics;
+    xSemaphoreGive(FirebaseApp::auth_metrics_mutex);
+    return m;
 }
 
 
@@ -1,12 +1,24 @@
 #ifndef _ESP_FIREBASE_H_
 #define  _ESP_FIREBASE_H_
 #include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <memory>
 #include <string>
 
+#include "json.h"
+
 
 // Buffer de recepción HTTP ampliado para respuestas más grandes
 #define HTTP_RECV_BUFFER_SIZE 16384
 
+// Contextos HTTP concurrentes. El 0 vive siempre; los demás se abren sólo cuando hay
+// contención y se liberan al soltarlos (keep-alive está apagado, no se pierde nada)
+#ifndef FIREBASE_HTTP_POOL_SIZE
+#define FIREBASE_HTTP_POOL_SIZE 2
+#endif
+
 namespace ESPFirebase 
 {
 
@@ -16,11 +28,106 @@ namespace ESPFirebase
         const char* user_password;
     };
     
+    // Clase de fallo de una petición: decide si performRequest reintenta
+    enum class http_error_class_t
+    {
+        none,           // 2xx
+        transport,      // conexión/socket/timeout: se reintenta
+        tls,            // handshake o lectura TLS: se reintenta
+        dns,            // no resolvió el host: se reintenta
+        server_error,   // 5xx (y 408): se reintenta
+        throttled,      // 429: se reintenta respetando Retry-After
+        client_error,   // resto de 4xx: no se reintenta (401 lo maneja RTDB)
+    };
+
     struct http_ret_t
     {
         esp_err_t err;
         int status_code;
+        http_error_class_t error_class;
+        size_t rx_bytes;            // bytes de cuerpo recibidos, sumando todos los intentos
     }; 
+
+    // Política de reintentos de performRequest: backoff exponencial con "full jitter"
+    // acotado por un presupuesto total por petición (intentos + esperas)
+    struct retry_policy_t
+    {
+        int max_attempts;
+        int base_delay_ms;   // tope de espera tras el primer fallo; se duplica en cada intento
+        int max_delay_ms;    // tope del backoff exponencial
+        int deadline_ms;     // presupuesto total; si el timeout HTTP es mayor, manda el timeout
+    };
+
+    // Una petición de un lote segmentado (pipelining HTTP/1.1); err/status_code/rx_bytes son salida
+    struct pipeline_item_t
+    {
+        esp_http_client_method_t method;    // PUT, PATCH o DELETE (idempotentes: se pueden reenviar)
+        const char* url;                    // mismo esquema://host:puerto en todo el lote
+        const char* body;
+        size_t body_len;
+        esp_err_t err;
+        int status_code;
+        size_t rx_bytes;
+        int64_t done_us;                    // esp_timer al recibir su respuesta
+    };
+
+    struct pipeline_metrics_t
+    {
+        uint32_t batches;
+        uint32_t pipelined;         // respondidas por la conexión segmentada
+        uint32_t serial;            // enviadas con performRequest tras un fallo (o lote no apto)
+        uint32_t fallbacks;         // lotes que cayeron a modo serie
+        uint32_t max_in_flight;
+    };
+
+    // 4xx a un cuerpo gzip: el endpoint no lo acepta (RTDB responde 400 al no poder leerlo, otros 415).
+    // 401, 408 y 429 no dicen nada del cuerpo y siguen su camino normal
+    inline bool gzipRejected(int status_code)
+    {
+        return status_code >= 400 && status_code < 500 && status_code != 401 && status_code != 408 && status_code != 429;
+    }
+
+    // Compresión gzip de cuerpos de petición (ver FirebaseApp::setRequestCompression)
+    struct compression_metrics_t
+    {
+        uint32_t compressed;        // cuerpos enviados con Content-Encoding: gzip
+        uint32_t not_smaller;       // comprimirlos no ganaba: se enviaron tal cual
+        uint32_t rejected;          // 4xx a un cuerpo gzip: se reenvió sin comprimir y se desactivó
+        uint64_t raw_bytes;         // entrada del compresor (cuerpos >= umbral)
+        uint64_t wire_bytes;        // lo enviado por esos cuerpos; wire_bytes / raw_bytes = ratio
+        int64_t cpu_us;             // tiempo comprimiendo; cpu_us * 1024 / raw_bytes = µs por KB
+    };
+
+    // Métricas del planificador de renovación del token
+    struct auth_metrics_t
+    {
+        uint32_t refresh_ok;        // renovaciones correctas (cualquier origen)
+        uint32_t refresh_failed;    // renovaciones fallidas (incluido el login de respaldo)
+        uint32_t proactive;         // lanzadas por la tarea de fondo antes de expirar
+        uint32_t on_demand;         // síncronas en el camino de una petición (token casi vencido)
+        uint32_t forced;            // forceRefreshAuth(): 401 o llamada externa
+        uint32_t full_logins;       // respaldo con email/password
+        int64_t last_latency_us;    // duración de la última renovación
+        int64_t max_latency_us;
+        int64_t total_latency_us;   // total / (refresh_ok + refresh_failed) = media
+    };
+
+    // Cliente + buffer de recepción + estado del handler de eventos: uno por petición en curso
+    struct http_context_t
+    {
+        esp_http_client_handle_t client;
+        char* response_buffer;
+        Json::CharReader* json_reader;  // lector strict-trusted propio (no es reentrante)
+        int output_len;
+        int retry_after_s;          // cabecera Retry-After (segundos) de la última respuesta
+        int current_timeout_ms;
+        TaskHandle_t owner;         // tarea que lo tiene prestado
+        int depth;                  // préstamos anidados de la misma tarea
+        bool discard_body;          // no copia cuerpos 2xx al buffer (escrituras sin eco)
+        size_t rx_bytes;            // bytes de cuerpo recibidos en la petición en curso
+        char etag[64];              // cabecera ETag de la última respuesta ("" si no vino)
+    };
+
     /**
      * @brief Class over the esp_http_client, handles auth and should be passed as ptr to other classes such as RTDB 
      * 
@@ -33,51 +140,196 @@ namespace ESPFirebase
             std::string login_url = "https://identitytoolkit.googleapis.com/v1/accounts:signInWithPassword?key=";
             std::string auth_url = "https://securetoken.googleapis.com/v1/token?key=";
             std::string refresh_token = "";
-            esp_http_client_handle_t client;
-            bool client_initialized = false;
-            // Control de expiración
-            time_t auth_obtained_time = 0;   // epoch cuando se obtuvo el access token
+            std::string auth_query = "";
+            http_context_t pool[FIREBASE_HTTP_POOL_SIZE] = {};
+            SemaphoreHandle_t pool_slots = nullptr;   // admisión: cuenta contextos libres
+            SemaphoreHandle_t pool_mutex = nullptr;   // protege owner/depth
+            // Control de expiración (reloj monotónico: SNTP no lo desplaza)
+            int64_t auth_obtained_us = 0;    // esp_timer cuando se obtuvo el access token
             int auth_expires_in = 0;         // segundos que dura el token
+            int64_t auth_refresh_at_us = 0;  // próxima renovación proactiva (con jitter)
+
+            std::string auth_token = "";
+            uint32_t auth_generation = 0;    // +1 con cada token nuevo: junta renovaciones concurrentes
+
+            // Protege tokens, query, expiración y cuenta; nunca se retiene durante E/S de red.
+            // Orden: ClientLease, RefreshLock, AuthLock
+            SemaphoreHandle_t auth_mutex = nullptr;
+            // Una renovación/login en vuelo (con E/S); las peticiones con token vigente no lo tocan
+            SemaphoreHandle_t refresh_mutex = nullptr;
+            TaskHandle_t auth_task = nullptr;
+            SemaphoreHandle_t auth_metrics_mutex = nullptr;   // protege auth_metrics
+            auth_metrics_t auth_metrics = {};
 
             int default_timeout_ms = 20000;
+            retry_policy_t retry_policy = {5, 500, 8000, 60000};
+            int pipeline_window = 4;
+            SemaphoreHandle_t pipeline_mutex = nullptr;   // protege pipeline_metrics
+            pipeline_metrics_t pipeline_metrics = {};
+            size_t compress_threshold = 0;                // 0 = sin compresión
+            size_t compress_window = 2048;
+            SemaphoreHandle_t compress_mutex = nullptr;   // protege compression_metrics
+            compression_metrics_t compression_metrics = {};
 
-            void firebaseClientInit(void);
+            bool openContext(http_context_t& ctx);
+            void closeContext(http_context_t& ctx);
+            http_context_t* acquireContext(void);
+            void releaseContext(http_context_t* ctx);
+            // gzip de un cuerpo >= compress_threshold en out; false si está apagado o no compensa
+            bool compressBody(const char* body, size_t len, std::string& out);
+            // gzipRejected(status_code) con un cuerpo gzip: se apaga la compresión
+            void rejectCompression(int status_code);
         
             esp_err_t getRefreshToken(bool register_account);
-            esp_err_t getAuthToken();
+            // rejected (opcional) = securetoken dio por inválido el refresh token (400 INVALID_REFRESH_TOKEN
+            // o TOKEN_EXPIRED): sólo entonces hace falta un login completo
+            esp_err_t getAuthToken(bool* rejected = nullptr);
+            void scheduleAuthRefresh(void);
+            // getAuthToken (con login sólo si rechaza el refresh token), midiendo latencia; origin = contador de métricas.
+            // No hace nada si el token ya no es el de generation (otra tarea renovó)
+            esp_err_t renewAuth(uint32_t auth_metrics_t::* origin, uint32_t generation);
+            void countAuth(uint32_t auth_metrics_t::* counter);
+            static void authTask(void* arg);
             
 
         public:
+            /**
+             * @brief Préstamo RAII de un contexto HTTP del pool. Una operación RTDB lo mantiene
+             *        mientras usa setHeader/performRequest/parseResponse/clearHTTPBuffer, que
+             *        actúan sobre el contexto de la tarea llamante. Es reentrante por tarea.
+             */
+            class ClientLease
+            {
+            public:
+                explicit ClientLease(FirebaseApp* app) : app(app), ctx(app->acquireContext()) {}
+                ~ClientLease() { app->releaseContext(ctx); }
+                ClientLease(const ClientLease&) = delete;
+                ClientLease& operator=(const ClientLease&) = delete;
+                http_context_t* context() const { return ctx; }
+            private:
+                FirebaseApp* app;
+                http_context_t* ctx;
+            };
+
+            class AuthLock
+            {
+            public:
+                explicit AuthLock(FirebaseApp* app) : app(app) { xSemaphoreTakeRecursive(app->auth_mutex, portMAX_DELAY); }
+                ~AuthLock() { xSemaphoreGiveRecursive(app->auth_mutex); }
+                AuthLock(const AuthLock&) = delete;
+                AuthLock& operator=(const AuthLock&) = delete;
+            private:
+                FirebaseApp* app;
+            };
+
+            class RefreshLock
+            {
+            public:
+                explicit RefreshLock(FirebaseApp* app) : app(app) { xSemaphoreTakeRecursive(app->refresh_mutex, portMAX_DELAY); }
+                ~RefreshLock() { xSemaphoreGiveRecursive(app->refresh_mutex); }
+                RefreshLock(const RefreshLock&) = delete;
+                RefreshLock& operator=(const RefreshLock&) = delete;
+            private:
+                FirebaseApp* app;
+            };
+
             user_account_t user_account = {"", ""};
 
-            char* local_response_buffer;
+            // Añade "auth=<token>" (cacheado al renovar) a la query de RTDB.
+            // RTDB no acepta el ID token de Firebase en "Authorization: Bearer" (sólo tokens OAuth2),
+            // así que viaja en la URL y no se debe registrar en logs.
+            // Devuelve la generación del token añadido: es la que se pasa a forceRefreshAuth tras un 401.
+            uint32_t appendAuthQuery(std::string& url);
+            size_t authQueryLength(void);
 
-            std::string auth_token = "";
+            // Buffer de respuesta del contexto prestado a la tarea llamante ("" si no tiene)
+            const char* responseBuffer(void);
+            // ETag de la última respuesta en ese mismo contexto ("" si no vino)
+            const char* responseETag(void);
 
             /**
-             * @brief Standard http request. Use after firebaseClientInit(). response stored in local_response_buffer. 
+             * @brief Standard http request on the caller's pooled context. Response stored in its buffer. 
              * 
              * @param url Request url
              * @param method Request method
              * @param post_field Optional post field. Used when method is POST
              * @return Returns struct http_ret_t: esp_err_t + http status code.
              */
-            http_ret_t performRequest(const char* url, esp_http_client_method_t method, std::string post_field = "");
+            http_ret_t performRequest(const char* url, esp_http_client_method_t method, const std::string& post_field = "");
+            // Igual que arriba pero sin copiar el body (esp_http_client guarda el puntero)
+            http_ret_t performRequest(const char* url, esp_http_client_method_t method, const char* post_field, size_t post_len);
             esp_err_t setHeader(const char* header, const char* value);
+            esp_err_t deleteHeader(const char* header);
             
             void clearHTTPBuffer(void);
+            // Con true, las respuestas 2xx sólo se cuentan, no se copian; las de error sí (para el log)
+            void setDiscardResponseBody(bool discard);
+
+            /**
+             * @brief Parsea el buffer de respuesta con el lector strict-trusted (sin comentarios ni extensiones).
+             * 
+             * @param out Valor destino
+             * @return true si el documento es JSON válido
+             */
+            bool parseResponse(Json::Value& out);
+            // Igual que parseResponse pero sobre un texto cualquiera (p. ej. el de la caché de RTDB)
+            bool parseJson(const char* begin, const char* end, Json::Value& out);
+
+            /**
+             * @brief Parsea sólo el valor apuntado por ptr dentro del buffer de respuesta;
+             *        el resto del documento se recorre sin construir el árbol.
+             * 
+             * @param ptr JSON Pointer precompilado (RFC 6901)
+             * @param out Valor destino
+             * @return true si el camino existe y su valor es JSON válido
+             */
+            bool parseResponseAt(const Json::Pointer& ptr, Json::Value& out);
 
             void setHttpTimeoutMs(int ms);
             void restoreDefaultHttpTimeout();
+            void setRetryPolicy(const retry_policy_t& policy);
+            // Login y renovación contra el emulador de Firebase Auth (origin = "http://host:9099")
+            // en lugar de identitytoolkit/securetoken: banco de pruebas y tests de host
+            void useAuthEmulator(const char* origin);
+
+            /**
+             * @brief Envía con Content-Encoding: gzip los cuerpos PUT/POST/PATCH de al menos
+             *        threshold bytes (backlogs, mapas de nulls de trimOldestBatch), si el resultado
+             *        es menor. Si el servidor lo rechaza con un 4xx (ver gzipRejected) se reenvía
+             *        una vez sin comprimir y se apaga.
+             * 
+             * @param threshold Tamaño mínimo en bytes; 0 desactiva (por defecto)
+             * @param window Ventana LZ77 en bytes (memoria de trabajo: 4 KB + 4 B por byte)
+             */
+            void setRequestCompression(size_t threshold, size_t window = 2048);
+            compression_metrics_t getCompressionMetrics();
+
+            /**
+             * @brief Envía un lote por una sola conexión keep-alive escribiendo hasta
+             *        pipeline_window peticiones antes de leer respuestas, emparejadas en orden.
+             *        Los cuerpos de respuesta se descartan. Ante cualquier error de conexión o
+             *        de parseo, o si el servidor cierra, lo que falta se envía en serie con
+             *        performRequest (con sus reintentos).
+             * 
+             * @return ESP_OK si todas respondieron 2xx; el detalle queda en cada item
+             */
+            esp_err_t performPipelined(pipeline_item_t* items, size_t count);
+            // Peticiones en vuelo por conexión; 1 = modo serie
+            void setPipelineWindow(int window);
+            pipeline_metrics_t getPipelineMetrics();
             
             FirebaseApp(const char * api_key);
             ~FirebaseApp();
             esp_err_t registerUserAccount(const user_account_t& account);
             esp_err_t loginUserAccount(const user_account_t& account);
-            // Comprueba y renueva si faltan <30s
+            // Red de seguridad en el camino de la petición: renueva si faltan <30s
+            // (normalmente la tarea de fondo ya lo hizo antes)
             esp_err_t refreshAuthIfNeeded();
-            // Forzar refresh inmediato (si falla intentará login)
-            esp_err_t forceRefreshAuth();
+            // Forzar refresh tras un 401. generation = la de appendAuthQuery al armar la URL rechazada:
+            // si otra tarea ya renovó desde entonces, no se repite el intercambio
+            esp_err_t forceRefreshAuth(uint32_t generation);
+            uint32_t authGeneration(void);
+            auth_metrics_t getAuthMetrics();
         };
 }
 
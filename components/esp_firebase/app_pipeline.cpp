@@ -0,0 +1,204 @@
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "esp_log.h"
+#include "esp_tls.h"
+#include "esp_timer.h"
+
+#include "app.h"
+#include "http_conn.h"
+#define FIREBASE_APP_TAG "FirebaseApp"
+
+#define PIPELINE_MAX_WINDOW 16
+
+namespace ESPFirebase {
+
+static const char* methodName(esp_http_client_method_t method)
+{
+    switch (method) {
+        case HTTP_METHOD_PUT: return "PUT";
+        case HTTP_METHOD_PATCH: return "PATCH";
+        case HTTP_METHOD_DELETE: return "DELETE";
+        default: return nullptr;   // POST no es idempotente: no se segmenta
+    }
+}
+
+// Transitorios (5xx, 429...) y rechazos del cuerpo gzip: en serie, performRequest reintenta o lo manda plano
+static bool resendSerial(int status_code, bool gzipped)
+{
+    return status_code < 0 || status_code >= 500 || status_code == 429 || status_code == 408
+           || (gzipped && gzipRejected(status_code));
+}
+
+// body/body_len pueden ser la versión gzip del cuerpo del item
+static bool sendRequest(esp_tls_t* tls, const origin_t& o, const pipeline_item_t& item,
+                        const char* body, size_t body_len, bool gzip, std::string& scratch)
+{
+    char length[16];
+    snprintf(length, sizeof(length), "%u", (unsigned)body_len);
+    const char* path = item.url + o.prefix_len;
+    scratch.clear();
+    scratch.append(methodName(item.method)).append(" ").append(path).append(" HTTP/1.1\r\nHost: ")
+           .append(o.host, o.host_len).append("\r\nContent-Type: application/json\r\n");
+    if (gzip) scratch.append("Content-Encoding: gzip\r\n");
+    scratch.append("Content-Length: ").append(length).append("\r\n\r\n");
+    return writeAll(tls, scratch.data(), scratch.size()) && writeAll(tls, body, body_len);
+}
+
+// Status + cabeceras + cuerpo descartado. keep_open = false si el servidor anunció cierre
+static bool readResponse(ResponseReader& reader, pipeline_item_t& item, bool& keep_open, std::string& line)
+{
+    int status;
+    do {
+        if (!reader.readLine(line) || strncmp(line.c_str(), "HTTP/1.", 7) != 0 || line.size() < 12) return false;
+        status = atoi(line.c_str() + 9);
+        if (status >= 100 && status < 200) {
+            // 1xx informativo: sus cabeceras se saltan y sigue la respuesta real
+            do { if (!reader.readLine(line)) return false; } while (!line.empty());
+        }
+    } while (status >= 100 && status < 200);
+
+    long long content_length = -1;
+    bool chunked = false;
+    while (true) {
+        if (!reader.readLine(line)) return false;
+        if (line.empty()) break;
+        const char* h = line.c_str();
+        if (strncasecmp(h, "Content-Length:", 15) == 0) content_length = atoll(h + 15);
+        else if (strncasecmp(h, "Transfer-Encoding:", 18) == 0 && headerHas(h + 18, "chunked")) chunked = true;
+        else if (strncasecmp(h, "Connection:", 11) == 0 && headerHas(h + 11, "close")) keep_open = false;
+    }
+
+    size_t body = 0;
+    if (status == 204 || status == 304) {
+        // sin cuerpo por definición
+    } else if (chunked) {
+        while (true) {
+            if (!reader.readLine(line)) return false;
+            size_t n = (size_t)strtoul(line.c_str(), nullptr, 16);
+            if (n == 0) {
+                do { if (!reader.readLine(line)) return false; } while (!line.empty());   // trailers
+                break;
+            }
+            if (!reader.skip(n + 2)) return false;   // datos + CRLF
+            body += n;
+        }
+    } else if (content_length >= 0) {
+        if (!reader.skip((size_t)content_length)) return false;
+        body = (size_t)content_length;
+    } else {
+        return false;   // cuerpo hasta el cierre: no deja seguir segmentando
+    }
+    item.err = ESP_OK;
+    item.status_code = status;
+    item.rx_bytes = body;
+    item.done_us = esp_timer_get_time();
+    return true;
+}
+
+esp_err_t FirebaseApp::performPipelined(pipeline_item_t* items, size_t count)
+{
+    // El préstamo acota las conexiones simultáneas (memoria TLS) igual que una petición normal
+    ClientLease lease(this);
+    const int timeout_ms = lease.context() ? lease.context()->current_timeout_ms : FirebaseApp::default_timeout_ms;
+    int window = FirebaseApp::pipeline_window < PIPELINE_MAX_WINDOW ? FirebaseApp::pipeline_window : PIPELINE_MAX_WINDOW;
+    for (size_t i = 0; i < count; ++i) {
+        items[i].err = ESP_FAIL;
+        items[i].status_code = -1;
+        items[i].rx_bytes = 0;
+        items[i].done_us = 0;
+    }
+
+    origin_t origin;
+    bool eligible = count > 1 && window > 1 && parseOrigin(items[0].url, origin);
+    for (size_t i = 0; eligible && i < count; ++i) {
+        eligible = methodName(items[i].method) && strncmp(items[i].url, items[0].url, origin.prefix_len) == 0
+                   && items[i].url[origin.prefix_len] == '/';
+    }
+
+    size_t done = 0;
+    uint32_t max_in_flight = 0;
+    std::vector<bool> gzipped(count, false);
+    if (eligible) {
+        esp_tls_t* tls = connectOrigin(origin, timeout_ms);
+        if (tls) {
+            ResponseReader reader(tls);
+            std::string scratch;
+            std::string gz;
+            size_t sent = 0;
+            bool keep_open = true;
+            while (done < count && keep_open) {
+                // Llena la ventana y después lee la respuesta más antigua
+                while (sent < count && sent - done < (size_t)window) {
+                    const pipeline_item_t& item = items[sent];
+                    bool gzip = FirebaseApp::compressBody(item.body, item.body_len, gz);
+                    gzipped[sent] = gzip;
+                    if (!sendRequest(tls, origin, item, gzip ? gz.data() : item.body,
+                                     gzip ? gz.size() : item.body_len, gzip, scratch)) break;
+                    ++sent;
+                }
+                if (sent - done > max_in_flight) max_in_flight = (uint32_t)(sent - done);
+                if (sent == done || !readResponse(reader, items[done], keep_open, scratch)) break;
+                // Lo que ya va en vuelo comprimido recibirá el mismo rechazo y pasará a serie; lo siguiente sale sin gzip
+                if (gzipped[done] && gzipRejected(items[done].status_code) && FirebaseApp::compress_threshold) {
+                    FirebaseApp::rejectCompression(items[done].status_code);
+                }
+                // Con 401 todas las que siguen fallarán igual: el que llama renueva el token
+                if (items[done++].status_code == 401) break;
+            }
+        } else {
+            ESP_LOGW(FIREBASE_APP_TAG, "pipeline: sin conexión a %.*s", origin.host_len, origin.host);
+        }
+        if (tls) esp_tls_conn_destroy(tls);
+    }
+
+    // En serie: lo que quedó sin respuesta y lo que falló con un error transitorio (5xx, 429...),
+    // que así recibe los reintentos de performRequest, o con el gzip rechazado. PUT/PATCH/DELETE se pueden repetir
+    size_t pipelined = 0;
+    for (size_t i = 0; i < done; ++i) {
+        if (!resendSerial(items[i].status_code, gzipped[i])) pipelined++;
+    }
+    size_t serial = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (items[i].status_code == 401) break;
+        if (i < done && !resendSerial(items[i].status_code, gzipped[i])) continue;
+        serial++;
+        http_ret_t r = FirebaseApp::performRequest(items[i].url, items[i].method, items[i].body, items[i].body_len);
+        items[i].err = r.err;
+        items[i].status_code = r.status_code;
+        items[i].rx_bytes = r.rx_bytes;
+        items[i].done_us = esp_timer_get_time();
+        if (r.status_code == 401) break;
+    }
+
+    xSemaphoreTake(FirebaseApp::pipeline_mutex, portMAX_DELAY);
+    pipeline_metrics_t& m = FirebaseApp::pipeline_metrics;
+    m.batches++;
+    m.pipelined += (uint32_t)pipelined;
+    m.serial += (uint32_t)serial;
+    if (eligible && serial > 0) m.fallbacks++;
+    if (max_in_flight > m.max_in_flight) m.max_in_flight = max_in_flight;
+    xSemaphoreGive(FirebaseApp::pipeline_mutex);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (items[i].err != ESP_OK || items[i].status_code / 100 != 2) return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void FirebaseApp::setPipelineWindow(int window)
+{
+    FirebaseApp::pipeline_window = window < 1 ? 1 : window;
+}
+
+pipeline_metrics_t FirebaseApp::getPipelineMetrics()
+{
+    xSemaphoreTake(FirebaseApp::pipeline_mutex, portMAX_DELAY);
+    pipeline_metrics_t m = FirebaseApp::pipeline_metrics;
+    xSemaphoreGive(FirebaseApp::pipeline_mutex);
+    return m;
+}
+
+}
@@ -1,5 +1,10 @@
 #include "app.h"
 #include "rtdb.h"
+#include "firebase.h"
+#include <memory>
+#include <cstring>
+#include <type_traits>
+#include <cstdlib>
 #include <string>
 
 // Acceso a claves privadas centralizadas
@@ -35,12 +40,27 @@ int firebase_init(void) {
 
 int firebase_refresh_token(void) {
 	if (!g_app) return -1;
-	// Forzamos refresh usando el refresh_token almacenado;
-	// si falla, intenta login completo.
-	if (g_app->forceRefreshAuth() == ESP_OK) return 0;
+	// Forzamos refresh del token vigente con el refresh_token almacenado;
+	// sólo si securetoken lo rechaza, intenta login completo.
+	if (g_app->forceRefreshAuth(g_app->authGeneration()) == ESP_OK) return 0;
 	return -2;
 }
 
+int firebase_get_auth_metrics(firebase_auth_metrics_t* out) {
+	if (!g_app || !out) return -1;
+	auth_metrics_t m = g_app->getAuthMetrics();
+	out->refresh_ok = m.refresh_ok;
+	out->refresh_failed = m.refresh_failed;
+	out->proactive = m.proactive;
+	out->on_demand = m.on_demand;
+	out->forced = m.forced;
+	out->full_logins = m.full_logins;
+	out->last_latency_us = m.last_latency_us;
+	out->max_latency_us = m.max_latency_us;
+	out->total_latency_us = m.total_latency_us;
+	return 0;
+}
+
 int firebase_push(const char* path, const char* json) {
 	if (!g_rtdb) return -1;
 	// RTDB::postData corresponds to push semantics
@@ -54,6 +74,22 @@ int firebase_putData(const char* path, const char* json) {
 	return err == ESP_OK ? 0 : (int)err;
 }
 
+int firebase_putCbor(const char* path, const uint8_t* cbor, size_t len) {
+	if (!g_rtdb) return -1;
+	Json::CborCharReaderBuilder reader_builder;
+	std::unique_ptr<Json::CharReader> reader(reader_builder.newCharReader());
+	Json::Value data;
+	const char* begin = reinterpret_cast<const char*>(cbor);
+	if (!reader->parse(begin, begin + len, &data, nullptr)) return -3;
+	// 15 dígitos significativos: los reales redondeados (23.46) salen igual que en el JSON por snprintf
+	Json::StreamWriterBuilder writer_builder;
+	writer_builder["indentation"] = "";
+	writer_builder["precision"] = 15;
+	std::string json = Json::writeString(writer_builder, data);
+	esp_err_t err = g_rtdb->putData(path, json.c_str());
+	return err == ESP_OK ? 0 : (int)err;
+}
+
 int firebase_delete(const char* path) {
 	if (!g_rtdb) return -1;
 	esp_err_t err = g_rtdb->deleteData(path);
@@ -71,5 +107,97 @@ int firebase_trim_oldest_batch(const char* root_path, int batch_size) {
     return g_rtdb->trimOldestBatch(root_path, batch_size);
 }
 
+static_assert(FIREBASE_UPLINK_HIST_BUCKETS == RTDB_UPLINK_HIST_BUCKETS, "histograma C/C++ distinto");
+static_assert(sizeof(firebase_uplink_metrics_t) == sizeof(rtdb_uplink_metrics_t), "métricas C/C++ distintas");
+
+// esp_err_t es int en ESP-IDF: el callback C es el mismo tipo que rtdb_done_cb_t
+static_assert(std::is_same<firebase_done_cb_t, rtdb_done_cb_t>::value, "callback C/C++ distinto");
+
+static rtdb_priority_t to_rtdb_prio(int prio) {
+    if (prio <= FIREBASE_PRIO_RETENTION) return rtdb_priority_t::retention;
+    if (prio >= FIREBASE_PRIO_MEASUREMENT) return rtdb_priority_t::measurement;
+    return rtdb_priority_t::normal;
+}
+
+uint32_t firebase_putData_async(const char* path, const char* json, int prio, uint32_t deadline_ms,
+                                firebase_done_cb_t cb, void* ctx) {
+    if (!g_rtdb) return 0;
+    return g_rtdb->putDataAsync(path, json, cb, ctx, to_rtdb_prio(prio), deadline_ms);
+}
+
+uint32_t firebase_trim_oldest_batch_async(const char* root_path, int batch_size, int prio, uint32_t deadline_ms,
+                                          firebase_done_cb_t cb, void* ctx) {
+    if (!g_rtdb) return 0;
+    return g_rtdb->trimOldestBatchAsync(root_path, batch_size, cb, ctx, to_rtdb_prio(prio), deadline_ms);
+}
+
+int firebase_cancel(uint32_t id) {
+    if (!g_rtdb) return -1;
+    return g_rtdb->cancel(id) ? 0 : -2;
+}
+
+static_assert(std::is_same<firebase_listen_cb_t, rtdb_listen_cb_t>::value, "callback C/C++ distinto");
+
+void* firebase_listen(const char* path, firebase_listen_cb_t cb, void* ctx) {
+    if (!g_rtdb || !cb) return nullptr;
+    return g_rtdb->listen(path, cb, ctx);
+}
+
+void firebase_unlisten(void* listener) {
+    if (!g_rtdb) return;
+    g_rtdb->unlisten(static_cast<rtdb_listener_t*>(listener));
+}
+
+int firebase_json_get_number(const char* json, size_t len, const char* pointer, double* out) {
+    if (!json || !pointer || !out) return -1;
+    Json::Pointer ptr(pointer);
+    const char* vb;
+    const char* ve;
+    if (!ptr.findSpan(json, json + len, &vb, &ve)) return -2;
+    // Sólo números: un span que no empieza como número no se convierte
+    if (!(*vb == '-' || (*vb >= '0' && *vb <= '9'))) return -3;
+    std::string num(vb, ve);
+    *out = strtod(num.c_str(), nullptr);
+    return 0;
+}
+
+int firebase_get_write_metrics(firebase_write_metrics_t* out) {
+    if (!g_rtdb || !out) return -1;
+    rtdb_write_metrics_t m = g_rtdb->getWriteMetrics();
+    out->writes = m.writes;
+    out->failed = m.failed;
+    out->tx_bytes = m.tx_bytes;
+    out->rx_bytes = m.rx_bytes;
+    out->last_latency_us = m.last_latency_us;
+    out->max_latency_us = m.max_latency_us;
+    out->total_latency_us = m.total_latency_us;
+    return 0;
+}
+
+int firebase_set_request_compression(size_t threshold) {
+    if (!g_app) return -1;
+    g_app->setRequestCompression(threshold);
+    return 0;
+}
+
+int firebase_get_compression_metrics(firebase_compression_metrics_t* out) {
+    if (!g_app || !out) return -1;
+    compression_metrics_t m = g_app->getCompressionMetrics();
+    out->compressed = m.compressed;
+    out->not_smaller = m.not_smaller;
+    out->rejected = m.rejected;
+    out->raw_bytes = m.raw_bytes;
+    out->wire_bytes = m.wire_bytes;
+    out->cpu_us = m.cpu_us;
+    return 0;
+}
+
+int firebase_get_uplink_metrics(firebase_uplink_metrics_t* out) {
+    if (!g_rtdb || !out) return -1;
+    rtdb_uplink_metrics_t m = g_rtdb->getUplinkMetrics();
+    memcpy(out, &m, sizeof(*out));
+    return 0;
+}
+
 }
 
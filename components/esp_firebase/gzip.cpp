@@ -0,0 +1,184 @@
+#include <string.h>
+#include <new>
+#include "esp_rom_crc.h"
+
+#include "gzip.h"
+
+#define GZIP_HASH_BITS 10
+#define GZIP_MIN_MATCH 3
+#define GZIP_MAX_MATCH 258
+
+namespace ESPFirebase
+{
+
+namespace
+{
+
+// deflate escribe los bits empezando por el menos significativo
+struct BitWriter
+{
+    std::string& out;
+    uint32_t acc = 0;
+    int count = 0;
+
+    explicit BitWriter(std::string& out) : out(out) {}
+
+    void put(uint32_t value, int bits)
+    {
+        acc |= value << count;
+        count += bits;
+        while (count >= 8) {
+            out.push_back((char)(acc & 0xFF));
+            acc >>= 8;
+            count -= 8;
+        }
+    }
+
+    void flush()
+    {
+        if (count > 0) out.push_back((char)(acc & 0xFF));
+        acc = 0;
+        count = 0;
+    }
+};
+
+// ... salvo los códigos Huffman, que van del más significativo al menos
+uint32_t reverseBits(uint32_t code, int bits)
+{
+    uint32_t r = 0;
+    for (int i = 0; i < bits; ++i) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+// Códigos fijos de literal/longitud (RFC 1951 3.2.6)
+void putSymbol(BitWriter& bw, int sym)
+{
+    if (sym < 144)      bw.put(reverseBits(0x30 + sym, 8), 8);
+    else if (sym < 256) bw.put(reverseBits(0x190 + sym - 144, 9), 9);
+    else if (sym < 280) bw.put(reverseBits(sym - 256, 7), 7);
+    else                bw.put(reverseBits(0xC0 + sym - 280, 8), 8);
+}
+
+const uint16_t len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                               35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                               3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                8193, 12289, 16385, 24577};
+const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+void putMatch(BitWriter& bw, size_t len, size_t dist)
+{
+    int l = 28;
+    while (len_base[l] > len) --l;
+    putSymbol(bw, 257 + l);
+    if (len_extra[l]) bw.put((uint32_t)(len - len_base[l]), len_extra[l]);
+    int d = 29;
+    while (dist_base[d] > dist) --d;
+    bw.put(reverseBits(d, 5), 5);
+    if (dist_extra[d]) bw.put((uint32_t)(dist - dist_base[d]), dist_extra[d]);
+}
+
+uint32_t hash3(const unsigned char* p)
+{
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (v * 2654435761u) >> (32 - GZIP_HASH_BITS);
+}
+
+void putLE32(std::string& out, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) out.push_back((char)((v >> (8 * i)) & 0xFF));
+}
+
+} // namespace
+
+GzipEncoder::GzipEncoder(size_t window, int max_chain) : window(256), max_chain(max_chain < 1 ? 1 : max_chain)
+{
+    while (this->window < window && this->window < 32768) this->window <<= 1;
+}
+
+bool GzipEncoder::compress(const char* data, size_t len, std::string& out)
+{
+    // head: última posición con ese hash; prev: anterior con el mismo hash (anillo de la ventana)
+    const size_t hash_size = (size_t)1 << GZIP_HASH_BITS;
+    const size_t mask = window - 1;
+    int32_t* head = new (std::nothrow) int32_t[hash_size];
+    int32_t* prev = new (std::nothrow) int32_t[window];
+    if (!head || !prev) {
+        delete[] head;
+        delete[] prev;
+        return false;
+    }
+    for (size_t i = 0; i < hash_size; ++i) head[i] = -1;
+
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+    out.clear();
+    out.reserve(len / 2 + 32);
+    // Cabecera gzip mínima: deflate, sin nombre ni mtime, SO desconocido
+    static const char header[10] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff'};
+    out.append(header, sizeof(header));
+
+    BitWriter bw(out);
+    bw.put(1, 1);   // BFINAL: un solo bloque
+    bw.put(1, 2);   // BTYPE=01: Huffman fijo
+
+    size_t i = 0;
+    while (i < len) {
+        size_t best_len = 0;
+        size_t best_dist = 0;
+        if (i + GZIP_MIN_MATCH <= len) {
+            const size_t max_len = len - i < GZIP_MAX_MATCH ? len - i : GZIP_MAX_MATCH;
+            uint32_t h = hash3(in + i);
+            int32_t cand = head[h];
+            for (int chain = max_chain; cand >= 0 && i - (size_t)cand < window && chain > 0; --chain) {
+                const unsigned char* a = in + cand;
+                const unsigned char* b = in + i;
+                if (a[best_len] == b[best_len]) {
+                    size_t l = 0;
+                    while (l < max_len && a[l] == b[l]) ++l;
+                    if (l > best_len) {
+                        best_len = l;
+                        best_dist = i - (size_t)cand;
+                        if (l == max_len) break;
+                    }
+                }
+                int32_t next = prev[(size_t)cand & mask];
+                if (next >= cand) break;    // el anillo ya se reutilizó
+                cand = next;
+            }
+            prev[i & mask] = head[h];
+            head[h] = (int32_t)i;
+        }
+
+        if (best_len >= GZIP_MIN_MATCH) {
+            putMatch(bw, best_len, best_dist);
+            for (size_t k = 1; k < best_len; ++k) {
+                size_t p = i + k;
+                if (p + GZIP_MIN_MATCH > len) break;
+                uint32_t h = hash3(in + p);
+                prev[p & mask] = head[h];
+                head[h] = (int32_t)p;
+            }
+            i += best_len;
+        } else {
+            putSymbol(bw, in[i]);
+            ++i;
+        }
+    }
+    putSymbol(bw, 256);     // fin de bloque
+    bw.flush();
+
+    delete[] head;
+    delete[] prev;
+
+    putLE32(out, esp_rom_crc32_le(0, in, (uint32_t)len));
+    putLE32(out, (uint32_t)len);
+    return true;
+}
+
+}
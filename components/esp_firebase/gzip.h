@@ -0,0 +1,33 @@
+#ifndef _ESP_FIREBASE_GZIP_H_
+#define  _ESP_FIREBASE_GZIP_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace ESPFirebase
+{
+
+    /**
+     * @brief Compresor gzip (RFC 1952 sobre deflate RFC 1951) pensado para los cuerpos JSON
+     *        de las escrituras: LZ77 voraz con ventana acotada y códigos Huffman fijos.
+     *        Comprime menos que zlib pero no guarda árboles ni buffers de 32 KB: la memoria
+     *        de trabajo es 4 KB de tabla hash + 4 B por byte de ventana, sólo durante la llamada.
+     *        No depende de ESP-IDF salvo el CRC32 de la ROM: se puede probar en el host.
+     */
+    class GzipEncoder
+    {
+    public:
+        // window: distancia máxima de las coincidencias (256..32768, se redondea a potencia de 2)
+        explicit GzipEncoder(size_t window = 2048, int max_chain = 32);
+
+        // Sustituye out por la versión gzip de [data, data+len). false si falta memoria
+        bool compress(const char* data, size_t len, std::string& out);
+
+    private:
+        size_t window;
+        int max_chain;
+    };
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include "esp_crt_bundle.h"
+#include "lwip/sockets.h"
+
+#include "http_conn.h"
+
+namespace ESPFirebase {
+
+bool parseOrigin(const char* url, origin_t& o)
+{
+    const char* p;
+    if (strncmp(url, "https://", 8) == 0) { o.https = true; p = url + 8; o.port = 443; }
+    else if (strncmp(url, "http://", 7) == 0) { o.https = false; p = url + 7; o.port = 80; }
+    else return false;
+    o.host = p;
+    while (*p && *p != ':' && *p != '/') ++p;
+    o.host_len = (int)(p - o.host);
+    if (*p == ':') {
+        o.port = atoi(p + 1);
+        while (*p && *p != '/') ++p;
+    }
+    o.prefix_len = (size_t)(p - url);
+    return o.host_len > 0 && *p == '/';
+}
+
+esp_tls_t* connectOrigin(const origin_t& o, int timeout_ms)
+{
+    esp_tls_cfg_t cfg = {};
+    cfg.crt_bundle_attach = o.https ? esp_crt_bundle_attach : nullptr;
+    cfg.is_plain_tcp = !o.https;
+    cfg.timeout_ms = timeout_ms;
+    esp_tls_t* tls = esp_tls_init();
+    if (!tls) return nullptr;
+    if (esp_tls_conn_new_sync(o.host, o.host_len, o.port, &cfg, tls) != 1) {
+        esp_tls_conn_destroy(tls);
+        return nullptr;
+    }
+    // timeout_ms de esp-tls sólo cubre la conexión: lecturas y escrituras van por el socket
+    int fd = -1;
+    if (esp_tls_get_conn_sockfd(tls, &fd) == ESP_OK && fd >= 0) {
+        struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        // Sin Nagle: con peticiones segmentadas siempre hay datos sin ACK, y cada escritura
+        // esperaría a la respuesta de la anterior (un RTT por petición, como en serie)
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return tls;
+}
+
+bool writeAll(esp_tls_t* tls, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t w = esp_tls_conn_write(tls, data, len);
+        if (w <= 0) return false;
+        data += w;
+        len -= (size_t)w;
+    }
+    return true;
+}
+
+bool headerHas(const char* value, const char* token)
+{
+    size_t n = strlen(token);
+    for (; *value; ++value) {
+        if (strncasecmp(value, token, n) == 0) return true;
+    }
+    return false;
+}
+
+bool ResponseReader::readLine(std::string& line)
+{
+    line.clear();
+    while (true) {
+        if (pos == len && !fill()) return false;
+        char* nl = static_cast<char*>(memchr(buf + pos, '\n', len - pos));
+        size_t n = nl ? (size_t)(nl - (buf + pos)) : len - pos;
+        line.append(buf + pos, n);
+        pos += n;
+        if (nl) {
+            ++pos;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        if (line.size() > 1024) return false;   // cabecera absurda: no es HTTP
+    }
+}
+
+bool ResponseReader::skip(size_t n)
+{
+    while (n > 0) {
+        if (pos == len && !fill()) return false;
+        size_t take = len - pos < n ? len - pos : n;
+        pos += take;
+        n -= take;
+    }
+    return true;
+}
+
+ssize_t ResponseReader::readSome(char* dst, size_t cap)
+{
+    if (pos == len && !fill()) return -1;
+    size_t n = len - pos < cap ? len - pos : cap;
+    memcpy(dst, buf + pos, n);
+    pos += n;
+    return (ssize_t)n;
+}
+
+bool ResponseReader::fill()
+{
+    ssize_t r = esp_tls_conn_read(tls, buf, sizeof(buf));
+    if (r <= 0) return false;
+    pos = 0;
+    len = (size_t)r;
+    return true;
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef _ESP_FIREBASE_HTTP_CONN_H_
+#define  _ESP_FIREBASE_HTTP_CONN_H_
+#include <stddef.h>
+#include <sys/types.h>
+#include <string>
+#include "esp_tls.h"
+
+namespace ESPFirebase
+{
+
+    // esquema://host[:puerto] de una URL; prefix_len = hasta el "/" de la ruta
+    struct origin_t
+    {
+        bool https;
+        const char* host;
+        int host_len;
+        int port;
+        size_t prefix_len;
+    };
+
+    bool parseOrigin(const char* url, origin_t& o);
+
+    // Conexión TLS (o TCP si es http://) con timeout de conexión y de lectura/escritura. nullptr si falla
+    esp_tls_t* connectOrigin(const origin_t& o, int timeout_ms);
+
+    bool writeAll(esp_tls_t* tls, const char* data, size_t len);
+
+    // ¿El valor de cabecera contiene token (sin distinguir mayúsculas)?
+    bool headerHas(const char* value, const char* token);
+
+    /**
+     * @brief Lector con buffer sobre una conexión esp-tls para HTTP/1.1 escrito a mano
+     *        (pipelining, stream SSE): líneas de cabecera, descarte de cuerpos y lectura
+     *        de lo que haya llegado sin esperar a llenar el destino.
+     */
+    class ResponseReader
+    {
+    public:
+        explicit ResponseReader(esp_tls_t* tls) : tls(tls) {}
+
+        // Línea sin CRLF; false si la conexión se cortó, venció el timeout o no es HTTP
+        bool readLine(std::string& line);
+        bool skip(size_t n);
+        // Hasta cap bytes: lo que quede en el buffer o lo que traiga una sola lectura. <= 0 si falla
+        ssize_t readSome(char* dst, size_t cap);
+
+    private:
+        bool fill();
+
+        esp_tls_t* tls;
+        char buf[512];
+        size_t pos = 0;
+        size_t len = 0;
+    };
+
+}
+
+#endif
@@ -1,18 +1,102 @@
 #pragma once
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Métricas de renovación del token (ver FirebaseApp::auth_metrics_t)
+typedef struct {
+    uint32_t refresh_ok;
+    uint32_t refresh_failed;
+    uint32_t proactive;
+    uint32_t on_demand;
+    uint32_t forced;
+    uint32_t full_logins;
+    int64_t last_latency_us;
+    int64_t max_latency_us;
+    int64_t total_latency_us;
+} firebase_auth_metrics_t;
+
+// Prioridades de la cola de subida (ver ESPFirebase::rtdb_priority_t)
+#define FIREBASE_PRIO_RETENTION   0
+#define FIREBASE_PRIO_NORMAL      1
+#define FIREBASE_PRIO_MEASUREMENT 2
+
+#define FIREBASE_UPLINK_HIST_BUCKETS 10
+
+// Fin de una petición asíncrona: err 0 = OK; value = borrados en trim
+typedef void (*firebase_done_cb_t)(uint32_t id, int err, int value, void* ctx);
+
+// Métricas de la cola de subida (ver ESPFirebase::rtdb_uplink_metrics_t)
+typedef struct {
+    uint32_t enqueued;
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t cancelled;
+    uint32_t expired;
+    uint32_t dropped;
+    uint32_t depth;
+    uint32_t max_depth;
+    uint32_t wait_hist[FIREBASE_UPLINK_HIST_BUCKETS];   // ms log2: <64, <128, ..., >=16384
+    uint32_t total_hist[FIREBASE_UPLINK_HIST_BUCKETS];
+} firebase_uplink_metrics_t;
+
+// Métricas de escrituras PUT/POST/PATCH (ver ESPFirebase::rtdb_write_metrics_t)
+typedef struct {
+    uint32_t writes;
+    uint32_t failed;
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+    int64_t last_latency_us;
+    int64_t max_latency_us;
+    int64_t total_latency_us;
+} firebase_write_metrics_t;
+
+// Compresión gzip de cuerpos de petición (ver ESPFirebase::compression_metrics_t)
+typedef struct {
+    uint32_t compressed;
+    uint32_t not_smaller;
+    uint32_t rejected;
+    uint64_t raw_bytes;
+    uint64_t wire_bytes;    // ratio = wire_bytes / raw_bytes
+    int64_t cpu_us;         // µs por KB = cpu_us * 1024 / raw_bytes
+} firebase_compression_metrics_t;
+
+// Cambio recibido por firebase_listen (ver ESPFirebase::rtdb_listen_cb_t); data no termina en '\0'
+typedef void (*firebase_listen_cb_t)(const char* event, const char* path, const char* data, size_t data_len, void* ctx);
+
 int firebase_init(void);
 int firebase_auth(void);
 int firebase_refresh_token(void);
+int firebase_get_auth_metrics(firebase_auth_metrics_t* out);
 int firebase_push(const char* path, const char* json);
 int firebase_putData(const char* path, const char* json);
+// PUT de un registro CBOR (p. ej. sensors_format_cbor): se convierte a JSON aquí, en la frontera con Firebase
+int firebase_putCbor(const char* path, const uint8_t* cbor, size_t len);
 int firebase_delete(const char* path);
 int firebase_trim_days(const char* root_path, int max_days);
 int firebase_trim_oldest_batch(const char* root_path, int batch_size);
 
+// Versiones asíncronas: devuelven el id (> 0) o 0 si no se pudo encolar. deadline_ms = 0 sin límite
+uint32_t firebase_putData_async(const char* path, const char* json, int prio, uint32_t deadline_ms,
+                                firebase_done_cb_t cb, void* ctx);
+uint32_t firebase_trim_oldest_batch_async(const char* root_path, int batch_size, int prio, uint32_t deadline_ms,
+                                          firebase_done_cb_t cb, void* ctx);
+int firebase_cancel(uint32_t id);
+int firebase_get_uplink_metrics(firebase_uplink_metrics_t* out);
+int firebase_get_write_metrics(firebase_write_metrics_t* out);
+// Cuerpos de al menos threshold bytes salen con gzip (0 = apagado)
+int firebase_set_request_compression(size_t threshold);
+int firebase_get_compression_metrics(firebase_compression_metrics_t* out);
+
+// Escucha cambios en vivo (streaming SSE). Devuelve un handle para firebase_unlisten, NULL si falla
+void* firebase_listen(const char* path, firebase_listen_cb_t cb, void* ctx);
+void firebase_unlisten(void* listener);
+// Número en el JSON [json, json+len) apuntado por pointer (RFC 6901, "" = todo el documento)
+int firebase_json_get_number(const char* json, size_t len, const char* pointer, double* out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,6 +2,7 @@
 #include <vector>
 #include <algorithm>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -19,166 +20,291 @@ RTDB::RTDB(FirebaseApp* app, const char * database_url)
     : app(app), base_database_url(database_url)
 
 {
-    
+    // Las rutas empiezan con '/': evita "//" en la URL
+    while (!RTDB::base_database_url.empty() && RTDB::base_database_url.back() == '/') RTDB::base_database_url.pop_back();
+    // Cola de subida asíncrona (rtdb_async.cpp); la tarea se arranca al primer encolado
+    this->uplink = newUplink();
+    this->metrics_mutex = xSemaphoreCreateMutex();
+    this->cache_mutex = xSemaphoreCreateMutex();
+}
+
+// base + path + ".json?" + query + "&" + "auth=<token>" en un solo bloque de memoria.
+// El sufijo de auth lo cachea FirebaseApp al obtener el token.
+std::string RTDB::buildUrl(const char* path, const char* query, uint32_t* generation)
+{
+    size_t path_len = strlen(path);
+    size_t query_len = query ? strlen(query) : 0;
+    std::string url;
+    url.reserve(RTDB::base_database_url.size() + path_len + 6 + query_len + 1 + this->app->authQueryLength());
+    url.append(RTDB::base_database_url).append(path, path_len).append(".json?");
+    if (query_len) url.append(query, query_len).append("&");
+    uint32_t gen = this->app->appendAuthQuery(url);
+    if (generation) *generation = gen;
+    return url;
 }
 Json::Value RTDB::getData(const char* path)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
+    FirebaseApp::ClientLease lease(this->app);
+    this->app->refreshAuthIfNeeded();
+
+    // Con caché: pide el ETag y, si ya hay entrada, revalida con if-none-match
+    std::string etag;
+    const bool cached = RTDB::cacheETag(path, etag);
+    if (cached) {
+        this->app->setHeader("X-Firebase-ETag", "true");
+        if (!etag.empty()) this->app->setHeader("if-none-match", etag.c_str());
+    }
+
+    uint32_t generation;
+    std::string url = RTDB::buildUrl(path, nullptr, &generation);
 
     this->app->setHeader("content-type", "application/json");
     http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
+    // Sólo un 401 justifica renovar el token; cualquier otro error se devuelve tal cual
+    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) && http_ret.status_code == 401) {
+        ESP_LOGW(RTDB_TAG, "GET 401 -> intentando refresh auth");
+        this->app->forceRefreshAuth(generation);
+        url = RTDB::buildUrl(path);
+        this->app->setHeader("content-type", "application/json");
+        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
+    }
+    if (http_ret.err == ESP_OK && http_ret.status_code == 304) {
+        Json::Value data;
+        if (RTDB::cacheHit(path, data)) {
+            this->app->deleteHeader("if-none-match");
+            this->app->deleteHeader("X-Firebase-ETag");
+            ESP_LOGI(RTDB_TAG, "Data with path=%s sin cambios (caché)", path);
+            return data;
+        }
+        // La entrada se expulsó mientras tanto: hace falta el cuerpo
+        this->app->deleteHeader("if-none-match");
+        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
+    }
+    if (cached) {
+        this->app->deleteHeader("if-none-match");
+        this->app->deleteHeader("X-Firebase-ETag");
+    }
     if (http_ret.err == ESP_OK && http_ret.status_code == 200)
     {
-        const char* begin = this->app->local_response_buffer;
-        const char* end = begin + strlen(this->app->local_response_buffer);
-
-        Json::Reader reader;
         Json::Value data;
-
-        reader.parse(begin, end, data, false);
+        this->app->parseResponse(data);
+
+        // Un cuerpo que llenó el buffer está truncado: no se guarda
+        const char* body = this->app->responseBuffer();
+        size_t len = strlen(body);
+        const char* new_etag = this->app->responseETag();
+        if (cached && new_etag[0] && len < HTTP_RECV_BUFFER_SIZE - 1) {
+            RTDB::cacheStore(path, new_etag, body, len);
+        }
 
         ESP_LOGI(RTDB_TAG, "Data with path=%s acquired", path);
         this->app->clearHTTPBuffer();
         return data;
     }
-    else
-    {   
-        ESP_LOGE(RTDB_TAG, "Error while getting data at path %s| esp_err_t=%d | status_code=%d", path, (int)http_ret.err, http_ret.status_code);
-    ESP_LOGI(RTDB_TAG, "Token expired ? Trying refreshing auth");
-    this->app->loginUserAccount(this->app->user_account);
-        this->app->setHeader("content-type", "application/json");
-        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
-        if (http_ret.err == ESP_OK && http_ret.status_code == 200)
-        {
-            const char* begin = this->app->local_response_buffer;
-            const char* end = begin + strlen(this->app->local_response_buffer);
-
-            Json::Reader reader;
-            Json::Value data;
-
-            reader.parse(begin, end, data, false);
-
-            ESP_LOGI(RTDB_TAG, "Data with path=%s acquired", path);
-            this->app->clearHTTPBuffer();
-            return data;
-        }
-        else
-        {
-            ESP_LOGE(RTDB_TAG, "Failed to get data after refreshing token. double check account credentials or database rules");
-            this->app->clearHTTPBuffer();
-            return Json::Value();
-        }
-    }
+    ESP_LOGE(RTDB_TAG, "Error while getting data at path %s| esp_err_t=%d | status_code=%d", path, (int)http_ret.err, http_ret.status_code);
+    this->app->clearHTTPBuffer();
+    return Json::Value();
 }
 
-esp_err_t RTDB::putData(const char* path, const char* json_str)
+// En modo silent Firebase responde 204 sin cuerpo: no hay nada que copiar ni que limpiar
+esp_err_t RTDB::writeData(const char* path, esp_http_client_method_t method, const char* op,
+                          const char* body, size_t body_len)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
+    FirebaseApp::ClientLease lease(this->app);
+    this->app->refreshAuthIfNeeded();
+    const bool silent = RTDB::write_ack == rtdb_write_ack_t::silent;
+    const char* query = silent ? "print=silent" : nullptr;
+    const int64_t start_us = esp_timer_get_time();
+
+    uint32_t generation;
+    std::string url = RTDB::buildUrl(path, query, &generation);
     this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PUT, json_str);
-    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) && http_ret.status_code == 401) {
-        ESP_LOGW(RTDB_TAG, "PUT 401 -> intentando refresh auth");
-        this->app->forceRefreshAuth();
-        url = RTDB::base_database_url; url += path; url += ".json?auth=" + this->app->auth_token;
+    this->app->setDiscardResponseBody(silent);
+    http_ret_t http_ret = this->app->performRequest(url.c_str(), method, body, body_len);
+    size_t rx_bytes = http_ret.rx_bytes;
+    if (!(http_ret.err == ESP_OK && http_ret.status_code / 100 == 2) && http_ret.status_code == 401) {
+        ESP_LOGW(RTDB_TAG, "%s 401 -> intentando refresh auth", op);
+        this->app->forceRefreshAuth(generation);
+        url = RTDB::buildUrl(path, query);
         this->app->setHeader("content-type", "application/json");
-        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PUT, json_str);
+        this->app->setDiscardResponseBody(silent);
+        http_ret = this->app->performRequest(url.c_str(), method, body, body_len);
+        rx_bytes += http_ret.rx_bytes;
     }
-    this->app->clearHTTPBuffer();
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200) {
-        ESP_LOGI(RTDB_TAG, "PUT successful");
+    this->app->setDiscardResponseBody(false);
+    if (!silent) this->app->clearHTTPBuffer();
+
+    const bool ok = http_ret.err == ESP_OK && http_ret.status_code / 100 == 2;
+    const int64_t latency_us = esp_timer_get_time() - start_us;
+    xSemaphoreTake(RTDB::metrics_mutex, portMAX_DELAY);
+    rtdb_write_metrics_t& m = RTDB::write_metrics;
+    m.writes++;
+    if (!ok) m.failed++;
+    m.tx_bytes += body_len;
+    m.rx_bytes += rx_bytes;
+    m.last_latency_us = latency_us;
+    if (latency_us > m.max_latency_us) m.max_latency_us = latency_us;
+    m.total_latency_us += latency_us;
+    xSemaphoreGive(RTDB::metrics_mutex);
+
+    if (ok) {
+        ESP_LOGI(RTDB_TAG, "%s successful (%lld ms, rx=%u B)", op, (long long)(latency_us / 1000), (unsigned)rx_bytes);
         return ESP_OK;
     }
-    ESP_LOGE(RTDB_TAG, "PUT failed");
+    ESP_LOGE(RTDB_TAG, "%s failed", op);
     return ESP_FAIL;
 }
 
+int RTDB::writeBatch(esp_http_client_method_t method, rtdb_write_item_t* items, size_t count)
+{
+    if (count == 0) return 0;
+    FirebaseApp::ClientLease lease(this->app);
+    this->app->refreshAuthIfNeeded();
+    const char* query = method == HTTP_METHOD_DELETE ? "writeSizeLimit=unlimited"
+                      : RTDB::write_ack == rtdb_write_ack_t::silent ? "print=silent" : nullptr;
+    const int64_t start_us = esp_timer_get_time();
+
+    std::vector<std::string> urls(count);
+    std::vector<pipeline_item_t> reqs(count);
+    uint32_t generation = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Todas llevan el mismo token salvo renovación en medio: basta la generación de la primera
+        urls[i] = RTDB::buildUrl(items[i].path, query, i == 0 ? &generation : nullptr);
+        const char* body = method == HTTP_METHOD_DELETE ? "" : items[i].body;
+        reqs[i] = {method, urls[i].c_str(), body, strlen(body), ESP_FAIL, -1, 0, 0};
+    }
+    this->app->performPipelined(reqs.data(), count);
+
+    // 401: token caducado. Se renueva una vez y se reenvían las que no llegaron a 2xx
+    std::vector<size_t> again;
+    for (size_t i = 0; i < count; ++i) {
+        if (reqs[i].status_code / 100 != 2) again.push_back(i);
+    }
+    if (!again.empty() && std::any_of(again.begin(), again.end(), [&](size_t i) { return reqs[i].status_code == 401; })) {
+        ESP_LOGW(RTDB_TAG, "batch 401 -> intentando refresh auth");
+        this->app->forceRefreshAuth(generation);
+        std::vector<pipeline_item_t> retry(again.size());
+        for (size_t k = 0; k < again.size(); ++k) {
+            size_t i = again[k];
+            urls[i] = RTDB::buildUrl(items[i].path, query);
+            retry[k] = reqs[i];
+            retry[k].url = urls[i].c_str();
+        }
+        this->app->performPipelined(retry.data(), retry.size());
+        for (size_t k = 0; k < again.size(); ++k) reqs[again[k]] = retry[k];
+    }
+
+    int ok_count = 0;
+    xSemaphoreTake(RTDB::metrics_mutex, portMAX_DELAY);
+    rtdb_write_metrics_t& m = RTDB::write_metrics;
+    for (size_t i = 0; i < count; ++i) {
+        const bool ok = reqs[i].err == ESP_OK && reqs[i].status_code / 100 == 2;
+        items[i].err = ok ? ESP_OK : ESP_FAIL;
+        ok_count += ok;
+        // Latencia de cada registro: desde el inicio del lote hasta su respuesta
+        int64_t latency_us = (reqs[i].done_us ? reqs[i].done_us : esp_timer_get_time()) - start_us;
+        m.writes++;
+        if (!ok) m.failed++;
+        m.tx_bytes += reqs[i].body_len;
+        m.rx_bytes += reqs[i].rx_bytes;
+        m.last_latency_us = latency_us;
+        if (latency_us > m.max_latency_us) m.max_latency_us = latency_us;
+        m.total_latency_us += latency_us;
+    }
+    xSemaphoreGive(RTDB::metrics_mutex);
+
+    ESP_LOGI(RTDB_TAG, "batch: %d/%u OK en %lld ms", ok_count, (unsigned)count,
+             (long long)((esp_timer_get_time() - start_us) / 1000));
+    return ok_count;
+}
+
+void RTDB::setWriteAck(rtdb_write_ack_t ack)
+{
+    RTDB::write_ack = ack;
+}
+
+rtdb_write_metrics_t RTDB::getWriteMetrics()
+{
+    xSemaphoreTake(RTDB::metrics_mutex, portMAX_DELAY);
+    rtdb_write_metrics_t m = RTDB::write_metrics;
+    xSemaphoreGive(RTDB::metrics_mutex);
+    return m;
+}
+
+// Serializa y libera el árbol antes del round trip HTTPS (el handshake TLS necesita heap)
+esp_err_t RTDB::writeOwned(const char* path, esp_http_client_method_t method, const char* op,
+                           Json::Value&& data)
+{
+    Json::Value owned(std::move(data));
+    Json::FastWriter writer;
+    std::string json_str = writer.write(owned);
+    owned = Json::Value();
+    return RTDB::writeData(path, method, op, json_str.data(), json_str.size());
+}
+
+esp_err_t RTDB::putData(const char* path, const char* json_str)
+{
+    return RTDB::writeData(path, HTTP_METHOD_PUT, "PUT", json_str, strlen(json_str));
+}
+
 esp_err_t RTDB::putData(const char* path, const Json::Value& data)
 {
     Json::FastWriter writer;
     std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::putData(path, json_str.c_str());
-    return err;
+    return RTDB::writeData(path, HTTP_METHOD_PUT, "PUT", json_str.data(), json_str.size());
+}
 
+esp_err_t RTDB::putData(const char* path, Json::Value&& data)
+{
+    return RTDB::writeOwned(path, HTTP_METHOD_PUT, "PUT", std::move(data));
 }
 
 esp_err_t RTDB::postData(const char* path, const char* json_str)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_POST, json_str);
-    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) && http_ret.status_code == 401) {
-        ESP_LOGW(RTDB_TAG, "POST 401 -> intentando refresh auth");
-        this->app->forceRefreshAuth();
-        url = RTDB::base_database_url; url += path; url += ".json?auth=" + this->app->auth_token;
-        this->app->setHeader("content-type", "application/json");
-        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_POST, json_str);
-    }
-    this->app->clearHTTPBuffer();
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200) {
-        ESP_LOGI(RTDB_TAG, "POST successful");
-        return ESP_OK;
-    }
-    ESP_LOGE(RTDB_TAG, "POST failed");
-    return ESP_FAIL;
+    return RTDB::writeData(path, HTTP_METHOD_POST, "POST", json_str, strlen(json_str));
 }
 
 esp_err_t RTDB::postData(const char* path, const Json::Value& data)
 {
     Json::FastWriter writer;
     std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::postData(path, json_str.c_str());
-    return err;
+    return RTDB::writeData(path, HTTP_METHOD_POST, "POST", json_str.data(), json_str.size());
+}
 
+esp_err_t RTDB::postData(const char* path, Json::Value&& data)
+{
+    return RTDB::writeOwned(path, HTTP_METHOD_POST, "POST", std::move(data));
 }
+
 esp_err_t RTDB::patchData(const char* path, const char* json_str)
 {
-    
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?auth=" + this->app->auth_token;
-    this->app->setHeader("content-type", "application/json");
-    http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PATCH, json_str);
-    if (!(http_ret.err == ESP_OK && http_ret.status_code == 200) && http_ret.status_code == 401) {
-        ESP_LOGW(RTDB_TAG, "PATCH 401 -> intentando refresh auth");
-        this->app->forceRefreshAuth();
-        url = RTDB::base_database_url; url += path; url += ".json?auth=" + this->app->auth_token;
-        this->app->setHeader("content-type", "application/json");
-        http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_PATCH, json_str);
-    }
-    this->app->clearHTTPBuffer();
-    if (http_ret.err == ESP_OK && http_ret.status_code == 200) {
-        ESP_LOGI(RTDB_TAG, "PATCH successful");
-        return ESP_OK;
-    }
-    ESP_LOGE(RTDB_TAG, "PATCH failed");
-    return ESP_FAIL;
+    return RTDB::writeData(path, HTTP_METHOD_PATCH, "PATCH", json_str, strlen(json_str));
 }
 
 esp_err_t RTDB::patchData(const char* path, const Json::Value& data)
 {
     Json::FastWriter writer;
     std::string json_str = writer.write(data);
-    esp_err_t err = RTDB::patchData(path, json_str.c_str());
-    return err;
+    return RTDB::writeData(path, HTTP_METHOD_PATCH, "PATCH", json_str.data(), json_str.size());
+}
+
+esp_err_t RTDB::patchData(const char* path, Json::Value&& data)
+{
+    return RTDB::writeOwned(path, HTTP_METHOD_PATCH, "PATCH", std::move(data));
 }
 
 esp_err_t RTDB::deleteData(const char* path)
 {
+    FirebaseApp::ClientLease lease(this->app);
+    this->app->refreshAuthIfNeeded();
+
     // --- URL con writeSizeLimit=unlimited (sin print=silent en DELETE) ---
-    std::string url = RTDB::base_database_url;
-    url += path;
-    url += ".json?writeSizeLimit=unlimited&auth=" + this->app->auth_token;
+    uint32_t generation;
+    std::string url = RTDB::buildUrl(path, "writeSizeLimit=unlimited", &generation);
 
     // --- Timeout largo SOLO para esta operación ---
+    // performRequest lo toma también como presupuesto total: los reintentos
+    // comparten estos 10 min en vez de sumar 10 min cada uno
     constexpr int LONG_TIMEOUT_MS = 600000;  // 10 min
     this->app->setHttpTimeoutMs(LONG_TIMEOUT_MS);
 
@@ -194,11 +320,9 @@ esp_err_t RTDB::deleteData(const char* path)
         && http_ret.status_code == 401) {
 
         ESP_LOGW(RTDB_TAG, "DELETE 401 -> intentando refresh de auth y reintento");
-        this->app->forceRefreshAuth();
+        this->app->forceRefreshAuth(generation);
 
-        std::string url2 = RTDB::base_database_url;
-        url2 += path;
-        url2 += ".json?writeSizeLimit=unlimited&auth=" + this->app->auth_token;
+        std::string url2 = RTDB::buildUrl(path, "writeSizeLimit=unlimited");
 
         this->app->setHeader("Content-Length", "0");
         this->app->setHeader("Accept", "application/json");
@@ -225,11 +349,11 @@ esp_err_t RTDB::deleteData(const char* path)
 esp_err_t RTDB::trimDays(const char* root_path, int max_days)
 {
     if (max_days <= 0) return ESP_OK;
+    FirebaseApp::ClientLease lease(this->app);
+    this->app->refreshAuthIfNeeded();
 
     // Listar días (claves) bajo root con shallow=true
-    std::string url = RTDB::base_database_url;
-    url += root_path;
-    url += ".json?shallow=true&auth=" + this->app->auth_token;
+    std::string url = RTDB::buildUrl(root_path, "shallow=true");
     this->app->setHeader("content-type", "application/json");
     http_ret_t http_ret = this->app->performRequest(url.c_str(), HTTP_METHOD_GET, "");
     if (!(http_ret.err == ESP_OK && http_ret.status_code == 200)) {
@@ -238,11 +362,8 @@ esp_err_t RTDB::trimDays(const char* root_path, int max_days)
         return ESP_FAIL;
     }
 
-    const char* begin = this->app->local_response_buffer;
-    const char* end = begin + strlen(this->app->local_response_buffer);
-    Json::Reader reader;
     Json::Value days_obj;
-    reader.parse(begin, end, days_obj, false);
+    this->app->parseResponse(days_obj);
     this->app->clearHTTPBuffer();
     if (!days_obj.isObject()) return ESP_OK; // nada que recortar
 
@@ -266,27 +387,29 @@ esp_err_t RTDB::trimDays(const char* root_path, int max_days)
 int RTDB::trimOldestBatch(const char* root_path, int batch_size)
 {
     if (batch_size <= 0) return 0;
-    std::string list_url = RTDB::base_database_url;
-    list_url += root_path;
-    list_url += ".json?orderBy=%22%24key%22&limitToFirst=" + std::to_string(batch_size) + "&auth=" + this->app->auth_token;
+    FirebaseApp::ClientLease lease(this->app);
+    this->app->refreshAuthIfNeeded();
+    char list_query[64];
+    snprintf(list_query, sizeof(list_query), "orderBy=%%22%%24key%%22&limitToFirst=%d", batch_size);
+    std::string list_url = RTDB::buildUrl(root_path, list_query);
     this->app->setHeader("content-type", "application/json");
     http_ret_t get_ret = this->app->performRequest(list_url.c_str(), HTTP_METHOD_GET, "");
     if (!(get_ret.err == ESP_OK && get_ret.status_code == 200)) {
         this->app->clearHTTPBuffer();
         return -1;
     }
-    const char* begin = this->app->local_response_buffer;
-    const char* end = begin + strlen(this->app->local_response_buffer);
-    Json::Reader reader;
     Json::Value obj;
-    reader.parse(begin, end, obj, false);
+    this->app->parseResponse(obj);
     this->app->clearHTTPBuffer();
     if (!obj.isObject()) return 0;
     std::vector<std::string> keys = obj.getMemberNames();
     if (keys.empty()) return 0;
 
+    // Tamaño exacto: {"k1":null,...} -> 2 llaves + (clave + 7) por entrada + comas
+    size_t body_len = 2 + keys.size() - 1;
+    for (const std::string& k : keys) body_len += k.size() + 7;
     std::string patch_body;
-    patch_body.reserve(1024);
+    patch_body.reserve(body_len);
     patch_body += "{";
     for (size_t i = 0; i < keys.size(); ++i) {
         if (i) patch_body += ",";
@@ -294,9 +417,7 @@ int RTDB::trimOldestBatch(const char* root_path, int batch_size)
     }
     patch_body += "}";
 
-    std::string patch_url = RTDB::base_database_url;
-    patch_url += root_path;
-    patch_url += ".json?auth=" + this->app->auth_token + "&print=silent";
+    std::string patch_url = RTDB::buildUrl(root_path, "print=silent");
     this->app->setHeader("content-type", "application/json");
     http_ret_t patch_ret = this->app->performRequest(patch_url.c_str(), HTTP_METHOD_PATCH, patch_body);
     this->app->clearHTTPBuffer();
@@ -1,21 +1,154 @@
 #ifndef _ESP_FIREBASE_RTDB_H_
 #define  _ESP_FIREBASE_RTDB_H_
 #include "app.h"
+#include <vector>
 
 
 #include "value.h"
 #include "json.h"
 
+// Capacidad de la cola de subida asíncrona (peticiones pendientes)
+#ifndef RTDB_UPLINK_QUEUE_LEN
+#define RTDB_UPLINK_QUEUE_LEN 16
+#endif
+#define RTDB_UPLINK_HIST_BUCKETS 10
+// Escrituras pendientes que la tarea de subida envía juntas por una conexión segmentada
+#ifndef RTDB_UPLINK_BATCH_MAX
+#define RTDB_UPLINK_BATCH_MAX 8
+#endif
+
 namespace ESPFirebase 
 {
 
-    
-    
+    // Prioridad en la cola de subida: las mediciones adelantan a la retención
+    enum class rtdb_priority_t : uint8_t
+    {
+        retention = 0,
+        normal = 1,
+        measurement = 2,
+    };
+
+    /**
+     * @brief Fin de una petición asíncrona. Se llama desde la tarea de subida, salvo al
+     *        cancelar o desplazar, que se llama desde la tarea que cancela/encola.
+     * 
+     * @param err ESP_OK, error de la petición, ESP_ERR_TIMEOUT (venció antes de empezar),
+     *            ESP_ERR_INVALID_STATE (cancelada) o ESP_ERR_NO_MEM (desplazada de la cola)
+     * @param value Resultado numérico de la operación (borrados en trimOldestBatchAsync)
+     */
+    typedef void (*rtdb_done_cb_t)(uint32_t id, esp_err_t err, int value, void* ctx);
+
+    struct rtdb_uplink_metrics_t
+    {
+        uint32_t enqueued;
+        uint32_t completed;        // ejecutadas (con éxito o no)
+        uint32_t failed;
+        uint32_t cancelled;
+        uint32_t expired;          // deadline vencido antes de empezar
+        uint32_t dropped;          // rechazadas o desplazadas con la cola llena
+        uint32_t depth;            // pendientes ahora
+        uint32_t max_depth;
+        // Histogramas log2 en ms: cubeta i = [64·2^(i-1), 64·2^i), la 0 es <64 ms y la última abierta
+        uint32_t wait_hist[RTDB_UPLINK_HIST_BUCKETS];    // encolado -> inicio
+        uint32_t total_hist[RTDB_UPLINK_HIST_BUCKETS];   // encolado -> fin
+    };
+
+    // Confirmación de escrituras PUT/POST/PATCH
+    enum class rtdb_write_ack_t : uint8_t
+    {
+        silent,     // print=silent: 204 sin cuerpo (por defecto)
+        echo,       // Firebase devuelve lo escrito (POST devuelve la clave generada)
+    };
+
+    struct rtdb_write_metrics_t
+    {
+        uint32_t writes;
+        uint32_t failed;
+        uint64_t tx_bytes;          // cuerpos enviados
+        uint64_t rx_bytes;          // cuerpos recibidos (eco o error), incluidos reintentos
+        int64_t last_latency_us;
+        int64_t max_latency_us;
+        int64_t total_latency_us;   // total / writes = media
+    };
+
+    struct rtdb_cache_metrics_t
+    {
+        uint32_t hits;              // 304: servido desde la caché
+        uint32_t misses;            // 200: cuerpo completo descargado
+        uint32_t stores;            // entradas guardadas o actualizadas
+        uint32_t evictions;         // expulsadas por LRU al superar el presupuesto
+        uint64_t bytes_saved;       // cuerpos no descargados gracias a un 304
+        uint32_t bytes;             // ocupación actual (cuerpo + ruta + ETag)
+        uint32_t entries;
+        uint32_t budget;
+    };
+
+    // Entrada de la caché de lectura: el cuerpo va en PSRAM si la hay
+    struct rtdb_cache_entry_t
+    {
+        std::string path;
+        std::string etag;
+        char* body;
+        size_t len;
+        uint32_t last_used;         // reloj lógico para LRU
+    };
+
+    /**
+     * @brief Cambio recibido por RTDB::listen. Se llama desde la tarea del listener.
+     * 
+     * @param event "put" (reemplaza) o "patch" (fusiona)
+     * @param path Ruta del cambio relativa a la escuchada ("/" = todo)
+     * @param data Texto JSON del nuevo valor ("null" si se borró); no termina en '\0'
+     */
+    typedef void (*rtdb_listen_cb_t)(const char* event, const char* path, const char* data, size_t data_len, void* ctx);
+
+    // Un registro de RTDB::writeBatch; err es salida
+    struct rtdb_write_item_t
+    {
+        const char* path;
+        const char* body;           // ignorado en DELETE
+        esp_err_t err;
+    };
+
+    struct rtdb_uplink_t;
+    struct rtdb_listener_t;
+
     class RTDB
     {
     private:
         FirebaseApp* app;
         std::string base_database_url;
+        rtdb_uplink_t* uplink = nullptr;   // cola + tarea de subida, se crea al primer uso
+        rtdb_write_ack_t write_ack = rtdb_write_ack_t::silent;
+        SemaphoreHandle_t metrics_mutex = nullptr;
+        rtdb_write_metrics_t write_metrics = {};
+
+        // Caché de lectura por ruta, revalidada con ETag (desactivada con presupuesto 0)
+        SemaphoreHandle_t cache_mutex = nullptr;
+        std::vector<rtdb_cache_entry_t> cache;
+        size_t cache_budget = 0;
+        uint32_t cache_tick = 0;
+        rtdb_cache_metrics_t cache_metrics = {};
+
+        bool cacheETag(const char* path, std::string& etag);
+        bool cacheHit(const char* path, Json::Value& out);
+        void cacheStore(const char* path, const char* etag, const char* body, size_t len);
+        void cacheErase(size_t index);
+
+        // generation (opcional) = la del token que lleva la URL, para forceRefreshAuth tras un 401
+        std::string buildUrl(const char* path, const char* query = nullptr, uint32_t* generation = nullptr);
+
+        // PUT/POST/PATCH comparten flujo: reintento único tras 401
+        esp_err_t writeData(const char* path, esp_http_client_method_t method, const char* op,
+                            const char* body, size_t body_len);
+        esp_err_t writeOwned(const char* path, esp_http_client_method_t method, const char* op,
+                             Json::Value&& data);
+
+        uint32_t enqueue(uint8_t op, const char* path, const char* body, int arg,
+                         rtdb_done_cb_t cb, void* ctx, rtdb_priority_t prio, uint32_t deadline_ms);
+        static rtdb_uplink_t* newUplink();
+        static void uplinkTask(void* arg);
+        static void listenTask(void* arg);
 
 
     public:
@@ -24,18 +157,73 @@ namespace ESPFirebase
 
         esp_err_t putData(const char* path, const char* json_str);
         esp_err_t putData(const char* path, const Json::Value& data);
+        // Toma posesión del árbol: se libera antes de enviar
+        esp_err_t putData(const char* path, Json::Value&& data);
 
         esp_err_t postData(const char* path, const char* json_str);
         esp_err_t postData(const char* path, const Json::Value& data);
+        // Toma posesión del árbol: se libera antes de enviar
+        esp_err_t postData(const char* path, Json::Value&& data);
 
         esp_err_t patchData(const char* path, const char* json_str);
         esp_err_t patchData(const char* path, const Json::Value& data);
+        // Toma posesión del árbol: se libera antes de enviar
+        esp_err_t patchData(const char* path, Json::Value&& data);
         
         esp_err_t deleteData(const char* path);
         // Opcionales de mantenimiento
         esp_err_t trimDays(const char* root_path, int max_days);
         int trimOldestBatch(const char* root_path, int batch_size);
+
+        /*
+         * Caché de lectura para getData: guarda cuerpo y ETag por ruta y revalida con
+         * if-none-match, así un dato sin cambios cuesta un 304 sin cuerpo. budget_bytes = 0
+         * la desactiva y libera las entradas.
+         */
+        void enableReadCache(size_t budget_bytes);
+        rtdb_cache_metrics_t getCacheMetrics();
+
+        /*
+         * Varias escrituras PUT/PATCH/DELETE segmentadas en una conexión (ver
+         * FirebaseApp::performPipelined): tras una caída, el backlog no paga un RTT por registro.
+         * Devuelve cuántas salieron bien; el resultado de cada una queda en items[i].err.
+         */
+        int writeBatch(esp_http_client_method_t method, rtdb_write_item_t* items, size_t count);
+
+        void setWriteAck(rtdb_write_ack_t ack);
+        rtdb_write_metrics_t getWriteMetrics();
+
+        /*
+         * API asíncrona: copia path/body, encola y vuelve en microsegundos. Una tarea de subida
+         * ejecuta la versión síncrona por orden de prioridad (FIFO dentro de la misma) y llama a cb.
+         * deadline_ms acota la espera en cola (0 = sin límite); en vuelo manda el presupuesto de
+         * reintentos de FirebaseApp. Devuelve un id > 0, o 0 si la cola estaba llena.
+         */
+        uint32_t putDataAsync(const char* path, const char* json_str, rtdb_done_cb_t cb = nullptr, void* ctx = nullptr,
+                              rtdb_priority_t prio = rtdb_priority_t::measurement, uint32_t deadline_ms = 0);
+        uint32_t postDataAsync(const char* path, const char* json_str, rtdb_done_cb_t cb = nullptr, void* ctx = nullptr,
+                               rtdb_priority_t prio = rtdb_priority_t::measurement, uint32_t deadline_ms = 0);
+        uint32_t patchDataAsync(const char* path, const char* json_str, rtdb_done_cb_t cb = nullptr, void* ctx = nullptr,
+                                rtdb_priority_t prio = rtdb_priority_t::normal, uint32_t deadline_ms = 0);
+        uint32_t deleteDataAsync(const char* path, rtdb_done_cb_t cb = nullptr, void* ctx = nullptr,
+                                 rtdb_priority_t prio = rtdb_priority_t::retention, uint32_t deadline_ms = 0);
+        uint32_t trimOldestBatchAsync(const char* root_path, int batch_size, rtdb_done_cb_t cb = nullptr, void* ctx = nullptr,
+                                      rtdb_priority_t prio = rtdb_priority_t::retention, uint32_t deadline_ms = 0);
+        /*
+         * Escucha path con streaming REST (Accept: text/event-stream) en una tarea propia con
+         * su propio cliente HTTP, fuera del pool. Reconecta con backoff y tras auth_revoked
+         * renueva el token. Al conectar, Firebase manda un "put" con el valor completo.
+         */
+        rtdb_listener_t* listen(const char* path, rtdb_listen_cb_t cb, void* ctx = nullptr);
+        // Al volver ya no se llama a cb; la tarea termina y se libera al salir de la lectura en curso
+        void unlisten(rtdb_listener_t* listener);
+
+        // Sólo cancela si aún no empezó; cb recibe ESP_ERR_INVALID_STATE
+        bool cancel(uint32_t id);
+        rtdb_uplink_metrics_t getUplinkMetrics();
+
         RTDB(FirebaseApp* app, const char* database_url);
+        ~RTDB();
     };
 
 
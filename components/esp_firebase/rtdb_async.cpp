@@ -0,0 +1,338 @@
+#include <string>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "rtdb.h"
+#define RTDB_TAG "RTDB"
+
+#define UPLINK_TASK_STACK 8192
+#define UPLINK_TASK_PRIO 5
+
+namespace ESPFirebase {
+
+enum : uint8_t { OP_PUT, OP_POST, OP_PATCH, OP_DELETE, OP_TRIM };
+enum : uint8_t { SLOT_FREE, SLOT_QUEUED, SLOT_RUNNING };
+
+// Los strings de cada hueco conservan su capacidad entre usos: en régimen estable encolar no reserva memoria
+struct uplink_slot_t
+{
+    uint8_t state = SLOT_FREE;
+    uint8_t op = OP_PUT;
+    rtdb_priority_t prio = rtdb_priority_t::normal;
+    uint32_t id = 0;
+    uint32_t seq = 0;
+    int arg = 0;
+    int64_t enqueued_us = 0;
+    int64_t deadline_us = 0;     // 0 = sin límite
+    rtdb_done_cb_t cb = nullptr;
+    void* ctx = nullptr;
+    std::string path;
+    std::string body;
+};
+
+struct rtdb_uplink_t
+{
+    SemaphoreHandle_t mutex = nullptr;
+    SemaphoreHandle_t exited = nullptr;
+    TaskHandle_t task = nullptr;
+    bool stop = false;
+    uint32_t next_id = 1;
+    uint32_t next_seq = 0;
+    uplink_slot_t slots[RTDB_UPLINK_QUEUE_LEN];
+    rtdb_uplink_metrics_t metrics = {};
+};
+
+// Cubeta log2: <64 ms en la 0, luego una por cada duplicación; la última acumula el resto
+static void histAdd(uint32_t* hist, int64_t us)
+{
+    int64_t ms = us / 1000;
+    int b = 0;
+    for (int64_t lim = 64; ms >= lim && b < RTDB_UPLINK_HIST_BUCKETS - 1; lim <<= 1) ++b;
+    ++hist[b];
+}
+
+static void finish(rtdb_done_cb_t cb, uint32_t id, esp_err_t err, int value, void* ctx)
+{
+    if (cb) cb(id, err, value, ctx);
+}
+
+rtdb_uplink_t* RTDB::newUplink()
+{
+    rtdb_uplink_t* q = new rtdb_uplink_t();
+    q->mutex = xSemaphoreCreateMutex();
+    q->exited = xSemaphoreCreateBinary();
+    return q;
+}
+
+uint32_t RTDB::enqueue(uint8_t op, const char* path, const char* body, int arg,
+                       rtdb_done_cb_t cb, void* ctx, rtdb_priority_t prio, uint32_t deadline_ms)
+{
+    rtdb_uplink_t* q = this->uplink;
+    const int64_t now = esp_timer_get_time();
+    uint32_t evicted_id = 0;
+    rtdb_done_cb_t evicted_cb = nullptr;
+    void* evicted_ctx = nullptr;
+
+    xSemaphoreTake(q->mutex, portMAX_DELAY);
+    if (!q->task && !q->stop) {
+        if (xTaskCreate(&RTDB::uplinkTask, "fb_uplink", UPLINK_TASK_STACK, this, UPLINK_TASK_PRIO, &q->task) != pdPASS) {
+            q->task = nullptr;
+            ESP_LOGE(RTDB_TAG, "No se pudo crear la tarea de subida");
+        }
+    }
+    if (!q->task) {
+        q->metrics.dropped++;
+        xSemaphoreGive(q->mutex);
+        return 0;
+    }
+
+    uplink_slot_t* slot = nullptr;
+    for (uplink_slot_t& s : q->slots) {
+        if (s.state == SLOT_FREE) { slot = &s; break; }
+    }
+    if (!slot) {
+        // Cola llena: desplaza la pendiente de menor prioridad (la más reciente) si es menor que la nueva
+        for (uplink_slot_t& s : q->slots) {
+            if (s.state != SLOT_QUEUED || s.prio >= prio) continue;
+            if (!slot || s.prio < slot->prio || (s.prio == slot->prio && (int32_t)(s.seq - slot->seq) > 0)) slot = &s;
+        }
+        if (!slot) {
+            q->metrics.dropped++;
+            xSemaphoreGive(q->mutex);
+            ESP_LOGW(RTDB_TAG, "Cola de subida llena, petición rechazada (%s)", path);
+            return 0;
+        }
+        evicted_id = slot->id;
+        evicted_cb = slot->cb;
+        evicted_ctx = slot->ctx;
+        q->metrics.dropped++;
+        q->metrics.depth--;
+    }
+
+    slot->state = SLOT_QUEUED;
+    slot->op = op;
+    slot->prio = prio;
+    slot->id = q->next_id++;
+    if (q->next_id == 0) q->next_id = 1;
+    slot->seq = q->next_seq++;
+    slot->arg = arg;
+    slot->enqueued_us = now;
+    slot->deadline_us = deadline_ms ? now + (int64_t)deadline_ms * 1000 : 0;
+    slot->cb = cb;
+    slot->ctx = ctx;
+    slot->path.assign(path);
+    if (body) slot->body.assign(body); else slot->body.clear();
+    uint32_t id = slot->id;
+
+    q->metrics.enqueued++;
+    if (++q->metrics.depth > q->metrics.max_depth) q->metrics.max_depth = q->metrics.depth;
+    TaskHandle_t task = q->task;
+    xSemaphoreGive(q->mutex);
+
+    xTaskNotifyGive(task);
+    if (evicted_id) {
+        ESP_LOGW(RTDB_TAG, "Cola de subida llena, desplazada la petición %u", (unsigned)evicted_id);
+        finish(evicted_cb, evicted_id, ESP_ERR_NO_MEM, 0, evicted_ctx);
+    }
+    return id;
+}
+
+// DELETE queda fuera: deleteData usa un timeout de 10 min para subárboles grandes
+static bool batchable(uint8_t op)
+{
+    return op == OP_PUT || op == OP_PATCH;
+}
+
+void RTDB::uplinkTask(void* arg)
+{
+    RTDB* self = static_cast<RTDB*>(arg);
+    rtdb_uplink_t* q = self->uplink;
+    uplink_slot_t* batch[RTDB_UPLINK_BATCH_MAX];
+    esp_err_t errs[RTDB_UPLINK_BATCH_MAX];
+
+    while (true) {
+        xSemaphoreTake(q->mutex, portMAX_DELAY);
+        if (q->stop) {
+            xSemaphoreGive(q->mutex);
+            break;
+        }
+        // Mayor prioridad primero; FIFO dentro de la misma prioridad
+        uplink_slot_t* slot = nullptr;
+        for (uplink_slot_t& s : q->slots) {
+            if (s.state != SLOT_QUEUED) continue;
+            if (!slot || s.prio > slot->prio || (s.prio == slot->prio && (int32_t)(s.seq - slot->seq) < 0)) slot = &s;
+        }
+        if (!slot) {
+            xSemaphoreGive(q->mutex);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        slot->state = SLOT_RUNNING;
+        q->metrics.depth--;
+        const int64_t start = esp_timer_get_time();
+        const bool expired = slot->deadline_us && start > slot->deadline_us;
+        if (expired) q->metrics.expired++;
+        else histAdd(q->metrics.wait_hist, start - slot->enqueued_us);
+
+        // Backlog (p. ej. tras una caída): las siguientes escrituras de la misma operación y
+        // prioridad, en orden FIFO, se envían juntas por una conexión segmentada
+        size_t n = 0;
+        batch[n++] = slot;
+        while (!expired && batchable(slot->op) && n < RTDB_UPLINK_BATCH_MAX) {
+            uplink_slot_t* next = nullptr;
+            for (uplink_slot_t& s : q->slots) {
+                if (s.state != SLOT_QUEUED || s.op != slot->op || s.prio != slot->prio) continue;
+                if (s.deadline_us && start > s.deadline_us) continue;   // vencerá en su turno
+                if (!next || (int32_t)(s.seq - next->seq) < 0) next = &s;
+            }
+            if (!next) break;
+            next->state = SLOT_RUNNING;
+            q->metrics.depth--;
+            histAdd(q->metrics.wait_hist, start - next->enqueued_us);
+            batch[n++] = next;
+        }
+        xSemaphoreGive(q->mutex);
+
+        int value = 0;
+        if (expired) {
+            errs[0] = ESP_ERR_TIMEOUT;
+            ESP_LOGW(RTDB_TAG, "Petición %u vencida en cola (%s)", (unsigned)slot->id, slot->path.c_str());
+        } else if (n > 1) {
+            rtdb_write_item_t items[RTDB_UPLINK_BATCH_MAX];
+            for (size_t i = 0; i < n; ++i) {
+                items[i].path = batch[i]->path.c_str();
+                items[i].body = batch[i]->body.c_str();
+            }
+            self->writeBatch(slot->op == OP_PUT ? HTTP_METHOD_PUT : HTTP_METHOD_PATCH, items, n);
+            for (size_t i = 0; i < n; ++i) errs[i] = items[i].err;
+        } else {
+            const char* path = slot->path.c_str();
+            const char* body = slot->body.c_str();
+            switch (slot->op) {
+            case OP_PUT:    errs[0] = self->putData(path, body); break;
+            case OP_POST:   errs[0] = self->postData(path, body); break;
+            case OP_PATCH:  errs[0] = self->patchData(path, body); break;
+            case OP_DELETE: errs[0] = self->deleteData(path); break;
+            case OP_TRIM:
+                value = self->trimOldestBatch(path, slot->arg);
+                errs[0] = value >= 0 ? ESP_OK : ESP_FAIL;
+                break;
+            }
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            uplink_slot_t* b = batch[i];
+            uint32_t id = b->id;
+            rtdb_done_cb_t cb = b->cb;
+            void* ctx = b->ctx;
+            xSemaphoreTake(q->mutex, portMAX_DELAY);
+            if (!expired) {
+                q->metrics.completed++;
+                if (errs[i] != ESP_OK) q->metrics.failed++;
+                histAdd(q->metrics.total_hist, esp_timer_get_time() - b->enqueued_us);
+            }
+            b->state = SLOT_FREE;
+            xSemaphoreGive(q->mutex);
+
+            finish(cb, id, errs[i], value, ctx);
+        }
+    }
+
+    xSemaphoreGive(q->exited);
+    vTaskDelete(NULL);
+}
+
+uint32_t RTDB::putDataAsync(const char* path, const char* json_str, rtdb_done_cb_t cb, void* ctx,
+                            rtdb_priority_t prio, uint32_t deadline_ms)
+{
+    return RTDB::enqueue(OP_PUT, path, json_str, 0, cb, ctx, prio, deadline_ms);
+}
+
+uint32_t RTDB::postDataAsync(const char* path, const char* json_str, rtdb_done_cb_t cb, void* ctx,
+                             rtdb_priority_t prio, uint32_t deadline_ms)
+{
+    return RTDB::enqueue(OP_POST, path, json_str, 0, cb, ctx, prio, deadline_ms);
+}
+
+uint32_t RTDB::patchDataAsync(const char* path, const char* json_str, rtdb_done_cb_t cb, void* ctx,
+                              rtdb_priority_t prio, uint32_t deadline_ms)
+{
+    return RTDB::enqueue(OP_PATCH, path, json_str, 0, cb, ctx, prio, deadline_ms);
+}
+
+uint32_t RTDB::deleteDataAsync(const char* path, rtdb_done_cb_t cb, void* ctx,
+                               rtdb_priority_t prio, uint32_t deadline_ms)
+{
+    return RTDB::enqueue(OP_DELETE, path, nullptr, 0, cb, ctx, prio, deadline_ms);
+}
+
+uint32_t RTDB::trimOldestBatchAsync(const char* root_path, int batch_size, rtdb_done_cb_t cb, void* ctx,
+                                    rtdb_priority_t prio, uint32_t deadline_ms)
+{
+    return RTDB::enqueue(OP_TRIM, root_path, nullptr, batch_size, cb, ctx, prio, deadline_ms);
+}
+
+bool RTDB::cancel(uint32_t id)
+{
+    rtdb_uplink_t* q = this->uplink;
+    rtdb_done_cb_t cb = nullptr;
+    void* ctx = nullptr;
+    bool found = false;
+
+    xSemaphoreTake(q->mutex, portMAX_DELAY);
+    for (uplink_slot_t& s : q->slots) {
+        if (s.state == SLOT_QUEUED && s.id == id) {
+            cb = s.cb;
+            ctx = s.ctx;
+            s.state = SLOT_FREE;
+            q->metrics.cancelled++;
+            q->metrics.depth--;
+            found = true;
+            break;
+        }
+    }
+    xSemaphoreGive(q->mutex);
+
+    if (found) finish(cb, id, ESP_ERR_INVALID_STATE, 0, ctx);
+    return found;
+}
+
+rtdb_uplink_metrics_t RTDB::getUplinkMetrics()
+{
+    xSemaphoreTake(this->uplink->mutex, portMAX_DELAY);
+    rtdb_uplink_metrics_t m = this->uplink->metrics;
+    xSemaphoreGive(this->uplink->mutex);
+    return m;
+}
+
+RTDB::~RTDB()
+{
+    rtdb_uplink_t* q = this->uplink;
+    xSemaphoreTake(q->mutex, portMAX_DELAY);
+    q->stop = true;
+    TaskHandle_t task = q->task;
+    xSemaphoreGive(q->mutex);
+    if (task) {
+        // Espera a que termine la petición en curso; las pendientes se cancelan
+        xTaskNotifyGive(task);
+        xSemaphoreTake(q->exited, portMAX_DELAY);
+    }
+    for (uplink_slot_t& s : q->slots) {
+        if (s.state == SLOT_QUEUED) {
+            s.state = SLOT_FREE;
+            q->metrics.cancelled++;
+            finish(s.cb, s.id, ESP_ERR_INVALID_STATE, 0, s.ctx);
+        }
+    }
+    vSemaphoreDelete(q->exited);
+    vSemaphoreDelete(q->mutex);
+    delete q;
+    vSemaphoreDelete(this->metrics_mutex);
+    RTDB::enableReadCache(0);
+    vSemaphoreDelete(this->cache_mutex);
+}
+
+}
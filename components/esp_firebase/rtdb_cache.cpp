@@ -0,0 +1,133 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "rtdb.h"
+#define RTDB_TAG "RTDB"
+
+namespace ESPFirebase {
+
+static size_t entryBytes(const rtdb_cache_entry_t& e)
+{
+    return e.len + e.path.size() + e.etag.size();
+}
+
+// Los cuerpos pueden ser grandes: PSRAM primero, RAM interna si no hay
+static char* allocBody(size_t len)
+{
+    char* p = static_cast<char*>(heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (!p) p = static_cast<char*>(heap_caps_malloc(len, MALLOC_CAP_8BIT));
+    return p;
+}
+
+// Entrada usada hace más tiempo; diferencia con signo: sigue valiendo si cache_tick da la vuelta
+static size_t lruIndex(const std::vector<rtdb_cache_entry_t>& cache)
+{
+    size_t lru = 0;
+    for (size_t i = 1; i < cache.size(); ++i) {
+        if ((int32_t)(cache[i].last_used - cache[lru].last_used) < 0) lru = i;
+    }
+    return lru;
+}
+
+void RTDB::cacheErase(size_t index)
+{
+    rtdb_cache_entry_t& e = RTDB::cache[index];
+    RTDB::cache_metrics.bytes -= entryBytes(e);
+    heap_caps_free(e.body);
+    RTDB::cache[index] = std::move(RTDB::cache.back());
+    RTDB::cache.pop_back();
+}
+
+// false si la caché está apagada; si no, etag queda con el de la entrada ("" si no hay)
+bool RTDB::cacheETag(const char* path, std::string& etag)
+{
+    xSemaphoreTake(RTDB::cache_mutex, portMAX_DELAY);
+    bool enabled = RTDB::cache_budget > 0;
+    etag.clear();
+    for (const rtdb_cache_entry_t& e : RTDB::cache) {
+        if (e.path == path) { etag = e.etag; break; }
+    }
+    xSemaphoreGive(RTDB::cache_mutex);
+    return enabled;
+}
+
+// Tras un 304: parsea el cuerpo guardado. false si la entrada ya no está (expulsada entretanto)
+bool RTDB::cacheHit(const char* path, Json::Value& out)
+{
+    bool found = false;
+    xSemaphoreTake(RTDB::cache_mutex, portMAX_DELAY);
+    for (rtdb_cache_entry_t& e : RTDB::cache) {
+        if (e.path != path) continue;
+        found = this->app->parseJson(e.body, e.body + e.len, out);
+        if (found) {
+            e.last_used = ++RTDB::cache_tick;
+            RTDB::cache_metrics.hits++;
+            RTDB::cache_metrics.bytes_saved += e.len;
+        }
+        break;
+    }
+    xSemaphoreGive(RTDB::cache_mutex);
+    return found;
+}
+
+void RTDB::cacheStore(const char* path, const char* etag, const char* body, size_t len)
+{
+    xSemaphoreTake(RTDB::cache_mutex, portMAX_DELAY);
+    RTDB::cache_metrics.misses++;
+    size_t need = len + strlen(path) + strlen(etag);
+    for (size_t i = 0; i < RTDB::cache.size(); ++i) {
+        if (RTDB::cache[i].path == path) { RTDB::cacheErase(i); break; }
+    }
+    if (RTDB::cache_budget == 0 || need > RTDB::cache_budget / 2) {
+        // Un solo cuerpo no debe vaciar la caché entera
+        xSemaphoreGive(RTDB::cache_mutex);
+        return;
+    }
+    while (RTDB::cache_metrics.bytes + need > RTDB::cache_budget && !RTDB::cache.empty()) {
+        size_t lru = lruIndex(RTDB::cache);
+        ESP_LOGD(RTDB_TAG, "Caché: expulsando %s", RTDB::cache[lru].path.c_str());
+        RTDB::cacheErase(lru);
+        RTDB::cache_metrics.evictions++;
+    }
+    char* copy = allocBody(len);
+    if (copy) {
+        memcpy(copy, body, len);
+        rtdb_cache_entry_t e;
+        e.path = path;
+        e.etag = etag;
+        e.body = copy;
+        e.len = len;
+        e.last_used = ++RTDB::cache_tick;
+        RTDB::cache.push_back(std::move(e));
+        RTDB::cache_metrics.bytes += need;
+        RTDB::cache_metrics.stores++;
+    }
+    xSemaphoreGive(RTDB::cache_mutex);
+}
+
+void RTDB::enableReadCache(size_t budget_bytes)
+{
+    xSemaphoreTake(RTDB::cache_mutex, portMAX_DELAY);
+    RTDB::cache_budget = budget_bytes;
+    while (!RTDB::cache.empty() && RTDB::cache_metrics.bytes > budget_bytes) {
+        // cacheErase reordena el vector: la última posición no es la menos usada
+        RTDB::cacheErase(lruIndex(RTDB::cache));
+        RTDB::cache_metrics.evictions++;
+    }
+    xSemaphoreGive(RTDB::cache_mutex);
+}
+
+rtdb_cache_metrics_t RTDB::getCacheMetrics()
+{
+    xSemaphoreTake(RTDB::cache_mutex, portMAX_DELAY);
+    rtdb_cache_metrics_t m = RTDB::cache_metrics;
+    m.entries = (uint32_t)RTDB::cache.size();
+    m.budget = (uint32_t)RTDB::cache_budget;
+    xSemaphoreGive(RTDB::cache_mutex);
+    return m;
+}
+
+}
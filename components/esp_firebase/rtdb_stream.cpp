@@ -0,0 +1,241 @@
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <string>
+#include <memory>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "rtdb.h"
+#include "sse.h"
+#include "http_conn.h"
+#include "pointer.h"
+#define RTDB_TAG "RTDB"
+
+#define LISTEN_TASK_STACK 8192
+#define LISTEN_TASK_PRIO 5
+// Firebase manda keep-alive cada ~30 s: sin nada en este tiempo la conexión está muerta
+#define LISTEN_READ_TIMEOUT_MS 75000
+#define LISTEN_BACKOFF_MIN_MS 1000
+#define LISTEN_BACKOFF_MAX_MS 60000
+#define LISTEN_MAX_REDIRECTS 3
+
+namespace ESPFirebase {
+
+static const Json::Pointer event_path_ptr("/path");
+static const Json::Pointer event_data_ptr("/data");
+
+enum : uint8_t { LISTEN_OK, LISTEN_RECONNECT, LISTEN_REAUTH };
+
+struct rtdb_listener_t
+{
+    RTDB* rtdb;
+    std::string path;
+    rtdb_listen_cb_t cb;
+    void* ctx;
+    SemaphoreHandle_t mutex;        // cb sólo se llama con el mutex y stop == false
+    bool stop;
+    uint8_t action;                 // qué pidió el último evento de control
+    bool got_event;
+    uint32_t events;
+    uint32_t reconnects;
+    std::unique_ptr<Json::CharReader> reader;
+};
+
+static bool listenerStopped(rtdb_listener_t* l)
+{
+    xSemaphoreTake(l->mutex, portMAX_DELAY);
+    bool stop = l->stop;
+    xSemaphoreGive(l->mutex);
+    return stop;
+}
+
+// Evento SSE completo: {"path":"/x","data":...} para put/patch; el resto es control
+static void onSseEvent(const std::string& event, const std::string& data, void* arg)
+{
+    rtdb_listener_t* l = static_cast<rtdb_listener_t*>(arg);
+    l->got_event = true;
+    if (event == "keep-alive") return;
+    if (event == "auth_revoked") {
+        ESP_LOGW(RTDB_TAG, "listen %s: token revocado, renovando", l->path.c_str());
+        l->action = LISTEN_REAUTH;
+        return;
+    }
+    if (event == "cancel") {
+        ESP_LOGW(RTDB_TAG, "listen %s: cancelado por el servidor (%s)", l->path.c_str(), data.c_str());
+        l->action = LISTEN_RECONNECT;
+        return;
+    }
+    if (event != "put" && event != "patch") return;
+
+    // Sólo se localizan path y data en el texto; data se entrega sin construir el árbol
+    const char* begin = data.data();
+    const char* end = begin + data.size();
+    const char* pb; const char* pe;
+    const char* db; const char* de;
+    Json::Value path;
+    if (!event_path_ptr.findSpan(begin, end, &pb, &pe) || !event_data_ptr.findSpan(begin, end, &db, &de)
+        || !l->reader->parse(pb, pe, &path, nullptr) || !path.isString()) {
+        ESP_LOGW(RTDB_TAG, "listen %s: evento %s mal formado", l->path.c_str(), event.c_str());
+        return;
+    }
+    l->events++;
+    xSemaphoreTake(l->mutex, portMAX_DELAY);
+    if (!l->stop) l->cb(event.c_str(), path.asCString(), db, (size_t)(de - db), l->ctx);
+    xSemaphoreGive(l->mutex);
+}
+
+rtdb_listener_t* RTDB::listen(const char* path, rtdb_listen_cb_t cb, void* ctx)
+{
+    rtdb_listener_t* l = new rtdb_listener_t();
+    l->rtdb = this;
+    l->path = path;
+    l->cb = cb;
+    l->ctx = ctx;
+    l->mutex = xSemaphoreCreateMutex();
+    Json::CharReaderBuilder reader_builder;
+    Json::CharReaderBuilder::strictTrustedMode(&reader_builder.settings_);
+    l->reader.reset(reader_builder.newCharReader());
+    if (xTaskCreate(&RTDB::listenTask, "fb_listen", LISTEN_TASK_STACK, l, LISTEN_TASK_PRIO, nullptr) != pdPASS) {
+        ESP_LOGE(RTDB_TAG, "No se pudo crear la tarea de listen");
+        vSemaphoreDelete(l->mutex);
+        delete l;
+        return nullptr;
+    }
+    return l;
+}
+
+void RTDB::unlisten(rtdb_listener_t* listener)
+{
+    if (!listener) return;
+    xSemaphoreTake(listener->mutex, portMAX_DELAY);
+    listener->stop = true;
+    xSemaphoreGive(listener->mutex);
+}
+
+// Status y cabeceras (saltando los 1xx). -1 si la respuesta no es HTTP o se cortó
+static int readHead(ResponseReader& reader, std::string& line, bool& chunked, std::string& location)
+{
+    int status;
+    do {
+        if (!reader.readLine(line) || strncmp(line.c_str(), "HTTP/1.", 7) != 0 || line.size() < 12) return -1;
+        status = atoi(line.c_str() + 9);
+        while (true) {
+            if (!reader.readLine(line)) return -1;
+            if (line.empty()) break;
+            const char* h = line.c_str();
+            if (strncasecmp(h, "Transfer-Encoding:", 18) == 0 && headerHas(h + 18, "chunked")) {
+                chunked = true;
+            } else if (strncasecmp(h, "Location:", 9) == 0) {
+                h += 9;
+                while (*h == ' ') ++h;
+                location = h;
+            }
+        }
+    } while (status >= 100 && status < 200);
+    return status;
+}
+
+// Cada lectura entrega al parser lo que haya llegado: un evento de pocos bytes no espera a llenar
+// el buffer ni al keep-alive siguiente. Con chunked se quitan los tamaños de trozo
+static void readEvents(rtdb_listener_t* l, SseParser& parser, ResponseReader& reader, bool chunked, int& backoff_ms)
+{
+    char buf[512];
+    std::string line;
+    size_t chunk_left = 0;
+    while (l->action == LISTEN_OK && !listenerStopped(l)) {
+        if (chunked && chunk_left == 0) {
+            // Tamaño del trozo siguiente; antes va el CRLF que cierra el anterior
+            if (!reader.readLine(line)) break;
+            if (line.empty() && !reader.readLine(line)) break;
+            chunk_left = (size_t)strtoul(line.c_str(), nullptr, 16);
+            if (chunk_left == 0) break;   // fin del cuerpo
+        }
+        size_t want = chunked && chunk_left < sizeof(buf) ? chunk_left : sizeof(buf);
+        ssize_t n = reader.readSome(buf, want);
+        if (n <= 0) break;
+        if (chunked) chunk_left -= (size_t)n;
+        parser.feed(buf, (size_t)n);
+        // Conexión útil: el siguiente corte vuelve a empezar desde el backoff mínimo
+        if (l->got_event) backoff_ms = LISTEN_BACKOFF_MIN_MS;
+    }
+}
+
+// Una conexión del listener: GET del stream siguiendo redirecciones (Firebase puede mandarlo a otro
+// nodo con 307) y, con 200, eventos hasta que se corte, pida reconectar o se pare el listener.
+// Devuelve el status de la última respuesta (-1 sin respuesta)
+static int streamOnce(rtdb_listener_t* l, SseParser& parser, std::string url, int& backoff_ms)
+{
+    std::string line;
+    for (int redirects = 0; redirects <= LISTEN_MAX_REDIRECTS; ++redirects) {
+        origin_t o;
+        if (!parseOrigin(url.c_str(), o)) return -1;
+        esp_tls_t* tls = connectOrigin(o, LISTEN_READ_TIMEOUT_MS);
+        if (!tls) return -1;
+        line.assign("GET ").append(url, o.prefix_len, std::string::npos).append(" HTTP/1.1\r\nHost: ")
+            .append(o.host, o.host_len).append("\r\nAccept: text/event-stream\r\nConnection: close\r\n\r\n");
+        int status = -1;
+        bool chunked = false;
+        std::string location;
+        ResponseReader reader(tls);
+        if (writeAll(tls, line.data(), line.size())) status = readHead(reader, line, chunked, location);
+        if (status == 200) {
+            ESP_LOGI(RTDB_TAG, "listen %s: conectado", l->path.c_str());
+            parser.reset();
+            readEvents(l, parser, reader, chunked, backoff_ms);
+        }
+        esp_tls_conn_destroy(tls);
+        bool redirect = status == 301 || status == 302 || status == 307 || status == 308;
+        if (!redirect || location.empty()) return status;
+        url.swap(location);
+    }
+    return -1;
+}
+
+void RTDB::listenTask(void* arg)
+{
+    rtdb_listener_t* l = static_cast<rtdb_listener_t*>(arg);
+    RTDB* self = l->rtdb;
+    SseParser parser(&onSseEvent, l);
+    int backoff_ms = LISTEN_BACKOFF_MIN_MS;
+
+    while (!listenerStopped(l)) {
+        self->app->refreshAuthIfNeeded();
+        uint32_t generation;
+        std::string url = self->buildUrl(l->path.c_str(), nullptr, &generation);
+
+        l->action = LISTEN_OK;
+        l->got_event = false;
+        int status = streamOnce(l, parser, url, backoff_ms);
+        if (status == 401) {
+            l->action = LISTEN_REAUTH;
+        } else if (status != 200) {
+            ESP_LOGW(RTDB_TAG, "listen %s: status=%d", l->path.c_str(), status);
+        }
+        if (listenerStopped(l)) break;
+
+        l->reconnects++;
+        if (l->action == LISTEN_REAUTH) {
+            // Token caducado en mitad del stream: se reconecta ya. Un 401 al conectar
+            // (reglas, cuenta) pasa además por el backoff para no martillear
+            if (self->app->forceRefreshAuth(generation) == ESP_OK && l->got_event) continue;
+        }
+        // Jitter "equal": al menos la mitad del backoff, para que un fallo inmediato no reconecte en bucle.
+        // El "retry:" del servidor actúa como mínimo
+        int delay_ms = backoff_ms / 2 + (int)(esp_random() % (uint32_t)(backoff_ms / 2 + 1));
+        if (parser.retryMs() > delay_ms) delay_ms = parser.retryMs();
+        ESP_LOGW(RTDB_TAG, "listen %s: reconexión %u en %d ms", l->path.c_str(), (unsigned)l->reconnects, delay_ms);
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        backoff_ms = backoff_ms * 2 < LISTEN_BACKOFF_MAX_MS ? backoff_ms * 2 : LISTEN_BACKOFF_MAX_MS;
+    }
+
+    ESP_LOGI(RTDB_TAG, "listen %s: detenido", l->path.c_str());
+    vSemaphoreDelete(l->mutex);
+    delete l;
+    vTaskDelete(NULL);
+}
+
+}
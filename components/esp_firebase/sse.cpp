@@ -0,0 +1,101 @@
+#include <string.h>
+#include "sse.h"
+
+namespace ESPFirebase {
+
+SseParser::SseParser(event_cb_t cb, void* ctx, size_t max_event_bytes)
+    : cb(cb), ctx(ctx), max_event_bytes(max_event_bytes)
+{
+}
+
+void SseParser::reset()
+{
+    SseParser::line_buf.clear();
+    SseParser::event.clear();
+    SseParser::data.clear();
+    SseParser::overflow = false;
+    SseParser::last_cr = false;
+}
+
+void SseParser::feed(const char* chunk, size_t len)
+{
+    const char* p = chunk;
+    const char* end = chunk + len;
+    while (p < end) {
+        // "\r\n" partido entre dos trozos: el '\n' ya no termina otra línea
+        if (SseParser::last_cr && *p == '\n') {
+            SseParser::last_cr = false;
+            ++p;
+            continue;
+        }
+        SseParser::last_cr = false;
+        const char* eol = p;
+        while (eol < end && *eol != '\n' && *eol != '\r') ++eol;
+        if (eol == end) {
+            if (SseParser::line_buf.size() + (end - p) > SseParser::maxLine()) SseParser::overflow = true;
+            else SseParser::line_buf.append(p, end - p);
+            return;
+        }
+        // Línea completa: sin copia si no había nada pendiente
+        if (SseParser::line_buf.empty()) {
+            SseParser::line(p, eol - p);
+        } else {
+            if (SseParser::line_buf.size() + (eol - p) > SseParser::maxLine()) SseParser::overflow = true;
+            else SseParser::line_buf.append(p, eol - p);
+            SseParser::line(SseParser::line_buf.data(), SseParser::line_buf.size());
+            SseParser::line_buf.clear();
+        }
+        SseParser::last_cr = *eol == '\r';
+        p = eol + 1;
+    }
+}
+
+void SseParser::line(const char* begin, size_t len)
+{
+    if (len == 0) {
+        SseParser::dispatch();
+        return;
+    }
+    if (begin[0] == ':') return;   // comentario
+    if (len > SseParser::maxLine()) {
+        SseParser::overflow = true;
+        return;
+    }
+
+    const char* colon = static_cast<const char*>(memchr(begin, ':', len));
+    size_t name_len = colon ? (size_t)(colon - begin) : len;
+    const char* value = colon ? colon + 1 : begin + len;
+    const char* end = begin + len;
+    if (value < end && *value == ' ') ++value;
+    size_t value_len = end - value;
+
+    if (name_len == 5 && memcmp(begin, "event", 5) == 0) {
+        SseParser::event.assign(value, value_len);
+    } else if (name_len == 4 && memcmp(begin, "data", 4) == 0) {
+        if (SseParser::data.size() + value_len + 1 > SseParser::max_event_bytes) {
+            SseParser::overflow = true;
+            return;
+        }
+        SseParser::data.append(value, value_len).append(1, '\n');
+    } else if (name_len == 5 && memcmp(begin, "retry", 5) == 0) {
+        int ms = 0;
+        size_t i = 0;
+        for (; i < value_len && value[i] >= '0' && value[i] <= '9'; ++i) ms = ms * 10 + (value[i] - '0');
+        if (i == value_len && value_len > 0) SseParser::retry_ms = ms;
+    }
+    // "id" y campos desconocidos se ignoran
+}
+
+void SseParser::dispatch()
+{
+    if (!SseParser::overflow && !SseParser::data.empty()) {
+        SseParser::data.pop_back();   // '\n' del último "data:"
+        static const std::string message_event("message");
+        SseParser::cb(SseParser::event.empty() ? message_event : SseParser::event, SseParser::data, SseParser::ctx);
+    }
+    SseParser::event.clear();
+    SseParser::data.clear();
+    SseParser::overflow = false;
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef _ESP_FIREBASE_SSE_H_
+#define  _ESP_FIREBASE_SSE_H_
+#include <stddef.h>
+#include <string>
+
+namespace ESPFirebase 
+{
+
+    /**
+     * @brief Parser incremental de Server-Sent Events (text/event-stream).
+     *        Se alimenta con trozos de cualquier tamaño tal como llegan del socket y
+     *        entrega cada evento completo (línea en blanco) a cb. Acepta \n, \r\n y \r.
+     *        Un evento que supera max_event_bytes se descarta entero.
+     *        No depende de ESP-IDF: se puede probar en el host.
+     */
+    class SseParser
+    {
+    public:
+        // event = "message" si el evento no trae campo "event:"; data sin el '\n' final
+        typedef void (*event_cb_t)(const std::string& event, const std::string& data, void* ctx);
+
+        SseParser(event_cb_t cb, void* ctx, size_t max_event_bytes = 16384);
+        void feed(const char* chunk, size_t len);
+        // Nueva conexión: descarta la línea y el evento a medias
+        void reset();
+        // Último "retry:" recibido (ms), -1 si ninguno
+        int retryMs() const { return retry_ms; }
+
+    private:
+        void line(const char* begin, size_t len);
+        void dispatch();
+        // Una línea admite el valor máximo más el nombre del campo ("data: ")
+        size_t maxLine() const { return max_event_bytes + 8; }
+
+        event_cb_t cb;
+        void* ctx;
+        size_t max_event_bytes;
+        std::string line_buf;
+        std::string event;
+        std::string data;
+        bool overflow = false;
+        bool last_cr = false;
+        int retry_ms = -1;
+    };
+
+}
+
+#endif
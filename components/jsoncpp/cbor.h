@@ -0,0 +1,67 @@
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef JSON_CBOR_H_INCLUDED
+#define JSON_CBOR_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "reader.h"
+#include "value.h"
+#include "writer.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+
+#pragma pack(push)
+#pragma pack()
+
+namespace Json {
+
+/** \brief Build a StreamWriter that serializes a Value as
+ * <a HREF="https://www.rfc-editor.org/rfc/rfc8949">CBOR</a> (RFC 8949).
+ *
+ * Arrays and objects are written with definite lengths, integers with the
+ * shortest head, and reals in the shortest exact form: float16, float32 or a
+ * decimal fraction (tag 4, e.g. 23.46 as [-2, 2346]) when lossless, float64
+ * otherwise. Comments are dropped. The output is binary; open streams in
+ * binary mode.
+ *
+ * Usage:
+ *   \code
+ *   Json::CborStreamWriterBuilder builder;
+ *   Json::String bytes = Json::writeString(builder, value);
+ *   \endcode
+ * \sa writeCbor()
+ */
+class JSON_API CborStreamWriterBuilder : public StreamWriter::Factory {
+public:
+  StreamWriter* newStreamWriter() const override;
+};
+
+/** \brief Build a CharReader that decodes a CBOR item into a Value.
+ *
+ * Supported: unsigned/negative integers, text and byte strings (byte strings
+ * become strings), definite and indefinite arrays and maps, decimal fractions
+ * (tag 4, exponent -6..0) as reals, other tags (ignored),
+ * false/true/null/undefined and half/single/double floats. Map keys must be
+ * text strings or integers (integers are converted to their decimal text).
+ */
+class JSON_API CborCharReaderBuilder : public CharReader::Factory {
+public:
+  /// Maximum nesting depth, same meaning as CharReaderBuilder "stackLimit".
+  unsigned stackLimit_{1000};
+
+  CharReader* newCharReader() const override;
+};
+
+/** \brief Append the CBOR encoding of \a root to \a out.
+ *
+ * Writes straight into the string without an intermediate stream; this is
+ * what CborStreamWriterBuilder uses internally.
+ */
+void JSON_API writeCbor(Value const& root, String* out);
+
+} // namespace Json
+
+#pragma pack(pop)
+
+#endif // JSON_CBOR_H_INCLUDED
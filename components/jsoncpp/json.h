@@ -11,5 +11,7 @@
 #include "reader.h"
 #include "value.h"
 #include "writer.h"
+#include "cbor.h"
+#include "pointer.h"
 
 #endif // JSON_JSON_H_INCLUDED
@@ -0,0 +1,525 @@
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include <cbor.h>
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace Json {
+
+namespace {
+
+enum CborMajor : unsigned char {
+  cborUnsigned = 0,
+  cborNegative = 1,
+  cborBytes = 2,
+  cborText = 3,
+  cborArray = 4,
+  cborMap = 5,
+  cborTag = 6,
+  cborSimple = 7
+};
+
+const unsigned char cborFalse = 0xf4;
+const unsigned char cborTrue = 0xf5;
+const unsigned char cborNull = 0xf6;
+const unsigned char cborUndefined = 0xf7;
+const unsigned char cborFloat16 = 0xf9;
+const unsigned char cborFloat32 = 0xfa;
+const unsigned char cborFloat64 = 0xfb;
+const unsigned char cborBreak = 0xff;
+const unsigned char cborIndefinite = 31;
+
+// Encoder
+// ////////////////////////////////
+
+void writeHead(String& out, CborMajor major, UInt64 arg) {
+  const auto mt = static_cast<unsigned char>(major << 5);
+  if (arg < 24) {
+    out += static_cast<char>(mt | arg);
+  } else if (arg <= 0xff) {
+    out += static_cast<char>(mt | 24);
+    out += static_cast<char>(arg);
+  } else if (arg <= 0xffff) {
+    out += static_cast<char>(mt | 25);
+    out += static_cast<char>(arg >> 8);
+    out += static_cast<char>(arg);
+  } else if (arg <= 0xffffffffU) {
+    out += static_cast<char>(mt | 26);
+    for (int shift = 24; shift >= 0; shift -= 8)
+      out += static_cast<char>(arg >> shift);
+  } else {
+    out += static_cast<char>(mt | 27);
+    for (int shift = 56; shift >= 0; shift -= 8)
+      out += static_cast<char>(arg >> shift);
+  }
+}
+
+// Exact powers of ten; decimal fractions use at most maxDecimalDigits.
+const unsigned maxDecimalDigits = 6;
+const double pow10Table[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+const UInt64 decimalTag = 4;
+
+size_t headSize(UInt64 arg) {
+  return arg < 24 ? 1 : arg <= 0xff ? 2 : arg <= 0xffff ? 3 : 5;
+}
+
+// Half float bits for value, or false if float16 cannot hold it exactly.
+bool toHalf(double value, uint16_t& half) {
+  const uint16_t sign = std::signbit(value) ? 0x8000 : 0;
+  const double magnitude = std::fabs(value);
+  if (magnitude == 0 || std::isinf(magnitude)) {
+    half = sign | (magnitude == 0 ? 0 : 0x7c00);
+    return true;
+  }
+  int exponent;
+  const double fraction = std::frexp(magnitude, &exponent); // [0.5, 1)
+  if (exponent > 16)
+    return false;
+  if (exponent >= -13) {
+    const double mantissa = (fraction * 2 - 1) * 1024;
+    if (mantissa != std::floor(mantissa))
+      return false;
+    half = sign | static_cast<uint16_t>((exponent + 14) << 10) |
+           static_cast<uint16_t>(mantissa);
+    return true;
+  }
+  const double subnormal = std::ldexp(magnitude, 24);
+  if (subnormal != std::floor(subnormal))
+    return false;
+  half = sign | static_cast<uint16_t>(subnormal);
+  return true;
+}
+
+// Mantissa and digit count of the shortest decimal fraction m / 10^digits
+// that reads back as exactly value, or digits = 0 if there is none.
+unsigned toDecimal(double value, LargestInt& mantissa) {
+  if (!std::isfinite(value) || value == std::trunc(value))
+    return 0;
+  for (unsigned digits = 1; digits <= maxDecimalDigits; ++digits) {
+    const double scaled = std::round(value * pow10Table[digits]);
+    if (std::fabs(scaled) > 4294967295.0)
+      return 0;
+    if (scaled / pow10Table[digits] == value) {
+      mantissa = static_cast<LargestInt>(scaled);
+      return digits;
+    }
+  }
+  return 0;
+}
+
+void writeInteger(String& out, LargestInt i) {
+  if (i >= 0)
+    writeHead(out, cborUnsigned, static_cast<UInt64>(i));
+  else
+    writeHead(out, cborNegative, static_cast<UInt64>(-(i + 1)));
+}
+
+// Shortest exact form: the narrowest IEEE width that round-trips, or a
+// decimal fraction (tag 4, [-digits, mantissa]) when that is shorter, as for
+// rounded sensor readings like 23.46 that have no short binary form.
+void writeReal(String& out, double value) {
+  uint16_t half;
+  if (!std::isnan(value) && toHalf(value, half)) {
+    out += static_cast<char>(cborFloat16);
+    out += static_cast<char>(half >> 8);
+    out += static_cast<char>(half);
+    return;
+  }
+  const auto narrow = static_cast<float>(value);
+  const bool single = static_cast<double>(narrow) == value || std::isnan(value);
+  LargestInt mantissa = 0;
+  const unsigned digits = toDecimal(value, mantissa);
+  if (digits != 0) {
+    const UInt64 magnitude = static_cast<UInt64>(
+        mantissa >= 0 ? mantissa : -(mantissa + 1));
+    const size_t decimalSize = 3 + headSize(magnitude);
+    if (decimalSize < (single ? 5u : 9u)) {
+      writeHead(out, cborTag, decimalTag);
+      writeHead(out, cborArray, 2);
+      writeInteger(out, -static_cast<LargestInt>(digits));
+      writeInteger(out, mantissa);
+      return;
+    }
+  }
+  if (single) {
+    uint32_t bits;
+    std::memcpy(&bits, &narrow, sizeof(bits));
+    out += static_cast<char>(cborFloat32);
+    for (int shift = 24; shift >= 0; shift -= 8)
+      out += static_cast<char>(bits >> shift);
+    return;
+  }
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  out += static_cast<char>(cborFloat64);
+  for (int shift = 56; shift >= 0; shift -= 8)
+    out += static_cast<char>(bits >> shift);
+}
+
+void writeValue(String& out, Value const& value) {
+  switch (value.type()) {
+  case nullValue:
+    out += static_cast<char>(cborNull);
+    break;
+  case booleanValue:
+    out += static_cast<char>(value.asBool() ? cborTrue : cborFalse);
+    break;
+  case intValue:
+    writeInteger(out, value.asLargestInt());
+    break;
+  case uintValue:
+    writeHead(out, cborUnsigned, value.asLargestUInt());
+    break;
+  case realValue:
+    writeReal(out, value.asDouble());
+    break;
+  case stringValue: {
+    char const* begin;
+    char const* end;
+    if (!value.getString(&begin, &end)) {
+      writeHead(out, cborText, 0);
+      break;
+    }
+    writeHead(out, cborText, static_cast<UInt64>(end - begin));
+    out.append(begin, static_cast<size_t>(end - begin));
+  } break;
+  case arrayValue: {
+    const ArrayIndex size = value.size();
+    writeHead(out, cborArray, size);
+    for (ArrayIndex index = 0; index < size; ++index)
+      writeValue(out, value[index]);
+  } break;
+  case objectValue: {
+    writeHead(out, cborMap, value.size());
+    for (auto it = value.begin(); it != value.end(); ++it) {
+      char const* end;
+      char const* name = it.memberName(&end);
+      writeHead(out, cborText, static_cast<UInt64>(end - name));
+      out.append(name, static_cast<size_t>(end - name));
+      writeValue(out, *it);
+    }
+  } break;
+  }
+}
+
+class CborStreamWriter : public StreamWriter {
+public:
+  int write(Value const& root, OStream* sout) override {
+    String buffer;
+    writeCbor(root, &buffer);
+    sout->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return 0;
+  }
+};
+
+// Decoder
+// ////////////////////////////////
+
+class CborReader {
+public:
+  explicit CborReader(unsigned stackLimit) : stackLimit_(stackLimit) {}
+
+  bool parse(char const* begin, char const* end, Value& root) {
+    begin_ = current_ = reinterpret_cast<const unsigned char*>(begin);
+    end_ = reinterpret_cast<const unsigned char*>(end);
+    error_.clear();
+    depth_ = 0;
+    if (!readItem(root))
+      return false;
+    if (current_ != end_)
+      return fail("Extra bytes after CBOR item.");
+    return true;
+  }
+
+  String const& error() const { return error_; }
+
+private:
+  bool fail(char const* message) {
+    if (error_.empty()) {
+      error_ = "* Offset ";
+      error_ += std::to_string(current_ - begin_).c_str();
+      error_ += "\n  ";
+      error_ += message;
+      error_ += "\n";
+    }
+    return false;
+  }
+
+  bool readArgument(unsigned char info, UInt64& arg) {
+    if (info < 24) {
+      arg = info;
+      return true;
+    }
+    int bytes;
+    switch (info) {
+    case 24:
+      bytes = 1;
+      break;
+    case 25:
+      bytes = 2;
+      break;
+    case 26:
+      bytes = 4;
+      break;
+    case 27:
+      bytes = 8;
+      break;
+    default:
+      return fail("Reserved additional information value.");
+    }
+    if (end_ - current_ < bytes)
+      return fail("Truncated CBOR head.");
+    arg = 0;
+    while (bytes--)
+      arg = (arg << 8) | *current_++;
+    return true;
+  }
+
+  bool readString(unsigned char major, unsigned char info, String& out) {
+    if (info == cborIndefinite) {
+      for (;;) {
+        if (current_ == end_)
+          return fail("Unterminated indefinite-length string.");
+        const unsigned char chunk = *current_++;
+        if (chunk == cborBreak)
+          return true;
+        if ((chunk >> 5) != major || (chunk & 0x1f) == cborIndefinite)
+          return fail("Bad chunk in indefinite-length string.");
+        if (!readString(major, chunk & 0x1f, out))
+          return false;
+      }
+    }
+    UInt64 length = 0;
+    if (!readArgument(info, length))
+      return false;
+    if (static_cast<UInt64>(end_ - current_) < length)
+      return fail("Truncated CBOR string.");
+    out.append(reinterpret_cast<char const*>(current_),
+               static_cast<size_t>(length));
+    current_ += length;
+    return true;
+  }
+
+  bool readKey(String& key) {
+    if (current_ == end_)
+      return fail("Truncated CBOR map.");
+    const unsigned char initial = *current_++;
+    const auto major = static_cast<unsigned char>(initial >> 5);
+    const auto info = static_cast<unsigned char>(initial & 0x1f);
+    if (major == cborText || major == cborBytes)
+      return readString(major, info, key);
+    if (major == cborUnsigned || major == cborNegative) {
+      UInt64 arg = 0;
+      if (!readArgument(info, arg))
+        return false;
+      Value number;
+      if (major == cborUnsigned)
+        number = arg;
+      else if (arg <= static_cast<UInt64>(Value::maxLargestInt))
+        number = -static_cast<LargestInt>(arg) - 1;
+      else
+        return fail("Negative map key out of range.");
+      key = number.asString();
+      return true;
+    }
+    return fail("Unsupported CBOR map key type.");
+  }
+
+  bool readFloat(unsigned char info, Value& out) {
+    if (info == 25) {
+      if (end_ - current_ < 2)
+        return fail("Truncated half float.");
+      const unsigned half = (unsigned(current_[0]) << 8) | current_[1];
+      current_ += 2;
+      const unsigned exponent = (half >> 10) & 0x1f;
+      const unsigned mantissa = half & 0x3ff;
+      double value;
+      if (exponent == 0)
+        value = std::ldexp(mantissa, -24);
+      else if (exponent != 31)
+        value = std::ldexp(mantissa + 1024, int(exponent) - 25);
+      else
+        value = mantissa == 0 ? std::numeric_limits<double>::infinity()
+                              : std::numeric_limits<double>::quiet_NaN();
+      out = (half & 0x8000) ? -value : value;
+      return true;
+    }
+    UInt64 bits = 0;
+    if (!readArgument(info, bits))
+      return false;
+    if (info == 26) {
+      const auto bits32 = static_cast<uint32_t>(bits);
+      float value;
+      std::memcpy(&value, &bits32, sizeof(value));
+      out = static_cast<double>(value);
+    } else {
+      double value;
+      std::memcpy(&value, &bits, sizeof(value));
+      out = value;
+    }
+    return true;
+  }
+
+  // Tag 4 [exponent, mantissa] becomes a real; anything else stays as read.
+  static void readDecimal(Value& item) {
+    if (!item.isArray() || item.size() != 2 || !item[0].isInt() ||
+        !item[1].isIntegral())
+      return;
+    const int exponent = item[0].asInt();
+    if (exponent < -static_cast<int>(maxDecimalDigits) || exponent > 0)
+      return;
+    const double mantissa = item[1].asDouble();
+    item = mantissa / pow10Table[-exponent];
+  }
+
+  bool readItem(Value& out) {
+    if (depth_ > stackLimit_)
+      return fail("Exceeded stackLimit while reading CBOR.");
+    if (current_ == end_)
+      return fail("Unexpected end of CBOR input.");
+    const unsigned char initial = *current_++;
+    const auto major = static_cast<CborMajor>(initial >> 5);
+    const auto info = static_cast<unsigned char>(initial & 0x1f);
+    UInt64 arg = 0;
+
+    switch (major) {
+    case cborUnsigned:
+      if (!readArgument(info, arg))
+        return false;
+      if (arg <= static_cast<UInt64>(Value::maxLargestInt))
+        out = static_cast<LargestInt>(arg);
+      else
+        out = arg;
+      return true;
+    case cborNegative:
+      if (!readArgument(info, arg))
+        return false;
+      if (arg <= static_cast<UInt64>(Value::maxLargestInt))
+        out = -static_cast<LargestInt>(arg) - 1;
+      else
+        out = -1.0 - static_cast<double>(arg);
+      return true;
+    case cborBytes:
+    case cborText: {
+      String text;
+      if (!readString(major, info, text))
+        return false;
+      out = Value(text.data(), text.data() + text.size());
+      return true;
+    }
+    case cborArray: {
+      out = Value(arrayValue);
+      const bool indefinite = info == cborIndefinite;
+      if (!indefinite && !readArgument(info, arg))
+        return false;
+      ++depth_;
+      for (UInt64 index = 0; indefinite || index < arg; ++index) {
+        if (indefinite && current_ != end_ && *current_ == cborBreak) {
+          ++current_;
+          break;
+        }
+        if (!readItem(out.append(Value())))
+          return false;
+      }
+      --depth_;
+      return true;
+    }
+    case cborMap: {
+      out = Value(objectValue);
+      const bool indefinite = info == cborIndefinite;
+      if (!indefinite && !readArgument(info, arg))
+        return false;
+      ++depth_;
+      String key;
+      for (UInt64 index = 0; indefinite || index < arg; ++index) {
+        if (indefinite && current_ != end_ && *current_ == cborBreak) {
+          ++current_;
+          break;
+        }
+        key.clear();
+        if (!readKey(key))
+          return false;
+        if (!readItem(*out.demand(key.data(), key.data() + key.size())))
+          return false;
+      }
+      --depth_;
+      return true;
+    }
+    case cborTag:
+      // Tags carry semantics Value cannot represent; keep the tagged item.
+      // Counted like a container level so tag chains cannot bypass
+      // stackLimit.
+      if (!readArgument(info, arg))
+        return false;
+      ++depth_;
+      if (!readItem(out))
+        return false;
+      --depth_;
+      if (arg == decimalTag)
+        readDecimal(out);
+      return true;
+    case cborSimple:
+      switch (initial) {
+      case cborFalse:
+        out = false;
+        return true;
+      case cborTrue:
+        out = true;
+        return true;
+      case cborNull:
+      case cborUndefined:
+        out = Value();
+        return true;
+      case cborFloat16:
+      case cborFloat32:
+      case cborFloat64:
+        return readFloat(info, out);
+      default:
+        return fail("Unsupported CBOR simple value.");
+      }
+    }
+    return fail("Unknown CBOR major type.");
+  }
+
+  const unsigned char* begin_ = nullptr;
+  const unsigned char* end_ = nullptr;
+  const unsigned char* current_ = nullptr;
+  unsigned stackLimit_;
+  unsigned depth_ = 0;
+  String error_;
+};
+
+class CborCharReader : public CharReader {
+  CborReader reader_;
+
+public:
+  explicit CborCharReader(unsigned stackLimit) : reader_(stackLimit) {}
+  bool parse(char const* beginDoc, char const* endDoc, Value* root,
+             String* errs) override {
+    bool ok = reader_.parse(beginDoc, endDoc, *root);
+    if (errs) {
+      *errs = reader_.error();
+    }
+    return ok;
+  }
+};
+
+} // namespace
+
+void writeCbor(Value const& root, String* out) { writeValue(*out, root); }
+
+StreamWriter* CborStreamWriterBuilder::newStreamWriter() const {
+  return new CborStreamWriter();
+}
+
+CharReader* CborCharReaderBuilder::newCharReader() const {
+  return new CborCharReader(stackLimit_);
+}
+
+} // namespace Json
@@ -0,0 +1,306 @@
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "json_tool.h"
+#include <pointer.h>
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cstring>
+#include <utility>
+
+namespace Json {
+
+namespace {
+
+using Cursor = char const*;
+
+Cursor skipSpaces(Cursor c, Cursor end) {
+  while (c != end && (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r'))
+    ++c;
+  return c;
+}
+
+/// \a c is on the opening quote. Returns the position past the closing quote.
+Cursor skipString(Cursor c, Cursor end) {
+  for (++c; c != end; ++c) {
+    if (*c == '\\') {
+      if (++c == end)
+        return nullptr;
+    } else if (*c == '"') {
+      return c + 1;
+    }
+  }
+  return nullptr;
+}
+
+/// \a c is on the first character of a value. Returns the position past it.
+/// Containers are skipped by bracket depth, without recursion.
+Cursor skipValue(Cursor c, Cursor end) {
+  if (c == end)
+    return nullptr;
+  if (*c == '"')
+    return skipString(c, end);
+  if (*c == '{' || *c == '[') {
+    size_t depth = 0;
+    while (c != end) {
+      switch (*c) {
+      case '"':
+        c = skipString(c, end);
+        if (!c)
+          return nullptr;
+        continue;
+      case '{':
+      case '[':
+        ++depth;
+        break;
+      case '}':
+      case ']':
+        if (--depth == 0)
+          return c + 1;
+        break;
+      default:
+        break;
+      }
+      ++c;
+    }
+    return nullptr;
+  }
+  Cursor start = c;
+  while (c != end && *c != ',' && *c != '}' && *c != ']' && *c != ' ' &&
+         *c != '\t' && *c != '\n' && *c != '\r')
+    ++c;
+  return c == start ? nullptr : c;
+}
+
+bool decodeHex4(Cursor c, Cursor end, unsigned int& unicode) {
+  if (end - c < 4)
+    return false;
+  unicode = 0;
+  for (int i = 0; i < 4; ++i, ++c) {
+    unicode *= 16;
+    if (*c >= '0' && *c <= '9')
+      unicode += static_cast<unsigned int>(*c - '0');
+    else if (*c >= 'a' && *c <= 'f')
+      unicode += static_cast<unsigned int>(*c - 'a' + 10);
+    else if (*c >= 'A' && *c <= 'F')
+      unicode += static_cast<unsigned int>(*c - 'A' + 10);
+    else
+      return false;
+  }
+  return true;
+}
+
+/// Compare the raw (still escaped) member name [begin, end) with \a name.
+bool keyEquals(Cursor begin, Cursor end, const String& name) {
+  auto length = static_cast<size_t>(end - begin);
+  if (!memchr(begin, '\\', length))
+    return length == name.size() && memcmp(begin, name.data(), length) == 0;
+
+  size_t pos = 0;
+  for (Cursor c = begin; c != end; ++c) {
+    if (*c != '\\') {
+      if (pos == name.size() || name[pos++] != *c)
+        return false;
+      continue;
+    }
+    if (++c == end)
+      return false;
+    char decoded;
+    switch (*c) {
+    case '"':
+    case '/':
+    case '\\':
+      decoded = *c;
+      break;
+    case 'b':
+      decoded = '\b';
+      break;
+    case 'f':
+      decoded = '\f';
+      break;
+    case 'n':
+      decoded = '\n';
+      break;
+    case 'r':
+      decoded = '\r';
+      break;
+    case 't':
+      decoded = '\t';
+      break;
+    case 'u': {
+      unsigned int unicode;
+      if (!decodeHex4(c + 1, end, unicode))
+        return false;
+      c += 4;
+      if (unicode >= 0xD800 && unicode <= 0xDBFF) {
+        unsigned int surrogate;
+        if (end - c < 7 || c[1] != '\\' || c[2] != 'u' ||
+            !decodeHex4(c + 3, end, surrogate))
+          return false;
+        unicode = 0x10000 + ((unicode & 0x3FF) << 10) + (surrogate & 0x3FF);
+        c += 6;
+      }
+      String utf8 = codePointToUTF8(unicode);
+      if (name.compare(pos, utf8.size(), utf8) != 0)
+        return false;
+      pos += utf8.size();
+      continue;
+    }
+    default:
+      return false;
+    }
+    if (pos == name.size() || name[pos++] != decoded)
+      return false;
+  }
+  return pos == name.size();
+}
+
+} // namespace
+
+Pointer::Pointer() = default;
+
+Pointer::Pointer(const char* pointer) {
+  compile(pointer, pointer + strlen(pointer));
+}
+
+Pointer::Pointer(const String& pointer) {
+  compile(pointer.data(), pointer.data() + pointer.size());
+}
+
+void Pointer::compile(char const* begin, char const* end) {
+  if (begin == end)
+    return;
+  if (*begin != '/') {
+    valid_ = false;
+    return;
+  }
+  while (begin != end) {
+    ++begin; // skip '/'
+    Token token;
+    Cursor c = begin;
+    for (; c != end && *c != '/'; ++c) {
+      if (*c != '~') {
+        token.name += *c;
+        continue;
+      }
+      if (c + 1 == end || (c[1] != '0' && c[1] != '1')) {
+        tokens_.clear();
+        valid_ = false;
+        return;
+      }
+      token.name += (*++c == '0') ? '~' : '/';
+    }
+    // RFC 6901: "0" or a digit string without leading zeros.
+    token.index = noIndex;
+    const String& n = token.name;
+    if (!n.empty() && n.size() <= 10 && (n[0] != '0' || n.size() == 1)) {
+      LargestUInt index = 0;
+      size_t i = 0;
+      for (; i < n.size() && n[i] >= '0' && n[i] <= '9'; ++i)
+        index = index * 10 + static_cast<LargestUInt>(n[i] - '0');
+      if (i == n.size() && index < noIndex)
+        token.index = static_cast<ArrayIndex>(index);
+    }
+    tokens_.push_back(std::move(token));
+    begin = c;
+  }
+}
+
+Value const* Pointer::find(Value const& root) const {
+  if (!valid_)
+    return nullptr;
+  Value const* node = &root;
+  for (const Token& token : tokens_) {
+    if (node->isArray()) {
+      if (token.index == noIndex || token.index >= node->size())
+        return nullptr;
+      node = &(*node)[token.index];
+    } else if (node->isObject()) {
+      node = node->find(token.name.data(),
+                        token.name.data() + token.name.size());
+      if (!node)
+        return nullptr;
+    } else {
+      return nullptr;
+    }
+  }
+  return node;
+}
+
+Value* Pointer::find(Value& root) const {
+  return const_cast<Value*>(find(static_cast<Value const&>(root)));
+}
+
+bool Pointer::findSpan(char const* begin, char const* end,
+                       char const** valueBegin, char const** valueEnd) const {
+  if (!valid_)
+    return false;
+  Cursor c = skipSpaces(begin, end);
+  for (const Token& token : tokens_) {
+    if (c == end)
+      return false;
+    if (*c == '{') {
+      ++c;
+      while (true) {
+        c = skipSpaces(c, end);
+        if (c == end || *c != '"')
+          return false; // '}' (not found) or malformed
+        Cursor nameBegin = c + 1;
+        Cursor nameEnd = skipString(c, end);
+        if (!nameEnd)
+          return false;
+        c = skipSpaces(nameEnd, end);
+        if (c == end || *c != ':')
+          return false;
+        c = skipSpaces(c + 1, end);
+        if (keyEquals(nameBegin, nameEnd - 1, token.name))
+          break;
+        c = skipValue(c, end);
+        if (!c)
+          return false;
+        c = skipSpaces(c, end);
+        if (c == end || *c != ',')
+          return false;
+        ++c;
+      }
+    } else if (*c == '[') {
+      if (token.index == noIndex)
+        return false;
+      ++c;
+      for (ArrayIndex index = 0;; ++index) {
+        c = skipSpaces(c, end);
+        if (c == end || *c == ']')
+          return false;
+        if (index == token.index)
+          break;
+        c = skipValue(c, end);
+        if (!c)
+          return false;
+        c = skipSpaces(c, end);
+        if (c == end || *c != ',')
+          return false;
+        ++c;
+      }
+    } else {
+      return false;
+    }
+  }
+  Cursor valueStop = skipValue(c, end);
+  if (!valueStop)
+    return false;
+  *valueBegin = c;
+  *valueEnd = valueStop;
+  return true;
+}
+
+bool Pointer::find(char const* begin, char const* end, CharReader& reader,
+                   Value* out) const {
+  char const* valueBegin;
+  char const* valueEnd;
+  if (!findSpan(begin, end, &valueBegin, &valueEnd))
+    return false;
+  return reader.parse(valueBegin, valueEnd, out, nullptr);
+}
+
+} // namespace Json
@@ -881,12 +881,57 @@ public:
 
 OurFeatures OurFeatures::all() { return {}; }
 
+// Feature policies for OurReader.
+//
+// OurRuntimePolicy reads every extension flag from OurFeatures, so the
+// CharReaderBuilder settings decide at parse time. OurStrictTrustedPolicy is
+// used for machine-generated RFC 8259 documents: every extension is a
+// compile-time false, so the comment, single-quote, special-float and
+// dropped-null branches disappear from the tokenizer loop.
+struct OurRuntimePolicy {
+  static constexpr bool lexExtensions = true;
+  static bool allowComments(OurFeatures const& f) { return f.allowComments_; }
+  static bool allowTrailingCommas(OurFeatures const& f) {
+    return f.allowTrailingCommas_;
+  }
+  static bool allowDroppedNullPlaceholders(OurFeatures const& f) {
+    return f.allowDroppedNullPlaceholders_;
+  }
+  static bool allowNumericKeys(OurFeatures const& f) {
+    return f.allowNumericKeys_;
+  }
+  static bool allowSingleQuotes(OurFeatures const& f) {
+    return f.allowSingleQuotes_;
+  }
+  static bool rejectDupKeys(OurFeatures const& f) { return f.rejectDupKeys_; }
+  static bool allowSpecialFloats(OurFeatures const& f) {
+    return f.allowSpecialFloats_;
+  }
+};
+
+struct OurStrictTrustedPolicy {
+  static constexpr bool lexExtensions = false;
+  static constexpr bool allowComments(OurFeatures const&) { return false; }
+  static constexpr bool allowTrailingCommas(OurFeatures const&) {
+    return false;
+  }
+  static constexpr bool allowDroppedNullPlaceholders(OurFeatures const&) {
+    return false;
+  }
+  static constexpr bool allowNumericKeys(OurFeatures const&) { return false; }
+  static constexpr bool allowSingleQuotes(OurFeatures const&) { return false; }
+  static constexpr bool rejectDupKeys(OurFeatures const&) { return false; }
+  static constexpr bool allowSpecialFloats(OurFeatures const&) {
+    return false;
+  }
+};
+
 // Implementation of class Reader
 // ////////////////////////////////
 
 // Originally copied from the Reader class (now deprecated), used internally
 // for implementing JSON reading.
-class OurReader {
+template <typename Policy> class OurReader {
 public:
   using Char = char;
   using Location = const Char*;
@@ -981,6 +1026,10 @@ private:
   static String normalizeEOL(Location begin, Location end);
   static bool containsNewLine(Location begin, Location end);
 
+  bool collectingComments() const {
+    return Policy::allowComments(features_) && collectComments_;
+  }
+
   using Nodes = std::stack<Value*>;
 
   Nodes nodes_{};
@@ -1000,16 +1049,20 @@ private:
 
 // complete copy of Read impl, for OurReader
 
-bool OurReader::containsNewLine(OurReader::Location begin,
-                                OurReader::Location end) {
+template <typename Policy>
+bool OurReader<Policy>::containsNewLine(OurReader::Location begin,
+                                        OurReader::Location end) {
   return std::any_of(begin, end, [](char b) { return b == '\n' || b == '\r'; });
 }
 
-OurReader::OurReader(OurFeatures const& features) : features_(features) {}
+template <typename Policy>
+OurReader<Policy>::OurReader(OurFeatures const& features)
+    : features_(features) {}
 
-bool OurReader::parse(const char* beginDoc, const char* endDoc, Value& root,
-                      bool collectComments) {
-  if (!features_.allowComments_) {
+template <typename Policy>
+bool OurReader<Policy>::parse(const char* beginDoc, const char* endDoc,
+                              Value& root, bool collectComments) {
+  if (!Policy::allowComments(features_)) {
     collectComments = false;
   }
 
@@ -1035,7 +1088,7 @@ bool OurReader::parse(const char* beginDoc, const char* endDoc, Value& root,
     addError("Extra non-whitespace after JSON value.", token);
     return false;
   }
-  if (collectComments_ && !commentsBefore_.empty())
+  if (collectingComments() && !commentsBefore_.empty())
     root.setComment(commentsBefore_, commentAfter);
   if (features_.strictRoot_) {
     if (!root.isArray() && !root.isObject()) {
@@ -1053,7 +1106,8 @@ bool OurReader::parse(const char* beginDoc, const char* endDoc, Value& root,
   return successful;
 }
 
-bool OurReader::readValue() {
+template <typename Policy>
+bool OurReader<Policy>::readValue() {
   //  To preserve the old behaviour we cast size_t to int.
   if (nodes_.size() > features_.stackLimit_)
     throwRuntimeError("Exceeded stackLimit in readValue().");
@@ -1061,7 +1115,7 @@ bool OurReader::readValue() {
   skipCommentTokens(token);
   bool successful = true;
 
-  if (collectComments_ && !commentsBefore_.empty()) {
+  if (collectingComments() && !commentsBefore_.empty()) {
     currentValue().setComment(commentsBefore_, commentBefore);
     commentsBefore_.clear();
   }
@@ -1120,7 +1174,7 @@ bool OurReader::readValue() {
   case tokenArraySeparator:
   case tokenObjectEnd:
   case tokenArrayEnd:
-    if (features_.allowDroppedNullPlaceholders_) {
+    if (Policy::allowDroppedNullPlaceholders(features_)) {
       // "Un-read" the current token and mark the current value as a null
       // token.
       current_--;
@@ -1136,7 +1190,7 @@ bool OurReader::readValue() {
     return addError("Syntax error: value, object or array expected.", token);
   }
 
-  if (collectComments_) {
+  if (collectingComments()) {
     lastValueEnd_ = current_;
     lastValueHasAComment_ = false;
     lastValue_ = &currentValue();
@@ -1145,8 +1199,9 @@ bool OurReader::readValue() {
   return successful;
 }
 
-void OurReader::skipCommentTokens(Token& token) {
-  if (features_.allowComments_) {
+template <typename Policy>
+void OurReader<Policy>::skipCommentTokens(Token& token) {
+  if (Policy::allowComments(features_)) {
     do {
       readToken(token);
     } while (token.type_ == tokenComment);
@@ -1155,7 +1210,8 @@ void OurReader::skipCommentTokens(Token& token) {
   }
 }
 
-bool OurReader::readToken(Token& token) {
+template <typename Policy>
+bool OurReader<Policy>::readToken(Token& token) {
   skipSpaces();
   token.start_ = current_;
   Char c = getNextChar();
@@ -1178,7 +1234,7 @@ bool OurReader::readToken(Token& token) {
     ok = readString();
     break;
   case '\'':
-    if (features_.allowSingleQuotes_) {
+    if (Policy::allowSingleQuotes(features_)) {
       token.type_ = tokenString;
       ok = readStringSingleQuote();
     } else {
@@ -1187,8 +1243,12 @@ bool OurReader::readToken(Token& token) {
     }
     break;
   case '/':
-    token.type_ = tokenComment;
-    ok = readComment();
+    if (Policy::lexExtensions) {
+      token.type_ = tokenComment;
+      ok = readComment();
+    } else {
+      ok = false;
+    }
     break;
   case '0':
   case '1':
@@ -1204,19 +1264,21 @@ bool OurReader::readToken(Token& token) {
     readNumber(false);
     break;
   case '-':
-    if (readNumber(true)) {
+    if (readNumber(Policy::lexExtensions)) {
       token.type_ = tokenNumber;
     } else {
       token.type_ = tokenNegInf;
-      ok = features_.allowSpecialFloats_ && match("nfinity", 7);
+      ok = Policy::allowSpecialFloats(features_) && match("nfinity", 7);
     }
     break;
   case '+':
-    if (readNumber(true)) {
+    if (!Policy::lexExtensions) {
+      ok = false;
+    } else if (readNumber(true)) {
       token.type_ = tokenNumber;
     } else {
       token.type_ = tokenPosInf;
-      ok = features_.allowSpecialFloats_ && match("nfinity", 7);
+      ok = Policy::allowSpecialFloats(features_) && match("nfinity", 7);
     }
     break;
   case 't':
@@ -1232,7 +1294,7 @@ bool OurReader::readToken(Token& token) {
     ok = match("ull", 3);
     break;
   case 'N':
-    if (features_.allowSpecialFloats_) {
+    if (Policy::allowSpecialFloats(features_)) {
       token.type_ = tokenNaN;
       ok = match("aN", 2);
     } else {
@@ -1240,7 +1302,7 @@ bool OurReader::readToken(Token& token) {
     }
     break;
   case 'I':
-    if (features_.allowSpecialFloats_) {
+    if (Policy::allowSpecialFloats(features_)) {
       token.type_ = tokenPosInf;
       ok = match("nfinity", 7);
     } else {
@@ -1266,7 +1328,8 @@ bool OurReader::readToken(Token& token) {
   return ok;
 }
 
-void OurReader::skipSpaces() {
+template <typename Policy>
+void OurReader<Policy>::skipSpaces() {
   while (current_ != end_) {
     Char c = *current_;
     if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
@@ -1276,7 +1339,8 @@ void OurReader::skipSpaces() {
   }
 }
 
-void OurReader::skipBom(bool skipBom) {
+template <typename Policy>
+void OurReader<Policy>::skipBom(bool skipBom) {
   // The default behavior is to skip BOM.
   if (skipBom) {
     if ((end_ - begin_) >= 3 && strncmp(begin_, "\xEF\xBB\xBF", 3) == 0) {
@@ -1286,7 +1350,8 @@ void OurReader::skipBom(bool skipBom) {
   }
 }
 
-bool OurReader::match(const Char* pattern, int patternLength) {
+template <typename Policy>
+bool OurReader<Policy>::match(const Char* pattern, int patternLength) {
   if (end_ - current_ < patternLength)
     return false;
   int index = patternLength;
@@ -1297,7 +1362,8 @@ bool OurReader::match(const Char* pattern, int patternLength) {
   return true;
 }
 
-bool OurReader::readComment() {
+template <typename Policy>
+bool OurReader<Policy>::readComment() {
   const Location commentBegin = current_ - 1;
   const Char c = getNextChar();
   bool successful = false;
@@ -1331,8 +1397,9 @@ bool OurReader::readComment() {
   return true;
 }
 
-String OurReader::normalizeEOL(OurReader::Location begin,
-                               OurReader::Location end) {
+template <typename Policy>
+String OurReader<Policy>::normalizeEOL(OurReader::Location begin,
+                                       OurReader::Location end) {
   String normalized;
   normalized.reserve(static_cast<size_t>(end - begin));
   OurReader::Location current = begin;
@@ -1351,8 +1418,9 @@ String OurReader::normalizeEOL(OurReader::Location begin,
   return normalized;
 }
 
-void OurReader::addComment(Location begin, Location end,
-                           CommentPlacement placement) {
+template <typename Policy>
+void OurReader<Policy>::addComment(Location begin, Location end,
+                                   CommentPlacement placement) {
   assert(collectComments_);
   const String& normalized = normalizeEOL(begin, end);
   if (placement == commentAfterOnSameLine) {
@@ -1363,7 +1431,8 @@ void OurReader::addComment(Location begin, Location end,
   }
 }
 
-bool OurReader::readCStyleComment(bool* containsNewLineResult) {
+template <typename Policy>
+bool OurReader<Policy>::readCStyleComment(bool* containsNewLineResult) {
   *containsNewLineResult = false;
 
   while ((current_ + 1) < end_) {
@@ -1377,7 +1446,8 @@ bool OurReader::readCStyleComment(bool* containsNewLineResult) {
   return getNextChar() == '/';
 }
 
-bool OurReader::readCppStyleComment() {
+template <typename Policy>
+bool OurReader<Policy>::readCppStyleComment() {
   while (current_ != end_) {
     Char c = getNextChar();
     if (c == '\n')
@@ -1393,7 +1463,8 @@ bool OurReader::readCppStyleComment() {
   return true;
 }
 
-bool OurReader::readNumber(bool checkInf) {
+template <typename Policy>
+bool OurReader<Policy>::readNumber(bool checkInf) {
   Location p = current_;
   if (checkInf && p != end_ && *p == 'I') {
     current_ = ++p;
@@ -1419,7 +1490,8 @@ bool OurReader::readNumber(bool checkInf) {
   }
   return true;
 }
-bool OurReader::readString() {
+template <typename Policy>
+bool OurReader<Policy>::readString() {
   Char c = 0;
   while (current_ != end_) {
     c = getNextChar();
@@ -1431,7 +1503,8 @@ bool OurReader::readString() {
   return c == '"';
 }
 
-bool OurReader::readStringSingleQuote() {
+template <typename Policy>
+bool OurReader<Policy>::readStringSingleQuote() {
   Char c = 0;
   while (current_ != end_) {
     c = getNextChar();
@@ -1443,7 +1516,8 @@ bool OurReader::readStringSingleQuote() {
   return c == '\'';
 }
 
-bool OurReader::readObject(Token& token) {
+template <typename Policy>
+bool OurReader<Policy>::readObject(Token& token) {
   Token tokenName;
   String name;
   Value init(objectValue);
@@ -1456,14 +1530,15 @@ bool OurReader::readObject(Token& token) {
     if (!initialTokenOk)
       break;
     if (tokenName.type_ == tokenObjectEnd &&
-        (name.empty() ||
-         features_.allowTrailingCommas_)) // empty object or trailing comma
+        (name.empty() || Policy::allowTrailingCommas(
+                              features_))) // empty object or trailing comma
       return true;
     name.clear();
     if (tokenName.type_ == tokenString) {
       if (!decodeString(tokenName, name))
         return recoverFromError(tokenObjectEnd);
-    } else if (tokenName.type_ == tokenNumber && features_.allowNumericKeys_) {
+    } else if (tokenName.type_ == tokenNumber &&
+               Policy::allowNumericKeys(features_)) {
       Value numberName;
       if (!decodeNumber(tokenName, numberName))
         return recoverFromError(tokenObjectEnd);
@@ -1473,7 +1548,7 @@ bool OurReader::readObject(Token& token) {
     }
     if (name.length() >= (1U << 30))
       throwRuntimeError("keylength >= 2^30");
-    if (features_.rejectDupKeys_ && currentValue().isMember(name)) {
+    if (Policy::rejectDupKeys(features_) && currentValue().isMember(name)) {
       String msg = "Duplicate key: '" + name + "'";
       return addErrorAndRecover(msg, tokenName, tokenObjectEnd);
     }
@@ -1507,7 +1582,8 @@ bool OurReader::readObject(Token& token) {
                             tokenObjectEnd);
 }
 
-bool OurReader::readArray(Token& token) {
+template <typename Policy>
+bool OurReader<Policy>::readArray(Token& token) {
   Value init(arrayValue);
   currentValue().swapPayload(init);
   currentValue().setOffsetStart(token.start_ - begin_);
@@ -1516,9 +1592,9 @@ bool OurReader::readArray(Token& token) {
     skipSpaces();
     if (current_ != end_ && *current_ == ']' &&
         (index == 0 ||
-         (features_.allowTrailingCommas_ &&
-          !features_.allowDroppedNullPlaceholders_))) // empty array or trailing
-                                                      // comma
+         (Policy::allowTrailingCommas(features_) &&
+          !Policy::allowDroppedNullPlaceholders(
+              features_)))) // empty array or trailing comma
     {
       Token endArray;
       readToken(endArray);
@@ -1549,7 +1625,8 @@ bool OurReader::readArray(Token& token) {
   return true;
 }
 
-bool OurReader::decodeNumber(Token& token) {
+template <typename Policy>
+bool OurReader<Policy>::decodeNumber(Token& token) {
   Value decoded;
   if (!decodeNumber(token, decoded))
     return false;
@@ -1559,7 +1636,8 @@ bool OurReader::decodeNumber(Token& token) {
   return true;
 }
 
-bool OurReader::decodeNumber(Token& token, Value& decoded) {
+template <typename Policy>
+bool OurReader<Policy>::decodeNumber(Token& token, Value& decoded) {
   // Attempts to parse the number as an integer. If the number is
   // larger than the maximum supported value of an integer then
   // we decode the number as a double.
@@ -1639,7 +1717,8 @@ bool OurReader::decodeNumber(Token& token, Value& decoded) {
   return true;
 }
 
-bool OurReader::decodeDouble(Token& token) {
+template <typename Policy>
+bool OurReader<Policy>::decodeDouble(Token& token) {
   Value decoded;
   if (!decodeDouble(token, decoded))
     return false;
@@ -1649,7 +1728,8 @@ bool OurReader::decodeDouble(Token& token) {
   return true;
 }
 
-bool OurReader::decodeDouble(Token& token, Value& decoded) {
+template <typename Policy>
+bool OurReader<Policy>::decodeDouble(Token& token, Value& decoded) {
   double value = 0;
   const String buffer(token.start_, token.end_);
   IStringStream is(buffer);
@@ -1666,7 +1746,8 @@ bool OurReader::decodeDouble(Token& token, Value& decoded) {
   return true;
 }
 
-bool OurReader::decodeString(Token& token) {
+template <typename Policy>
+bool OurReader<Policy>::decodeString(Token& token) {
   String decoded_string;
   if (!decodeString(token, decoded_string))
     return false;
@@ -1677,7 +1758,8 @@ bool OurReader::decodeString(Token& token) {
   return true;
 }
 
-bool OurReader::decodeString(Token& token, String& decoded) {
+template <typename Policy>
+bool OurReader<Policy>::decodeString(Token& token, String& decoded) {
   decoded.reserve(static_cast<size_t>(token.end_ - token.start_ - 2));
   Location current = token.start_ + 1; // skip '"'
   Location end = token.end_ - 1;       // do not include '"'
@@ -1730,8 +1812,10 @@ bool OurReader::decodeString(Token& token, String& decoded) {
   return true;
 }
 
-bool OurReader::decodeUnicodeCodePoint(Token& token, Location& current,
-                                       Location end, unsigned int& unicode) {
+template <typename Policy>
+bool OurReader<Policy>::decodeUnicodeCodePoint(Token& token,
+                                               Location& current, Location end,
+                                               unsigned int& unicode) {
 
   if (!decodeUnicodeEscapeSequence(token, current, end, unicode))
     return false;
@@ -1755,9 +1839,9 @@ bool OurReader::decodeUnicodeCodePoint(Token& token, Location& current,
   return true;
 }
 
-bool OurReader::decodeUnicodeEscapeSequence(Token& token, Location& current,
-                                            Location end,
-                                            unsigned int& ret_unicode) {
+template <typename Policy>
+bool OurReader<Policy>::decodeUnicodeEscapeSequence(
+    Token& token, Location& current, Location end, unsigned int& ret_unicode) {
   if (end - current < 4)
     return addError(
         "Bad unicode escape sequence in string: four digits expected.", token,
@@ -1781,7 +1865,9 @@ bool OurReader::decodeUnicodeEscapeSequence(Token& token, Location& current,
   return true;
 }
 
-bool OurReader::addError(const String& message, Token& token, Location extra) {
+template <typename Policy>
+bool OurReader<Policy>::addError(const String& message, Token& token,
+                                 Location extra) {
   ErrorInfo info;
   info.token_ = token;
   info.message_ = message;
@@ -1790,7 +1876,8 @@ bool OurReader::addError(const String& message, Token& token, Location extra) {
   return false;
 }
 
-bool OurReader::recoverFromError(TokenType skipUntilToken) {
+template <typename Policy>
+bool OurReader<Policy>::recoverFromError(TokenType skipUntilToken) {
   size_t errorCount = errors_.size();
   Token skip;
   for (;;) {
@@ -1803,22 +1890,26 @@ bool OurReader::recoverFromError(TokenType skipUntilToken) {
   return false;
 }
 
-bool OurReader::addErrorAndRecover(const String& message, Token& token,
-                                   TokenType skipUntilToken) {
+template <typename Policy>
+bool OurReader<Policy>::addErrorAndRecover(const String& message, Token& token,
+                                           TokenType skipUntilToken) {
   addError(message, token);
   return recoverFromError(skipUntilToken);
 }
 
-Value& OurReader::currentValue() { return *(nodes_.top()); }
+template <typename Policy>
+Value& OurReader<Policy>::currentValue() { return *(nodes_.top()); }
 
-OurReader::Char OurReader::getNextChar() {
+template <typename Policy>
+typename OurReader<Policy>::Char OurReader<Policy>::getNextChar() {
   if (current_ == end_)
     return 0;
   return *current_++;
 }
 
-void OurReader::getLocationLineAndColumn(Location location, int& line,
-                                         int& column) const {
+template <typename Policy>
+void OurReader<Policy>::getLocationLineAndColumn(Location location, int& line,
+                                                 int& column) const {
   Location current = begin_;
   Location lastLineStart = current;
   line = 0;
@@ -1839,7 +1930,8 @@ void OurReader::getLocationLineAndColumn(Location location, int& line,
   ++line;
 }
 
-String OurReader::getLocationLineAndColumn(Location location) const {
+template <typename Policy>
+String OurReader<Policy>::getLocationLineAndColumn(Location location) const {
   int line, column;
   getLocationLineAndColumn(location, line, column);
   char buffer[18 + 16 + 16 + 1];
@@ -1847,7 +1939,8 @@ String OurReader::getLocationLineAndColumn(Location location) const {
   return buffer;
 }
 
-String OurReader::getFormattedErrorMessages() const {
+template <typename Policy>
+String OurReader<Policy>::getFormattedErrorMessages() const {
   String formattedMessage;
   for (const auto& error : errors_) {
     formattedMessage +=
@@ -1860,7 +1953,9 @@ String OurReader::getFormattedErrorMessages() const {
   return formattedMessage;
 }
 
-std::vector<OurReader::StructuredError> OurReader::getStructuredErrors() const {
+template <typename Policy>
+std::vector<typename OurReader<Policy>::StructuredError>
+OurReader<Policy>::getStructuredErrors() const {
   std::vector<OurReader::StructuredError> allErrors;
   for (const auto& error : errors_) {
     OurReader::StructuredError structured;
@@ -1872,9 +1967,9 @@ std::vector<OurReader::StructuredError> OurReader::getStructuredErrors() const {
   return allErrors;
 }
 
-class OurCharReader : public CharReader {
+template <typename Policy> class OurCharReader : public CharReader {
   bool const collectComments_;
-  OurReader reader_;
+  OurReader<Policy> reader_;
 
 public:
   OurCharReader(bool collectComments, OurFeatures const& features)
@@ -1909,7 +2004,9 @@ CharReader* CharReaderBuilder::newCharReader() const {
   features.rejectDupKeys_ = settings_["rejectDupKeys"].asBool();
   features.allowSpecialFloats_ = settings_["allowSpecialFloats"].asBool();
   features.skipBom_ = settings_["skipBom"].asBool();
-  return new OurCharReader(collectComments, features);
+  if (settings_["strictTrusted"].asBool())
+    return new OurCharReader<OurStrictTrustedPolicy>(false, features);
+  return new OurCharReader<OurRuntimePolicy>(collectComments, features);
 }
 
 bool CharReaderBuilder::validate(Json::Value* invalid) const {
@@ -1926,6 +2023,7 @@ bool CharReaderBuilder::validate(Json::Value* invalid) const {
       "rejectDupKeys",
       "allowSpecialFloats",
       "skipBom",
+      "strictTrusted",
   };
   for (auto si = settings_.begin(); si != settings_.end(); ++si) {
     auto key = si.name();
@@ -1959,6 +2057,24 @@ void CharReaderBuilder::strictMode(Json::Value* settings) {
   //! [CharReaderBuilderStrictMode]
 }
 // static
+void CharReaderBuilder::strictTrustedMode(Json::Value* settings) {
+  //! [CharReaderBuilderStrictTrustedMode]
+  (*settings)["collectComments"] = false;
+  (*settings)["allowComments"] = false;
+  (*settings)["allowTrailingCommas"] = false;
+  (*settings)["strictRoot"] = false;
+  (*settings)["allowDroppedNullPlaceholders"] = false;
+  (*settings)["allowNumericKeys"] = false;
+  (*settings)["allowSingleQuotes"] = false;
+  (*settings)["stackLimit"] = 1000;
+  (*settings)["failIfExtra"] = false;
+  (*settings)["rejectDupKeys"] = false;
+  (*settings)["allowSpecialFloats"] = false;
+  (*settings)["skipBom"] = false;
+  (*settings)["strictTrusted"] = true;
+  //! [CharReaderBuilderStrictTrustedMode]
+}
+// static
 void CharReaderBuilder::setDefaults(Json::Value* settings) {
   //! [CharReaderBuilderDefaults]
   (*settings)["collectComments"] = true;
@@ -1973,6 +2089,7 @@ void CharReaderBuilder::setDefaults(Json::Value* settings) {
   (*settings)["rejectDupKeys"] = false;
   (*settings)["allowSpecialFloats"] = false;
   (*settings)["skipBom"] = true;
+  (*settings)["strictTrusted"] = false;
   //! [CharReaderBuilderDefaults]
 }
 
@@ -1047,8 +1047,7 @@ Value& Value::resolveReference(const char* key) {
   if (it != value_.map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
+  it = value_.map_->emplace_hint(it, std::move(actualKey), Value());
   Value& value = (*it).second;
   return value;
 }
@@ -1066,8 +1065,9 @@ Value& Value::resolveReference(char const* key, char const* end) {
   if (it != value_.map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
+  // Duplicate the key once; the map node takes it by move.
+  CZString ownedKey(actualKey);
+  it = value_.map_->emplace_hint(it, std::move(ownedKey), Value());
   Value& value = (*it).second;
   return value;
 }
@@ -1123,6 +1123,22 @@ Value& Value::operator[](const StaticString& key) {
   return resolveReference(key.c_str());
 }
 
+Value& Value::emplace(const char* key, Value&& value) {
+  return emplace(key, key + strlen(key), std::move(value));
+}
+
+Value& Value::emplace(const String& key, Value&& value) {
+  return emplace(key.data(), key.data() + key.length(), std::move(value));
+}
+
+Value& Value::emplace(char const* begin, char const* end, Value&& value) {
+  JSON_ASSERT_MESSAGE(type() == nullValue || type() == objectValue,
+                      "in Json::Value::emplace: requires objectValue");
+  Value& member = resolveReference(begin, end);
+  member.swapPayload(value);
+  return member;
+}
+
 Value& Value::append(const Value& value) { return append(Value(value)); }
 
 Value& Value::append(Value&& value) {
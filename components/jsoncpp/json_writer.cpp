@@ -353,6 +353,77 @@ String valueToQuotedString(const char* value) {
   return valueToQuotedStringN(value, strlen(value));
 }
 
+/// Length of valueToQuotedStringN(value, length) without building it.
+static size_t quotedStringLength(const char* value, size_t length) {
+  if (value == nullptr)
+    return 0;
+  if (!doesAnyCharRequireEscaping(value, length))
+    return length + 2;
+  size_t result = 2;
+  char const* end = value + length;
+  for (const char* c = value; c != end; ++c) {
+    switch (*c) {
+    case '\"':
+    case '\\':
+    case '\b':
+    case '\f':
+    case '\n':
+    case '\r':
+    case '\t':
+      result += 2;
+      break;
+    default: {
+      unsigned codepoint = utf8ToCodepoint(c, end); // modifies `c`
+      if (codepoint < 0x20)
+        result += 6;
+      else if (codepoint < 0x80)
+        result += 1;
+      else if (codepoint < 0x10000)
+        result += 6;
+      else
+        result += 12; // surrogate pair
+    } break;
+    }
+  }
+  return result;
+}
+
+/// Length of valueToString(value) without allocating.
+static size_t largestUIntLength(LargestUInt value) {
+  size_t digits = 1;
+  while (value >= 10) {
+    value /= 10;
+    ++digits;
+  }
+  return digits;
+}
+
+static size_t largestIntLength(LargestInt value) {
+  if (value >= 0)
+    return largestUIntLength(LargestUInt(value));
+  // -(value + 1) avoids overflow on minLargestInt.
+  return 1 + largestUIntLength(LargestUInt(-(value + 1)) + 1);
+}
+
+/// Length of valueToString(value) with the default precision, formatted on
+/// the stack instead of in a heap String.
+static size_t realLength(double value) {
+  if (!isfinite(value))
+    return isnan(value) ? 4 : (value < 0) ? 8 : 7; // null, -1e+9999, 1e+9999
+  char buffer[36];
+  int len = jsoncpp_snprintf(buffer, sizeof(buffer), "%.*g",
+                             Value::defaultRealPrecision, value);
+  assert(len >= 0 && static_cast<size_t>(len) < sizeof(buffer));
+  auto result = static_cast<size_t>(len);
+  bool hasDotOrExp = false;
+  for (size_t i = 0; i < result; ++i) {
+    // fixNumericLocale() turns ',' into '.'.
+    if (buffer[i] == '.' || buffer[i] == ',' || buffer[i] == 'e')
+      hasDotOrExp = true;
+  }
+  return hasDotOrExp ? result : result + 2; // ".0"
+}
+
 // Class Writer
 // //////////////////////////////////////////////////////////////////
 Writer::~Writer() = default;
@@ -372,12 +443,65 @@ void FastWriter::omitEndingLineFeed() { omitEndingLineFeed_ = true; }
 
 String FastWriter::write(const Value& root) {
   document_.clear();
+  document_.reserve(measure(root));
   writeValue(root);
   if (!omitEndingLineFeed_)
     document_ += '\n';
   return document_;
 }
 
+String::size_type FastWriter::measure(const Value& root) const {
+  size_t size = measureValue(root);
+  if (!omitEndingLineFeed_)
+    ++size;
+  return size;
+}
+
+size_t FastWriter::measureValue(const Value& value) const {
+  switch (value.type()) {
+  case nullValue:
+    return dropNullPlaceholders_ ? 0 : 4;
+  case intValue:
+    return largestIntLength(value.asLargestInt());
+  case uintValue:
+    return largestUIntLength(value.asLargestUInt());
+  case realValue:
+    return realLength(value.asDouble());
+  case stringValue: {
+    char const* str;
+    char const* end;
+    if (!value.getString(&str, &end))
+      return 0;
+    return quotedStringLength(str, static_cast<size_t>(end - str));
+  }
+  case booleanValue:
+    return value.asBool() ? 4 : 5;
+  case arrayValue: {
+    ArrayIndex size = value.size();
+    size_t result = 2 + (size > 0 ? size - 1 : 0); // brackets and commas
+    for (ArrayIndex index = 0; index < size; ++index)
+      result += measureValue(value[index]);
+    return result;
+  }
+  case objectValue: {
+    // Member order does not change the length, so walk the map directly
+    // instead of copying the names like writeValue() does.
+    const size_t separator = yamlCompatibilityEnabled_ ? 2 : 1;
+    size_t result = 2;
+    for (auto it = value.begin(); it != value.end(); ++it) {
+      if (it != value.begin())
+        ++result;
+      char const* end;
+      char const* name = it.memberName(&end);
+      result += quotedStringLength(name, static_cast<size_t>(end - name));
+      result += separator + measureValue(*it);
+    }
+    return result;
+  }
+  }
+  return 0;
+}
+
 void FastWriter::writeValue(const Value& value) {
   switch (value.type()) {
   case nullValue:
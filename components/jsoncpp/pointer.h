@@ -0,0 +1,87 @@
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef JSON_POINTER_H_INCLUDED
+#define JSON_POINTER_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "reader.h"
+#include "value.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <vector>
+
+#pragma pack(push)
+#pragma pack()
+
+namespace Json {
+
+/** \brief Precompiled <a HREF="https://www.rfc-editor.org/rfc/rfc6901">JSON
+ * Pointer</a> (RFC 6901).
+ *
+ * The pointer text is parsed once: "~1" and "~0" escapes are decoded and
+ * array indices are converted up front, so a Pointer can be kept (e.g. as a
+ * static) and resolved against many documents without re-parsing or
+ * allocating.
+ *
+ * A pointer can be resolved against a Value tree, or directly against a JSON
+ * text buffer, in which case only the addressed sub-value is located (and
+ * optionally parsed); the rest of the document is skipped, never built.
+ *
+ * Usage:
+ *   \code
+ *   static const Json::Pointer token("/access_token");
+ *   const Json::Value* v = token.find(root);
+ *   if (v && v->isString()) ...
+ *   \endcode
+ */
+class JSON_API Pointer {
+public:
+  /// The empty pointer; it refers to the whole document.
+  Pointer();
+  /// Compile \a pointer (string representation, e.g. "/a/0/b~1c").
+  explicit Pointer(const char* pointer);
+  explicit Pointer(const String& pointer);
+
+  /// False if the text did not start with '/' or held a bad '~' escape.
+  /// An invalid pointer resolves to nothing.
+  bool isValid() const { return valid_; }
+  /// Number of reference tokens.
+  size_t size() const { return tokens_.size(); }
+
+  /// Resolve against a tree. Returns nullptr if any token is missing.
+  Value const* find(Value const& root) const;
+  Value* find(Value& root) const;
+
+  /** \brief Locate the sub-value in the JSON text [\a begin, \a end).
+   *
+   * On success [\a *valueBegin, \a *valueEnd) is the exact text of the value
+   * (no surrounding whitespace). The buffer is only scanned, so malformed
+   * input outside the path taken may go unnoticed.
+   * \return false if the path does not exist or the text is malformed.
+   */
+  bool findSpan(char const* begin, char const* end, char const** valueBegin,
+                char const** valueEnd) const;
+
+  /// findSpan() and then parse just that span with \a reader into \a out.
+  bool find(char const* begin, char const* end, CharReader& reader,
+            Value* out) const;
+
+private:
+  struct Token {
+    String name;       ///< Unescaped member name.
+    ArrayIndex index;  ///< Array index, or noIndex if \a name is not one.
+  };
+  static const ArrayIndex noIndex = ArrayIndex(-1);
+
+  void compile(char const* begin, char const* end);
+
+  std::vector<Token> tokens_;
+  bool valid_{true};
+};
+
+} // namespace Json
+
+#pragma pack(pop)
+
+#endif // JSON_POINTER_H_INCLUDED
@@ -327,6 +327,11 @@ public:
    * - `"skipBom": false or true`
    *   - If true, if the input starts with the Unicode byte order mark (BOM),
    *     it is skipped.
+   * - `"strictTrusted": false or true`
+   *   - If true, use a reader specialized for trusted, machine-generated
+   *     JSON. Comments, trailing commas, dropped null placeholders, numeric
+   *     keys, single quotes, special floats and duplicate-key checks are
+   *     compiled out and the corresponding settings above are ignored.
    *
    * You can examine 'settings_` yourself to see the defaults. You can also
    * write and read them just like any JSON Value.
@@ -360,6 +365,12 @@ public:
    * \snippet src/lib_json/json_reader.cpp CharReaderBuilderStrictMode
    */
   static void strictMode(Json::Value* settings);
+  /** Fast path for trusted, machine-generated JSON (no extensions at all).
+   * \pre 'settings' != NULL (but Json::null is fine)
+   * \remark Defaults:
+   * \snippet src/lib_json/json_reader.cpp CharReaderBuilderStrictTrustedMode
+   */
+  static void strictTrustedMode(Json::Value* settings);
 };
 
 /** Consume entire stream and use its begin/end.
@@ -497,6 +497,21 @@ public:
    *   \endcode
    */
   Value& operator[](const StaticString& key);
+  /** \brief Move a value into the member named key, creating it if needed.
+   *
+   * The payload of \a value is swapped into the member (no deep copy); the
+   * member's comments and offsets are kept and \a value is left holding the
+   * previous payload.
+   * \pre type() is objectValue or nullValue
+   * \return the member that now holds the value
+   */
+  Value& emplace(const char* key, Value&& value);
+  /// Same as emplace(const char*, Value&&)
+  /// \param key may contain embedded nulls.
+  Value& emplace(const String& key, Value&& value);
+  /// Same as emplace(const char*, Value&&)
+  /// \note key may contain embedded nulls.
+  Value& emplace(const char* begin, const char* end, Value&& value);
   /// Return the member named key if it exist, defaultValue otherwise.
   /// \note deep copy
   Value get(const char* key, const Value& defaultValue) const;
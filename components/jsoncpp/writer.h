@@ -185,11 +185,20 @@ public:
 
   void omitEndingLineFeed();
 
+  /** \brief Exact length of the string write() returns for \a root with the
+   * current settings, computed without serializing.
+   *
+   * write() uses it to reserve its buffer once; callers can use it to size
+   * their own buffers or to choose between chunked and single-shot upload.
+   */
+  String::size_type measure(const Value& root) const;
+
 public: // overridden from Writer
   String write(const Value& root) override;
 
 private:
   void writeValue(const Value& value);
+  size_t measureValue(const Value& value) const;
 
   String document_;
   bool yamlCompatibilityEnabled_{false};
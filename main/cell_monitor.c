@@ -0,0 +1,200 @@
+#include "cell_monitor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "geo_cache.h"
+#include "sensors.h"
+
+static const char *TAG = "cell_mon";
+
+#define CELL_MONITOR_STACK  8192        // la consulta a UnwiredLabs abre TLS en esta tarea
+#define HOUR_US             (3600LL * 1000000)
+
+static cell_monitor_config_t  s_cfg;
+static TaskHandle_t           s_task;
+static portMUX_TYPE           s_mux = portMUX_INITIALIZER_UNLOCKED;
+static cell_location_t        s_loc = { .city_state = "----" };
+static cell_monitor_metrics_t s_metrics;
+static bool                   s_pending;       // la celda actual aún no tiene ciudad
+
+/* Límite de UnwiredLabs: separación mínima y tope por ventana de una hora */
+static int64_t s_last_net_us;
+static int64_t s_window_us;
+static int     s_window_count;
+
+static void count(uint32_t *metric)
+{
+    taskENTER_CRITICAL(&s_mux);
+    (*metric)++;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+/* Construye "Ciudad-Estado" sin comas (para CSV), con saneo básico */
+static void build_city_hyphen(char *dst, size_t dstlen, const char *city, const char *state)
+{
+    if (!dst || dstlen == 0) return;
+    const char *c = (city && city[0]) ? city : "----";
+    if (state && state[0]) {
+        snprintf(dst, dstlen, "%s-%s", c, state);
+    } else {
+        snprintf(dst, dstlen, "%s", c);
+    }
+    // Reemplaza cualquier coma accidental por '-'
+    for (size_t i = 0; dst[i]; ++i) {
+        if (dst[i] == ',' || dst[i] == ';' || dst[i] == '|') dst[i] = '-';
+    }
+}
+
+static bool same_cell(const modem_ue_info_t *a, const modem_ue_info_t *b)
+{
+    return a->valid == b->valid && a->mcc == b->mcc && a->mnc == b->mnc &&
+           a->tac == b->tac && a->cell_id == b->cell_id;
+}
+
+/* Celda y ciudad se publican juntas: un registro nunca mezcla la celda de una con la ciudad de otra */
+static void publish(const modem_ue_info_t *cell, const char *city_state, bool resolved)
+{
+    taskENTER_CRITICAL(&s_mux);
+    bool changed = !same_cell(&s_loc.cell, cell) || s_loc.resolved != resolved ||
+                   strcmp(s_loc.city_state, city_state) != 0;
+    s_loc.cell = *cell;
+    strlcpy(s_loc.city_state, city_state, sizeof(s_loc.city_state));
+    s_loc.resolved = resolved;
+    if (changed) s_loc.seq++;
+    s_loc.updated_us = esp_timer_get_time();
+    taskEXIT_CRITICAL(&s_mux);
+    sensors_set_city_state(city_state);
+}
+
+static bool net_allowed(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_cfg.max_lookups_per_hour <= 0) return false;
+    if (s_window_us == 0 || now - s_window_us >= HOUR_US) {
+        s_window_us = now;
+        s_window_count = 0;
+    }
+    if (s_window_count >= s_cfg.max_lookups_per_hour) return false;
+    return s_last_net_us == 0 || now - s_last_net_us >= (int64_t)s_cfg.min_lookup_interval_ms * 1000;
+}
+
+/* Caché primero (sin red ni límite); UnwiredLabs sólo si el límite lo permite.
+ * true si out quedó con la ciudad de esta celda */
+static bool resolve(const modem_ue_info_t *cell, char *out, size_t len)
+{
+    geo_cell_key_t key = { .mcc = cell->mcc, .mnc = cell->mnc, .tac = cell->tac, .cell_id = cell->cell_id };
+    geo_cache_loc_t loc;
+    if (geo_cache_lookup(&key, &loc)) {
+        count(&s_metrics.cache_hits);
+        build_city_hyphen(out, len, loc.city, loc.state);
+        return true;
+    }
+    if (!net_allowed()) {
+        count(&s_metrics.rate_limited);
+        return false;
+    }
+    s_last_net_us = esp_timer_get_time();
+    s_window_count++;
+    count(&s_metrics.net_lookups);
+
+    char city[64] = "", state[64] = "";
+    if (modem_unwiredlabs_cell_city_state(cell, city, sizeof(city), state, sizeof(state)) != ESP_OK) {
+        count(&s_metrics.net_failures);
+        return false;
+    }
+    build_city_hyphen(out, len, city, state);
+    return true;
+}
+
+static void monitor_task(void *arg)
+{
+    bool warned_no_at = false;
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(s_cfg.poll_ms));
+
+        modem_radio_status_t rs;
+        esp_err_t err = modem_poll_radio(&rs);
+        if (err == ESP_ERR_TIMEOUT && modem_ppp_is_asleep()) {
+            count(&s_metrics.polls_asleep);
+            continue;
+        }
+        count(&s_metrics.polls);
+        if (err != ESP_OK || !rs.ue.valid) {
+            count(&s_metrics.poll_failures);
+            if (err == ESP_ERR_INVALID_STATE && !warned_no_at) {
+                ESP_LOGW(TAG, "PPP sin CMUX: no hay canal AT para seguir la celda");
+                warned_no_at = true;
+            }
+            continue;
+        }
+        warned_no_at = false;
+
+        cell_location_t cur;
+        (void)cell_monitor_get(&cur);
+        bool changed = !same_cell(&cur.cell, &rs.ue);
+        if (!changed && !s_pending) continue;
+        if (changed) {
+            count(&s_metrics.cell_changes);
+            ESP_LOGI(TAG, "Celda %d-%d %" PRIu32 "/%" PRIu32 " -> %d-%d %" PRIu32 "/%" PRIu32,
+                     cur.cell.mcc, cur.cell.mnc, cur.cell.tac, cur.cell.cell_id,
+                     rs.ue.mcc, rs.ue.mnc, rs.ue.tac, rs.ue.cell_id);
+        }
+
+        char city[64];
+        if (resolve(&rs.ue, city, sizeof(city))) {
+            s_pending = false;
+            publish(&rs.ue, city, true);
+            if (changed || strcmp(city, cur.city_state) != 0) ESP_LOGI(TAG, "Ubicación: %s", city);
+        } else {
+            // Mientras tanto se conserva la última ciudad conocida, marcada como no resuelta
+            s_pending = true;
+            if (changed) publish(&rs.ue, cur.city_state, false);
+        }
+    }
+}
+
+esp_err_t cell_monitor_start(const cell_monitor_config_t *cfg)
+{
+    if (!cfg || cfg->poll_ms <= 0) return ESP_ERR_INVALID_ARG;
+    if (s_task) return ESP_ERR_INVALID_STATE;
+    s_cfg = *cfg;
+
+    modem_ue_info_t ue = {0};
+    char city[64] = "----";
+    bool ok = modem_get_ue_info(&ue) && resolve(&ue, city, sizeof(city));
+    s_pending = ue.valid && !ok;
+    publish(&ue, ok ? city : "----", ok);
+    if (ok) ESP_LOGI(TAG, "Ciudad para JSON: %s", city);
+    else    ESP_LOGW(TAG, "No se pudo geolocalizar por celda. Ciudad='----'");
+
+    if (xTaskCreate(monitor_task, "cell_mon", CELL_MONITOR_STACK, NULL, 4, &s_task) != pdPASS) {
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool cell_monitor_get(cell_location_t *out)
+{
+    if (!out) return false;
+    taskENTER_CRITICAL(&s_mux);
+    *out = s_loc;
+    taskEXIT_CRITICAL(&s_mux);
+    return out->cell.valid;
+}
+
+void cell_monitor_get_metrics(cell_monitor_metrics_t *out)
+{
+    if (!out) return;
+    taskENTER_CRITICAL(&s_mux);
+    *out = s_metrics;
+    taskEXIT_CRITICAL(&s_mux);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "esp_err.h"
+#include "modem_ppp.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Seguimiento de la celda servidora en segundo plano: lee +CPSI por el canal AT de CMUX y,
+ * sólo cuando cambia la celda, vuelve a geolocalizar (caché primero, UnwiredLabs con límite) */
+typedef struct {
+    int      poll_ms;                  // periodo de lectura de +CPSI
+    int      min_lookup_interval_ms;   // separación mínima entre consultas a UnwiredLabs
+    int      max_lookups_per_hour;     // tope de consultas a UnwiredLabs por hora (0: sin red)
+} cell_monitor_config_t;
+
+/** Ubicación vigente: la celda actual y la ciudad resuelta para ella */
+typedef struct {
+    modem_ue_info_t cell;              // celda servidora; cell.valid = false si nunca se leyó
+    char     city_state[64];           // "Ciudad-Estado" (sin comas); "----" si no se conoce
+    bool     resolved;                 // city_state es de esta celda (false: la última conocida)
+    uint32_t seq;                      // sube con cada cambio de celda o de ciudad
+    int64_t  updated_us;
+} cell_location_t;
+
+typedef struct {
+    uint32_t polls;
+    uint32_t poll_failures;            // sin CMUX, módem en recuperación o sin celda válida
+    uint32_t polls_asleep;             // con el módem dormido entre subidas: ni lectura ni fallo
+    uint32_t cell_changes;
+    uint32_t cache_hits;
+    uint32_t net_lookups;              // consultas a UnwiredLabs
+    uint32_t net_failures;
+    uint32_t rate_limited;             // resoluciones aplazadas por el límite (una por lectura)
+} cell_monitor_metrics_t;
+
+/** Geolocaliza la celda del arranque (bloquea como antes; publica en sensors_set_city_state)
+ *  y lanza la tarea de seguimiento. Llamar con PPP arriba */
+esp_err_t cell_monitor_start(const cell_monitor_config_t *cfg);
+
+/** Copia coherente de la ubicación vigente; false si aún no hay celda */
+bool cell_monitor_get(cell_location_t *out);
+
+void cell_monitor_get_metrics(cell_monitor_metrics_t *out);
+
+#ifdef __cplusplus
+}
+#endif
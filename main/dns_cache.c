@@ -0,0 +1,443 @@
+#include "dns_cache.h"
+
+#include <string.h>
+#include <strings.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "lwip/api.h"
+#include "lwip/dns.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "dns_cache";
+
+#define DNS_PORT                53
+#define DNS_TASK_STACK          4096
+#define DNS_MSG_MAX             512     // UDP sin EDNS
+#define DNS_SERVERS_MAX         4       // los dos de PPP y dos públicos de respaldo
+#define DNS_PREFETCH_AHEAD_S    60      // el prefetch renueva también lo que caduca antes de esto
+
+typedef struct {
+    char     host[DNS_CACHE_HOST_MAX];  // "" = hueco libre
+    uint32_t addr;                      // IPv4 en orden de red; 0 = nunca resuelto
+    int64_t  expires_us;
+    int64_t  last_used_us;
+    bool     known;                     // de dns_cache_add_host: se precarga y no sale por LRU
+    bool     refresh;                   // servida caducada: el prefetch la renueva aunque no sea conocida
+} entry_t;
+
+/* Consulta en vuelo: una por host; el prefetch manda todas a la vez por el mismo socket */
+typedef struct {
+    const char *host;
+    uint16_t    id;
+    bool        sent;
+    bool        done;                   // contestada (addr 0: el nombre no tiene A)
+    uint32_t    addr;
+    uint32_t    ttl;
+} query_t;
+
+static StaticSemaphore_t   s_mutex_buf;
+static SemaphoreHandle_t   s_mutex;
+static dns_cache_config_t  s_cfg = { .min_ttl_s = 30, .max_ttl_s = 3600, .max_stale_s = 86400, .timeout_ms = 3000 };
+static bool                s_ready;
+static TaskHandle_t        s_task;
+static entry_t             s_entries[DNS_CACHE_SLOTS];
+static uint32_t            s_pinned;    // el último servidor que contestó va primero
+static dns_cache_metrics_t s_metrics;
+
+static void lock(void)
+{
+    if (!s_mutex) s_mutex = xSemaphoreCreateMutexStatic(&s_mutex_buf);
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_mutex);
+}
+
+/* ===== Mensajes DNS (RFC 1035) ===== */
+static size_t build_query(uint8_t *buf, size_t cap, uint16_t id, const char *host)
+{
+    if (cap < 12) return 0;
+    memset(buf, 0, 12);
+    buf[0] = id >> 8;
+    buf[1] = id & 0xff;
+    buf[2] = 0x01;                      // RD: recursión
+    buf[5] = 1;                         // QDCOUNT
+    size_t n = 12;
+    const char *p = host;
+    while (*p) {
+        const char *dot = strchr(p, '.');
+        size_t len = dot ? (size_t)(dot - p) : strlen(p);
+        if (len == 0 || len > 63 || n + 1 + len + 5 > cap) return 0;
+        buf[n++] = (uint8_t)len;
+        memcpy(buf + n, p, len);
+        n += len;
+        p += len;
+        if (*p == '.') p++;
+    }
+    if (n == 12) return 0;
+    buf[n++] = 0;
+    buf[n++] = 0; buf[n++] = 1;         // QTYPE A
+    buf[n++] = 0; buf[n++] = 1;         // QCLASS IN
+    return n;
+}
+
+/* Salta un nombre (etiquetas o puntero de compresión); 0 si se sale del mensaje */
+static size_t skip_name(const uint8_t *m, size_t len, size_t off)
+{
+    while (off < len) {
+        uint8_t l = m[off];
+        if ((l & 0xC0) == 0xC0) return off + 2 <= len ? off + 2 : 0;
+        if (l & 0xC0) return 0;
+        off += 1 + l;
+        if (l == 0) return off;
+    }
+    return 0;
+}
+
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+
+/* Respuesta a la consulta id: primera A y el menor TTL de la cadena (los CNAME cuentan).
+ * 1 = dirección, 0 = respuesta sin A (NXDOMAIN, sólo AAAA), -1 = no es de esta consulta o está rota,
+ * -2 = el servidor no pudo (SERVFAIL, REFUSED): se pregunta al siguiente */
+static int parse_response(const uint8_t *m, size_t len, uint16_t id, uint32_t *addr, uint32_t *ttl)
+{
+    if (len < 12 || get_u16(m) != id || !(m[2] & 0x80)) return -1;
+    int rcode = m[3] & 0x0F;
+    if (rcode == 3) return 0;
+    if (rcode != 0) return -2;
+    int qd = get_u16(m + 4), an = get_u16(m + 6);
+    size_t off = 12;
+    for (int i = 0; i < qd; ++i) {
+        off = skip_name(m, len, off);
+        if (!off || off + 4 > len) return -1;
+        off += 4;
+    }
+    uint32_t min_ttl = UINT32_MAX;
+    for (int i = 0; i < an; ++i) {
+        off = skip_name(m, len, off);
+        if (!off || off + 10 > len) return -1;
+        uint16_t type = get_u16(m + off), cls = get_u16(m + off + 2), rdlen = get_u16(m + off + 8);
+        uint32_t t = get_u32(m + off + 4);
+        off += 10;
+        if (off + rdlen > len) return -1;
+        if (t > INT32_MAX) t = 0;       // RFC 2181: bit alto puesto = 0
+        if (t < min_ttl) min_ttl = t;
+        if (type == 1 && cls == 1 && rdlen == 4) {
+            memcpy(addr, m + off, 4);
+            *ttl = min_ttl;
+            return 1;
+        }
+        off += rdlen;
+    }
+    return 0;
+}
+
+/* ===== Resolución ===== */
+static void add_server(uint32_t *list, int *n, uint32_t a)
+{
+    if (!a || *n >= DNS_SERVERS_MAX) return;
+    for (int i = 0; i < *n; ++i) if (list[i] == a) return;
+    list[(*n)++] = a;
+}
+
+/* El fijado primero; luego los de PPP (lwIP) y los públicos que ya usaba ensure_dns */
+static int server_list(uint32_t *list)
+{
+    int n = 0;
+    lock();
+    add_server(list, &n, s_pinned);
+    unlock();
+    for (uint8_t i = 0; i < 2; ++i) {
+        const ip_addr_t *s = dns_getserver(i);
+        if (s && IP_IS_V4(s)) add_server(list, &n, ip4_addr_get_u32(ip_2_ip4(s)));
+    }
+    add_server(list, &n, ipaddr_addr("1.1.1.1"));
+    add_server(list, &n, ipaddr_addr("8.8.8.8"));
+    return n;
+}
+
+/* Todas las consultas pendientes a un servidor y espera de respuestas hasta el timeout.
+ * Devuelve cuántas contestó */
+static int query_server(int sock, uint32_t server, query_t *q, int n)
+{
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(DNS_PORT) };
+    to.sin_addr.s_addr = server;
+    uint8_t buf[DNS_MSG_MAX];
+    int pending = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < n; ++i) {
+        q[i].sent = false;
+        if (q[i].done) continue;
+        q[i].id = (uint16_t)esp_random();
+        size_t len = build_query(buf, sizeof(buf), q[i].id, q[i].host);
+        if (!len || sendto(sock, buf, len, 0, (struct sockaddr *)&to, sizeof(to)) != (int)len) continue;
+        q[i].sent = true;
+        pending++;
+    }
+    lock();
+    s_metrics.queries += pending;
+    unlock();
+
+    int answered = 0;
+    while (pending > 0) {
+        int left = s_cfg.timeout_ms - (int)((esp_timer_get_time() - t0) / 1000);
+        if (left <= 0) break;
+        struct timeval tv = { .tv_sec = left / 1000, .tv_usec = (left % 1000) * 1000 };
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        struct sockaddr_in from;
+        socklen_t flen = sizeof(from);
+        int r = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &flen);
+        if (r < 0) break;                       // timeout o sin red
+        if (from.sin_addr.s_addr != server) continue;
+        for (int i = 0; i < n; ++i) {
+            if (!q[i].sent || q[i].done) continue;
+            int res = parse_response(buf, (size_t)r, q[i].id, &q[i].addr, &q[i].ttl);
+            if (res == -1) continue;
+            q[i].sent = false;
+            pending--;
+            if (res == -2) break;
+            q[i].done = true;
+            if (res == 0) q[i].addr = 0;
+            answered++;
+            int64_t rtt = esp_timer_get_time() - t0;
+            lock();
+            s_metrics.answers++;
+            s_metrics.last_rtt_us = rtt;
+            s_metrics.total_rtt_us += rtt;
+            unlock();
+            break;
+        }
+    }
+    return answered;
+}
+
+static void resolve(query_t *q, int n)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    int failed = n;
+    if (sock >= 0) {
+        uint32_t servers[DNS_SERVERS_MAX];
+        int ns = server_list(servers);
+        for (int s = 0; s < ns; ++s) {
+            if (query_server(sock, servers[s], q, n) > 0) {
+                lock();
+                bool changed = s_pinned != servers[s];
+                s_pinned = servers[s];
+                unlock();
+                esp_ip4_addr_t ip = { .addr = servers[s] };
+                if (changed) ESP_LOGI(TAG, "Servidor DNS fijado: " IPSTR, IP2STR(&ip));
+            }
+            failed = 0;
+            for (int i = 0; i < n; ++i) if (!q[i].done) failed++;
+            if (!failed) break;
+        }
+        close(sock);
+    }
+    lock();
+    s_metrics.failures += failed;
+    unlock();
+}
+
+/* ===== Caché (con el mutex tomado) ===== */
+static int find(const char *host)
+{
+    for (int i = 0; i < DNS_CACHE_SLOTS; ++i) {
+        if (s_entries[i].host[0] && strcasecmp(s_entries[i].host, host) == 0) return i;
+    }
+    return -1;
+}
+
+/* Hueco para un host nuevo: libre, si no el menos usado de los no conocidos; -1 si todos son conocidos */
+static int slot_for(const char *host)
+{
+    int i = find(host);
+    if (i >= 0) return i;
+    int lru = -1;
+    for (i = 0; i < DNS_CACHE_SLOTS; ++i) {
+        if (!s_entries[i].host[0]) return i;
+        if (!s_entries[i].known && (lru < 0 || s_entries[i].last_used_us < s_entries[lru].last_used_us)) lru = i;
+    }
+    return lru;
+}
+
+static void store(const char *host, uint32_t addr, uint32_t ttl, int64_t now)
+{
+    int i = slot_for(host);
+    if (i < 0) return;
+    entry_t *e = &s_entries[i];
+    if (strcasecmp(e->host, host) != 0) {
+        *e = (entry_t){0};
+        strlcpy(e->host, host, sizeof(e->host));
+        e->last_used_us = now;
+    }
+    if (ttl < s_cfg.min_ttl_s) ttl = s_cfg.min_ttl_s;
+    if (ttl > s_cfg.max_ttl_s) ttl = s_cfg.max_ttl_s;
+    e->addr = addr;
+    e->expires_us = now + (int64_t)ttl * 1000000;
+    e->refresh = false;
+}
+
+/* Vigente: sin red. Caducada hace menos de max_stale_s: se sirve al momento y el prefetch la renueva
+ * en segundo plano (una conexión no espera al DNS celular). Si no, se pregunta y se espera */
+static bool lookup(const char *host, uint32_t *out)
+{
+    int64_t now = esp_timer_get_time();
+    lock();
+    s_metrics.lookups++;
+    int i = find(host);
+    if (i >= 0 && s_entries[i].addr && now - s_entries[i].expires_us < (int64_t)s_cfg.max_stale_s * 1000000) {
+        entry_t *e = &s_entries[i];
+        bool fresh = now < e->expires_us;
+        if (fresh) s_metrics.hits++;
+        else       s_metrics.stale++;
+        e->refresh = !fresh;
+        e->last_used_us = now;
+        *out = e->addr;
+        unlock();
+        if (!fresh) dns_cache_prefetch();
+        return true;
+    }
+    s_metrics.misses++;
+    unlock();
+
+    query_t q = { .host = host };
+    resolve(&q, 1);
+    if (!q.done || !q.addr) return false;
+
+    lock();
+    store(host, q.addr, q.ttl, esp_timer_get_time());
+    unlock();
+    *out = q.addr;
+    return true;
+}
+
+/* ===== Prefetch ===== */
+static void prefetch_task(void *arg)
+{
+    (void)arg;
+    char hosts[DNS_CACHE_SLOTS][DNS_CACHE_HOST_MAX];
+    query_t q[DNS_CACHE_SLOTS];
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t t0 = esp_timer_get_time();
+        int n = 0;
+        lock();
+        for (int i = 0; i < DNS_CACHE_SLOTS; ++i) {
+            const entry_t *e = &s_entries[i];
+            bool due = !e->addr || e->expires_us - t0 <= (int64_t)DNS_PREFETCH_AHEAD_S * 1000000;
+            if (!e->host[0] || !(e->known || e->refresh) || !due) continue;
+            strlcpy(hosts[n], e->host, sizeof(hosts[n]));
+            q[n] = (query_t){ .host = hosts[n] };
+            n++;
+        }
+        unlock();
+        if (!n) continue;
+
+        resolve(q, n);
+        int64_t now = esp_timer_get_time();
+        int ok = 0;
+        lock();
+        for (int i = 0; i < n; ++i) {
+            if (!q[i].done || !q[i].addr) continue;
+            store(q[i].host, q[i].addr, q[i].ttl, now);
+            ok++;
+        }
+        s_metrics.prefetched += ok;
+        unlock();
+        ESP_LOGI(TAG, "Prefetch: %d/%d hosts en %lld ms", ok, n, (long long)((now - t0) / 1000));
+    }
+}
+
+static void on_got_ip(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    (void)arg; (void)base; (void)id; (void)data;
+    dns_cache_prefetch();
+}
+
+esp_err_t dns_cache_init(const dns_cache_config_t *cfg)
+{
+    if (!cfg || cfg->timeout_ms <= 0 || cfg->min_ttl_s > cfg->max_ttl_s) return ESP_ERR_INVALID_ARG;
+    if (s_ready) return ESP_ERR_INVALID_STATE;
+    lock();
+    s_cfg = *cfg;
+    unlock();
+    if (xTaskCreate(prefetch_task, "dns_prefetch", DNS_TASK_STACK, NULL, 4, &s_task) != pdPASS) {
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = esp_event_handler_register(IP_EVENT, IP_EVENT_PPP_GOT_IP, on_got_ip, NULL);
+    if (err != ESP_OK) return err;
+    s_ready = true;
+#if !CONFIG_LWIP_HOOK_NETCONN_EXT_RESOLVE_CUSTOM
+    ESP_LOGW(TAG, "Sin CONFIG_LWIP_HOOK_NETCONN_EXT_RESOLVE_CUSTOM: getaddrinfo no pasa por la caché");
+#endif
+    return ESP_OK;
+}
+
+esp_err_t dns_cache_add_host(const char *host_or_url)
+{
+    if (!host_or_url) return ESP_ERR_INVALID_ARG;
+    const char *h = strstr(host_or_url, "://");
+    h = h ? h + 3 : host_or_url;
+    size_t len = strcspn(h, "/:?#");
+    if (len == 0 || len >= DNS_CACHE_HOST_MAX) return ESP_ERR_INVALID_ARG;
+    char host[DNS_CACHE_HOST_MAX];
+    memcpy(host, h, len);
+    host[len] = '\0';
+
+    lock();
+    int i = slot_for(host);
+    if (i >= 0 && strcasecmp(s_entries[i].host, host) != 0) {
+        s_entries[i] = (entry_t){0};
+        strlcpy(s_entries[i].host, host, sizeof(s_entries[i].host));
+    }
+    if (i >= 0) s_entries[i].known = true;
+    unlock();
+    return i >= 0 ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void dns_cache_prefetch(void)
+{
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+void dns_cache_get_metrics(dns_cache_metrics_t *out)
+{
+    if (!out) return;
+    lock();
+    *out = s_metrics;
+    unlock();
+}
+
+#if CONFIG_LWIP_HOOK_NETCONN_EXT_RESOLVE_CUSTOM
+/* Hook de lwIP: netconn_gethostbyname (y con él getaddrinfo) pregunta aquí antes que a su DNS.
+ * Corre en la tarea que resuelve; 0 = que resuelva lwIP (IPv6, literales, o la caché no pudo) */
+int lwip_hook_netconn_external_resolve(const char *name, ip_addr_t *addr, u8_t addrtype, err_t *err)
+{
+    if (!s_ready || !name || addrtype == NETCONN_DNS_IPV6) return 0;
+    ip4_addr_t literal;
+    if (ip4addr_aton(name, &literal) || strlen(name) >= DNS_CACHE_HOST_MAX) return 0;
+    uint32_t a;
+    if (!lookup(name, &a)) {
+        lock();
+        s_metrics.fallbacks++;
+        unlock();
+        return 0;
+    }
+    ip_addr_set_ip4_u32(addr, a);
+    *err = ERR_OK;
+    return 1;
+}
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Caché de DNS con TTL para los hosts de Firebase y UnwiredLabs.
+ * Se engancha a lwIP (CONFIG_LWIP_HOOK_NETCONN_EXT_RESOLVE_CUSTOM): todo getaddrinfo pasa por aquí.
+ * Las consultas A las hace un cliente UDP propio que lee el TTL de la respuesta; con cada IP de PPP
+ * los hosts conocidos se resuelven en paralelo (un solo ida y vuelta) */
+#define DNS_CACHE_SLOTS     8
+#define DNS_CACHE_HOST_MAX  64
+
+typedef struct {
+    uint32_t min_ttl_s;     // suelo del TTL (respuestas con TTL 0 o de pocos segundos)
+    uint32_t max_ttl_s;     // techo del TTL
+    uint32_t max_stale_s;   // hasta esto la dirección caducada se sirve al momento mientras se renueva
+    int      timeout_ms;    // espera por servidor
+} dns_cache_config_t;
+
+/** Idas y vueltas ahorradas = hits (stale no espera, pero dispara la consulta de renovación);
+ *  tasa de acierto = hits / lookups */
+typedef struct {
+    uint32_t lookups;       // resoluciones de nombre que pasaron por la caché
+    uint32_t hits;          // dirección vigente: sin ida y vuelta por la red celular
+    uint32_t stale;         // caducada servida al momento; se renueva en segundo plano
+    uint32_t misses;        // hubo que preguntar y esperar (ausente o caducada hace más de max_stale_s)
+    uint32_t queries;       // consultas enviadas, prefetch incluido
+    uint32_t answers;       // consultas contestadas
+    uint32_t failures;      // ningún servidor contestó
+    uint32_t prefetched;    // hosts renovados por el prefetch
+    uint32_t fallbacks;     // cedidas al resolvedor de lwIP
+    int64_t  last_rtt_us;
+    int64_t  total_rtt_us;  // media = total_rtt_us / answers
+} dns_cache_metrics_t;
+
+/** Prepara la caché y la tarea de prefetch (tras esp_event_loop_create_default) */
+esp_err_t dns_cache_init(const dns_cache_config_t *cfg);
+
+/** Añade un host conocido (acepta una URL: se queda con el nombre). Se resuelve con cada IP de PPP
+ *  y no sale de la caché por LRU */
+esp_err_t dns_cache_add_host(const char *host_or_url);
+
+/** Renueva ya los hosts conocidos y los servidos caducados que caducaron o están a punto (no bloquea) */
+void dns_cache_prefetch(void);
+
+void dns_cache_get_metrics(dns_cache_metrics_t *out);
+
+#ifdef __cplusplus
+}
+#endif
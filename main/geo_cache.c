@@ -0,0 +1,265 @@
+#include "geo_cache.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+static const char *TAG = "geo_cache";
+
+/* Formato del blob (little endian, lo replica tools/geo_cache_prefill.py):
+ *   0 u8 versión | 1 u8 flags | 2 u16 MCC | 4 u16 MNC | 6 u16 reservado
+ *   8 u32 TAC | 12 u32 CID | 16 i32 lat*1e7 | 20 i32 lon*1e7 | 24 u32 precisión m
+ *  28 u32 guardado (epoch s, 0 = desconocido) | 32 u32 secuencia LRU
+ *  36 city[40] | 76 state[40]  (terminadas en '\0') */
+#define ENTRY_VERSION       1
+#define ENTRY_HDR           36
+#define ENTRY_TEXT          40
+_Static_assert(ENTRY_HDR + 2 * ENTRY_TEXT == GEO_CACHE_ENTRY_SIZE, "formato de entrada");
+_Static_assert(sizeof(((geo_cache_loc_t *)0)->city) == ENTRY_TEXT, "city");
+_Static_assert(sizeof(((geo_cache_loc_t *)0)->state) == ENTRY_TEXT, "state");
+
+#define CLOCK_VALID_EPOCH   1609459200      // ~2021-01-01, como init_sntp_and_time
+
+/* Índice en RAM: la búsqueda no lee flash salvo el blob del acierto */
+typedef struct {
+    bool     used;
+    uint16_t mcc;
+    uint16_t mnc;
+    uint32_t tac;
+    uint32_t cell_id;
+    uint32_t stored_at;
+    uint32_t last_used;
+} slot_t;
+
+static StaticSemaphore_t   s_mutex_buf;
+static SemaphoreHandle_t   s_mutex;
+static nvs_handle_t        s_nvs;
+static bool                s_ready;
+static uint32_t            s_ttl_s;
+static uint32_t            s_seq;           // mayor secuencia LRU vista
+static slot_t              s_slots[GEO_CACHE_SLOTS];
+static geo_cache_metrics_t s_metrics;
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void put_u32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t get_u32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+static void slot_key(int i, char key[8])
+{
+    snprintf(key, 8, "c%02d", i);
+}
+
+static uint32_t now_epoch(void)
+{
+    time_t now = time(NULL);
+    return now > CLOCK_VALID_EPOCH ? (uint32_t)now : 0;
+}
+
+static bool key_matches(const slot_t *s, const geo_cell_key_t *k)
+{
+    return s->used && s->mcc == k->mcc && s->mnc == k->mnc && s->tac == k->tac && s->cell_id == k->cell_id;
+}
+
+static bool decode(const uint8_t *b, slot_t *s, geo_cache_loc_t *loc)
+{
+    if (b[0] != ENTRY_VERSION) return false;
+    *s = (slot_t){
+        .used = true,
+        .mcc = get_u16(b + 2), .mnc = get_u16(b + 4),
+        .tac = get_u32(b + 8), .cell_id = get_u32(b + 12),
+        .stored_at = get_u32(b + 28), .last_used = get_u32(b + 32),
+    };
+    if (loc) {
+        loc->lat = (int32_t)get_u32(b + 16) / 1e7;
+        loc->lon = (int32_t)get_u32(b + 20) / 1e7;
+        loc->accuracy_m = get_u32(b + 24);
+        memcpy(loc->city, b + ENTRY_HDR, ENTRY_TEXT);
+        memcpy(loc->state, b + ENTRY_HDR + ENTRY_TEXT, ENTRY_TEXT);
+        loc->city[ENTRY_TEXT - 1] = '\0';
+        loc->state[ENTRY_TEXT - 1] = '\0';
+    }
+    return s->mcc != 0 && s->cell_id != 0;
+}
+
+static void encode(uint8_t *b, const slot_t *s, const geo_cache_loc_t *loc)
+{
+    memset(b, 0, GEO_CACHE_ENTRY_SIZE);
+    b[0] = ENTRY_VERSION;
+    put_u16(b + 2, s->mcc);
+    put_u16(b + 4, s->mnc);
+    put_u32(b + 8, s->tac);
+    put_u32(b + 12, s->cell_id);
+    put_u32(b + 16, (uint32_t)(int32_t)lround(loc->lat * 1e7));
+    put_u32(b + 20, (uint32_t)(int32_t)lround(loc->lon * 1e7));
+    put_u32(b + 24, loc->accuracy_m);
+    put_u32(b + 28, s->stored_at);
+    put_u32(b + 32, s->last_used);
+    strlcpy((char *)b + ENTRY_HDR, loc->city, ENTRY_TEXT);
+    strlcpy((char *)b + ENTRY_HDR + ENTRY_TEXT, loc->state, ENTRY_TEXT);
+}
+
+static esp_err_t write_slot(int i, const uint8_t *blob)
+{
+    char key[8];
+    slot_key(i, key);
+    esp_err_t err = nvs_set_blob(s_nvs, key, blob, GEO_CACHE_ENTRY_SIZE);
+    if (err == ESP_OK) err = nvs_commit(s_nvs);
+    if (err != ESP_OK) {
+        s_metrics.write_errors++;
+        ESP_LOGW(TAG, "No se pudo guardar %s: %s", key, esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t geo_cache_init(uint32_t ttl_s)
+{
+    if (!s_mutex) s_mutex = xSemaphoreCreateMutexStatic(&s_mutex_buf);
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_ttl_s = ttl_s;
+    if (s_ready) {
+        xSemaphoreGive(s_mutex);
+        return ESP_OK;
+    }
+    esp_err_t err = nvs_open(GEO_CACHE_NAMESPACE, NVS_READWRITE, &s_nvs);
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_mutex);
+        ESP_LOGW(TAG, "nvs_open: %s; caché desactivada", esp_err_to_name(err));
+        return err;
+    }
+
+    uint8_t blob[GEO_CACHE_ENTRY_SIZE];
+    s_metrics.entries = 0;
+    for (int i = 0; i < GEO_CACHE_SLOTS; ++i) {
+        char key[8];
+        slot_key(i, key);
+        size_t len = sizeof(blob);
+        s_slots[i].used = false;
+        if (nvs_get_blob(s_nvs, key, blob, &len) != ESP_OK || len != sizeof(blob)) continue;
+        if (!decode(blob, &s_slots[i], NULL)) {
+            s_slots[i].used = false;          // versión vieja o entrada nula: el hueco se reutiliza
+            continue;
+        }
+        if (s_slots[i].last_used > s_seq) s_seq = s_slots[i].last_used;
+        s_metrics.entries++;
+    }
+    s_ready = true;
+    xSemaphoreGive(s_mutex);
+    ESP_LOGI(TAG, "%" PRIu32 " celdas en caché (TTL %" PRIu32 " s)", s_metrics.entries, ttl_s);
+    return ESP_OK;
+}
+
+bool geo_cache_lookup(const geo_cell_key_t *key, geo_cache_loc_t *out)
+{
+    if (!key || !out || !s_ready) return false;
+    int64_t t0 = esp_timer_get_time();
+    bool hit = false;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int i = 0;
+    while (i < GEO_CACHE_SLOTS && !key_matches(&s_slots[i], key)) i++;
+    uint32_t now = now_epoch();
+    if (i == GEO_CACHE_SLOTS) {
+        s_metrics.misses++;
+    } else if (s_ttl_s && now && s_slots[i].stored_at && now - s_slots[i].stored_at > s_ttl_s) {
+        s_metrics.expired++;
+        s_metrics.misses++;
+    } else {
+        uint8_t blob[GEO_CACHE_ENTRY_SIZE];
+        char nkey[8];
+        slot_key(i, nkey);
+        size_t len = sizeof(blob);
+        slot_t s;
+        if (nvs_get_blob(s_nvs, nkey, blob, &len) == ESP_OK && len == sizeof(blob) &&
+            decode(blob, &s, out) && key_matches(&s, key)) {
+            out->age_s = now && s.stored_at && now > s.stored_at ? now - s.stored_at : 0;
+            /* Sólo se reescribe si no era ya la más reciente: arrancar una y otra vez en la
+             * misma celda no gasta flash */
+            if (s_slots[i].last_used != s_seq) {
+                s_slots[i].last_used = ++s_seq;
+                put_u32(blob + 32, s_seq);
+                (void)write_slot(i, blob);
+            }
+            s_metrics.hits++;
+            hit = true;
+        } else {
+            s_slots[i].used = false;          // el índice no coincide con la flash: se descarta
+            s_metrics.entries--;
+            s_metrics.misses++;
+        }
+    }
+    s_metrics.last_lookup_us = esp_timer_get_time() - t0;
+    xSemaphoreGive(s_mutex);
+    return hit;
+}
+
+esp_err_t geo_cache_store(const geo_cell_key_t *key, const geo_cache_loc_t *loc)
+{
+    if (!key || !loc || key->mcc <= 0 || key->cell_id == 0) return ESP_ERR_INVALID_ARG;
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    /* Misma celda (refresco), si no un hueco libre, si no la usada hace más tiempo */
+    int slot = -1, free_slot = -1, lru = 0;
+    for (int i = 0; i < GEO_CACHE_SLOTS && slot < 0; ++i) {
+        if (key_matches(&s_slots[i], key)) slot = i;
+        else if (!s_slots[i].used && free_slot < 0) free_slot = i;
+        else if (s_slots[i].last_used < s_slots[lru].last_used) lru = i;
+    }
+    if (slot < 0) slot = free_slot;
+    if (slot < 0) {
+        slot = lru;
+        s_metrics.evictions++;
+        ESP_LOGI(TAG, "Caché llena; sale %u-%u %" PRIu32 "/%" PRIu32,
+                 s_slots[lru].mcc, s_slots[lru].mnc, s_slots[lru].tac, s_slots[lru].cell_id);
+    }
+
+    slot_t s = {
+        .used = true, .mcc = (uint16_t)key->mcc, .mnc = (uint16_t)key->mnc,
+        .tac = key->tac, .cell_id = key->cell_id,
+        .stored_at = now_epoch(), .last_used = ++s_seq,
+    };
+    uint8_t blob[GEO_CACHE_ENTRY_SIZE];
+    encode(blob, &s, loc);
+    esp_err_t err = write_slot(slot, blob);
+    if (err == ESP_OK) {
+        if (!s_slots[slot].used) s_metrics.entries++;
+        s_slots[slot] = s;
+    }
+    xSemaphoreGive(s_mutex);
+    return err;
+}
+
+esp_err_t geo_cache_clear(void)
+{
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_err_t err = nvs_erase_all(s_nvs);
+    if (err == ESP_OK) err = nvs_commit(s_nvs);
+    memset(s_slots, 0, sizeof(s_slots));
+    s_metrics.entries = 0;
+    s_seq = 0;
+    xSemaphoreGive(s_mutex);
+    return err;
+}
+
+void geo_cache_get_metrics(geo_cache_metrics_t *out)
+{
+    if (!out) return;
+    if (!s_mutex) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *out = s_metrics;
+    xSemaphoreGive(s_mutex);
+}
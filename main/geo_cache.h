@@ -0,0 +1,63 @@
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Caché persistente celda -> ubicación (NVS, namespace "geocache").
+ * Cada entrada es un blob "cNN" de GEO_CACHE_ENTRY_SIZE bytes con el formato de geo_cache.c;
+ * tools/geo_cache_prefill.py genera el mismo formato desde un CSV */
+#define GEO_CACHE_NAMESPACE   "geocache"
+#define GEO_CACHE_SLOTS       32
+#define GEO_CACHE_ENTRY_SIZE  116
+
+/** Celda servidora: la misma tupla que se manda a UnwiredLabs */
+typedef struct {
+    int      mcc;
+    int      mnc;
+    uint32_t tac;       // TAC (LTE) o LAC
+    uint32_t cell_id;   // ECI o CID
+} geo_cell_key_t;
+
+typedef struct {
+    char     city[40];
+    char     state[40];
+    double   lat;
+    double   lon;
+    uint32_t accuracy_m;    // 0 si no se conoce
+    uint32_t age_s;         // sólo en lookup: antigüedad; 0 si el reloj aún no está en hora
+} geo_cache_loc_t;
+
+typedef struct {
+    uint32_t entries;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t expired;       // presentes pero con más de ttl_s
+    uint32_t evictions;     // LRU sustituida al guardar con la caché llena
+    uint32_t write_errors;
+    int64_t  last_lookup_us;
+} geo_cache_metrics_t;
+
+/** Abre el namespace y carga el índice a RAM (llamar tras nvs_flash_init).
+ *  ttl_s: antigüedad máxima de una entrada; 0 = no caducan */
+esp_err_t geo_cache_init(uint32_t ttl_s);
+
+/** Busca la celda sin tocar la red. true si hay entrada vigente (out rellenado).
+ *  Si el reloj no está en hora todavía no se puede medir la edad y la entrada se acepta */
+bool geo_cache_lookup(const geo_cell_key_t *key, geo_cache_loc_t *out);
+
+/** Guarda o refresca la celda; si no hay hueco sustituye la usada hace más tiempo */
+esp_err_t geo_cache_store(const geo_cell_key_t *key, const geo_cache_loc_t *loc);
+
+/** Borra todas las entradas (RAM y NVS) */
+esp_err_t geo_cache_clear(void);
+
+void geo_cache_get_metrics(geo_cache_metrics_t *out);
+
+#ifdef __cplusplus
+}
+#endif
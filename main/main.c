@@ -2,7 +2,9 @@
 #include <stdio.h>
 #include <time.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string.h>
+#include <stdatomic.h>
 
 // ESP-IDF
 #include "nvs_flash.h"
@@ -19,19 +21,51 @@
 
 // PPP
 #include "modem_ppp.h"
+#include "geo_cache.h"
+#include "cell_monitor.h"
+#include "dns_cache.h"
 #include "esp_modem_api.h"
 
 #include "esp_wifi.h"
 
 static const char *TAG_APP = "app";
 static esp_modem_dce_t *g_dce = NULL;
-static inline int64_t minutes_to_us(int m) { return (int64_t)m * 60 * 1000000; }
 
-// ---- Ciudad global para el JSON ----
-static char g_city[64]  = "----";
+// ---- Ubicación por celda para el JSON (cell_monitor) ----
+// Se sigue la celda cada 30 s; UnwiredLabs como mucho cada 2 min y 12 veces por hora (las celdas
+// ya vistas salen de la caché sin red)
+#define CELL_POLL_MS            30000
+#define CELL_LOOKUP_MIN_MS      (2 * 60 * 1000)
+#define CELL_LOOKUPS_PER_HOUR   12
+// Las celdas no se mueven: 30 días antes de volver a preguntar a UnwiredLabs por la misma
+#define GEO_CACHE_TTL_S (30u * 24 * 3600)
+
+// ---- Ahorro de energía del módem entre subidas (modem_ppp) ----
+// FULL: PPP siempre arriba (la config remota y la celda se siguen en vivo, con el consumo de siempre).
+// DTR: PPP se cuelga tras cada lote y el módem duerme hasta poco antes del siguiente. Dormido no llegan
+// cambios de /config (el listener reconecta al despertar), la celda no se sigue y el token se renueva
+// al despertar. PSM: además pide a la red PSM (TAU 1 h, 10 s activo) y eDRX; sólo LTE y si el operador
+// lo concede
+#define MODEM_POWER_MODE        MODEM_PPP_POWER_FULL
+#define MODEM_WAKE_LEAD_MS      20000   // mínimo; crece con el tiempo a IP medido
+#define MODEM_IDLE_MS           30000   // tras la última subida, antes de dormir
+#define MODEM_PSM_TAU_S         3600
+#define MODEM_PSM_ACTIVE_S      10
+#define MODEM_EDRX_MS           20480
+
+// ---- Caché de DNS (Firebase y UnwiredLabs) ----
+// TTL de la respuesta acotado a [30 s, 1 h]; caducada, la dirección se sirve al momento hasta 24 h mientras se renueva
+#define DNS_MIN_TTL_S           30
+#define DNS_MAX_TTL_S           3600
+#define DNS_MAX_STALE_S         (24 * 3600)
+#define DNS_TIMEOUT_MS          3000
 
 #define LOG_EACH_SAMPLE 1
 
+// Benchmark de PPP: si se define la URL (fichero grande), mide el throughput sostenido tras el arranque
+// #define PPP_BENCH_URL "http://speedtest.tele2.net/10MB.zip"
+#define PPP_BENCH_MS 30000
+
 static void wifi_hard_off(void) {
     
     // Ignora errores si no estaba inicializado
@@ -60,22 +94,195 @@ static void init_sntp_and_time(void) {
     }
 }
 
-/* Construye "Ciudad-Estado" sin comas (para CSV), con saneo básico */
-static void build_city_hyphen(char *dst, size_t dstlen, const char *city, const char *state) {
-    if (!dst || dstlen == 0) return;
-    const char *c = (city && city[0]) ? city : "----";
-    if (state && state[0]) {
-        snprintf(dst, dstlen, "%s-%s", c, state);
+#define SENSOR_TASK_STACK 10240
+
+// ,"ciudad":"…","celda":"MCC-MNC-TAC-CID" para el registro (sin ciudad: el primero ya la lleva)
+static void format_cell_tag(char *dst, size_t len, const cell_location_t *loc, bool with_city) {
+    int n = with_city ? snprintf(dst, len, ",\"ciudad\":\"%s\"", loc->city_state) : 0;
+    if (n < 0 || (size_t)n >= len) n = 0;
+    if (loc->cell.valid) {
+        snprintf(dst + n, len - n, ",\"celda\":\"%d-%d-%" PRIu32 "-%" PRIu32 "\"",
+                 loc->cell.mcc, loc->cell.mnc, loc->cell.tac, loc->cell.cell_id);
     } else {
-        snprintf(dst, dstlen, "%s", c);
+        dst[n] = '\0';
     }
-    // Reemplaza cualquier coma accidental por '-'
-    for (size_t i = 0; dst[i]; ++i) {
-        if (dst[i] == ',' || dst[i] == ';' || dst[i] == '|') dst[i] = '-';
+}
+
+
+// Configuración remota en /config (sample_every_min, samples_per_batch, max_bytes).
+// La escribe el listener de Firebase y la lee sensor_task en cada vuelta
+#define CONFIG_PATH "/config"
+static atomic_int s_cfg_sample_every_min = 1;     // 1 muestra/minuto
+static atomic_int s_cfg_samples_per_batch = 5;    // envío cada 5 muestras
+static atomic_uint s_cfg_max_bytes = 10 * 1024 * 1024;   // retención ~10 MB
+static TaskHandle_t s_sensor_task = NULL;
+
+static bool config_number(const char *event_path, const char *key,
+                          const char *data, size_t len, double *out) {
+    char pointer[40];
+    if (strcmp(event_path, "/") == 0) {
+        snprintf(pointer, sizeof(pointer), "/%s", key);            // put/patch de todo el objeto
+    } else if (event_path[0] == '/' && strcmp(event_path + 1, key) == 0) {
+        pointer[0] = '\0';                                         // put de la clave suelta
+    } else {
+        return false;
     }
+    return firebase_json_get_number(data, len, pointer, out) == 0;
 }
 
-#define SENSOR_TASK_STACK 10240
+static void on_config_change(const char *event, const char *path, const char *data, size_t len, void *ctx) {
+    (void)ctx;
+    double v;
+    bool changed = false;
+    if (config_number(path, "sample_every_min", data, len, &v) && v >= 1 && v <= 60) {
+        atomic_store(&s_cfg_sample_every_min, (int)v);
+        changed = true;
+    }
+    if (config_number(path, "samples_per_batch", data, len, &v) && v >= 1 && v <= 60) {
+        atomic_store(&s_cfg_samples_per_batch, (int)v);
+        changed = true;
+    }
+    if (config_number(path, "max_bytes", data, len, &v) && v >= 64 * 1024 && v <= 1024.0 * 1024 * 1024) {
+        atomic_store(&s_cfg_max_bytes, (unsigned)v);
+        changed = true;
+    }
+    if (!changed) return;
+    ESP_LOGI(TAG_APP, "Config remota (%s %s): muestra cada %d min, lote %d, retención %u B", event, path,
+             atomic_load(&s_cfg_sample_every_min), atomic_load(&s_cfg_samples_per_batch),
+             atomic_load(&s_cfg_max_bytes));
+    // Despierta a sensor_task para que reprograme la espera con el periodo nuevo
+    if (s_sensor_task) xTaskNotifyGive(s_sensor_task);
+}
+
+// Subida asíncrona: la medición puede esperar en cola hasta 10 min; los recortes no caducan
+#define UPLOAD_DEADLINE_MS (10 * 60 * 1000)
+
+// Los callbacks corren en la tarea de subida; sensor_task recoge los resultados con atomic_exchange
+static atomic_int s_trim_deleted = 0;
+static atomic_bool s_trim_pending = false;
+static atomic_int s_puts_in_flight = 0;     // encolados sin terminar: el módem no se duerme
+static atomic_uint s_loc_seq_sent = 0;      // ubicación que ya lleva algún registro subido
+
+// ctx = seq de la ubicación del registro. Sólo un PUT confirmado da la ubicación por enviada;
+// los PUT pueden terminar desordenados, así que nunca se retrocede
+static void on_put_done(uint32_t id, int err, int value, void *ctx) {
+    (void)value;
+    atomic_fetch_sub(&s_puts_in_flight, 1);
+    if (err != 0) {
+        ESP_LOGW(TAG_APP, "PUT %u fallo: 0x%x", (unsigned)id, (unsigned)err);
+        return;
+    }
+    unsigned seq = (unsigned)(uintptr_t)ctx;
+    unsigned sent = atomic_load(&s_loc_seq_sent);
+    while (seq > sent && !atomic_compare_exchange_weak(&s_loc_seq_sent, &sent, seq)) {
+    }
+}
+
+static void on_trim_done(uint32_t id, int err, int value, void *ctx) {
+    (void)id; (void)ctx;
+    if (err == 0 && value > 0) atomic_fetch_add(&s_trim_deleted, value);
+    atomic_store(&s_trim_pending, false);
+}
+
+static bool uplink_busy(void) {
+    return atomic_load(&s_puts_in_flight) > 0 || atomic_load(&s_trim_pending);
+}
+
+static void log_uplink_metrics(void) {
+    firebase_uplink_metrics_t um;
+    if (firebase_get_uplink_metrics(&um) != 0) return;
+    char wait[96], total[96];
+    int wn = 0, tn = 0;
+    for (int i = 0; i < FIREBASE_UPLINK_HIST_BUCKETS; ++i) {
+        wn += snprintf(wait + wn, sizeof(wait) - wn, "%s%u", i ? "," : "", (unsigned)um.wait_hist[i]);
+        tn += snprintf(total + tn, sizeof(total) - tn, "%s%u", i ? "," : "", (unsigned)um.total_hist[i]);
+    }
+    ESP_LOGI(TAG_APP, "Uplink: cola=%u max=%u enc=%u ok=%u fallos=%u canc=%u venc=%u desc=%u espera[%s] total[%s]",
+             (unsigned)um.depth, (unsigned)um.max_depth, (unsigned)um.enqueued,
+             (unsigned)(um.completed - um.failed), (unsigned)um.failed, (unsigned)um.cancelled,
+             (unsigned)um.expired, (unsigned)um.dropped, wait, total);
+
+    firebase_write_metrics_t wm;
+    if (firebase_get_write_metrics(&wm) == 0 && wm.writes > 0) {
+        ESP_LOGI(TAG_APP, "Escrituras: n=%u fallos=%u tx=%llu B rx=%llu B latencia ult=%lld ms max=%lld ms media=%lld ms",
+                 (unsigned)wm.writes, (unsigned)wm.failed, (unsigned long long)wm.tx_bytes,
+                 (unsigned long long)wm.rx_bytes, (long long)(wm.last_latency_us / 1000),
+                 (long long)(wm.max_latency_us / 1000), (long long)(wm.total_latency_us / 1000 / wm.writes));
+    }
+}
+
+// Telemetría de radio en vivo (canal AT de CMUX); en modo DATA sólo no hay y no se registra nada
+static void log_radio_status(void) {
+    modem_radio_status_t rs;
+    esp_err_t err = modem_poll_radio(&rs);
+    if (err == ESP_ERR_INVALID_STATE) return;
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG_APP, "Radio: sin lectura (%s)", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG_APP, "Radio: CSQ=%d,%d CEREG=%d celda=%d-%d TAC=%u CID=%u",
+             rs.rssi, rs.ber, rs.cereg_stat, rs.ue.mcc, rs.ue.mnc,
+             (unsigned)rs.ue.tac, (unsigned)rs.ue.cell_id);
+}
+
+// Caídas de PPP recuperadas por modem_ppp (sin reiniciar): sólo se reporta si hubo alguna nueva
+static void log_link_metrics(void) {
+    static uint32_t last_losses = 0;
+    modem_ppp_link_metrics_t lm;
+    modem_ppp_get_link_metrics(&lm);
+    uint32_t recovered = lm.recovered[0] + lm.recovered[1] + lm.recovered[2];
+    if (lm.losses == last_losses || recovered == 0) return;
+    last_losses = lm.losses;
+    ESP_LOGI(TAG_APP, "PPP: caídas=%u recuperadas DATA/AT/POWER=%u/%u/%u MTTR=%lld ms max=%lld ms",
+             (unsigned)lm.losses, (unsigned)lm.recovered[0], (unsigned)lm.recovered[1], (unsigned)lm.recovered[2],
+             (long long)(lm.total_down_us / 1000 / recovered), (long long)(lm.max_down_us / 1000));
+}
+
+// Seguimiento de celda: se reporta cuando hubo cambios de celda o consultas nuevas
+static void log_cell_metrics(void) {
+    static uint32_t last_events = 0;
+    cell_monitor_metrics_t cm;
+    cell_monitor_get_metrics(&cm);
+    uint32_t events = cm.cell_changes + cm.net_lookups + cm.rate_limited;
+    if (events == last_events) return;
+    last_events = events;
+    ESP_LOGI(TAG_APP, "Celda: lecturas=%u fallidas=%u dormido=%u cambios=%u caché=%u UnwiredLabs=%u (fallos=%u) aplazadas=%u",
+             (unsigned)cm.polls, (unsigned)cm.poll_failures, (unsigned)cm.polls_asleep, (unsigned)cm.cell_changes, (unsigned)cm.cache_hits,
+             (unsigned)cm.net_lookups, (unsigned)cm.net_failures, (unsigned)cm.rate_limited);
+}
+
+// Ahorro de energía: se reporta cuando hubo despertares nuevos
+static void log_power_metrics(void) {
+    static uint32_t last_wakes = 0;
+    modem_ppp_power_metrics_t pm;
+    modem_ppp_get_power_metrics(&pm);
+    if (pm.wakes == last_wakes) return;
+    last_wakes = pm.wakes;
+    uint32_t ok = pm.wakes - pm.wake_failures;
+    int64_t total_us = pm.awake_us + pm.asleep_us;
+    ESP_LOGI(TAG_APP, "Módem: despertares=%u (fallidos=%u fuera_de_plan=%u) IP ult=%lld ms max=%lld ms media=%lld ms "
+             "despierto=%lld%% PSM=%d/%d s",
+             (unsigned)pm.wakes, (unsigned)pm.wake_failures, (unsigned)pm.unscheduled,
+             (long long)(pm.last_time_to_ip_us / 1000), (long long)(pm.max_time_to_ip_us / 1000),
+             (long long)(ok ? pm.total_time_to_ip_us / 1000 / ok : 0),
+             (long long)(total_us ? pm.awake_us * 100 / total_us : 100), pm.psm_active_s, pm.psm_tau_s);
+}
+
+// DNS: se reporta cuando hubo resoluciones nuevas
+static void log_dns_metrics(void) {
+    static uint32_t last_lookups = 0;
+    dns_cache_metrics_t dm;
+    dns_cache_get_metrics(&dm);
+    if (dm.lookups == last_lookups) return;
+    last_lookups = dm.lookups;
+    // Sólo los aciertos ahorran la ida y vuelta: una caducada servida dispara su consulta igualmente
+    ESP_LOGI(TAG_APP, "DNS: resoluciones=%u ida_y_vuelta_ahorradas=%u (%u%%) caducadas=%u "
+             "consultas=%u fallidas=%u prefetch=%u lwIP=%u RTT ult=%lld ms media=%lld ms",
+             (unsigned)dm.lookups, (unsigned)dm.hits, (unsigned)(dm.hits * 100ULL / dm.lookups),
+             (unsigned)dm.stale, (unsigned)dm.queries, (unsigned)dm.failures,
+             (unsigned)dm.prefetched, (unsigned)dm.fallbacks, (long long)(dm.last_rtt_us / 1000),
+             (long long)(dm.answers ? dm.total_rtt_us / 1000 / dm.answers : 0));
+}
 
 static void sensor_task(void *pv) {
     SensorData data;
@@ -98,20 +305,36 @@ static void sensor_task(void *pv) {
     vTaskDelay(pdMS_TO_TICKS(1000));
     firebase_delete("/historial_mediciones");
 
-    // 1 muestra/minuto, envío cada 5 min
-    const int SAMPLE_EVERY_MIN = 1;
-    const int SAMPLES_PER_BATCH = 5;
-    const TickType_t SAMPLE_DELAY_TICKS = pdMS_TO_TICKS(SAMPLE_EVERY_MIN * 60000);
+    s_sensor_task = xTaskGetCurrentTaskHandle();
+    if (!firebase_listen(CONFIG_PATH, on_config_change, NULL)) {
+        ESP_LOGW(TAG_APP, "Sin listener de config: se usan los valores por defecto");
+    }
+
+    // Desde aquí el módem puede dormir entre lotes (el login y el borrado inicial ya pasaron).
+    // Dormido, el listener de config reconecta en el siguiente despertar
+    modem_ppp_power_config_t power_cfg = {
+        .mode = MODEM_POWER_MODE,
+        .psm_tau_s = MODEM_PSM_TAU_S,
+        .psm_active_s = MODEM_PSM_ACTIVE_S,
+        .edrx_ms = MODEM_EDRX_MS,
+        .wake_lead_ms = MODEM_WAKE_LEAD_MS,
+        .idle_ms = MODEM_IDLE_MS,
+        .uplink_busy = uplink_busy,
+    };
+    if (modem_ppp_power_start(&power_cfg) != ESP_OK) {
+        ESP_LOGW(TAG_APP, "Sin ahorro de energía: el módem queda siempre en PPP");
+    }
     int sample_count = 0;
 
     double sum_pm1p0=0, sum_pm2p5=0, sum_pm4p0=0, sum_pm10p0=0, sum_voc=0, sum_nox=0, sum_avg_temp=0, sum_avg_hum=0;
     uint32_t sum_co2 = 0;
     char last_fecha_str[20] = "";
 
-    const int64_t REFRESH_US = minutes_to_us(50);
-    int64_t next_refresh_us = esp_timer_get_time() + REFRESH_US;
-
     while (1) {
+        const int SAMPLE_EVERY_MIN = atomic_load(&s_cfg_sample_every_min);
+        const int SAMPLES_PER_BATCH = atomic_load(&s_cfg_samples_per_batch);
+        TickType_t sample_start = xTaskGetTickCount();
+
         if (sensors_read(&data) == ESP_OK) {
             sample_count++;
             sum_pm1p0 += data.pm1p0;
@@ -160,9 +383,23 @@ static void sensor_task(void *pv) {
             avg.sen_temp = avg.avg_temp;
             avg.sen_hum = avg.avg_hum;
 
-            char json[384];
+            // Celda y ciudad vigentes al cerrar el lote. Como la fecha, sólo viajan cuando cambian:
+            // un registro sin "celda" sigue en la del anterior. Hasta que un PUT con la nueva se
+            // confirma (on_put_done), todos los registros la repiten
+            cell_location_t loc;
+            (void)cell_monitor_get(&loc);
+            char cell_tag[128] = "";
+            if (first_send || loc.seq != atomic_load(&s_loc_seq_sent)) {
+                format_cell_tag(cell_tag, sizeof(cell_tag), &loc, !first_send);
+            }
+
+            char json[448];
             if (first_send) {
                 sensors_format_json(&avg, hora_envio, fecha_actual, inicio_str, json, sizeof(json));
+                size_t jlen = strlen(json);
+                if (cell_tag[0] && jlen > 0 && json[jlen - 1] == '}' && jlen + strlen(cell_tag) < sizeof(json)) {
+                    snprintf(json + jlen - 1, sizeof(json) - jlen + 1, "%s}", cell_tag);
+                }
                 strncpy(last_fecha_str, fecha_actual, sizeof(last_fecha_str)-1);
                 last_fecha_str[sizeof(last_fecha_str)-1] = '\0';
                 first_send = false;
@@ -171,20 +408,20 @@ static void sensor_task(void *pv) {
                     snprintf(json, sizeof(json),
                         "{\"pm1p0\":%.2f,\"pm2p5\":%.2f,\"pm4p0\":%.2f,\"pm10p0\":%.2f,"
                         "\"voc\":%.1f,\"nox\":%.1f,\"cTe\":%.2f,\"cHu\":%.2f,\"co2\":%u,"
-                        "\"fecha\":\"%s\",\"hora\":\"%s\"}",
+                        "\"fecha\":\"%s\",\"hora\":\"%s\"%s}",
                         avg.pm1p0, avg.pm2p5, avg.pm4p0, avg.pm10p0,
                         avg.voc, avg.nox, avg.avg_temp, avg.avg_hum,
-                        avg.co2, fecha_actual, hora_envio);
+                        avg.co2, fecha_actual, hora_envio, cell_tag);
                     strncpy(last_fecha_str, fecha_actual, sizeof(last_fecha_str)-1);
                     last_fecha_str[sizeof(last_fecha_str)-1] = '\0';
                 } else {
                     snprintf(json, sizeof(json),
                         "{\"pm1p0\":%.2f,\"pm2p5\":%.2f,\"pm4p0\":%.2f,\"pm10p0\":%.2f,"
                         "\"voc\":%.1f,\"nox\":%.1f,\"cTe\":%.2f,\"cHu\":%.2f,\"co2\":%u,"
-                        "\"hora\":\"%s\"}",
+                        "\"hora\":\"%s\"%s}",
                         avg.pm1p0, avg.pm2p5, avg.pm4p0, avg.pm10p0,
                         avg.voc, avg.nox, avg.avg_temp, avg.avg_hum,
-                        avg.co2, hora_envio);
+                        avg.co2, hora_envio, cell_tag);
                 }
             }
             // Log dinámico indicando cada cuántos minutos se está enviando
@@ -199,11 +436,22 @@ static void sensor_task(void *pv) {
             snprintf(path_put, sizeof(path_put), "/historial_mediciones/%s", clave_min);
 
             ESP_LOGI(TAG_APP, "Path: %s", path_put);
-            firebase_putData(path_put, json);
+            // El módem despertó para este lote; si no (subida fuera de plan) se le pide despertar y el
+            // lote espera en la cola: sensor_task no se para
+            if (!modem_ppp_request_uplink()) {
+                ESP_LOGI(TAG_APP, "Sin IP todavía; el lote sale cuando la haya");
+            }
+            // Se encola (copia path y json) y sensor_task sigue muestreando sin esperar la red
+            atomic_fetch_add(&s_puts_in_flight, 1);
+            if (!firebase_putData_async(path_put, json, FIREBASE_PRIO_MEASUREMENT, UPLOAD_DEADLINE_MS,
+                                        on_put_done, (void *)(uintptr_t)loc.seq)) {
+                atomic_fetch_sub(&s_puts_in_flight, 1);
+                ESP_LOGW(TAG_APP, "Cola de subida llena, medición descartada");
+            }
             //firebase_push("/historial_mediciones", json);
 
             // Retención aproximada por tamaño total (~10 MB)
-            const size_t MAX_BYTES = 10 * 1024 * 1024;
+            const size_t MAX_BYTES = atomic_load(&s_cfg_max_bytes);
             static double avg_size = 256.0;
             static uint32_t approx_count = 0;
             size_t item_len = strlen(json);
@@ -211,14 +459,25 @@ static void sensor_task(void *pv) {
             approx_count++;
             uint32_t max_items = (uint32_t)(MAX_BYTES / (avg_size > 1.0 ? avg_size : 1.0));
             uint32_t high_water = max_items + 50;
-            if (approx_count > high_water) {
-                int deleted = firebase_trim_oldest_batch("/historial_mediciones", 50);
-                if (deleted > 0) {
-                    approx_count = (approx_count > (uint32_t)deleted) ? (approx_count - (uint32_t)deleted) : 0;
-                    ESP_LOGI(TAG_APP, "Retención: borrados %d antiguos. approx_count=%u max_items=%u avg=%.1fB",
-                             deleted, approx_count, max_items, avg_size);
+            int deleted = atomic_exchange(&s_trim_deleted, 0);
+            if (deleted > 0) {
+                approx_count = (approx_count > (uint32_t)deleted) ? (approx_count - (uint32_t)deleted) : 0;
+                ESP_LOGI(TAG_APP, "Retención: borrados %d antiguos. approx_count=%u max_items=%u avg=%.1fB",
+                         deleted, approx_count, max_items, avg_size);
+            }
+            // Un solo recorte en vuelo; va detrás de las mediciones en la cola
+            if (approx_count > high_water && !atomic_exchange(&s_trim_pending, true)) {
+                if (!firebase_trim_oldest_batch_async("/historial_mediciones", 50, FIREBASE_PRIO_RETENTION, 0,
+                                                      on_trim_done, NULL)) {
+                    atomic_store(&s_trim_pending, false);
                 }
             }
+            log_uplink_metrics();
+            log_link_metrics();
+            log_radio_status();
+            log_cell_metrics();
+            log_power_metrics();
+            log_dns_metrics();
 
             // Reset de acumuladores
             sample_count = 0;
@@ -226,17 +485,29 @@ static void sensor_task(void *pv) {
             sum_co2 = 0;
         }
 
-        // Refresh del token cada ~50 min (no le afecta SNTP):
-        int64_t now_us = esp_timer_get_time();
-        if (now_us >= next_refresh_us) {
-            ESP_LOGI(TAG_APP, "Refrescando token (50m) [monotónico]...");
-            int r = firebase_refresh_token();
-            if (r == 0) ESP_LOGI(TAG_APP, "Token refresh OK"); else ESP_LOGW(TAG_APP, "Fallo refresh token (%d)", r);
-            // agenda el próximo exactamente 50 min después DEL AHORA (evita drift):
-            next_refresh_us = now_us + REFRESH_US;
+        // El token lo renueva FirebaseApp en segundo plano; aquí sólo se reportan sus métricas
+        firebase_auth_metrics_t am;
+        static uint32_t last_refreshes = 0;
+        if (firebase_get_auth_metrics(&am) == 0 && am.refresh_ok + am.refresh_failed != last_refreshes) {
+            last_refreshes = am.refresh_ok + am.refresh_failed;
+            ESP_LOGI(TAG_APP, "Auth: ok=%u fallos=%u (proactivos=%u en_peticion=%u forzados=%u logins=%u) "
+                     "latencia ult=%lld ms max=%lld ms media=%lld ms",
+                     (unsigned)am.refresh_ok, (unsigned)am.refresh_failed, (unsigned)am.proactive,
+                     (unsigned)am.on_demand, (unsigned)am.forced, (unsigned)am.full_logins,
+                     (long long)(am.last_latency_us / 1000), (long long)(am.max_latency_us / 1000),
+                     (long long)(am.total_latency_us / 1000 / last_refreshes));
         }
 
-        vTaskDelay(SAMPLE_DELAY_TICKS);
+        // Espera hasta la próxima muestra; un cambio de config la recalcula con el periodo nuevo
+        while (1) {
+            TickType_t period = pdMS_TO_TICKS(atomic_load(&s_cfg_sample_every_min) * 60000);
+            TickType_t elapsed = xTaskGetTickCount() - sample_start;
+            if (elapsed >= period) break;
+            // Si la próxima muestra cierra el lote, el módem dormido tiene que tener IP para entonces
+            bool flush_next = sample_count + 1 >= atomic_load(&s_cfg_samples_per_batch);
+            modem_ppp_schedule_uplink(flush_next ? esp_timer_get_time() + (int64_t)pdTICKS_TO_MS(period - elapsed) * 1000 : 0);
+            if (ulTaskNotifyTake(pdTRUE, period - elapsed) == 0) break;
+        }
     }
 }
 
@@ -250,21 +521,35 @@ void app_main(void)
         ESP_ERROR_CHECK(nvs_flash_erase());
         ESP_ERROR_CHECK(nvs_flash_init());
     }
+    (void)geo_cache_init(GEO_CACHE_TTL_S);   // sin caché se geolocaliza por red como siempre
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
+    // Antes de PPP: el primer GOT_IP ya precarga los hosts (el de UnwiredLabs lo añade modem_ppp)
+    dns_cache_config_t dcfg = {
+        .min_ttl_s = DNS_MIN_TTL_S, .max_ttl_s = DNS_MAX_TTL_S,
+        .max_stale_s = DNS_MAX_STALE_S, .timeout_ms = DNS_TIMEOUT_MS,
+    };
+    if (dns_cache_init(&dcfg) == ESP_OK) {   // sin caché resuelve lwIP como siempre
+        (void)dns_cache_add_host(DATABASE_URL);
+        (void)dns_cache_add_host("securetoken.googleapis.com");
+        (void)dns_cache_add_host("identitytoolkit.googleapis.com");
+    }
+
     wifi_hard_off();
 
     // === 1) Arranca PPP ===
     modem_ppp_config_t cfg = {
         .tx_io = 26, .rx_io = 27,
-        .rts_io = -1, .cts_io = -1,     // sin flow control por ahora
+        .rts_io = -1, .cts_io = -1,     // sin pines RTS/CTS cableados en esta placa
         .dtr_io = 25,
         .rst_io = 5, .pwrkey_io = 4, .board_power_io = 12,
         .rst_active_low = true, .rst_pulse_ms = 200,
         .apn = "internet.itelcel.com",
         .sim_pin = "",
-        .use_cmux = false               // ¡dejar en false!
+        .use_cmux = true,               // PPP + canal AT; si el módem no acepta CMUX sigue en DATA
+        .baud_rate = 921600,            // AT+IPR con verificación; si no verifica vuelve al anterior
+        .hw_flow_ctrl = false           // true en cuanto haya rts_io/cts_io
     };
     esp_err_t mret = modem_ppp_start_blocking(&cfg, 150000 /* 150s timeout */, &g_dce);
     if (mret != ESP_OK) {
@@ -276,22 +561,24 @@ void app_main(void)
     // === 2) SNTP con PPP activo ===
     init_sntp_and_time();
 
-    // === 3) Geolocalización por celda (AT + UnwiredLabs) => g_city sin comas ===
-    if (UNWIREDLABS_TOKEN[0]) {
-        char city[64] = "", state[64] = "";
-        if (modem_unwiredlabs_city_state(city, sizeof(city), state, sizeof(state)) == ESP_OK) {
-            build_city_hyphen(g_city, sizeof(g_city), city, state); // "Ciudad-Estado" sin comas
-            ESP_LOGI(TAG_APP, "Ciudad para JSON (1a vez): %s", g_city);
-            sensors_set_city_state(g_city);
-        } else {
-            ESP_LOGW(TAG_APP, "No se pudo geolocalizar por celda. Ciudad='----'");
-            strncpy(g_city, "----", sizeof(g_city));
-            g_city[sizeof(g_city)-1] = '\0';
-            sensors_set_city_state(g_city);
-        }
-    } else {
-            ESP_LOGW(TAG_APP, "UNWIREDLABS_TOKEN vacío. Ciudad quedará '----'");
-            sensors_set_city_state("----");
+#ifdef PPP_BENCH_URL
+    modem_ppp_bench_t bench;
+    if (modem_ppp_benchmark(PPP_BENCH_URL, PPP_BENCH_MS, &bench) != ESP_OK) {
+        ESP_LOGW(TAG_APP, "Benchmark PPP sin datos");
+    }
+#endif
+
+    // === 3) Geolocalización por celda (caché + UnwiredLabs) y seguimiento de la celda ===
+    cell_monitor_config_t cell_cfg = {
+        .poll_ms = CELL_POLL_MS,
+        .min_lookup_interval_ms = CELL_LOOKUP_MIN_MS,
+        .max_lookups_per_hour = UNWIREDLABS_TOKEN[0] ? CELL_LOOKUPS_PER_HOUR : 0,
+    };
+    if (!UNWIREDLABS_TOKEN[0]) {
+        ESP_LOGW(TAG_APP, "UNWIREDLABS_TOKEN vacío: sólo celdas ya en caché, si no ciudad '----'");
+    }
+    if (cell_monitor_start(&cell_cfg) != ESP_OK) {
+        ESP_LOGW(TAG_APP, "Sin monitor de celda: la ciudad queda la del arranque");
     }
     vTaskDelay(pdMS_TO_TICKS(1500));
     // === 4) Sensores y task de envío a Firebase ===
@@ -0,0 +1,655 @@
+#include "modem_at.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "modem_at";
+
+#define AT_LINE_MAX     160     // las URC que interesan caben de sobra; las más largas se descartan
+#define AT_EV_COUNT     5
+#define AT_MAX_FIELDS   16      // +CPSI LTE trae 14
+
+static EventGroupHandle_t s_eg;
+static bool               s_urc_enabled;
+
+/* Ensamblado de líneas: esp_modem entrega trozos del UART tal cual llegan */
+static char   s_line[AT_LINE_MAX];
+static size_t s_line_len;
+static bool   s_line_overflow;
+
+/* Cronómetro de arranque y último +CEREG (los leen otras tareas) */
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t      s_boot_us;
+static int64_t      s_ev_us[AT_EV_COUNT];     // 0 = aún no llegó
+static int          s_cereg_stat = -1;
+static uint32_t     s_cereg_tac;
+static uint32_t     s_cereg_ci;
+
+/* Comando en vuelo: esp_modem_command no pasa contexto al callback, así que el del llamador se
+ * publica aquí mientras dura. El DTE sólo procesa un comando a la vez; el mutex (estático) lo hace explícito */
+static StaticSemaphore_t s_cmd_mutex_buf;
+static SemaphoreHandle_t s_cmd_mutex;
+static modem_at_rsp_t   *s_cmd;
+
+static EventGroupHandle_t event_group(void)
+{
+    if (!s_eg) s_eg = xEventGroupCreate();
+    return s_eg;
+}
+
+static void publish(EventBits_t bits)
+{
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_mux);
+    for (int i = 0; i < AT_EV_COUNT; ++i) {
+        if ((bits & (1u << i)) && s_ev_us[i] == 0) s_ev_us[i] = now;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    xEventGroupSetBits(event_group(), bits);
+}
+
+/* ===== Parsers =====
+ * Sin heap ni strtok: la línea se parte en campos que apuntan al texto original */
+typedef struct {
+    const char *p;
+    size_t      len;
+    bool        quoted;
+} at_field_t;
+
+static const char *skip_ws(const char *p)
+{
+    while (*p == ' ') p++;
+    return p;
+}
+
+/* Devuelve el texto tras "<prefix>" (con ':') de la primera línea que empieza así */
+static const char *find_line(const char *rsp, const char *prefix)
+{
+    size_t n = strlen(prefix);
+    const char *p = rsp;
+    while (p && *p) {
+        while (*p == '\r' || *p == '\n' || *p == ' ') p++;
+        if (strncmp(p, prefix, n) == 0) return skip_ws(p + n);
+        p = strchr(p, '\n');
+    }
+    return NULL;
+}
+
+/* Campos separados por ',' hasta fin de línea; las comas entre comillas no cortan */
+static int split_fields(const char *s, at_field_t *f, int max)
+{
+    int n = 0;
+    while (n < max) {
+        s = skip_ws(s);
+        at_field_t *cur = &f[n++];
+        cur->quoted = *s == '"';
+        if (cur->quoted) {
+            const char *q = strchr(s + 1, '"');
+            const char *eol = strpbrk(s + 1, "\r\n");
+            if (!q || (eol && eol < q)) q = eol ? eol : s + strlen(s);
+            cur->p = s + 1;
+            cur->len = (size_t)(q - cur->p);
+            s = *q == '"' ? q + 1 : q;
+            s = skip_ws(s);
+        } else {
+            cur->p = s;
+            while (*s && *s != ',' && *s != '\r' && *s != '\n') s++;
+            const char *e = s;
+            while (e > cur->p && e[-1] == ' ') e--;
+            cur->len = (size_t)(e - cur->p);
+        }
+        if (*s != ',') break;
+        s++;
+    }
+    return n;
+}
+
+static bool field_eq(const at_field_t *f, const char *lit)
+{
+    return f->len == strlen(lit) && strncmp(f->p, lit, f->len) == 0;
+}
+
+static bool field_int(const at_field_t *f, int *out)
+{
+    size_t i = 0;
+    bool neg = f->len > 0 && f->p[0] == '-';
+    if (neg) i++;
+    if (i == f->len) return false;
+    long v = 0;
+    for (; i < f->len; ++i) {
+        if (!isdigit((unsigned char)f->p[i]) || v > 100000000) return false;
+        v = v * 10 + (f->p[i] - '0');
+    }
+    *out = (int)(neg ? -v : v);
+    return true;
+}
+
+/* Hexadecimal con o sin "0x" (LAC/TAC de +CPSI, TAC/CI de +CEREG) */
+static bool field_hex(const at_field_t *f, uint32_t *out)
+{
+    size_t i = 0;
+    if (f->len > 2 && f->p[0] == '0' && (f->p[1] == 'x' || f->p[1] == 'X')) i = 2;
+    if (i == f->len || f->len - i > 8) return false;
+    uint32_t v = 0;
+    for (; i < f->len; ++i) {
+        char c = f->p[i];
+        if (!isxdigit((unsigned char)c)) return false;
+        v = (v << 4) | (uint32_t)(isdigit((unsigned char)c) ? c - '0' : (tolower((unsigned char)c) - 'a' + 10));
+    }
+    *out = v;
+    return true;
+}
+
+/* Decimal, o hexadecimal si lleva "0x" (el Cell ID de +CPSI varía según firmware) */
+static bool field_u32(const at_field_t *f, uint32_t *out)
+{
+    if (f->len > 2 && f->p[0] == '0' && (f->p[1] == 'x' || f->p[1] == 'X')) return field_hex(f, out);
+    if (f->len == 0 || f->len > 10) return false;
+    uint64_t v = 0;
+    for (size_t i = 0; i < f->len; ++i) {
+        if (!isdigit((unsigned char)f->p[i])) return false;
+        v = v * 10 + (uint64_t)(f->p[i] - '0');
+    }
+    if (v > UINT32_MAX) return false;
+    *out = (uint32_t)v;
+    return true;
+}
+
+/* Disposición de +CPSI por <System Mode>. Comunes: 1 Operation Mode, 2 MCC-MNC, 3 LAC/TAC, 4 Cell ID
+ *   LTE:   ...,<TAC>,<SCellID>,<PCellID>,<Frequency Band>,<earfcn>,<dlbw>,<ulbw>,<RSRQ>,<RSRP>,<RSSI>,<RSSNR>
+ *   WCDMA: ...,<LAC>,<Cell ID>,<Frequency Band>,<PSC>,<Freq>,<SSC>,<EC/IO>,<RSCP>,<Qual>,<RxLev>,<TXPWR>
+ *   GSM:   ...,<LAC>,<Cell ID>,<Absolute RF Ch Num>,<RxLev>,<Track LO Adjust>,<C1-C2> */
+typedef struct {
+    const char *mode;
+    modem_rat_t rat;
+    uint8_t     min_fields;
+    int8_t      band_idx;       // campo "EUTRAN-BANDn"; -1 si la RAT no lo trae así
+    int8_t      pci_idx;        // PCI/PSC; -1 si no hay
+    int8_t      arfcn_idx;
+    int8_t      signal_idx;
+    uint8_t     signal_div;     // RSRP viene en décimas de dBm
+} cpsi_layout_t;
+
+static const cpsi_layout_t k_cpsi_layout[] = {
+    { "LTE",   MODEM_RAT_LTE,   7, 6,  5,  7, 11, 10 },
+    { "WCDMA", MODEM_RAT_WCDMA, 6, -1, 6,  7, 10, 1 },
+    { "GSM",   MODEM_RAT_GSM,   5, -1, -1, 5, 6,  1 },
+};
+
+/* Entero al comienzo del campo ("733 PCS 1900" -> 733) */
+static bool field_lead_int(const at_field_t *f, int *out)
+{
+    size_t n = 0;
+    if (n < f->len && f->p[n] == '-') n++;
+    while (n < f->len && isdigit((unsigned char)f->p[n])) n++;
+    at_field_t head = { f->p, n, false };
+    return field_int(&head, out);
+}
+
+/* dBm plausible; algunos firmwares dan RSCP en positivo */
+static int signal_dbm(int v, int div)
+{
+    v /= div;
+    if (v > 0) v = -v;
+    return (v <= -20 && v >= -150) ? v : 0;
+}
+
+bool modem_at_parse_cpsi(const char *rsp, modem_cpsi_t *out)
+{
+    const char *p = rsp ? find_line(rsp, "+CPSI:") : NULL;
+    if (!p || !out) return false;
+    memset(out, 0, sizeof(*out));
+
+    at_field_t f[AT_MAX_FIELDS];
+    int nf = split_fields(p, f, AT_MAX_FIELDS);
+    out->online = nf > 1 && field_eq(&f[1], "Online");
+
+    out->pci = out->arfcn = -1;
+    const cpsi_layout_t *lay = NULL;
+    for (size_t i = 0; i < sizeof(k_cpsi_layout) / sizeof(k_cpsi_layout[0]); ++i) {
+        if (field_eq(&f[0], k_cpsi_layout[i].mode)) lay = &k_cpsi_layout[i];
+    }
+    if (!lay || nf < lay->min_fields) return true;      // NO SERVICE, modo sin celda...
+    out->rat = lay->rat;
+
+    // "334-20"
+    const char *dash = memchr(f[2].p, '-', f[2].len);
+    if (dash) {
+        at_field_t mcc = { f[2].p, (size_t)(dash - f[2].p), false };
+        at_field_t mnc = { dash + 1, f[2].len - mcc.len - 1, false };
+        if (!field_int(&mcc, &out->mcc) || !field_int(&mnc, &out->mnc)) out->mcc = out->mnc = 0;
+    }
+    (void)field_hex(&f[3], &out->lac);
+    (void)field_u32(&f[4], &out->cell_id);
+    if (lay->band_idx >= 0) {
+        const at_field_t *b = &f[lay->band_idx];
+        const char *band = b->len > 4 ? memchr(b->p, 'B', b->len) : NULL;
+        if (band && (size_t)(b->p + b->len - band) > 4 && strncmp(band, "BAND", 4) == 0) {
+            at_field_t num = { band + 4, (size_t)(b->p + b->len - band - 4), false };
+            (void)field_int(&num, &out->band);
+        }
+    }
+    // Campos extendidos: opcionales, faltan en firmwares que acortan la línea
+    int v;
+    if (lay->pci_idx >= 0 && nf > lay->pci_idx && field_int(&f[lay->pci_idx], &v)) out->pci = v;
+    if (nf > lay->arfcn_idx && field_lead_int(&f[lay->arfcn_idx], &v)) out->arfcn = v;
+    if (nf > lay->signal_idx && field_int(&f[lay->signal_idx], &v)) out->signal_dbm = signal_dbm(v, lay->signal_div);
+    out->valid = out->online && out->mcc > 0 && out->lac != 0 && out->cell_id != 0 &&
+                 (lay->band_idx < 0 || out->band > 0);
+    return true;
+}
+
+/* +CENG: cabecera "+CENG: <mode>,<Ncell>,..." y una línea por celda "+CENG: <i>,\"<campos>\""
+ *   2G (SIM800), vecina: <arfcn>,<rxl>,<bsic>,<cellid>,<mcc>,<mnc>,<lac>   (cellid/lac hex, rxl 0..63)
+ *   LTE (SIM70x0), vecina: <earfcn>,<pci>,<rsrp>,<rssi>,<rsrq>[,...]        (sin Cell ID)
+ * La servidora (i = 0) ya sale de +CPSI */
+static bool ceng_neighbor(const at_field_t *f, int nf, modem_neighbor_t *n)
+{
+    int v;
+    *n = (modem_neighbor_t){ .pci = -1, .arfcn = -1 };
+    if (nf == 7) {
+        n->rat = MODEM_RAT_GSM;
+        if (!field_hex(&f[3], &n->cell_id) || !field_hex(&f[6], &n->lac)) return false;
+        if (!field_int(&f[4], &n->mcc) || !field_int(&f[5], &n->mnc)) n->mcc = n->mnc = 0;
+        if (field_int(&f[0], &v)) n->arfcn = v;
+        if (field_int(&f[1], &v) && v >= 0 && v <= 63) n->signal_dbm = v - 110;
+        if (field_int(&f[2], &v)) n->pci = v;
+        return n->cell_id != 0 && n->cell_id != 0xFFFF;
+    }
+    if (nf >= 5) {
+        n->rat = MODEM_RAT_LTE;
+        if (!field_int(&f[1], &n->pci) || n->pci < 0 || n->pci > 503) return false;
+        if (field_int(&f[0], &v)) n->arfcn = v;
+        if (field_int(&f[2], &v)) n->signal_dbm = signal_dbm(v, 1);
+        return true;
+    }
+    return false;
+}
+
+bool modem_at_parse_ceng(const char *rsp, modem_neighbors_t *out)
+{
+    if (!rsp || !out) return false;
+    memset(out, 0, sizeof(*out));
+    bool found = false;
+    for (const char *p = find_line(rsp, "+CENG:"); p; p = find_line(p, "+CENG:")) {
+        found = true;
+        at_field_t f[2];
+        int idx;
+        if (split_fields(p, f, 2) < 2 || !f[1].quoted || !field_int(&f[0], &idx) || idx == 0) continue;
+
+        char inner[96];
+        size_t len = f[1].len < sizeof(inner) - 1 ? f[1].len : sizeof(inner) - 1;
+        memcpy(inner, f[1].p, len);
+        inner[len] = '\0';
+        at_field_t cf[AT_MAX_FIELDS];
+        int nf = split_fields(inner, cf, AT_MAX_FIELDS);
+
+        modem_neighbor_t n;
+        if (!ceng_neighbor(cf, nf, &n)) continue;
+        out->seen++;
+        if (out->count < MODEM_MAX_NEIGHBORS) out->cell[out->count++] = n;
+    }
+    return found;
+}
+
+bool modem_at_parse_csq(const char *rsp, modem_csq_t *out)
+{
+    const char *p = rsp ? find_line(rsp, "+CSQ:") : NULL;
+    if (!p || !out) return false;
+    at_field_t f[2];
+    if (split_fields(p, f, 2) < 2 || !field_int(&f[0], &out->rssi) || !field_int(&f[1], &out->ber)) return false;
+    out->dbm = (out->rssi >= 0 && out->rssi <= 31) ? -113 + 2 * out->rssi : 0;
+    return true;
+}
+
+bool modem_at_parse_cereg(const char *rsp, modem_cereg_t *out)
+{
+    const char *p = rsp ? find_line(rsp, "+CEREG:") : NULL;
+    if (!p || !out) return false;
+    at_field_t f[10];
+    int nf = split_fields(p, f, 10);
+    int a, b;
+    if (!field_int(&f[0], &a)) return false;
+    out->n = -1;
+    out->tac = out->ci = 0;
+    out->act = -1;
+    out->active_time_s = out->periodic_tau_s = -1;
+    // La respuesta a AT+CEREG? lleva <n> delante; en la URC el segundo campo es el TAC entre comillas
+    int i = 1;
+    if (nf > 1 && !f[1].quoted && field_int(&f[1], &b) && b <= 10) {
+        out->n = a;
+        a = b;
+        i = 2;
+    }
+    out->stat = a;
+    if (nf > i + 1 && field_hex(&f[i], &out->tac)) {
+        (void)field_hex(&f[i + 1], &out->ci);
+        if (nf > i + 2) (void)field_int(&f[i + 2], &out->act);
+    }
+    if (nf > i + 6) {
+        out->active_time_s = modem_at_psm_timer_s(f[i + 5].p, f[i + 5].len, true);
+        out->periodic_tau_s = modem_at_psm_timer_s(f[i + 6].p, f[i + 6].len, false);
+    }
+    return true;
+}
+
+bool modem_at_parse_cops(const char *rsp, modem_cops_t *out)
+{
+    const char *p = rsp ? find_line(rsp, "+COPS:") : NULL;
+    if (!p || !out) return false;
+    at_field_t f[4];
+    int nf = split_fields(p, f, 4);
+    memset(out, 0, sizeof(*out));
+    out->format = -1;
+    out->act = -1;
+    if (!field_int(&f[0], &out->mode)) return false;
+    if (nf >= 3 && field_int(&f[1], &out->format)) {
+        size_t n = f[2].len < sizeof(out->oper) - 1 ? f[2].len : sizeof(out->oper) - 1;
+        memcpy(out->oper, f[2].p, n);
+        out->oper[n] = '\0';
+        if (nf >= 4) (void)field_int(&f[3], &out->act);
+    }
+    return true;
+}
+
+/* ===== Temporizadores PSM/eDRX =====
+ * Un octeto: 3 bits de unidad + 5 de valor (0..31). Tablas en orden de unidad creciente */
+typedef struct {
+    uint8_t  unit;
+    uint32_t step_s;
+} psm_unit_t;
+
+static const psm_unit_t k_t3412_units[] = {    // GPRS Timer 3
+    { 3, 2 }, { 4, 30 }, { 5, 60 }, { 0, 600 }, { 1, 3600 }, { 2, 36000 }, { 6, 1152000 },
+};
+static const psm_unit_t k_t3324_units[] = {    // GPRS Timer 2
+    { 0, 2 }, { 1, 60 }, { 2, 360 },
+};
+
+static void psm_bits(uint32_t seconds, const psm_unit_t *u, size_t n, char out[MODEM_PSM_BITS_LEN])
+{
+    size_t k = 0;
+    uint32_t v = 31;
+    for (; k < n; ++k) {
+        uint32_t need = (seconds + u[k].step_s - 1) / u[k].step_s;
+        if (need <= 31) {
+            v = need;
+            break;
+        }
+    }
+    if (k == n) k = n - 1;                  // no cabe: el máximo representable
+    uint8_t octet = (uint8_t)(u[k].unit << 5 | v);
+    for (int i = 0; i < 8; ++i) out[i] = (octet & (0x80 >> i)) ? '1' : '0';
+    out[8] = '\0';
+}
+
+void modem_at_psm_tau_bits(uint32_t seconds, char out[MODEM_PSM_BITS_LEN])
+{
+    psm_bits(seconds, k_t3412_units, sizeof(k_t3412_units) / sizeof(k_t3412_units[0]), out);
+}
+
+void modem_at_psm_active_bits(uint32_t seconds, char out[MODEM_PSM_BITS_LEN])
+{
+    psm_bits(seconds, k_t3324_units, sizeof(k_t3324_units) / sizeof(k_t3324_units[0]), out);
+}
+
+int modem_at_psm_timer_s(const char *bits, size_t len, bool active)
+{
+    if (!bits || len != 8) return -1;
+    uint8_t octet = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        if (bits[i] != '0' && bits[i] != '1') return -1;
+        octet = (uint8_t)(octet << 1 | (bits[i] - '0'));
+    }
+    const psm_unit_t *u = active ? k_t3324_units : k_t3412_units;
+    size_t n = active ? sizeof(k_t3324_units) / sizeof(k_t3324_units[0])
+                      : sizeof(k_t3412_units) / sizeof(k_t3412_units[0]);
+    for (size_t k = 0; k < n; ++k) {
+        if (u[k].unit == octet >> 5) return (int)(u[k].step_s * (octet & 0x1f));
+    }
+    return -1;                              // 111: desactivado
+}
+
+/* eDRX E-UTRAN: 5,12 s * {1, 2, 4, 8, 12, 16, ..., 2048} según el valor de 4 bits */
+void modem_at_edrx_bits(uint32_t ms, char out[MODEM_EDRX_BITS_LEN])
+{
+    static const uint16_t k_mult[16] = { 1, 2, 4, 8, 12, 16, 20, 24, 28, 32, 64, 128, 256, 512, 1024, 2048 };
+    int v = 0;
+    while (v < 15 && (uint64_t)k_mult[v + 1] * 5120 <= ms) v++;
+    for (int i = 0; i < 4; ++i) out[i] = (v & (8 >> i)) ? '1' : '0';
+    out[4] = '\0';
+}
+
+/* ===== Manejadores de URC ===== */
+static void urc_rdy(const char *line)
+{
+    (void)line;
+    ESP_LOGI(TAG, "URC RDY");
+    publish(MODEM_AT_EV_RDY);
+}
+
+static void urc_cpin(const char *line)
+{
+    if (strstr(line, "READY")) {
+        ESP_LOGI(TAG, "URC SIM lista");
+        publish(MODEM_AT_EV_SIM_READY);
+    } else {
+        ESP_LOGW(TAG, "URC %s", line);      // SIM PIN, NOT INSERTED...
+        xEventGroupClearBits(event_group(), MODEM_AT_EV_SIM_READY);
+    }
+}
+
+static void urc_pb_done(const char *line)
+{
+    (void)line;
+    publish(MODEM_AT_EV_PB_DONE);
+}
+
+static void urc_cereg(const char *line)
+{
+    modem_cereg_t c;
+    if (!modem_at_parse_cereg(line, &c)) return;
+    int stat = c.stat;
+    uint32_t tac = c.tac, ci = c.ci;
+    taskENTER_CRITICAL(&s_mux);
+    int prev = s_cereg_stat;
+    uint32_t prev_ci = s_cereg_ci;
+    s_cereg_stat = stat;
+    if (ci) {
+        s_cereg_tac = tac;
+        s_cereg_ci = ci;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+
+    if (stat != prev) ESP_LOGI(TAG, "CEREG stat %d -> %d", prev, stat);
+    if (stat == 1 || stat == 5) {
+        EventBits_t bits = MODEM_AT_EV_REGISTERED;
+        if (ci) bits |= MODEM_AT_EV_CELL;
+        if (ci && ci != prev_ci) ESP_LOGI(TAG, "Celda TAC=0x%X CI=0x%X", (unsigned)tac, (unsigned)ci);
+        publish(bits);
+    } else {
+        xEventGroupClearBits(event_group(), MODEM_AT_EV_REGISTERED);
+    }
+}
+
+typedef struct {
+    const char *prefix;
+    void (*fn)(const char *line);
+} urc_entry_t;
+
+static const urc_entry_t k_urc[] = {
+    { "RDY",      urc_rdy },
+    { "+CPIN:",   urc_cpin },
+    { "PB DONE",  urc_pb_done },
+    { "+CEREG:",  urc_cereg },
+};
+
+static void dispatch_line(const char *line)
+{
+    for (size_t i = 0; i < sizeof(k_urc) / sizeof(k_urc[0]); ++i) {
+        if (strncmp(line, k_urc[i].prefix, strlen(k_urc[i].prefix)) == 0) {
+            k_urc[i].fn(line);
+            return;
+        }
+    }
+}
+
+/* Corre en la tarea del DTE: sólo ensambla líneas y publica eventos. También ve las respuestas
+ * a comandos (p. ej. +CEREG de AT+CEREG?), que actualizan el mismo estado */
+esp_err_t modem_at_feed(uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        char ch = (char)data[i];
+        if (ch == '\r' || ch == '\n') {
+            if (s_line_len > 0 && !s_line_overflow) {
+                s_line[s_line_len] = '\0';
+                dispatch_line(s_line);
+            }
+            s_line_len = 0;
+            s_line_overflow = false;
+        } else if (s_line_len < AT_LINE_MAX - 1) {
+            s_line[s_line_len++] = ch;
+        } else {
+            s_line_overflow = true;
+        }
+    }
+    return ESP_OK;
+}
+
+/* ===== Comandos con contexto propio ===== */
+
+/* Sigue el comienzo de cada línea para reconocer el código final */
+static void rsp_scan(modem_at_rsp_t *r, const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        char c = (char)p[i];
+        if (c != '\r' && c != '\n') {
+            if (r->line_len < sizeof(r->line) - 1) r->line[r->line_len++] = c;
+            continue;
+        }
+        if (r->line_len) {
+            r->line[r->line_len] = '\0';
+            if (strcmp(r->line, "OK") == 0) {
+                r->result = ESP_OK;
+            } else if (strncmp(r->line, "ERROR", 5) == 0 || strncmp(r->line, "+CME ERROR", 10) == 0 ||
+                       strncmp(r->line, "+CMS ERROR", 10) == 0) {
+                r->result = ESP_FAIL;
+            }
+        }
+        r->line_len = 0;
+    }
+}
+
+/* Corre en la tarea del DTE. Según la versión, esp_modem entrega cada trozo nuevo o el buffer
+ * acumulado desde el inicio del comando: si empieza por lo ya visto, sólo se añade lo nuevo.
+ * ESP_ERR_TIMEOUT = respuesta incompleta, sigue esperando */
+static esp_err_t cmd_cb(uint8_t *data, size_t len)
+{
+    modem_at_rsp_t *r = s_cmd;
+    if (!r) return ESP_FAIL;
+    size_t skip = 0;
+    if (r->seen > 0 && len >= r->seen && memcmp(data, r->buf, r->used) == 0) skip = r->seen;
+    const uint8_t *p = data + skip;
+    size_t n = len - skip;
+
+    size_t room = r->size - 1 - r->used;
+    size_t take = n < room ? n : room;
+    memcpy(r->buf + r->used, p, take);
+    r->used += take;
+    r->buf[r->used] = '\0';
+    r->seen += n;
+
+    rsp_scan(r, p, n);
+    return r->result;
+}
+
+esp_err_t modem_at_command(esp_modem_dce_t *dce, const char *cmd, modem_at_rsp_t *rsp, uint32_t timeout_ms)
+{
+    if (!dce || !cmd || !rsp || !rsp->buf || rsp->size == 0) return ESP_ERR_INVALID_ARG;
+    if (!s_cmd_mutex) return ESP_ERR_INVALID_STATE;
+    rsp->used = 0;
+    rsp->seen = 0;
+    rsp->buf[0] = '\0';
+    rsp->result = ESP_ERR_TIMEOUT;
+    rsp->line_len = 0;
+
+    xSemaphoreTake(s_cmd_mutex, portMAX_DELAY);
+    s_cmd = rsp;
+    esp_err_t err = esp_modem_command(dce, cmd, cmd_cb, timeout_ms);
+    s_cmd = NULL;
+    xSemaphoreGive(s_cmd_mutex);
+
+    if (err == ESP_OK && rsp->seen > rsp->used) return ESP_ERR_INVALID_SIZE;
+    return err;
+}
+
+esp_err_t modem_at_init(esp_modem_dce_t *dce)
+{
+    if (!dce) return ESP_ERR_INVALID_ARG;
+    (void)event_group();
+    if (!s_cmd_mutex) s_cmd_mutex = xSemaphoreCreateMutexStatic(&s_cmd_mutex_buf);
+    esp_err_t err = esp_modem_set_urc(dce, modem_at_feed);
+    s_urc_enabled = err == ESP_OK;
+    if (!s_urc_enabled) {
+        ESP_LOGW(TAG, "Sin manejador de URC (%s); las esperas vuelven a ser por consulta", esp_err_to_name(err));
+    }
+    return err;
+}
+
+bool modem_at_urc_enabled(void)
+{
+    return s_urc_enabled;
+}
+
+void modem_at_mark_boot(void)
+{
+    xEventGroupClearBits(event_group(), MODEM_AT_EV_ALL);
+    taskENTER_CRITICAL(&s_mux);
+    s_boot_us = esp_timer_get_time();
+    memset(s_ev_us, 0, sizeof(s_ev_us));
+    s_cereg_stat = -1;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void modem_at_clear(EventBits_t bits)
+{
+    xEventGroupClearBits(event_group(), bits);
+}
+
+EventBits_t modem_at_wait(EventBits_t bits, bool all, int timeout_ms)
+{
+    EventBits_t got = xEventGroupWaitBits(event_group(), bits, pdFALSE, all ? pdTRUE : pdFALSE,
+                                          timeout_ms > 0 ? pdMS_TO_TICKS(timeout_ms) : 0);
+    got &= bits;
+    if (all) return got == bits ? got : 0;
+    return got;
+}
+
+int modem_at_elapsed_ms(EventBits_t bit)
+{
+    int ms = -1;
+    taskENTER_CRITICAL(&s_mux);
+    for (int i = 0; i < AT_EV_COUNT; ++i) {
+        if (bit == (1u << i) && s_ev_us[i] != 0) ms = (int)((s_ev_us[i] - s_boot_us) / 1000);
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    return ms;
+}
+
+int modem_at_cereg_stat(uint32_t *tac, uint32_t *ci)
+{
+    taskENTER_CRITICAL(&s_mux);
+    int stat = s_cereg_stat;
+    if (tac) *tac = s_cereg_tac;
+    if (ci) *ci = s_cereg_ci;
+    taskEXIT_CRITICAL(&s_mux);
+    return stat;
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include "esp_err.h"
+#include "esp_modem_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Eventos que publica el motor de URC (bits de un EventGroup) */
+#define MODEM_AT_EV_RDY         BIT0    // "RDY": el módem arrancó y acepta AT
+#define MODEM_AT_EV_SIM_READY   BIT1    // "+CPIN: READY"
+#define MODEM_AT_EV_PB_DONE     BIT2    // "PB DONE": SIM inicializada del todo
+#define MODEM_AT_EV_REGISTERED  BIT3    // +CEREG stat 1 (local) o 5 (roaming); se borra con cualquier otro stat
+#define MODEM_AT_EV_CELL        BIT4    // +CEREG con TAC/CI: celda servidora nueva o confirmada
+#define MODEM_AT_EV_ALL         (MODEM_AT_EV_RDY | MODEM_AT_EV_SIM_READY | MODEM_AT_EV_PB_DONE | \
+                                 MODEM_AT_EV_REGISTERED | MODEM_AT_EV_CELL)
+
+/* ===== Respuestas tipadas ===== */
+typedef enum {
+    MODEM_RAT_UNKNOWN = 0,
+    MODEM_RAT_GSM,
+    MODEM_RAT_WCDMA,
+    MODEM_RAT_LTE,
+} modem_rat_t;
+
+/** +CPSI: <System Mode>,<Operation Mode>,<MCC>-<MNC>,<LAC|TAC>,<Cell ID>,... (GSM, WCDMA, LTE) */
+typedef struct {
+    modem_rat_t rat;
+    bool        online;     // <Operation Mode> == Online
+    int         mcc;
+    int         mnc;
+    uint32_t    lac;        // LAC (GSM/WCDMA) o TAC (LTE)
+    uint32_t    cell_id;    // CID (GSM/WCDMA) o ECI de 28 bits (LTE)
+    int         band;       // LTE: n de EUTRAN-BANDn; 0 si no aplica
+    int         pci;        // PCI (LTE) o PSC (WCDMA); -1 si no viene
+    int         arfcn;      // EARFCN, UARFCN o ARFCN; -1 si no viene
+    int         signal_dbm; // RSRP (LTE), RSCP (WCDMA) o RxLev (GSM); 0 si no viene
+    bool        valid;      // RAT conocida, MCC/LAC/CID no nulos y (LTE) banda no nula
+} modem_cpsi_t;
+
+/** +CSQ: <rssi>,<ber> */
+typedef struct {
+    int rssi;               // 0..31, 99 = desconocido
+    int ber;                // 0..7, 99 = desconocido
+    int dbm;                // -113 + 2*rssi; 0 si desconocido
+} modem_csq_t;
+
+/** +CEREG: URC (<stat>[,<tac>,<ci>[,<AcT>]]) o respuesta a AT+CEREG? (<n>,<stat>[,...]).
+ *  Con AT+CEREG=4 añade <cause_type>,<reject_cause>,<Active-Time>,<Periodic-TAU>: PSM concedido */
+typedef struct {
+    int      n;             // -1 en la URC (no lo trae)
+    int      stat;          // 1 local, 5 roaming, 2 buscando, 0/3/4 sin registro
+    uint32_t tac;           // 0 si no venía
+    uint32_t ci;
+    int      act;           // -1 si no venía
+    int      active_time_s; // T3324 concedido; -1 si no venía o PSM desactivado
+    int      periodic_tau_s;// T3412 concedido; -1 si no venía
+} modem_cereg_t;
+
+/** +COPS: <mode>[,<format>,<oper>[,<AcT>]] */
+typedef struct {
+    int  mode;
+    int  format;            // -1 si no hay operador
+    char oper[24];          // nombre (formato 0/1) o MCCMNC (formato 2)
+    int  act;               // -1 si no venía
+} modem_cops_t;
+
+/** Celda vecina de +CENG. En LTE el módem sólo da PCI y señal (sin Cell ID) */
+typedef struct {
+    modem_rat_t rat;
+    int         mcc;        // 0 si no viene (se asume el de la servidora)
+    int         mnc;
+    uint32_t    lac;
+    uint32_t    cell_id;    // 0 si no viene
+    int         pci;        // PCI (LTE) o BSIC (GSM); -1 si no viene
+    int         arfcn;
+    int         signal_dbm; // 0 si no viene
+} modem_neighbor_t;
+
+#define MODEM_MAX_NEIGHBORS 6
+
+typedef struct {
+    int              count;             // guardadas en cell[]
+    int              seen;              // anunciadas por el módem (puede ser > count)
+    modem_neighbor_t cell[MODEM_MAX_NEIGHBORS];
+} modem_neighbors_t;
+
+/* Temporizadores de PSM/eDRX como cadenas de bits de 3GPP TS 24.008 ("00100011"), el formato de
+ * AT+CPSMS, AT+CEDRXS y +CEREG. Los de PSM se redondean hacia arriba al valor representable */
+#define MODEM_PSM_BITS_LEN  9       // 8 bits + '\0'
+#define MODEM_EDRX_BITS_LEN 5       // 4 bits + '\0'
+
+/** T3412 extendido (TAU periódico, GPRS Timer 3) */
+void modem_at_psm_tau_bits(uint32_t seconds, char out[MODEM_PSM_BITS_LEN]);
+/** T3324 (tiempo activo tras cada actividad, GPRS Timer 2) */
+void modem_at_psm_active_bits(uint32_t seconds, char out[MODEM_PSM_BITS_LEN]);
+/** Segundos de un temporizador en bits (active: T3324, si no T3412); -1 si desactivado o mal formado */
+int  modem_at_psm_timer_s(const char *bits, size_t len, bool active);
+/** Ciclo eDRX de E-UTRAN: el mayor que no supera ms (mínimo 5,12 s) */
+void modem_at_edrx_bits(uint32_t ms, char out[MODEM_EDRX_BITS_LEN]);
+
+/** Contexto de un comando: la respuesta va al buffer del llamador (pila), sin heap.
+ *  Inicializar con MODEM_AT_RSP(buf) */
+typedef struct {
+    char     *buf;
+    size_t    size;
+    size_t    used;         // bytes guardados en buf (siempre terminado en '\0')
+    size_t    seen;         // bytes recibidos; > used si la respuesta no cupo
+    esp_err_t result;       // ESP_OK con "OK", ESP_FAIL con ERROR/+CME ERROR/+CMS ERROR
+    char      line[16];     // comienzo de la línea en curso, para detectar el código final
+    uint8_t   line_len;
+} modem_at_rsp_t;
+
+#define MODEM_AT_RSP(b) { .buf = (b), .size = sizeof(b), .result = ESP_ERR_TIMEOUT }
+
+/** Envía cmd (con '\r' final) y acumula la respuesta completa hasta OK/ERROR en rsp.
+ *  Se puede llamar desde varias tareas: cada una pasa su contexto y los comandos se serializan
+ *  (el DTE sólo admite uno en vuelo). ESP_ERR_INVALID_SIZE si la respuesta no cupo */
+esp_err_t modem_at_command(esp_modem_dce_t *dce, const char *cmd, modem_at_rsp_t *rsp, uint32_t timeout_ms);
+
+/** Parsers: buscan la línea con el prefijo en rsp (que puede traer eco, varias líneas y OK).
+ *  No escriben en rsp ni reservan memoria */
+bool modem_at_parse_cpsi(const char *rsp, modem_cpsi_t *out);
+bool modem_at_parse_csq(const char *rsp, modem_csq_t *out);
+bool modem_at_parse_cereg(const char *rsp, modem_cereg_t *out);
+bool modem_at_parse_cops(const char *rsp, modem_cops_t *out);
+/** Vecinas de AT+CENG? (formatos 2G con Cell ID y LTE con PCI); la servidora (índice 0) se omite */
+bool modem_at_parse_ceng(const char *rsp, modem_neighbors_t *out);
+
+/** Prepara modem_at_command y registra el manejador de URC en el DCE (requiere
+ *  CONFIG_ESP_MODEM_URC_HANDLER). Sin URC, modem_at_wait sólo agota el timeout y los llamadores
+ *  siguen consultando */
+esp_err_t modem_at_init(esp_modem_dce_t *dce);
+
+/** true si el DCE entrega URC al motor */
+bool modem_at_urc_enabled(void);
+
+/** Alimenta el motor con bytes crudos del UART (lo llama esp_modem; público para test/host/mock_modem.c).
+ *  Acepta líneas partidas entre llamadas */
+esp_err_t modem_at_feed(uint8_t *data, size_t len);
+
+/** Nuevo arranque del módem: borra todos los eventos y pone a cero el cronómetro de modem_at_elapsed_ms */
+void modem_at_mark_boot(void);
+
+/** Borra eventos concretos (p. ej. REGISTERED antes de AT+CFUN=1) */
+void modem_at_clear(EventBits_t bits);
+
+/** Espera a los eventos (all: todos o cualquiera). Devuelve los bits presentes de los pedidos; 0 si timeout */
+EventBits_t modem_at_wait(EventBits_t bits, bool all, int timeout_ms);
+
+/** ms desde modem_at_mark_boot hasta la primera vez que llegó el evento; -1 si no llegó */
+int modem_at_elapsed_ms(EventBits_t bit);
+
+/** Último +CEREG visto (URC o respuesta): stat y, si venían, TAC/CI. stat -1 si no hubo ninguno */
+int modem_at_cereg_stat(uint32_t *tac, uint32_t *ci);
+
+#ifdef __cplusplus
+}
+#endif
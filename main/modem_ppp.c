@@ -2,14 +2,16 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <inttypes.h>
-#include <ctype.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include "driver/gpio.h"
+#include "driver/uart.h"
 
 #include "esp_log.h"
 #include "esp_err.h"
@@ -17,10 +19,12 @@
 #include "esp_netif.h"
 #include "esp_netif_ppp.h"
 #include "esp_heap_caps.h"
+#include "esp_system.h"           // esp_restart (último recurso)
 #include "lwip/inet.h"              // ipaddr_addr
-#include "lwip/dns.h"          // dns_setserver
-#include "lwip/netdb.h"        // getaddrinfo (si haces pruebas)
 #include "esp_modem_api.h"
+#include "modem_at.h"              // URC: RDY, +CPIN, PB DONE, +CEREG
+#include "geo_cache.h"             // celda -> ciudad sin volver a UnwiredLabs
+#include "dns_cache.h"             // el host de UnwiredLabs se precarga con cada IP
 
 /* ==== HTTP (UnwiredLabs) ==== */
 #include "esp_http_client.h"
@@ -40,13 +44,86 @@
 
 static const char *TAG = "modem_ppp";
 static EventGroupHandle_t s_ppp_eg;
-#define PPP_UP_BIT  BIT0
+#define PPP_UP_BIT    BIT0
+#define PPP_LOST_BIT  BIT1
+
+/* Recuperación de enlace: cada nivel se intenta 2 veces antes de escalar */
+#define RECOVERY_TASK_STACK     6144
+#define RECOVERY_DATA_IP_MS     30000   // nivel 1: volver a DATA
+#define RECOVERY_AT_IP_MS       60000   // nivel 2: ATH + CFUN 0/1
+#define RECOVERY_POWER_IP_MS    90000   // nivel 3: ciclo de alimentación del módem
+#define RECOVERY_CEREG_MS       60000
+#define RECOVERY_TRIES_PER_LVL  2
+
+/* UART del DTE: arranca a 115200 y sube con AT+IPR si el config lo pide */
+#define MODEM_UART_PORT         UART_NUM_1
+#define MODEM_BAUD_DEFAULT      115200
+#define MODEM_BAUD_VERIFY_AT    3       // AT seguidos que deben contestar a un baud nuevo
+#define BENCH_BUF_SIZE          2048
+
+/* Esperas por URC: el tope sólo se agota si el módem no avisa; CHECK es la consulta de respaldo */
+#define MODEM_BOOT_READY_MS     15000   // RDY/+CPIN: READY tras encender
+#define MODEM_BOOT_CHECK_MS     1000    // sin URC, un AT por segundo detecta que ya contesta
+#define CEREG_CHECK_MS          5000    // re-consulta AT+CEREG? por si se perdió la URC
 
 /* ===== UE info global ===== */
 static modem_ue_info_t s_ue_info;   // última UE info válida (CPSI)
 static bool            s_ue_valid;  // hay UE info válida
+static portMUX_TYPE    s_ue_mux = portMUX_INITIALIZER_UNLOCKED;   // la actualiza también modem_poll_radio
 static esp_netif_t *s_ppp_netif = NULL;   // guarda el netif PPP para bind
 
+/* ===== Estado de la recuperación ===== */
+static modem_ppp_config_t    s_cfg;          // copia del config de arranque (pines, APN)
+static esp_modem_dce_t      *s_dce;
+static TaskHandle_t          s_recovery_task;
+static int64_t               s_lost_us;      // esp_timer de la última caída
+static modem_ppp_link_metrics_t s_link;     // lo escribe sólo la tarea de recuperación
+static portMUX_TYPE          s_link_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* CMUX: un canal virtual lleva PPP y otro los AT. s_at_mutex serializa el uso del DCE
+ * entre la recuperación (que cambia de modo) y las consultas de telemetría */
+static volatile bool         s_cmux_active;
+static SemaphoreHandle_t     s_at_mutex;
+
+/* AT+CENG: modo ingeniería activado en esta sesión del módem, o el firmware no lo tiene.
+ * Un ciclo de alimentación lo devuelve a UNKNOWN. La respuesta va a un buffer protegido por s_at_mutex */
+typedef enum { CENG_UNKNOWN, CENG_ON, CENG_UNSUPPORTED } ceng_state_t;
+static ceng_state_t          s_ceng = CENG_UNKNOWN;
+static char                  s_ceng_buf[768];
+
+/* Geolocalización: lo escribe sólo quien llama a UnwiredLabs (serializado por ul_body) */
+static modem_ul_metrics_t    s_ul;
+static portMUX_TYPE          s_ul_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Ahorro de energía: entre subidas PPP se cuelga y el módem duerme (DTR alto; PSM/eDRX si la red los da).
+ * s_power cambia siempre con s_at_mutex tomado; el resto del estado va bajo s_power_mux */
+#define POWER_TASK_STACK        6144
+#define POWER_CHECK_MS          1000    // despierto: mira la cola y la hora una vez por segundo
+#define POWER_MIN_SLEEP_MS      30000   // colgar + despertar + IP: no compensa dormir menos
+#define POWER_WAKE_CEREG_MS     30000
+#define POWER_WAKE_IP_MS        60000
+#define POWER_DTR_WAKE_MS       100     // DTR bajo -> UART del módem atiende (A7670/SIM7600: ~50 ms)
+
+typedef enum { POWER_AWAKE, POWER_SLEEPING, POWER_WAKING } power_state_t;
+static modem_ppp_power_config_t  s_pcfg;
+static TaskHandle_t              s_power_task;
+static volatile power_state_t    s_power = POWER_AWAKE;
+static bool                      s_psm_requested;   // AT+CPSMS enviado en esta sesión del módem
+static int64_t                   s_uplink_due_us;   // próxima subida programada; 0 = ninguna
+static int64_t                   s_activity_us;     // el reposo (idle_ms) cuenta desde aquí
+static int                       s_hold_count;      // modem_ppp_hold_awake sin su release: no se duerme
+static bool                      s_wake_req;        // subida fuera de plan: despertar ya
+static int64_t                   s_ttip_avg_us;     // tiempo a IP suavizado: fija la antelación
+static int64_t                   s_power_since_us;  // inicio del estado actual
+static modem_ppp_power_metrics_t s_pm;
+static portMUX_TYPE              s_power_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Estado del UART local (lo cambian el arranque y la recuperación, con el módem en COMMAND) */
+static int                   s_uart_baud = MODEM_BAUD_DEFAULT;
+static bool                  s_hw_flow;
+/* De mayor a menor; se prueban sólo los <= baud_rate del config. A7670/SIM7600 llegan a 3686400 */
+static const int             k_baud_ladder[] = { 3686400, 3000000, 1843200, 921600, 460800, 230400 };
+
 /* ---------------- PPP / Eventos ---------------- */
 static void on_ip_event(void *arg, esp_event_base_t base, int32_t id, void *data) {
     if (id == IP_EVENT_PPP_GOT_IP) {
@@ -54,13 +131,33 @@ static void on_ip_event(void *arg, esp_event_base_t base, int32_t id, void *data
         ESP_LOGI(TAG, "PPP UP  ip=" IPSTR " gw=" IPSTR, IP2STR(&e->ip_info.ip), IP2STR(&e->ip_info.gw));
         xEventGroupSetBits(s_ppp_eg, PPP_UP_BIT);
     } else if (id == IP_EVENT_PPP_LOST_IP) {
-        ESP_LOGW(TAG, "Fallo PPP reiniciando esp...");
-        esp_restart();
+        // Sin reiniciar: la tarea de recuperación reconecta; muestreo y cola siguen mientras tanto
+        xEventGroupClearBits(s_ppp_eg, PPP_UP_BIT);
+        if (s_power != POWER_AWAKE) return;    // colgado a propósito para dormir
+        if (!s_recovery_task) {
+            ESP_LOGW(TAG, "PPP perdido durante el arranque");
+            return;
+        }
+        ESP_LOGW(TAG, "PPP perdido; iniciando recuperación");
+        xEventGroupSetBits(s_ppp_eg, PPP_LOST_BIT);
     }
 }
 
+/* Tras encender, el módem avisa con RDY (o +CPIN: READY) en cuanto acepta AT. Si ya estaba
+ * encendido o arrancó a otro baud no llega la URC: un AT por segundo lo detecta igual */
+static void wait_modem_ready(void)
+{
+    int64_t t0 = esp_timer_get_time();
+    while ((esp_timer_get_time() - t0) / 1000 < MODEM_BOOT_READY_MS) {
+        if (modem_at_wait(MODEM_AT_EV_RDY | MODEM_AT_EV_SIM_READY, false, MODEM_BOOT_CHECK_MS)) return;
+        if (s_dce && esp_modem_sync(s_dce) == ESP_OK) return;
+    }
+    ESP_LOGW(TAG, "El módem no avisó RDY en %d ms; se continúa", MODEM_BOOT_READY_MS);
+}
+
 /* Encendido estable para A7670/SIM7600 */
 static void hw_boot(const modem_ppp_config_t *c) {
+    modem_at_mark_boot();
     if (c->board_power_io >= 0) {
         gpio_set_direction(c->board_power_io, GPIO_MODE_OUTPUT);
         gpio_set_level(c->board_power_io, 1);
@@ -70,7 +167,7 @@ static void hw_boot(const modem_ppp_config_t *c) {
         gpio_set_level(c->rst_io, 0);
         vTaskDelay(pdMS_TO_TICKS(100));
         gpio_set_level(c->rst_io, 1);
-        vTaskDelay(pdMS_TO_TICKS(2600));
+        vTaskDelay(pdMS_TO_TICKS(2600));       // ancho mínimo del pulso de reset
         gpio_set_level(c->rst_io, 0);
     }
     if (c->dtr_io >= 0) {
@@ -85,75 +182,85 @@ static void hw_boot(const modem_ppp_config_t *c) {
         vTaskDelay(pdMS_TO_TICKS(100));
         gpio_set_level(c->pwrkey_io, 1);
     }
-    vTaskDelay(pdMS_TO_TICKS(3000));
+    wait_modem_ready();
 }
 
-/* Acumulador para esp_modem_command() */
-typedef struct { char *buf; size_t size; size_t used; } at_acc_t;
-static at_acc_t s_acc;
-
-static esp_err_t at_acc_cb(uint8_t *data, size_t len) {
-    size_t n = (len < (s_acc.size - s_acc.used - 1)) ? len : (s_acc.size - s_acc.used - 1);
-    if (n > 0 && s_acc.buf) {
-        memcpy(s_acc.buf + s_acc.used, data, n);
-        s_acc.used += n;
-        s_acc.buf[s_acc.used] = '\0';
+/* Apaga el módem de verdad (corte de alimentación o PWRKEY largo) y lo vuelve a encender */
+static void hw_power_cycle(const modem_ppp_config_t *c) {
+    if (c->board_power_io >= 0) {
+        gpio_set_level(c->board_power_io, 0);
+        vTaskDelay(pdMS_TO_TICKS(2000));
+    } else if (c->pwrkey_io >= 0) {
+        gpio_set_level(c->pwrkey_io, 0);          // A7670/SIM7600: PWRKEY bajo >2.5 s apaga
+        vTaskDelay(pdMS_TO_TICKS(3000));
+        gpio_set_level(c->pwrkey_io, 1);
+        vTaskDelay(pdMS_TO_TICKS(3000));
     }
-    return ESP_OK;
+    hw_boot(c);
 }
 
-/* Validación de CPSI “completa” (descarta NO SERVICE/valores nulos) */
-static bool cpsi_se_ve_valido(const char *s) {
-    if (!s || !*s) return false;
-    if (strstr(s, "NO SERVICE")) return false;
-    if (strstr(s, "000-00"))     return false;  // MCC-MNC nulos
-    if (strstr(s, "BAND0"))      return false;  // banda nula/transitoria
-    if (strstr(s, ",0,0,") || strstr(s, ",00000000,")) return false; // CellID/TAC nulos
-    return true;
+/* La celda servidora que publica el módulo: +CPSI ya validado */
+static void ue_from_cpsi(const modem_cpsi_t *c, modem_ue_info_t *out)
+{
+    *out = (modem_ue_info_t){
+        .rat = c->rat, .mcc = c->mcc, .mnc = c->mnc,
+        .tac = c->lac, .cell_id = c->cell_id, .pci = c->pci, .signal_dbm = c->signal_dbm,
+        .valid = c->valid,
+    };
 }
 
-/* +CEREG: <n>,<stat>[,...] ; stat 1(home) / 5(roaming) */
+/* +CEREG stat 1(home) / 5(roaming) */
 static bool cereg_registrado(const char *rsp) {
-    return (rsp && (strstr(rsp, ",1") || strstr(rsp, ",5")));
+    modem_cereg_t c;
+    return modem_at_parse_cereg(rsp, &c) && (c.stat == 1 || c.stat == 5);
 }
 
-static esp_err_t esperar_cereg(esp_modem_dce_t *dce, int timeout_ms, int poll_ms) {
-    int elapsed = 0;
+/* AT+CEREG=2 hace que el módem avise (+CEREG: <stat>,<tac>,<ci>) en cuanto cambia el registro:
+ * se despierta con la URC. La consulta cada check_ms es sólo respaldo por si se pierde */
+static esp_err_t esperar_cereg(esp_modem_dce_t *dce, int timeout_ms, int check_ms) {
     char out[128] = {0};
-    while (elapsed < timeout_ms) {
-        esp_err_t err = esp_modem_at(dce, "AT+CEREG?\r", out, 2000);
+    modem_at_rsp_t rsp = MODEM_AT_RSP(out);
+    (void)modem_at_command(dce, "AT+CEREG=2\r", &rsp, 2000);
+    int64_t t0 = esp_timer_get_time();
+    while (1) {
+        rsp = (modem_at_rsp_t)MODEM_AT_RSP(out);
+        esp_err_t err = modem_at_command(dce, "AT+CEREG?\r", &rsp, 2000);
         if (err == ESP_OK && cereg_registrado(out)) {
             ESP_LOGI(TAG, "CEREG OK: %s", out);
             return ESP_OK;
         }
-        vTaskDelay(pdMS_TO_TICKS(poll_ms));
-        elapsed += poll_ms;
+        int elapsed = (int)((esp_timer_get_time() - t0) / 1000);
+        if (elapsed >= timeout_ms) break;
+        int slice = timeout_ms - elapsed < check_ms ? timeout_ms - elapsed : check_ms;
+        if (modem_at_wait(MODEM_AT_EV_REGISTERED, true, slice)) {
+            ESP_LOGI(TAG, "CEREG OK por URC en %d ms", (int)((esp_timer_get_time() - t0) / 1000));
+            return ESP_OK;
+        }
     }
     ESP_LOGW(TAG, "CEREG no llegó a registrado en %d ms (último: %s)", timeout_ms, out);
     return ESP_ERR_TIMEOUT;
 }
 
-/* AT+CPSI? con reintentos/backoff */
-static esp_err_t cpsi_con_reintentos(esp_modem_dce_t *dce,
-                                     char *out_final, size_t out_len,
+/* AT+CPSI? con reintentos. Tras registrarse el módem tarda en fijar la celda (NO SERVICE, BAND0):
+ * entre intentos se espera la URC +CEREG con TAC/CI, con el backoff lineal como tope */
+static esp_err_t cpsi_con_reintentos(esp_modem_dce_t *dce, modem_cpsi_t *cpsi,
                                      int intentos, int delay_ms)
 {
     char out[256] = {0};
     esp_err_t last = ESP_FAIL;
 
     for (int i = 0; i < intentos; ++i) {
-        memset(out, 0, sizeof(out));
-        last = esp_modem_at(dce, "AT+CPSI?\r", out, 12000);
-        if (last == ESP_OK && cpsi_se_ve_valido(out)) {
-            if (out_final && out_len) strlcpy(out_final, out, out_len);
-            ESP_LOGI(TAG, "CPSI intento %d/%d OK: %s", i+1, intentos, out);
+        modem_at_rsp_t rsp = MODEM_AT_RSP(out);
+        last = modem_at_command(dce, "AT+CPSI?\r", &rsp, 12000);
+        if (last == ESP_OK && modem_at_parse_cpsi(out, cpsi) && cpsi->valid) {
+            ESP_LOGI(TAG, "CPSI intento %d/%d OK", i+1, intentos);
             return ESP_OK;
         }
         ESP_LOGW(TAG, "CPSI intento %d/%d %s: %s",
                  i+1, intentos, (last==ESP_OK ? "inválido" : esp_err_to_name(last)), out);
-        vTaskDelay(pdMS_TO_TICKS(delay_ms + i*delay_ms)); // backoff lineal
+        modem_at_clear(MODEM_AT_EV_CELL);
+        (void)modem_at_wait(MODEM_AT_EV_CELL, true, delay_ms + i*delay_ms);
     }
-    if (out_final && out_len) strlcpy(out_final, out, out_len);
     return last == ESP_OK ? ESP_FAIL : last;
 }
 
@@ -182,84 +289,303 @@ static esp_err_t set_mode_if_needed(esp_modem_dce_t *dce, esp_modem_dce_mode_t t
     return esp_modem_set_mode(dce, target);
 }
 
-/* ===== Parser C de +CPSI (LTE/GSM): MCC, MNC, TAC/LAC, ECI/CID =====
- * LTE ejemplo:
- *   +CPSI: LTE,Online,334-20,0x232,43790378,55,EUTRAN-BAND5,...
- * GSM ejemplo:
- *   +CPSI: GSM,Online,334-20,0x19,31925,733 PCS 1900,...
- *       idx:  0    1     2      3       4
- */
-static char *trim_ws(char *s) {
-    if (!s) return s;
-    while (*s && isspace((unsigned char)*s)) s++;
-    size_t n = strlen(s);
-    while (n && isspace((unsigned char)s[n-1])) s[--n] = '\0';
-    return s;
+/* ===================== UART: baud y flow control ===================== */
+static void uart_set_local_baud(int baud)
+{
+    uart_set_baudrate(MODEM_UART_PORT, baud);
+    s_uart_baud = baud;
 }
 
-static bool parse_cpsi_line(const char *line_in, modem_ue_info_t *out)
+/* Un baud marginal suele dejar pasar algún AT y romper otros: se exigen varios seguidos */
+static bool uart_link_ok(esp_modem_dce_t *dce)
 {
-    if (!line_in || !out) return false;
-    memset(out, 0, sizeof(*out));
-    out->valid = false;
-
-    char buf[256];
-    strlcpy(buf, line_in, sizeof(buf));
-
-    char *s = buf;
-    char *pfx = strstr(buf, "+CPSI:");
-    if (pfx) s = pfx + 6; // salta el prefijo
-
-    int tokenId = 0;
-    char *save = NULL;
-    for (char *tok = strtok_r(s, ",", &save); tok; tok = strtok_r(NULL, ",", &save), tokenId++) {
-        tok = trim_ws(tok);
-        if (tokenId == 2) {  // "<MCC>-<MNC>"
-            char *dash = strchr(tok, '-');
-            if (!dash) return false;
-            *dash = '\0';
-            out->mcc = atoi(trim_ws(tok));
-            out->mnc = atoi(trim_ws(dash + 1));
-        } else if (tokenId == 3) { // TAC/LAC (hex o dec)
-            out->tac = (uint32_t)strtoul(tok, NULL, 0);
-        } else if (tokenId == 4) { // SCellID/CellID (ECI/CID)
-            out->cell_id = (uint32_t)strtoul(tok, NULL, 0);
-            break; // ya tenemos lo que queremos
+    for (int i = 0; i < MODEM_BAUD_VERIFY_AT; ++i) {
+        if (esp_modem_sync(dce) != ESP_OK) return false;
+    }
+    return true;
+}
+
+/* AT+IPR se guarda en el módem: tras un reinicio puede seguir en el baud negociado.
+ * Busca el baud al que contesta empezando por el actual */
+static esp_err_t uart_probe_baud(esp_modem_dce_t *dce)
+{
+    int prev = s_uart_baud;
+    if (esp_modem_sync(dce) == ESP_OK) return ESP_OK;
+    if (prev != MODEM_BAUD_DEFAULT) {
+        uart_set_local_baud(MODEM_BAUD_DEFAULT);
+        if (esp_modem_sync(dce) == ESP_OK) {
+            ESP_LOGW(TAG, "Módem contesta a %d (no a %d)", MODEM_BAUD_DEFAULT, prev);
+            return ESP_OK;
         }
     }
+    for (size_t i = 0; i < sizeof(k_baud_ladder) / sizeof(k_baud_ladder[0]); ++i) {
+        if (k_baud_ladder[i] == prev) continue;
+        uart_set_local_baud(k_baud_ladder[i]);
+        if (esp_modem_sync(dce) == ESP_OK) {
+            ESP_LOGW(TAG, "Módem contesta a %d (no a %d)", k_baud_ladder[i], prev);
+            return ESP_OK;
+        }
+    }
+    uart_set_local_baud(prev);
+    return ESP_FAIL;
+}
 
-    if (out->mcc < 100 || out->mcc > 999) return false;
-    if (out->mnc < 0   || out->mnc > 999) return false;
-    out->valid = true;
-    return true;
+/* Quita RTS/CTS del lado ESP (antes de un ciclo de alimentación el módem pierde AT+IFC) */
+static void uart_flow_local_off(void)
+{
+    if (!s_hw_flow) return;
+    uart_set_hw_flow_ctrl(MODEM_UART_PORT, UART_HW_FLOWCTRL_DISABLE, 0);
+    s_hw_flow = false;
+}
+
+/* RTS/CTS en ambos extremos; si el AT deja de contestar se deshace */
+static void uart_setup_flow(esp_modem_dce_t *dce, const modem_ppp_config_t *c)
+{
+    if (!c->hw_flow_ctrl || s_hw_flow) return;
+    if (c->rts_io < 0 || c->cts_io < 0) {
+        ESP_LOGW(TAG, "hw_flow_ctrl requiere rts_io y cts_io; sigue sin flow control");
+        return;
+    }
+    if (esp_modem_set_flow_control(dce, 2, 2) != ESP_OK) {
+        ESP_LOGW(TAG, "AT+IFC=2,2 rechazado; sigue sin flow control");
+        return;
+    }
+    uart_set_hw_flow_ctrl(MODEM_UART_PORT, UART_HW_FLOWCTRL_CTS_RTS, UART_HW_FIFO_LEN(MODEM_UART_PORT) - 8);
+    s_hw_flow = true;
+    if (uart_link_ok(dce)) {
+        ESP_LOGI(TAG, "Flow control RTS/CTS activo");
+        return;
+    }
+    ESP_LOGW(TAG, "Sin respuesta AT con RTS/CTS (¿pines cruzados?); volviendo a NONE");
+    uart_flow_local_off();
+    (void)esp_modem_set_flow_control(dce, 0, 0);
+}
+
+/* Sube el baud con AT+IPR escalón a escalón (de mayor a menor) hasta que uno verifique.
+ * Si el nuevo baud no contesta se pide AT+IPR=<anterior> a ciegas y se vuelve al anterior */
+static void uart_negotiate_baud(esp_modem_dce_t *dce, int target)
+{
+    for (size_t i = 0; i < sizeof(k_baud_ladder) / sizeof(k_baud_ladder[0]); ++i) {
+        int baud = k_baud_ladder[i];
+        if (baud > target || baud <= s_uart_baud) continue;
+        int prev = s_uart_baud;
+        if (esp_modem_set_baud(dce, baud) != ESP_OK) {
+            ESP_LOGW(TAG, "AT+IPR=%d rechazado", baud);
+            continue;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));    // el módem cambia tras responder OK
+        uart_set_local_baud(baud);
+        if (uart_link_ok(dce)) {
+            ESP_LOGI(TAG, "UART a %d baud (%s)", baud, s_hw_flow ? "RTS/CTS" : "sin flow control");
+            return;
+        }
+        ESP_LOGW(TAG, "%d baud no verifica; volviendo a %d", baud, prev);
+        for (int t = 0; t < 3; ++t) {
+            uart_set_local_baud(baud);
+            (void)esp_modem_set_baud(dce, prev);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            uart_set_local_baud(prev);
+            if (uart_link_ok(dce)) break;
+        }
+        if (uart_probe_baud(dce) != ESP_OK) {
+            ESP_LOGE(TAG, "Módem sin respuesta tras rollback de baud");
+            return;
+        }
+    }
+    if (s_uart_baud != MODEM_BAUD_DEFAULT || target > MODEM_BAUD_DEFAULT) {
+        ESP_LOGI(TAG, "UART a %d baud (%s)", s_uart_baud, s_hw_flow ? "RTS/CTS" : "sin flow control");
+    }
+}
+
+/* Flow control primero: protege al baud alto de desbordes durante la verificación */
+static void uart_setup_link(esp_modem_dce_t *dce, const modem_ppp_config_t *c)
+{
+    uart_setup_flow(dce, c);
+    if (c->baud_rate > MODEM_BAUD_DEFAULT) uart_negotiate_baud(dce, c->baud_rate);
 }
 
 /* ===== API pública ===== */
 bool modem_get_ue_info(modem_ue_info_t *out)
 {
     if (!out) return false;
+    taskENTER_CRITICAL(&s_ue_mux);
     *out = s_ue_info;
-    return s_ue_valid;
+    bool valid = s_ue_valid;
+    taskEXIT_CRITICAL(&s_ue_mux);
+    return valid;
+}
+
+static void set_ue_info(const modem_ue_info_t *info)
+{
+    taskENTER_CRITICAL(&s_ue_mux);
+    if (info) s_ue_info = *info;
+    s_ue_valid = info != NULL;
+    taskEXIT_CRITICAL(&s_ue_mux);
+}
+
+bool modem_ppp_is_up(void)
+{
+    return s_ppp_eg && (xEventGroupGetBits(s_ppp_eg) & PPP_UP_BIT);
+}
+
+bool modem_ppp_cmux_active(void)
+{
+    return s_cmux_active;
 }
 
-static void force_public_dns(void) {
-    // Ajusta ambos: global (LWIP) y por interfaz (esp-netif)
-    ip_addr_t dns;
-    IP_ADDR4(&dns, 1, 1, 1, 1);
-    dns_setserver(0, &dns);
-    IP_ADDR4(&dns, 8, 8, 8, 8);
-    dns_setserver(1, &dns);
+/* Telemetría por el canal AT de CMUX: no toca la sesión PPP. Cada comando es independiente;
+ * un fallo deja su campo en "desconocido" y el resto se rellena igual */
+esp_err_t modem_poll_radio(modem_radio_status_t *out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+    if (s_power != POWER_AWAKE) return ESP_ERR_TIMEOUT;     // dormido entre subidas (modem_ppp_is_asleep)
+    if (!s_dce || !s_cmux_active) return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(s_at_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return ESP_ERR_TIMEOUT;  // en recuperación
+    if (!s_cmux_active) {
+        xSemaphoreGive(s_at_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    if (s_ppp_netif) {
-        esp_netif_dns_info_t d1 = { .ip.type = ESP_IPADDR_TYPE_V4 };
-        d1.ip.u_addr.ip4.addr = ipaddr_addr("1.1.1.1");
-        esp_netif_set_dns_info(s_ppp_netif, ESP_NETIF_DNS_MAIN, &d1);
-        esp_netif_dns_info_t d2 = { .ip.type = ESP_IPADDR_TYPE_V4 };
-        d2.ip.u_addr.ip4.addr = ipaddr_addr("8.8.8.8");
-        esp_netif_set_dns_info(s_ppp_netif, ESP_NETIF_DNS_BACKUP, &d2);
+    memset(out, 0, sizeof(*out));
+    out->rssi = 99;
+    out->ber = 99;
+    out->cereg_stat = -1;
+    int ok = 0;
+
+    if (esp_modem_get_signal_quality(s_dce, &out->rssi, &out->ber) == ESP_OK) ok++;
+
+    char buf[256] = {0};
+    modem_at_rsp_t rsp = MODEM_AT_RSP(buf);
+    modem_cereg_t cereg;
+    if (modem_at_command(s_dce, "AT+CEREG?\r", &rsp, 2000) == ESP_OK &&
+        modem_at_parse_cereg(buf, &cereg)) {
+        out->cereg_stat = cereg.stat;
+        ok++;
     }
+
+    rsp = (modem_at_rsp_t)MODEM_AT_RSP(buf);
+    modem_cpsi_t cpsi;
+    if (modem_at_command(s_dce, "AT+CPSI?\r", &rsp, 5000) == ESP_OK &&
+        modem_at_parse_cpsi(buf, &cpsi) && cpsi.valid) {
+        ue_from_cpsi(&cpsi, &out->ue);
+        set_ue_info(&out->ue);     // la celda servidora puede haber cambiado desde el arranque
+        ok++;
+    }
+    xSemaphoreGive(s_at_mutex);
+
+    out->updated_us = esp_timer_get_time();
+    return ok ? ESP_OK : ESP_FAIL;
 }
 
+/* Vecinas por AT+CENG (canal AT de CMUX). Si el firmware no lo tiene (ERROR) se recuerda y no se
+ * vuelve a preguntar: la geolocalización sigue con la servidora sola */
+esp_err_t modem_read_neighbors(modem_neighbors_t *out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+    memset(out, 0, sizeof(*out));
+    if (!s_dce || !s_cmux_active) return ESP_ERR_INVALID_STATE;
+    if (s_ceng == CENG_UNSUPPORTED) return ESP_ERR_NOT_SUPPORTED;
+    if (xSemaphoreTake(s_at_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return ESP_ERR_TIMEOUT;
+    if (!s_cmux_active) {
+        xSemaphoreGive(s_at_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_OK;
+    modem_at_rsp_t rsp = MODEM_AT_RSP(s_ceng_buf);
+    if (s_ceng == CENG_UNKNOWN) {
+        err = modem_at_command(s_dce, "AT+CENG=1,1\r", &rsp, 2000);    // modo ingeniería con vecinas
+        if (err == ESP_FAIL) {
+            s_ceng = CENG_UNSUPPORTED;
+            ESP_LOGI(TAG, "El módem no tiene AT+CENG; geolocalización con la celda servidora sola");
+            err = ESP_ERR_NOT_SUPPORTED;
+        } else if (err == ESP_OK) {
+            s_ceng = CENG_ON;
+        }
+    }
+    if (err == ESP_OK) {
+        rsp = (modem_at_rsp_t)MODEM_AT_RSP(s_ceng_buf);
+        err = modem_at_command(s_dce, "AT+CENG?\r", &rsp, 3000);
+        if (err == ESP_OK && !modem_at_parse_ceng(s_ceng_buf, out)) err = ESP_FAIL;
+    }
+    xSemaphoreGive(s_at_mutex);
+    return err;
+}
+
+/* Descarga url en bucle hasta duration_ms y mide bytes/s del cuerpo (sin tocar el UART) */
+esp_err_t modem_ppp_benchmark(const char *url, int duration_ms, modem_ppp_bench_t *out)
+{
+    if (!url || !out || duration_ms <= 0) return ESP_ERR_INVALID_ARG;
+    memset(out, 0, sizeof(*out));
+    if (!modem_ppp_is_up()) return ESP_ERR_INVALID_STATE;
+
+    char *buf = malloc(BENCH_BUF_SIZE);
+    if (!buf) return ESP_ERR_NO_MEM;
+
+    struct ifreq ifr = {0};
+    if (s_ppp_netif) esp_netif_get_netif_impl_name(s_ppp_netif, ifr.ifr_name);
+    esp_http_client_config_t hc = {
+        .url = url,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .timeout_ms = 15000,
+        .buffer_size = BENCH_BUF_SIZE,
+        .if_name = s_ppp_netif ? &ifr : NULL
+    };
+    esp_http_client_handle_t cli = esp_http_client_init(&hc);
+    if (!cli) {
+        free(buf);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = ESP_OK;
+    int rounds = 0;
+    int64_t t0 = esp_timer_get_time();
+    int64_t deadline = t0 + (int64_t)duration_ms * 1000;
+    while (esp_timer_get_time() < deadline) {
+        err = esp_http_client_open(cli, 0);
+        if (err != ESP_OK) break;
+        int status = 0;
+        if (esp_http_client_fetch_headers(cli) < 0 || (status = esp_http_client_get_status_code(cli)) / 100 != 2) {
+            ESP_LOGW(TAG, "Benchmark: HTTP %d", status);
+            err = ESP_FAIL;
+            esp_http_client_close(cli);
+            break;
+        }
+        int n;
+        while ((n = esp_http_client_read(cli, buf, BENCH_BUF_SIZE)) > 0) {
+            out->bytes += (uint64_t)n;
+            if (esp_timer_get_time() >= deadline) break;
+        }
+        esp_http_client_close(cli);
+        rounds++;
+        if (n < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+    }
+    out->elapsed_us = esp_timer_get_time() - t0;
+    esp_http_client_cleanup(cli);
+    free(buf);
+
+    out->baud = s_uart_baud;
+    out->hw_flow = s_hw_flow;
+    out->uart_limit = (uint32_t)(s_uart_baud / 10);
+    if (out->elapsed_us > 0) out->bytes_per_s = (uint32_t)(out->bytes * 1000000ULL / (uint64_t)out->elapsed_us);
+    ESP_LOGI(TAG, "Benchmark PPP: %llu B en %lld ms (%d descargas) = %u B/s; UART %d baud%s, techo %u B/s (%u%%)",
+             (unsigned long long)out->bytes, (long long)(out->elapsed_us / 1000), rounds,
+             (unsigned)out->bytes_per_s, out->baud, out->hw_flow ? " RTS/CTS" : "",
+             (unsigned)out->uart_limit, (unsigned)(out->bytes_per_s * 100ULL / out->uart_limit));
+    if (out->bytes > 0) return ESP_OK;
+    return err != ESP_OK ? err : ESP_FAIL;
+}
+
+void modem_ppp_get_link_metrics(modem_ppp_link_metrics_t *out)
+{
+    if (!out) return;
+    taskENTER_CRITICAL(&s_link_mux);
+    *out = s_link;
+    taskEXIT_CRITICAL(&s_link_mux);
+}
 
 /* ===================== UnwiredLabs (HTTPS) ===================== */
 /* Patrón “Geoapify”: buffer estático + event handler acumulador */
@@ -299,33 +625,131 @@ static bool json_get_string(const char *json, const char *key, char *out, size_t
     return true;
 }
 
-/* POST a UL usando s_ue_info. Solo city/state, sin fecha/hora. */
-esp_err_t modem_unwiredlabs_city_state(char *city, size_t city_len,
-                                       char *state, size_t state_len)
+static const char *ul_radio(modem_rat_t rat)
 {
-    if (city && city_len)  city[0]  = '\0';
-    if (state && state_len) state[0] = '\0';
+    return rat == MODEM_RAT_GSM ? "gsm" : rat == MODEM_RAT_WCDMA ? "umts" : "lte";
+}
 
-    if (!s_ue_valid) {
-        ESP_LOGW(TAG, "UE info inválida; ejecuta CPSI primero");
-        return ESP_FAIL;
+static bool ul_append(char *buf, size_t cap, int *len, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *len, cap - (size_t)*len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)(*len + n) >= cap) {
+        buf[*len] = '\0';
+        return false;
     }
-    if (UNWIREDLABS_TOKEN[0] == '\0') {
-        ESP_LOGE(TAG, "UNWIREDLABS_TOKEN vacío (defínelo en privado.h)");
-        return ESP_ERR_INVALID_ARG;
+    *len += n;
+    return true;
+}
+
+/* {"lac":..,"cid":..[,"signal":dBm][,"psc":PCI/PSC]}; la vecina lleva mcc/mnc/radio sólo si difieren */
+static bool ul_append_cell(char *buf, size_t cap, int *len, const modem_ue_info_t *ue, const modem_neighbor_t *n)
+{
+    uint32_t lac = n ? n->lac : ue->tac;
+    uint32_t cid = n ? n->cell_id : ue->cell_id;
+    int signal = n ? n->signal_dbm : ue->signal_dbm;
+    int psc = n ? (n->rat == MODEM_RAT_GSM ? -1 : n->pci) : ue->pci;   // BSIC no es un PSC
+    bool ok = ul_append(buf, cap, len, "{\"lac\":%u,\"cid\":%u", (unsigned)lac, (unsigned)cid);
+    if (ok && n && n->mcc > 0 && (n->mcc != ue->mcc || n->mnc != ue->mnc)) {
+        ok = ul_append(buf, cap, len, ",\"mcc\":%d,\"mnc\":%d", n->mcc, n->mnc);
+    }
+    if (ok && n && n->rat != MODEM_RAT_UNKNOWN && n->rat != ue->rat) {
+        ok = ul_append(buf, cap, len, ",\"radio\":\"%s\"", ul_radio(n->rat));
     }
+    if (ok && signal) ok = ul_append(buf, cap, len, ",\"signal\":%d", signal);
+    if (ok && psc >= 0) ok = ul_append(buf, cap, len, ",\"psc\":%d", psc);
+    return ok && ul_append(buf, cap, len, "}");
+}
+
+/* Precisión y latencia por consulta, separadas por si llevó vecinas, para comparar */
+static void ul_record(bool ok, int neighbors, uint32_t accuracy_m, int64_t latency_us)
+{
+    int k = neighbors > 0;
+    taskENTER_CRITICAL(&s_ul_mux);
+    if (ok) {
+        s_ul.requests++;
+        s_ul.accuracy_sum_m[k] += accuracy_m;
+        s_ul.accuracy_n[k]++;
+        s_ul.latency_sum_us[k] += latency_us;
+    } else {
+        s_ul.failures++;
+    }
+    s_ul.last_cells = 1 + neighbors;
+    s_ul.last_accuracy_m = accuracy_m;
+    s_ul.last_latency_us = latency_us;
+    modem_ul_metrics_t m = s_ul;
+    taskEXIT_CRITICAL(&s_ul_mux);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "UL: sin ubicación con %d celdas tras %lld ms", 1 + neighbors, (long long)(latency_us / 1000));
+        return;
+    }
+    ESP_LOGI(TAG, "UL: %d celdas, precisión %" PRIu32 " m, %lld ms | media sola=%" PRIu32 " m/%lld ms (%" PRIu32 ") "
+             "con vecinas=%" PRIu32 " m/%lld ms (%" PRIu32 ")",
+             1 + neighbors, accuracy_m, (long long)(latency_us / 1000),
+             m.accuracy_n[0] ? (uint32_t)(m.accuracy_sum_m[0] / m.accuracy_n[0]) : 0,
+             (long long)(m.accuracy_n[0] ? m.latency_sum_us[0] / m.accuracy_n[0] / 1000 : 0), m.accuracy_n[0],
+             m.accuracy_n[1] ? (uint32_t)(m.accuracy_sum_m[1] / m.accuracy_n[1]) : 0,
+             (long long)(m.accuracy_n[1] ? m.latency_sum_us[1] / m.accuracy_n[1] / 1000 : 0), m.accuracy_n[1]);
+}
+
+/* Número JSON ("key":123.4) */
+static bool json_get_number(const char *json, const char *key, double *out) {
+    if (!json || !key || !out) return false;
+    char pat[64];
+    snprintf(pat, sizeof(pat), "\"%s\":", key);
+    const char *p = strstr(json, pat);
+    if (!p) return false;
+    char *end = NULL;
+    double v = strtod(p + strlen(pat), &end);
+    if (end == p + strlen(pat)) return false;
+    *out = v;
+    return true;
+}
+
+/* Consulta de red de modem_unwiredlabs_cell_city_state (con el módem retenido despierto) */
+static esp_err_t ul_lookup(const modem_ue_info_t *ue_cell, const geo_cell_key_t *cell,
+                           char *city, size_t city_len,
+                           char *state, size_t state_len)
+{
+    const modem_ue_info_t ue = *ue_cell;
+    geo_cache_loc_t loc;
+
+    /* Vecinas en la misma petición: UL triangula y el fix sale más preciso por la misma consulta.
+     * Sin CMUX o sin AT+CENG se envía la servidora sola, como antes */
+    modem_neighbors_t nb;
+    (void)modem_read_neighbors(&nb);
 
     /* UL usa 'lac' para TAC/LAC y 'cid' para ECI/CID. address=2 pide address_detail */
-    char payload[256];
-    int plen = snprintf(payload, sizeof(payload),
-        "{\"token\":\"%s\",\"radio\":\"lte\",\"mcc\":%d,\"mnc\":%d,"
-        "\"cells\":[{\"lac\":%u,\"cid\":%u}],\"address\":2}",
-        UNWIREDLABS_TOKEN, s_ue_info.mcc, s_ue_info.mnc,
-        (unsigned)s_ue_info.tac, (unsigned)s_ue_info.cell_id);
-    if (plen <= 0 || plen >= (int)sizeof(payload)) {
+    char payload[768];
+    int plen = 0;
+    bool fits = ul_append(payload, sizeof(payload), &plen,
+        "{\"token\":\"%s\",\"radio\":\"%s\",\"mcc\":%d,\"mnc\":%d,\"cells\":[",
+        UNWIREDLABS_TOKEN, ul_radio(ue.rat), ue.mcc, ue.mnc);
+    fits = fits && ul_append_cell(payload, sizeof(payload), &plen, &ue, NULL);
+    const int tail = (int)strlen("],\"address\":2}");
+    int sent_nb = 0;
+    for (int i = 0; fits && i < nb.count; ++i) {
+        const modem_neighbor_t *n = &nb.cell[i];
+        if (n->cell_id == 0 || (n->cell_id == ue.cell_id && n->lac == ue.tac)) continue;   // sólo PCI, o la servidora
+        int mark = plen;
+        if (ul_append(payload, sizeof(payload), &plen, ",") &&
+            ul_append_cell(payload, sizeof(payload), &plen, &ue, n) && plen + tail < (int)sizeof(payload)) {
+            sent_nb++;
+        } else {
+            plen = mark;            // no cabe: se manda lo que haya
+            break;
+        }
+    }
+    fits = fits && ul_append(payload, sizeof(payload), &plen, "],\"address\":2}");
+    if (!fits) {
         ESP_LOGW(TAG, "payload truncado");
         return ESP_FAIL;
     }
+    ESP_LOGI(TAG, "UL: servidora + %d vecinas (%d anunciadas por +CENG)", sent_nb, nb.seen);
+    int64_t t_req = esp_timer_get_time();
 
     const int MAX_ATTEMPTS = 5;
     esp_err_t last_err = ESP_FAIL;
@@ -340,8 +764,6 @@ esp_err_t modem_unwiredlabs_city_state(char *city, size_t city_len,
         /* Checkpoint de integridad de heap ANTES del init del client */
         heap_caps_check_integrity_all(true);
 
-        force_public_dns();  // asegúrate de llamarla aquí
-
         struct ifreq ifr = {0};
         if (s_ppp_netif) {
             esp_netif_get_netif_impl_name(s_ppp_netif, ifr.ifr_name);
@@ -382,11 +804,15 @@ esp_err_t modem_unwiredlabs_city_state(char *city, size_t city_len,
         esp_http_client_cleanup(cli);
 
         if (err == ESP_OK && status == 200 && acc.len > 0) {
-            /* Verifica "status":"ok" */
+            /* Verifica "status":"ok". La API ya contestó: un error suyo (token, celda
+             * desconocida, sin saldo) se repetiría igual en cada intento y gastaría cuota */
             char api_status[8] = "";
             (void)json_get_string(ul_body, "status", api_status, sizeof(api_status));
             if (strcasecmp(api_status, "ok") != 0) {
-                ESP_LOGW(TAG, "API status no OK ('%s')", api_status);
+                char message[64] = "";
+                (void)json_get_string(ul_body, "message", message, sizeof(message));
+                ESP_LOGW(TAG, "API status no OK ('%s': %s); sin reintento", api_status, message);
+                break;
             } else {
                 /* city/state: a veces en "address" o en "address_detail" */
                 const char *addr = strstr(ul_body, "\"address\"");
@@ -397,9 +823,19 @@ esp_err_t modem_unwiredlabs_city_state(char *city, size_t city_len,
                 (void)json_get_string(addr, "state", state, state_len);
 
                 if ((city && city[0]) || (state && state[0])) {
+                    memset(&loc, 0, sizeof(loc));
+                    if (city)  strlcpy(loc.city, city, sizeof(loc.city));
+                    if (state) strlcpy(loc.state, state, sizeof(loc.state));
+                    double acc_m = 0;
+                    (void)json_get_number(ul_body, "lat", &loc.lat);
+                    (void)json_get_number(ul_body, "lon", &loc.lon);
+                    if (json_get_number(ul_body, "accuracy", &acc_m) && acc_m > 0) loc.accuracy_m = (uint32_t)acc_m;
+                    (void)geo_cache_store(cell, &loc);
+                    ul_record(true, sent_nb, loc.accuracy_m, esp_timer_get_time() - t_req);
                     return ESP_OK;
                 }
-                ESP_LOGW(TAG, "Sin address.city/state en respuesta");
+                ESP_LOGW(TAG, "Sin address.city/state en respuesta; sin reintento");
+                break;
             }
         } else {
             ESP_LOGW(TAG, "HTTP fallo %s", esp_err_to_name(err));
@@ -408,10 +844,490 @@ esp_err_t modem_unwiredlabs_city_state(char *city, size_t city_len,
         vTaskDelay(pdMS_TO_TICKS(500 * attempt)); // backoff suave
     }
 
+    ul_record(false, sent_nb, 0, esp_timer_get_time() - t_req);
     return last_err ? last_err : ESP_FAIL;
 }
+
+/* POST a UL usando la UE info (+CPSI). Solo city/state, sin fecha/hora.
+ * Antes de ir a la red se consulta la caché de celdas (geo_cache); cada respuesta buena se guarda */
+esp_err_t modem_unwiredlabs_city_state(char *city, size_t city_len,
+                                       char *state, size_t state_len)
+{
+    modem_ue_info_t ue;
+    if (!modem_get_ue_info(&ue)) {
+        if (city && city_len)  city[0]  = '\0';
+        if (state && state_len) state[0] = '\0';
+        ESP_LOGW(TAG, "UE info inválida; ejecuta CPSI primero");
+        return ESP_FAIL;
+    }
+    return modem_unwiredlabs_cell_city_state(&ue, city, city_len, state, state_len);
+}
+
+esp_err_t modem_unwiredlabs_cell_city_state(const modem_ue_info_t *ue_cell,
+                                            char *city, size_t city_len,
+                                            char *state, size_t state_len)
+{
+    if (city && city_len)  city[0]  = '\0';
+    if (state && state_len) state[0] = '\0';
+    if (!ue_cell || !ue_cell->valid) return ESP_ERR_INVALID_ARG;
+    const modem_ue_info_t ue = *ue_cell;
+
+    geo_cell_key_t cell = { .mcc = ue.mcc, .mnc = ue.mnc, .tac = ue.tac, .cell_id = ue.cell_id };
+    geo_cache_loc_t loc;
+    if (geo_cache_lookup(&cell, &loc)) {
+        geo_cache_metrics_t gm;
+        geo_cache_get_metrics(&gm);
+        ESP_LOGI(TAG, "Celda en caché (%lld us, %" PRIu32 " s de antigüedad): %s, %s (%.5f, %.5f)",
+                 (long long)gm.last_lookup_us, loc.age_s, loc.city, loc.state, loc.lat, loc.lon);
+        if (city && city_len)   strlcpy(city, loc.city, city_len);
+        if (state && state_len) strlcpy(state, loc.state, state_len);
+        return ESP_OK;
+    }
+
+    if (UNWIREDLABS_TOKEN[0] == '\0') {
+        ESP_LOGE(TAG, "UNWIREDLABS_TOKEN vacío (defínelo en privado.h)");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* +CENG y hasta 5 intentos HTTP con backoff: el planificador de energía no debe colgar PPP
+     * a mitad de la consulta */
+    if (!modem_ppp_hold_awake()) {
+        ESP_LOGW(TAG, "UL: módem dormido, consulta aplazada");
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t err = ul_lookup(&ue, &cell, city, city_len, state, state_len);
+    modem_ppp_release_awake();
+    return err;
+}
+
+void modem_unwiredlabs_get_metrics(modem_ul_metrics_t *out)
+{
+    if (!out) return;
+    taskENTER_CRITICAL(&s_ul_mux);
+    *out = s_ul;
+    taskEXIT_CRITICAL(&s_ul_mux);
+}
 /* =================== /UnwiredLabs (HTTPS) ===================== */
 
+/* DNS fallback si el PPP no trajo servidores (tras el arranque y tras cada reconexión) */
+static void ensure_dns(esp_netif_t *ppp)
+{
+    esp_netif_dns_info_t dmain = {0}, dbackup = {0};
+    esp_netif_get_dns_info(ppp, ESP_NETIF_DNS_MAIN, &dmain);
+    esp_netif_get_dns_info(ppp, ESP_NETIF_DNS_BACKUP, &dbackup);
+    bool dns_ok = (dmain.ip.type == ESP_IPADDR_TYPE_V4 && dmain.ip.u_addr.ip4.addr != 0) ||
+                  (dbackup.ip.type == ESP_IPADDR_TYPE_V4 && dbackup.ip.u_addr.ip4.addr != 0);
+    if (!dns_ok) {
+        ESP_LOGW(TAG, "DNS del PPP vacío; fijando 1.1.1.1 y 8.8.8.8");
+        esp_netif_dns_info_t dns1 = { .ip.type = ESP_IPADDR_TYPE_V4 };
+        dns1.ip.u_addr.ip4.addr = ipaddr_addr("1.1.1.1");
+        esp_netif_set_dns_info(ppp, ESP_NETIF_DNS_MAIN, &dns1);
+        esp_netif_dns_info_t dns2 = { .ip.type = ESP_IPADDR_TYPE_V4 };
+        dns2.ip.u_addr.ip4.addr = ipaddr_addr("8.8.8.8");
+        esp_netif_set_dns_info(ppp, ESP_NETIF_DNS_BACKUP, &dns2);
+    } else {
+        ESP_LOGI(TAG, "DNS PPP: main=%" PRIu32 " backup=%" PRIu32,
+                 dmain.ip.u_addr.ip4.addr, dbackup.ip.u_addr.ip4.addr);
+    }
+}
+
+/* ===================== Recuperación de enlace ===================== */
+static bool wait_ppp_up(int timeout_ms)
+{
+    EventBits_t b = xEventGroupWaitBits(s_ppp_eg, PPP_UP_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (b & PPP_UP_BIT) != 0;
+}
+
+/* Sale de DATA (+++ lo envía esp_modem) y comprueba que el módem contesta AT.
+ * Si el DCE quedó en un modo inconsistente se reinicia su estado interno (UNDEF) */
+static esp_err_t enter_command_mode(esp_modem_dce_t *dce)
+{
+    s_cmux_active = false;
+    if (esp_modem_get_mode(dce) != ESP_MODEM_MODE_COMMAND &&
+        esp_modem_set_mode(dce, ESP_MODEM_MODE_COMMAND) != ESP_OK) {
+        ESP_LOGW(TAG, "set_mode(COMMAND) falló; reseteando estado del DCE");
+        (void)esp_modem_set_mode(dce, ESP_MODEM_MODE_UNDEF);
+        (void)esp_modem_set_mode(dce, ESP_MODEM_MODE_COMMAND);
+    }
+    for (int i = 0; i < 5; ++i) {
+        if (esp_modem_sync(dce) == ESP_OK) return ESP_OK;
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    return uart_probe_baud(dce);    // tras un reinicio del módem el baud puede no coincidir
+}
+
+/* CMUX si se pidió (PPP + canal AT); si el módem no lo acepta, DATA sólo */
+static esp_err_t enter_data_mode(esp_modem_dce_t *dce, int ip_timeout_ms)
+{
+    esp_err_t err = ESP_FAIL;
+    if (s_cfg.use_cmux) {
+        err = set_mode_if_needed(dce, ESP_MODEM_MODE_CMUX);
+        if (err != ESP_OK) ESP_LOGW(TAG, "set_mode(CMUX) falló: %s; usando DATA", esp_err_to_name(err));
+    }
+    if (err != ESP_OK) err = set_mode_if_needed(dce, ESP_MODEM_MODE_DATA);
+    if (err != ESP_OK) return err;
+    s_cmux_active = esp_modem_get_mode(dce) == ESP_MODEM_MODE_CMUX;
+    return wait_ppp_up(ip_timeout_ms) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+/* Nivel 1: la sesión de datos cayó pero el módem sigue registrado: re-marcar */
+static esp_err_t recover_data(esp_modem_dce_t *dce)
+{
+    if (enter_command_mode(dce) != ESP_OK) return ESP_FAIL;
+    return enter_data_mode(dce, RECOVERY_DATA_IP_MS);
+}
+
+/* Nivel 2: colgar y ciclar la radio (fuerza re-attach a la red) */
+static esp_err_t recover_at(esp_modem_dce_t *dce)
+{
+    if (enter_command_mode(dce) != ESP_OK) return ESP_FAIL;
+    modem_send_at_and_log(dce, "ATH", 5000);
+    modem_send_at_and_log(dce, "AT+CFUN=0", 15000);
+    vTaskDelay(pdMS_TO_TICKS(2000));
+    modem_at_clear(MODEM_AT_EV_REGISTERED | MODEM_AT_EV_CELL);
+    modem_send_at_and_log(dce, "AT+CFUN=1", 15000);
+    if (esperar_cereg(dce, RECOVERY_CEREG_MS, CEREG_CHECK_MS) != ESP_OK) return ESP_ERR_TIMEOUT;
+    return enter_data_mode(dce, RECOVERY_AT_IP_MS);
+}
+
+/* Nivel 3: el módem no contesta o no se registra: ciclo de alimentación */
+static esp_err_t recover_power(esp_modem_dce_t *dce)
+{
+    (void)esp_modem_set_mode(dce, ESP_MODEM_MODE_UNDEF);   // el módem vuelve en COMMAND
+    uart_flow_local_off();                                 // y sin AT+IFC
+    hw_power_cycle(&s_cfg);
+    s_ceng = CENG_UNKNOWN;
+    s_psm_requested = false;
+    (void)esp_modem_set_mode(dce, ESP_MODEM_MODE_COMMAND);
+    if (enter_command_mode(dce) != ESP_OK) return ESP_FAIL;
+    modem_send_at_and_log(dce, "ATE0", 3000);
+    modem_send_at_and_log(dce, "AT+CMEE=2", 3000);
+    uart_setup_link(dce, &s_cfg);
+    if (esperar_cereg(dce, RECOVERY_CEREG_MS, CEREG_CHECK_MS) != ESP_OK) return ESP_ERR_TIMEOUT;
+    return enter_data_mode(dce, RECOVERY_POWER_IP_MS);
+}
+
+static void recovery_task(void *arg)
+{
+    (void)arg;
+    static const char *const level_name[] = { "DATA", "AT", "POWER" };
+    esp_err_t (*const level_fn[])(esp_modem_dce_t *) = { recover_data, recover_at, recover_power };
+
+    while (1) {
+        xEventGroupWaitBits(s_ppp_eg, PPP_LOST_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+        if (modem_ppp_is_up()) continue;    // volvió solo (o aviso repetido)
+        xSemaphoreTake(s_at_mutex, portMAX_DELAY);   // los modos cambian: nadie más usa el DCE
+        s_lost_us = esp_timer_get_time();
+        taskENTER_CRITICAL(&s_link_mux);
+        s_link.losses++;
+        taskEXIT_CRITICAL(&s_link_mux);
+
+        int level = -1;
+        for (int l = 0; l < MODEM_PPP_RECOVERY_LEVELS && level < 0; ++l) {
+            for (int t = 1; t <= RECOVERY_TRIES_PER_LVL; ++t) {
+                ESP_LOGW(TAG, "Recuperación nivel %s, intento %d/%d", level_name[l], t, RECOVERY_TRIES_PER_LVL);
+                taskENTER_CRITICAL(&s_link_mux);
+                s_link.attempts[l]++;
+                taskEXIT_CRITICAL(&s_link_mux);
+                if (level_fn[l](s_dce) == ESP_OK || modem_ppp_is_up()) {
+                    level = l;
+                    break;
+                }
+            }
+        }
+        if (level < 0) {
+            ESP_LOGE(TAG, "PPP irrecuperable tras ciclar el módem; reiniciando ESP32");
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            esp_restart();
+        }
+
+        xSemaphoreGive(s_at_mutex);
+
+        // Las caídas provocadas por la propia recuperación (salir de DATA) no cuentan
+        xEventGroupClearBits(s_ppp_eg, PPP_LOST_BIT);
+        if (!modem_ppp_is_up()) xEventGroupSetBits(s_ppp_eg, PPP_LOST_BIT);
+        ensure_dns(s_ppp_netif);
+
+        int64_t down_us = esp_timer_get_time() - s_lost_us;
+        taskENTER_CRITICAL(&s_link_mux);
+        s_link.recovered[level]++;
+        s_link.last_down_us = down_us;
+        if (down_us > s_link.max_down_us) s_link.max_down_us = down_us;
+        s_link.total_down_us += down_us;
+        modem_ppp_link_metrics_t m = s_link;
+        taskEXIT_CRITICAL(&s_link_mux);
+        uint32_t n = m.recovered[0] + m.recovered[1] + m.recovered[2];
+        ESP_LOGI(TAG, "PPP restaurado (nivel %s) en %lld ms; caídas=%u MTTR=%lld ms",
+                 level_name[level], (long long)(down_us / 1000), (unsigned)m.losses,
+                 (long long)(m.total_down_us / 1000 / n));
+    }
+}
+
+/* ===================== Ahorro de energía ===================== */
+/* Con s_power_mux tomado: cierra el tramo del estado anterior en las métricas */
+static void power_set_locked(power_state_t next, int64_t now)
+{
+    int64_t d = now - s_power_since_us;
+    if (s_power == POWER_SLEEPING) s_pm.asleep_us += d;
+    else                           s_pm.awake_us += d;
+    s_power_since_us = now;
+    s_power = next;
+}
+
+/* Antelación del despertar: la configurada o el doble del tiempo a IP habitual, lo que sea mayor */
+static int64_t power_lead_us(void)
+{
+    int64_t lead = (int64_t)s_pcfg.wake_lead_ms * 1000;
+    return 2 * s_ttip_avg_us > lead ? 2 * s_ttip_avg_us : lead;
+}
+
+/* PSM y eDRX se piden una vez por sesión del módem. Lo concedido llega en +CEREG con <n>=4 y se
+ * relee en cada reposo: la red lo fija en el attach o el TAU siguiente, no al pedirlo */
+static void power_psm(esp_modem_dce_t *dce)
+{
+    char cmd[64];
+    if (!s_psm_requested) {
+        char tau[MODEM_PSM_BITS_LEN], active[MODEM_PSM_BITS_LEN];
+        modem_at_psm_tau_bits(s_pcfg.psm_tau_s, tau);
+        modem_at_psm_active_bits(s_pcfg.psm_active_s, active);
+        snprintf(cmd, sizeof(cmd), "AT+CPSMS=1,,,\"%s\",\"%s\"", tau, active);
+        modem_send_at_and_log(dce, cmd, 3000);
+        if (s_pcfg.edrx_ms) {
+            char edrx[MODEM_EDRX_BITS_LEN];
+            modem_at_edrx_bits(s_pcfg.edrx_ms, edrx);
+            snprintf(cmd, sizeof(cmd), "AT+CEDRXS=1,4,\"%s\"", edrx);     // 4: E-UTRAN
+            modem_send_at_and_log(dce, cmd, 3000);
+        }
+        s_psm_requested = true;
+    }
+
+    char out[160] = {0};
+    modem_at_rsp_t rsp = MODEM_AT_RSP(out);
+    modem_cereg_t c;
+    if (modem_at_command(dce, "AT+CEREG=4\r", &rsp, 2000) != ESP_OK) return;
+    rsp = (modem_at_rsp_t)MODEM_AT_RSP(out);
+    if (modem_at_command(dce, "AT+CEREG?\r", &rsp, 2000) != ESP_OK || !modem_at_parse_cereg(out, &c)) return;
+    taskENTER_CRITICAL(&s_power_mux);
+    bool changed = s_pm.psm_active_s != c.active_time_s || s_pm.psm_tau_s != c.periodic_tau_s;
+    s_pm.psm_active_s = c.active_time_s;
+    s_pm.psm_tau_s = c.periodic_tau_s;
+    taskEXIT_CRITICAL(&s_power_mux);
+    if (!changed) return;
+    if (c.active_time_s >= 0) ESP_LOGI(TAG, "PSM concedido: activo %d s, TAU %d s", c.active_time_s, c.periodic_tau_s);
+    else                      ESP_LOGW(TAG, "La red no concede PSM; el módem duerme sólo por DTR");
+}
+
+/* Cuelga PPP y duerme el módem. No duerme si la recuperación tiene el enlace, si alguien pidió
+ * subir mientras tanto (modem_ppp_request_uplink renueva s_activity_us) o si hay una retención
+ * (modem_ppp_hold_awake) */
+static void power_sleep(int64_t due_us)
+{
+    xSemaphoreTake(s_at_mutex, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    bool up = modem_ppp_is_up();
+    taskENTER_CRITICAL(&s_power_mux);
+    bool idle = up && s_hold_count == 0 && now - s_activity_us >= (int64_t)s_pcfg.idle_ms * 1000;
+    if (idle) power_set_locked(POWER_SLEEPING, now);    // antes de colgar: la caída de PPP no es avería
+    taskEXIT_CRITICAL(&s_power_mux);
+    if (!idle) {
+        xSemaphoreGive(s_at_mutex);
+        return;
+    }
+
+    esp_err_t err = enter_command_mode(s_dce);
+    if (err == ESP_OK) {
+        modem_send_at_and_log(s_dce, "ATH", 5000);
+        if (s_pcfg.mode == MODEM_PPP_POWER_PSM) power_psm(s_dce);
+        if (s_cfg.dtr_io >= 0) {
+            modem_send_at_and_log(s_dce, "AT+CSCLK=1", 3000);  // con DTR alto y el UART quieto, duerme
+            gpio_set_level(s_cfg.dtr_io, 1);
+        }
+    }
+    xEventGroupClearBits(s_ppp_eg, PPP_LOST_BIT);
+    taskENTER_CRITICAL(&s_power_mux);
+    if (err == ESP_OK) s_pm.sleeps++;
+    else               power_set_locked(POWER_AWAKE, esp_timer_get_time());
+    taskEXIT_CRITICAL(&s_power_mux);
+    xSemaphoreGive(s_at_mutex);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "No se pudo salir de PPP para dormir; la recuperación revisa el enlace");
+        xEventGroupSetBits(s_ppp_eg, PPP_LOST_BIT);
+    } else if (due_us) {
+        ESP_LOGI(TAG, "Módem dormido; próxima subida en %lld s", (long long)((due_us - now) / 1000000));
+    } else {
+        ESP_LOGI(TAG, "Módem dormido hasta la próxima subida");
+    }
+}
+
+/* DTR bajo, registro y PPP de nuevo. El tiempo a IP se mide desde DTR bajo. Si no hay IP, el enlace
+ * pasa a la recuperación como cualquier caída */
+static void power_wake(void)
+{
+    int64_t t0 = esp_timer_get_time();
+    xSemaphoreTake(s_at_mutex, portMAX_DELAY);
+    taskENTER_CRITICAL(&s_power_mux);
+    power_set_locked(POWER_WAKING, t0);
+    taskEXIT_CRITICAL(&s_power_mux);
+    if (s_cfg.dtr_io >= 0) {
+        gpio_set_level(s_cfg.dtr_io, 0);
+        vTaskDelay(pdMS_TO_TICKS(POWER_DTR_WAKE_MS));
+    }
+    esp_err_t err = enter_command_mode(s_dce);
+    if (err == ESP_OK) err = esperar_cereg(s_dce, POWER_WAKE_CEREG_MS, CEREG_CHECK_MS);  // tras PSM se re-engancha
+    if (err == ESP_OK) err = enter_data_mode(s_dce, POWER_WAKE_IP_MS);
+    int64_t now = esp_timer_get_time();
+    int64_t ttip = now - t0;
+    taskENTER_CRITICAL(&s_power_mux);
+    power_set_locked(POWER_AWAKE, now);
+    s_activity_us = now;
+    s_pm.wakes++;
+    if (err == ESP_OK) {
+        s_pm.last_time_to_ip_us = ttip;
+        if (ttip > s_pm.max_time_to_ip_us) s_pm.max_time_to_ip_us = ttip;
+        s_pm.total_time_to_ip_us += ttip;
+        s_ttip_avg_us = s_ttip_avg_us ? (3 * s_ttip_avg_us + ttip) / 4 : ttip;
+    } else {
+        s_pm.wake_failures++;
+    }
+    taskEXIT_CRITICAL(&s_power_mux);
+    xEventGroupClearBits(s_ppp_eg, PPP_LOST_BIT);
+    xSemaphoreGive(s_at_mutex);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Sin IP al despertar (%s); pasa a la recuperación", esp_err_to_name(err));
+        xEventGroupSetBits(s_ppp_eg, PPP_LOST_BIT);
+        return;
+    }
+    ensure_dns(s_ppp_netif);
+    ESP_LOGI(TAG, "Módem despierto: IP en %lld ms (%s)", (long long)(ttip / 1000),
+             s_cmux_active ? "CMUX" : "DATA");
+}
+
+static void power_task(void *arg)
+{
+    (void)arg;
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        taskENTER_CRITICAL(&s_power_mux);
+        int64_t due = s_uplink_due_us;
+        bool wake_req = s_wake_req;
+        s_wake_req = false;
+        if (s_power == POWER_AWAKE && due && now >= due) {
+            s_uplink_due_us = due = 0;          // es la hora de la subida: el reposo cuenta desde aquí
+            s_activity_us = now;
+        }
+        int64_t activity = s_activity_us;
+        bool held = s_hold_count > 0;
+        taskEXIT_CRITICAL(&s_power_mux);
+        int64_t lead = power_lead_us();
+        TickType_t wait = pdMS_TO_TICKS(POWER_CHECK_MS);
+
+        if (s_power == POWER_SLEEPING) {
+            if (wake_req || (due && now >= due - lead)) {
+                power_wake();
+                continue;
+            }
+            int64_t ms = (due - lead - now) / 1000;
+            wait = due ? pdMS_TO_TICKS(ms < 3600000 ? ms : 3600000) + 1 : portMAX_DELAY;   // con tope: se recalcula
+        } else if (!modem_ppp_is_up() || held || (s_pcfg.uplink_busy && s_pcfg.uplink_busy())) {
+            taskENTER_CRITICAL(&s_power_mux);
+            s_activity_us = now;
+            taskEXIT_CRITICAL(&s_power_mux);
+        } else if (now - activity >= (int64_t)s_pcfg.idle_ms * 1000 &&
+                   !(due && due - now < lead + (int64_t)POWER_MIN_SLEEP_MS * 1000)) {
+            power_sleep(due);
+            continue;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+esp_err_t modem_ppp_power_start(const modem_ppp_power_config_t *cfg)
+{
+    if (!cfg || cfg->wake_lead_ms < 0 || cfg->idle_ms < 0) return ESP_ERR_INVALID_ARG;
+    if (cfg->mode == MODEM_PPP_POWER_FULL) return ESP_OK;
+    if (!s_recovery_task || s_power_task) return ESP_ERR_INVALID_STATE;   // antes, modem_ppp_start_blocking
+    s_pcfg = *cfg;
+    if (s_cfg.dtr_io < 0) ESP_LOGW(TAG, "Sin dtr_io el módem no duerme: entre subidas sólo se cuelga PPP");
+
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_power_mux);
+    s_pm.psm_active_s = s_pm.psm_tau_s = -1;
+    s_power_since_us = s_activity_us = now;
+    taskEXIT_CRITICAL(&s_power_mux);
+    if (xTaskCreate(power_task, "modem_power", POWER_TASK_STACK, NULL, 5, &s_power_task) != pdPASS) {
+        s_power_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Ahorro de energía %s: antelación %d ms, a dormir tras %d ms sin subidas",
+             cfg->mode == MODEM_PPP_POWER_PSM ? "PSM/eDRX + DTR" : "DTR", cfg->wake_lead_ms, cfg->idle_ms);
+    return ESP_OK;
+}
+
+void modem_ppp_schedule_uplink(int64_t due_us)
+{
+    taskENTER_CRITICAL(&s_power_mux);
+    bool changed = s_uplink_due_us != due_us;
+    s_uplink_due_us = due_us;
+    taskEXIT_CRITICAL(&s_power_mux);
+    if (changed && s_power_task) xTaskNotifyGive(s_power_task);
+}
+
+bool modem_ppp_request_uplink(void)
+{
+    if (!s_power_task) return true;
+    taskENTER_CRITICAL(&s_power_mux);
+    s_activity_us = esp_timer_get_time();     // que no se duerma entre esta espera y el encolado
+    bool asleep = s_power == POWER_SLEEPING;
+    if (asleep) {
+        s_wake_req = true;
+        s_pm.unscheduled++;
+    }
+    taskEXIT_CRITICAL(&s_power_mux);
+    if (asleep) {
+        ESP_LOGW(TAG, "Subida con el módem dormido: despertando fuera de plan");
+        xTaskNotifyGive(s_power_task);
+    }
+    // PPP_UP puede seguir puesto un instante mientras se cuelga: vale sólo con el módem despierto
+    return s_power == POWER_AWAKE && modem_ppp_is_up();
+}
+
+bool modem_ppp_hold_awake(void)
+{
+    taskENTER_CRITICAL(&s_power_mux);
+    bool ok = s_power != POWER_SLEEPING;
+    if (ok) s_hold_count++;
+    taskEXIT_CRITICAL(&s_power_mux);
+    return ok;
+}
+
+void modem_ppp_release_awake(void)
+{
+    taskENTER_CRITICAL(&s_power_mux);
+    if (s_hold_count > 0) s_hold_count--;
+    s_activity_us = esp_timer_get_time();     // el reposo cuenta desde el final de la actividad
+    taskEXIT_CRITICAL(&s_power_mux);
+}
+
+bool modem_ppp_is_asleep(void)
+{
+    return s_power != POWER_AWAKE;
+}
+
+void modem_ppp_get_power_metrics(modem_ppp_power_metrics_t *out)
+{
+    if (!out) return;
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_power_mux);
+    *out = s_pm;
+    if (s_power_task) {
+        if (s_power == POWER_SLEEPING) out->asleep_us += now - s_power_since_us;
+        else                           out->awake_us += now - s_power_since_us;
+    }
+    taskEXIT_CRITICAL(&s_power_mux);
+}
+
 /* ===== Arranque PPP bloqueante ===== */
 esp_err_t modem_ppp_start_blocking(const modem_ppp_config_t *cfg,
                                    int timeout_ms,
@@ -429,65 +1345,74 @@ esp_err_t modem_ppp_start_blocking(const modem_ppp_config_t *cfg,
     esp_netif_set_default_netif(ppp);
 
     if (!s_ppp_eg) s_ppp_eg = xEventGroupCreate();
+    if (!s_at_mutex) s_at_mutex = xSemaphoreCreateMutex();
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, ESP_EVENT_ANY_ID, &on_ip_event, NULL));
-
-    /* Power-on del módem */
-    hw_boot(cfg);
+    if (UNWIREDLABS_TOKEN[0] != '\0') (void)dns_cache_add_host(UNWIRED_URL);
 
     /* DTE (UART) */
     esp_modem_dte_config_t dte_cfg = ESP_MODEM_DTE_DEFAULT_CONFIG();
     dte_cfg.uart_config.port_num   = UART_NUM_1;
-    dte_cfg.uart_config.baud_rate  = 115200;
+    dte_cfg.uart_config.baud_rate  = MODEM_BAUD_DEFAULT;   // AT+IPR lo sube después
     dte_cfg.uart_config.tx_io_num  = cfg->tx_io;
     dte_cfg.uart_config.rx_io_num  = cfg->rx_io;
     dte_cfg.uart_config.rts_io_num = cfg->rts_io;
     dte_cfg.uart_config.cts_io_num = cfg->cts_io;
-    dte_cfg.uart_config.flow_control = ESP_MODEM_FLOW_CONTROL_NONE;
+    dte_cfg.uart_config.flow_control = ESP_MODEM_FLOW_CONTROL_NONE;   // RTS/CTS se activa tras AT+IFC
+    if (cfg->baud_rate > MODEM_BAUD_DEFAULT) {
+        // a 921600 los 4 KB por defecto se llenan en ~45 ms si la tarea del DTE se retrasa
+        dte_cfg.uart_config.rx_buffer_size = 16384;
+        dte_cfg.dte_buffer_size = 1024;
+    }
 
     /* DCE SIM7600 (A7670 compatible) */
     esp_modem_dce_config_t dce_cfg = ESP_MODEM_DCE_DEFAULT_CONFIG(cfg->apn);
     esp_modem_dce_t *dce = esp_modem_new_dev(ESP_MODEM_DCE_SIM7600, &dte_cfg, &dce_cfg, ppp);
     if (!dce) return ESP_FAIL;
     if (out_dce) *out_dce = dce;
+    s_dce = dce;
+    s_cfg = *cfg;
+
+    /* Power-on del módem con el DCE ya creado: así se ven RDY/+CPIN: READY/PB DONE */
+    (void)modem_at_init(dce);
+    hw_boot(cfg);
 
     ESP_ERROR_CHECK(esp_modem_set_apn(dce, cfg->apn));
 
     /* 1) Asegurar COMMAND, diagnóstico y registro */
     ESP_ERROR_CHECK(set_mode_if_needed(dce, ESP_MODEM_MODE_COMMAND));
+    if (uart_probe_baud(dce) != ESP_OK) ESP_LOGW(TAG, "El módem no contesta a ningún baud conocido");
     modem_send_at_and_log(dce, "AT",        3000);
     modem_send_at_and_log(dce, "ATE0",      3000);
     modem_send_at_and_log(dce, "AT+CMEE=2", 3000);
-    (void)esperar_cereg(dce, 15000, 500);   // opcional pero recomendado en LTE/2G
+    uart_setup_link(dce, cfg);              // RTS/CTS y baud alto antes de PPP/CMUX
+    (void)esperar_cereg(dce, 15000, CEREG_CHECK_MS);   // opcional pero recomendado en LTE/2G
+    ESP_LOGI(TAG, "Arranque del módem: RDY %d ms, SIM %d ms, registro %d ms (-1: sin URC)",
+             modem_at_elapsed_ms(MODEM_AT_EV_RDY), modem_at_elapsed_ms(MODEM_AT_EV_SIM_READY),
+             modem_at_elapsed_ms(MODEM_AT_EV_REGISTERED));
 
     /* 2) Obtener CPSI con reintentos y parsearlo */
-    char cpsi[128] = {0};
-    esp_err_t cpsi_ok = cpsi_con_reintentos(dce, cpsi, sizeof(cpsi), 3, 700);
-    if (cpsi_ok == ESP_OK) {
+    modem_cpsi_t cpsi;
+    if (cpsi_con_reintentos(dce, &cpsi, 3, 700) == ESP_OK) {
         modem_ue_info_t info;
-        if (parse_cpsi_line(cpsi, &info) && cpsi_se_ve_valido(cpsi)) {
-            s_ue_info   = info;
-            s_ue_valid  = true;
-            ESP_LOGI(TAG, "UE: MCC=%d MNC=%d TAC/LAC=%" PRIu32 " ECI/CID=%" PRIu32,
-                     info.mcc, info.mnc, info.tac, info.cell_id);
-        } else {
-            s_ue_valid = false;
-            ESP_LOGW(TAG, "CPSI válido pero parseo incompleto: %s", cpsi);
-        }
+        ue_from_cpsi(&cpsi, &info);
+        set_ue_info(&info);
+        ESP_LOGI(TAG, "UE: RAT=%d MCC=%d MNC=%d TAC/LAC=%" PRIu32 " ECI/CID=%" PRIu32 " banda=%d",
+                 info.rat, info.mcc, info.mnc, info.tac, info.cell_id, cpsi.band);
     } else {
-        s_ue_valid = false;
-        ESP_LOGW(TAG, "CPSI no confiable tras reintentos: %s", cpsi);
+        set_ue_info(NULL);
+        ESP_LOGW(TAG, "CPSI no confiable tras reintentos");
     }
 
     /* 3) Handshake corto con esp_modem_command() */
     char at_rsp[64] = {0};
-    s_acc = (at_acc_t){ .buf = at_rsp, .size = sizeof(at_rsp), .used = 0 };
-    esp_err_t at_ok = esp_modem_command(dce, "AT\r", at_acc_cb, 1000);
+    modem_at_rsp_t rsp = MODEM_AT_RSP(at_rsp);
+    esp_err_t at_ok = modem_at_command(dce, "AT\r", &rsp, 1000);
     if (at_ok != ESP_OK) {
         ESP_LOGE(TAG, "El módem no responde a AT. rsp='%s' (verifica PWRKEY/baud/TX-RX/GND)", at_rsp);
         return at_ok;
     }
-    (void)esp_modem_command(dce, "ATE0\r", at_acc_cb, 1000);
-    vTaskDelay(pdMS_TO_TICKS(500));
+    rsp = (modem_at_rsp_t)MODEM_AT_RSP(at_rsp);
+    (void)modem_at_command(dce, "ATE0\r", &rsp, 1000);
 
     /* 4) DATA/PPP (o CMUX si lo pides) */
     esp_err_t mode_err = set_mode_if_needed(dce, cfg->use_cmux ? ESP_MODEM_MODE_CMUX
@@ -497,6 +1422,8 @@ esp_err_t modem_ppp_start_blocking(const modem_ppp_config_t *cfg,
         mode_err = set_mode_if_needed(dce, ESP_MODEM_MODE_DATA);
     }
     ESP_ERROR_CHECK(mode_err);
+    s_cmux_active = esp_modem_get_mode(dce) == ESP_MODEM_MODE_CMUX;
+    ESP_LOGI(TAG, "Modo %s", s_cmux_active ? "CMUX (PPP + canal AT)" : "DATA (sin AT durante PPP)");
 
     ESP_LOGI(TAG, "Esperando IP PPP (%d ms)…", timeout_ms);
      EventBits_t b = xEventGroupWaitBits(s_ppp_eg, PPP_UP_BIT, pdFALSE, pdTRUE,
@@ -507,24 +1434,13 @@ esp_err_t modem_ppp_start_blocking(const modem_ppp_config_t *cfg,
      }
 
     /* DNS fallback si viene vacío */
-    esp_netif_dns_info_t dmain = {0}, dbackup = {0};
-    esp_netif_get_dns_info(ppp, ESP_NETIF_DNS_MAIN, &dmain);
-    esp_netif_get_dns_info(ppp, ESP_NETIF_DNS_BACKUP, &dbackup);
-    bool dns_ok = (dmain.ip.type == ESP_IPADDR_TYPE_V4 && dmain.ip.u_addr.ip4.addr != 0) ||
-                  (dbackup.ip.type == ESP_IPADDR_TYPE_V4 && dbackup.ip.u_addr.ip4.addr != 0);
-    if (!dns_ok) {
-        ESP_LOGW(TAG, "DNS del PPP vacío; fijando 1.1.1.1 y 8.8.8.8");
-        esp_netif_dns_info_t dns1 = { .ip.type = ESP_IPADDR_TYPE_V4 };
-        dns1.ip.u_addr.ip4.addr = ipaddr_addr("1.1.1.1");
-        esp_netif_set_dns_info(ppp, ESP_NETIF_DNS_MAIN, &dns1);
-        esp_netif_dns_info_t dns2 = { .ip.type = ESP_IPADDR_TYPE_V4 };
-        dns2.ip.u_addr.ip4.addr = ipaddr_addr("8.8.8.8");
-        esp_netif_set_dns_info(ppp, ESP_NETIF_DNS_BACKUP, &dns2);
-    } else {
-        ESP_LOGI(TAG, "DNS PPP: main=%" PRIu32 " backup=%" PRIu32,
-                 dmain.ip.u_addr.ip4.addr, dbackup.ip.u_addr.ip4.addr);
-    }
+    ensure_dns(ppp);
 
+    /* A partir de aquí una caída de PPP se recupera sin reiniciar el ESP32 */
+    if (!s_recovery_task) {
+        xEventGroupClearBits(s_ppp_eg, PPP_LOST_BIT);
+        xTaskCreate(recovery_task, "ppp_recovery", RECOVERY_TASK_STACK, NULL, 6, &s_recovery_task);
+    }
     return ESP_OK;
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "esp_err.h"
 #include "esp_modem_api.h"
+#include "modem_at.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -15,23 +16,151 @@ typedef struct {
     int  rst_pulse_ms;
     const char *apn;       // ej: "internet.itelcel.com"
     const char *sim_pin;   // opcional
-    bool use_cmux;         // true para CMUX (déjalo en false a menos que lo necesites)
+    bool use_cmux;         // true: PPP + canal AT virtual (modem_poll_radio); si falla, DATA sólo
+    int  baud_rate;        // baud máximo a negociar con AT+IPR (0 o 115200: se queda en 115200)
+    bool hw_flow_ctrl;     // RTS/CTS (AT+IFC=2,2); requiere rts_io y cts_io
 } modem_ppp_config_t;
 
-/** Info de UE/celda extraída de +CPSI (LTE) */
+/** Info de UE/celda extraída de +CPSI (GSM, WCDMA o LTE) */
 typedef struct {
-    int      mcc;      // 100..999
+    modem_rat_t rat;
+    int      mcc;      // 1..999
     int      mnc;      // 0..999
-    uint32_t tac;      // TAC (acepta "0x.." → entero)
-    uint32_t cell_id;  // E-UTRAN Cell ID (ECI, 28 bits)
+    uint32_t tac;      // TAC (LTE) o LAC (GSM/WCDMA)
+    uint32_t cell_id;  // ECI de 28 bits (LTE) o CID
+    int      pci;      // PCI (LTE) o PSC (WCDMA); -1 si no se conoce
+    int      signal_dbm;   // RSRP/RSCP/RxLev; 0 si no se conoce
     bool     valid;
 } modem_ue_info_t;
 
-/** Arranca PPP y BLOQUEA hasta obtener IP (o timeout_ms) */
+/** Niveles de recuperación del enlace: 0 = volver a DATA, 1 = ATH + CFUN 0/1, 2 = ciclo de alimentación */
+#define MODEM_PPP_RECOVERY_LEVELS 3
+
+/** Caídas de PPP y su recuperación. MTTR = total_down_us / (suma de recovered) */
+typedef struct {
+    uint32_t losses;                                   // IP_EVENT_PPP_LOST_IP tras el arranque
+    uint32_t attempts[MODEM_PPP_RECOVERY_LEVELS];      // intentos por nivel
+    uint32_t recovered[MODEM_PPP_RECOVERY_LEVELS];     // nivel que devolvió la IP
+    int64_t  last_down_us;                             // caída -> IP de la última recuperación
+    int64_t  max_down_us;
+    int64_t  total_down_us;
+} modem_ppp_link_metrics_t;
+
+/** Estado de radio leído en vivo por el canal AT de CMUX */
+typedef struct {
+    int      rssi;         // +CSQ 0..31, 99 = desconocido
+    int      ber;          // +CSQ 0..7, 99 = desconocido
+    int      cereg_stat;   // +CEREG <stat>: 1 local, 5 roaming, 2 buscando...; -1 desconocido
+    modem_ue_info_t ue;    // celda servidora (+CPSI); ue.valid = false si no se pudo leer
+    int64_t  updated_us;   // esp_timer de la lectura
+} modem_radio_status_t;
+
+/** Resultado de modem_ppp_benchmark */
+typedef struct {
+    uint64_t bytes;        // bytes de cuerpo HTTP recibidos
+    int64_t  elapsed_us;
+    uint32_t bytes_per_s;  // sostenido: bytes / elapsed
+    uint32_t uart_limit;   // techo del UART: baud / 10 B/s (8N1)
+    int      baud;         // baud del UART durante la medida
+    bool     hw_flow;      // RTS/CTS activo
+} modem_ppp_bench_t;
+
+/** Consultas a UnwiredLabs. Índice [0]: sólo la servidora; [1]: con vecinas */
+typedef struct {
+    uint32_t requests;           // con ubicación
+    uint32_t failures;           // sin ubicación tras los reintentos
+    uint32_t last_cells;         // celdas enviadas en la última
+    uint32_t last_accuracy_m;
+    int64_t  last_latency_us;    // consulta completa, reintentos incluidos
+    uint64_t accuracy_sum_m[2];
+    int64_t  latency_sum_us[2];
+    uint32_t accuracy_n[2];
+} modem_ul_metrics_t;
+
+/** Ahorro de energía entre subidas */
+typedef enum {
+    MODEM_PPP_POWER_FULL = 0,   // PPP siempre arriba a plena potencia
+    MODEM_PPP_POWER_DTR,        // entre subidas se cuelga PPP y el módem duerme (AT+CSCLK=1 + DTR alto)
+    MODEM_PPP_POWER_PSM,        // igual, y además pide PSM (AT+CPSMS) y eDRX (AT+CEDRXS) a la red
+} modem_ppp_power_mode_t;
+
+typedef struct {
+    modem_ppp_power_mode_t mode;
+    uint32_t psm_tau_s;         // PSM: T3412 pedido (TAU periódico)
+    uint32_t psm_active_s;      // PSM: T3324 pedido (alcanzable tras cada actividad)
+    uint32_t edrx_ms;           // PSM: ciclo eDRX pedido; 0 = no se pide
+    int      wake_lead_ms;      // antelación mínima del despertar; crece si el tiempo a IP medido lo pide
+    int      idle_ms;           // sin nada que subir durante este tiempo tras la subida: a dormir
+    bool   (*uplink_busy)(void);    // true mientras quede algo por subir; NULL = sólo cuenta idle_ms
+} modem_ppp_power_config_t;
+
+/** Despertares y consumo. Fracción despierta = awake_us / (awake_us + asleep_us) */
+typedef struct {
+    uint32_t sleeps;
+    uint32_t wakes;
+    uint32_t wake_failures;     // sin IP tras despertar: pasó a la recuperación
+    uint32_t unscheduled;       // despertares pedidos por modem_ppp_request_uplink (subida fuera de plan)
+    int64_t  last_time_to_ip_us;    // DTR bajo -> IP
+    int64_t  max_time_to_ip_us;
+    int64_t  total_time_to_ip_us;   // media = total / (wakes - wake_failures)
+    int64_t  awake_us;
+    int64_t  asleep_us;
+    int      psm_active_s;      // concedido por la red; -1 si no hubo PSM
+    int      psm_tau_s;
+} modem_ppp_power_metrics_t;
+
+/** Arranca PPP y BLOQUEA hasta obtener IP (o timeout_ms).
+ *  Después, una caída de PPP la recupera una tarea propia escalando niveles;
+ *  sólo si falla el ciclo de alimentación del módem se reinicia el ESP32 */
 esp_err_t modem_ppp_start_blocking(const modem_ppp_config_t *cfg,
                                    int timeout_ms,
                                    esp_modem_dce_t **out_dce);
 
+/** true si PPP tiene IP ahora mismo */
+bool modem_ppp_is_up(void);
+
+/** true si la sesión corre en CMUX (hay canal AT junto a PPP) */
+bool modem_ppp_cmux_active(void);
+
+/** Lee +CSQ, +CEREG y +CPSI sin cortar PPP (sólo en CMUX). Actualiza la UE info si la celda es válida.
+ *  ESP_ERR_INVALID_STATE sin CMUX, ESP_ERR_TIMEOUT si la recuperación tiene el módem o está dormido,
+ *  ESP_FAIL si no contestó ningún comando */
+esp_err_t modem_poll_radio(modem_radio_status_t *out);
+
+/** Vecinas por AT+CENG? (sólo en CMUX). ESP_ERR_NOT_SUPPORTED si el firmware no tiene +CENG */
+esp_err_t modem_read_neighbors(modem_neighbors_t *out);
+
+/** Mide el throughput sostenido de PPP descargando url (se repite hasta cumplir duration_ms).
+ *  Usa un fichero grande: cada repetición paga de nuevo la conexión TCP/TLS */
+esp_err_t modem_ppp_benchmark(const char *url, int duration_ms, modem_ppp_bench_t *out);
+
+/** Lanza el planificador de energía (llamar con PPP arriba). Con MODEM_PPP_POWER_FULL no hace nada */
+esp_err_t modem_ppp_power_start(const modem_ppp_power_config_t *cfg);
+
+/** Próxima subida (esp_timer, µs): el módem despierta antes para tener IP a esa hora. 0 = ninguna */
+void modem_ppp_schedule_uplink(int64_t due_us);
+
+/** Antes de encolar una subida: si el módem duerme pide despertarlo fuera de plan y vuelve sin
+ *  esperar (la cola de subidas lo mantiene despierto y reintenta hasta tener IP). true si PPP ya
+ *  está arriba; sin ahorro de energía, siempre true */
+bool modem_ppp_request_uplink(void);
+
+/** Retiene el módem despierto durante una actividad de red que no pasa por la cola de subidas
+ *  (p. ej. una consulta a UnwiredLabs): mientras haya retenciones no se cuelga PPP. No despierta
+ *  al módem: false (sin retener) si ya duerme. Cada true pide su modem_ppp_release_awake */
+bool modem_ppp_hold_awake(void);
+
+/** Suelta una retención; el reposo (idle_ms) vuelve a contar desde aquí */
+void modem_ppp_release_awake(void);
+
+/** true si el módem duerme entre subidas o está despertando (sin canal AT ni PPP) */
+bool modem_ppp_is_asleep(void);
+
+void modem_ppp_get_power_metrics(modem_ppp_power_metrics_t *out);
+
+/** Copia de las métricas de caída/recuperación */
+void modem_ppp_get_link_metrics(modem_ppp_link_metrics_t *out);
+
 /** Última UE info válida (+CPSI) */
 bool modem_get_ue_info(modem_ue_info_t *out);
 
@@ -42,6 +171,15 @@ bool modem_get_ue_info(modem_ue_info_t *out);
 esp_err_t modem_unwiredlabs_city_state(char *city, size_t city_len,
                                        char *state, size_t state_len);
 
+/** Igual, para una celda concreta (p. ej. la que acaba de leer modem_poll_radio) en vez de la última UE info.
+ *  Retiene el módem despierto mientras consulta; ESP_ERR_TIMEOUT si ya dormía */
+esp_err_t modem_unwiredlabs_cell_city_state(const modem_ue_info_t *cell,
+                                            char *city, size_t city_len,
+                                            char *state, size_t state_len);
+
+/** Precisión (accuracy de la respuesta) y latencia de las consultas a UnwiredLabs */
+void modem_unwiredlabs_get_metrics(modem_ul_metrics_t *out);
+
 #ifdef __cplusplus
 }
 #endif
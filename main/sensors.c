@@ -3,6 +3,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include <stdbool.h>
+#include <string.h>
 #include "privado.h" //Para el Device ID
 
 #define I2C_MASTER_SCL_IO 19
@@ -15,6 +17,13 @@
 
 static const char *TAG_SENS = "SENSORS";
 static char g_city_state[64] = "----";
+static portMUX_TYPE g_city_mux = portMUX_INITIALIZER_UNLOCKED;   // la reescribe el monitor de celda
+
+void sensors_get_city_state(char *dst, size_t len) {
+    taskENTER_CRITICAL(&g_city_mux);
+    strlcpy(dst, g_city_state, len);
+    taskEXIT_CRITICAL(&g_city_mux);
+}
 
 // CRC8 (SEN55)
 static uint8_t sen5x_crc8(const uint8_t *data, int len) {
@@ -196,9 +205,11 @@ esp_err_t sensors_read(SensorData *out) {
 
 void sensors_format_json(const SensorData *d, const char *time_str, const char *fecha_str, const char *inicio_str, char *buf, size_t buf_size) {
     if (!buf || buf_size == 0) return;
+    char city[sizeof(g_city_state)];
+    sensors_get_city_state(city, sizeof(city));
     int written = snprintf(buf, buf_size,
         "{\"pm1p0\":%.2f,\"pm2p5\":%.2f,\"pm4p0\":%.2f,\"pm10p0\":%.2f,\"voc\":%.1f,\"nox\":%.1f,\"cTe\":%.2f,\"cHu\":%.2f,\"co2\":%u,\"fecha\":\"%s\",\"inicio\":\"%s\",\"ciudad\":\"%s\",\"hora\":\"%s\",\"id\":\"%s\"}",
-        d->pm1p0, d->pm2p5, d->pm4p0, d->pm10p0, d->voc, d->nox, d->avg_temp, d->avg_hum, d->co2, fecha_str, inicio_str, g_city_state, time_str, DEVICE_ID);
+        d->pm1p0, d->pm2p5, d->pm4p0, d->pm10p0, d->voc, d->nox, d->avg_temp, d->avg_hum, d->co2, fecha_str, inicio_str, city, time_str, DEVICE_ID);
     if (written < 0 || (size_t)written >= buf_size) {
         if (buf_size) buf[buf_size-1] = '\0';
     }
@@ -208,7 +219,9 @@ void sensors_set_city_state(const char *city_state) {
     if (!city_state) return;
     size_t len = strlen(city_state);
     if (len >= sizeof(g_city_state)) len = sizeof(g_city_state)-1;
+    taskENTER_CRITICAL(&g_city_mux);
     memcpy(g_city_state, city_state, len);
     g_city_state[len] = '\0';
+    taskEXIT_CRITICAL(&g_city_mux);
 }
 
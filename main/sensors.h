@@ -1,6 +1,11 @@
 #pragma once
 #include "esp_err.h"
 #include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef struct {
     // SCD4x
@@ -36,5 +41,23 @@ void sensors_format_json(const SensorData *d,
                          char *buf,
                          size_t buf_size);
 
-// Establece ciudad (city-state) obtenida externamente (Geoapify)
+// Igual que sensors_format_json pero en CBOR (RFC 8949) con Json::writeCbor: mismas claves y mismo
+// redondeo, los reales salen como fracción decimal (23.46 -> [-2, 2346]). Formato compacto para
+// almacenamiento local; se pasa a JSON sólo en la frontera con Firebase (firebase_putCbor).
+// Devuelve los bytes escritos, o 0 si no cabe en buf.
+size_t sensors_format_cbor(const SensorData *d,
+                           const char *time_str,
+                           const char *fecha_str,
+                           const char *inicio_str,
+                           uint8_t *buf,
+                           size_t buf_size);
+
+// Copia la ciudad actual (city-state) en dst
+void sensors_get_city_state(char *dst, size_t len);
+
+// Establece ciudad (city-state) obtenida externamente (monitor de celda). Se puede llamar desde otra tarea
 void sensors_set_city_state(const char *city_state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,43 @@
+#include "sensors.h"
+#include <math.h>
+#include <string.h>
+#include <string>
+#include "cbor.h"
+#include "privado.h" //Para el Device ID
+
+// Mismo redondeo que el "%.Nf" de sensors_format_json: writeCbor lo saca como fracción decimal exacta
+static Json::Value rounded(float v, int decimals)
+{
+    double scale = decimals == 1 ? 10.0 : 100.0;
+    return Json::Value(round((double)v * scale) / scale);
+}
+
+size_t sensors_format_cbor(const SensorData *d, const char *time_str, const char *fecha_str, const char *inicio_str, uint8_t *buf, size_t buf_size)
+{
+    if (!d || !buf || buf_size == 0) return 0;
+    char city[64];
+    sensors_get_city_state(city, sizeof(city));
+
+    Json::Value rec(Json::objectValue);
+    rec.emplace("pm1p0", rounded(d->pm1p0, 2));
+    rec.emplace("pm2p5", rounded(d->pm2p5, 2));
+    rec.emplace("pm4p0", rounded(d->pm4p0, 2));
+    rec.emplace("pm10p0", rounded(d->pm10p0, 2));
+    rec.emplace("voc", rounded(d->voc, 1));
+    rec.emplace("nox", rounded(d->nox, 1));
+    rec.emplace("cTe", rounded(d->avg_temp, 2));
+    rec.emplace("cHu", rounded(d->avg_hum, 2));
+    rec.emplace("co2", Json::Value((Json::UInt)d->co2));
+    rec.emplace("fecha", Json::Value(fecha_str ? fecha_str : ""));
+    rec.emplace("inicio", Json::Value(inicio_str ? inicio_str : ""));
+    rec.emplace("ciudad", Json::Value(city));
+    rec.emplace("hora", Json::Value(time_str ? time_str : ""));
+    rec.emplace("id", Json::Value(Json::StaticString(DEVICE_ID)));
+
+    std::string out;
+    out.reserve(buf_size);
+    Json::writeCbor(rec, &out);
+    if (out.size() > buf_size) return 0;
+    memcpy(buf, out.data(), out.size());
+    return out.size();
+}
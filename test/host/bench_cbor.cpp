@@ -0,0 +1,95 @@
+#include <string.h>
+#include <memory>
+#include <string>
+
+#include "json.h"
+#include "cbor.h"
+#include "sensors.h"
+#include "host_test.h"
+
+/* En el equipo la escribe el monitor de celda (sensors.c) */
+void sensors_get_city_state(char *dst, size_t len)
+{
+    strncpy(dst, "Ciudad de México-Ciudad de México", len - 1);
+    dst[len - 1] = '\0';
+}
+
+static const SensorData k_sample = {
+    612, 23.9f, 47.5f,                          /* co2, scd_temp, scd_hum */
+    3.21f, 5.87f, 7.02f, 7.66f, 101.5f, 1.0f,   /* pm1p0..pm10p0, voc, nox */
+    23.03f, 48.74f,                             /* sen_temp, sen_hum */
+    23.46f, 48.12f,                             /* avg_temp, avg_hum */
+};
+
+static bool parse_json(const std::string &doc, Json::Value &out)
+{
+    static std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+    return reader->parse(doc.data(), doc.data() + doc.size(), &out, nullptr);
+}
+
+static bool parse_cbor(const std::string &doc, Json::Value &out)
+{
+    static std::unique_ptr<Json::CharReader> reader(Json::CborCharReaderBuilder().newCharReader());
+    return reader->parse(doc.data(), doc.data() + doc.size(), &out, nullptr);
+}
+
+int main()
+{
+    uint8_t buf[256];
+    size_t n = sensors_format_cbor(&k_sample, "12:00:00", "2024-10-01 12:00:00", "2024-10-01 11:55:00", buf, sizeof(buf));
+    CHECK(n > 0);
+    CHECK(sensors_format_cbor(&k_sample, "12:00:00", "2024-10-01 12:00:00", "2024-10-01 11:55:00", buf, n - 1) == 0);
+    const std::string cbor(reinterpret_cast<const char *>(buf), n);
+
+    /* Mismo registro que sensors_format_json, con los reales redondeados igual */
+    Json::Value rec;
+    CHECK(parse_cbor(cbor, rec));
+    CHECK(rec.size() == 14);
+    CHECK(rec["pm1p0"].asDouble() == 3.21 && rec["cTe"].asDouble() == 23.46 && rec["voc"].asDouble() == 101.5);
+    CHECK(rec["co2"].asUInt() == 612 && rec["id"].asString() == "host-0001");
+    CHECK(rec["ciudad"].asString() == "Ciudad de México-Ciudad de México");
+
+    Json::FastWriter fast;
+    const std::string json = fast.write(rec);
+    Json::Value back;
+    CHECK(parse_json(json, back) && back == rec);
+    std::string again;
+    Json::writeCbor(rec, &again);
+    CHECK(again == cbor);
+
+    /* Lote de 12 registros (una hora cada 5 min), como iría a un journal local */
+    Json::Value batch(Json::arrayValue);
+    for (int i = 0; i < 12; ++i) {
+        Json::Value r = rec;
+        r["co2"] = 600 + i;
+        batch.append(std::move(r));
+    }
+    std::string batch_cbor;
+    Json::writeCbor(batch, &batch_cbor);
+    const std::string batch_json = fast.write(batch);
+    Json::Value batch_back;
+    CHECK(parse_cbor(batch_cbor, batch_back) && batch_back == batch);
+
+    bench_note();
+    printf("tamaño registro: CBOR %u B, FastWriter %u B (%.0f%%)\n", (unsigned)cbor.size(), (unsigned)json.size(),
+           100.0 * cbor.size() / json.size());
+    printf("tamaño lote x12: CBOR %u B, FastWriter %u B (%.0f%%)\n", (unsigned)batch_cbor.size(),
+           (unsigned)batch_json.size(), 100.0 * batch_cbor.size() / batch_json.size());
+
+    const int iters = bench_iters(20000);
+    double t_sensor = bench_ns(iters, [&] {
+        sensors_format_cbor(&k_sample, "12:00:00", "2024-10-01 12:00:00", "2024-10-01 11:55:00", buf, sizeof(buf));
+    });
+    double t_enc_cbor = bench_ns(iters, [&] { std::string s; Json::writeCbor(rec, &s); });
+    double t_enc_json = bench_ns(iters, [&] { std::string s = fast.write(rec); });
+    double t_dec_cbor = bench_ns(iters, [&] { Json::Value v; parse_cbor(cbor, v); });
+    double t_dec_json = bench_ns(iters, [&] { Json::Value v; parse_json(json, v); });
+    printf("%-34s %10s\n", "registro", "ns");
+    printf("%-34s %10.0f\n", "sensors_format_cbor (árbol + CBOR)", t_sensor);
+    printf("%-34s %10.0f\n", "writeCbor", t_enc_cbor);
+    printf("%-34s %10.0f\n", "FastWriter::write", t_enc_json);
+    printf("%-34s %10.0f\n", "CborCharReader::parse", t_dec_cbor);
+    printf("%-34s %10.0f\n", "CharReader (JSON)::parse", t_dec_json);
+    printf("codificar x%.2f, decodificar x%.2f frente a JSON\n", t_enc_json / t_enc_cbor, t_dec_json / t_dec_cbor);
+    return test_result("bench_cbor");
+}
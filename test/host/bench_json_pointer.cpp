@@ -0,0 +1,112 @@
+#include <string.h>
+#include <memory>
+#include <string>
+
+#include "json.h"
+#include "pointer.h"
+#include "host_test.h"
+
+static const char k_unwiredlabs[] =
+    "{\"status\":\"ok\",\"balance\":4821,\"lat\":19.43260773,\"lon\":-99.13320541,\"accuracy\":612,"
+    "\"address\":\"Calle 5 de Mayo, Centro, Cuauhtémoc, Ciudad de México, 06000, México\","
+    "\"address_detail\":{\"road\":\"Calle 5 de Mayo\",\"neighbourhood\":\"Centro\",\"suburb\":\"Cuauhtémoc\","
+    "\"city\":\"Ciudad de México\",\"county\":\"Cuauhtémoc\",\"state\":\"Ciudad de México\",\"postal_code\":\"06000\","
+    "\"country\":\"México\",\"country_code\":\"MX\"},\"aged\":false,\"fallback\":null}";
+
+static const char k_securetoken[] =
+    "{\"access_token\":\"eyJhbGciOiJSUzI1NiJ9.eyJ1c2VyX2lkIjoiYWJjIiwiZW1haWwiOiJzZW5zb3JAZXhhbXBsZS5jb20ifQ.c2ln\","
+    "\"expires_in\":\"3600\",\"token_type\":\"Bearer\","
+    "\"refresh_token\":\"AMf-vBxk3b9Q1m4lXkZ0Yf2p7qNwU5vJr8cT6eHdLsGaIoPzRnyKtWjMhVgFuCbDxEqAiSkOlBmNpQrSt\","
+    "\"id_token\":\"eyJhbGciOiJSUzI1NiJ9.eyJ1c2VyX2lkIjoiYWJjIn0.c2ln\",\"user_id\":\"u1vK9aQ2bXcD3eF4gH5iJ6kL7mN8\","
+    "\"project_id\":\"123456789012\"}";
+
+/* Lectura de días (RTDB shallow) con un registro anidado al final */
+static const char k_nested[] =
+    "{\"dias\":[{\"fecha\":\"2024-09-28\",\"n\":288},{\"fecha\":\"2024-09-29\",\"n\":288},"
+    "{\"fecha\":\"2024-09-30\",\"n\":287},{\"fecha\":\"2024-10-01\",\"n\":144,"
+    "\"ultimo\":{\"hora\":\"12:00:00\",\"medidas\":{\"pm2p5\":5.87,\"co2\":612}}}]}";
+
+static Json::Value parse(const char *doc)
+{
+    static std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+    Json::Value v;
+    reader->parse(doc, doc + strlen(doc), &v, nullptr);
+    return v;
+}
+
+struct lookup_t {
+    const char *name;
+    const char *doc;
+    const char *pointer;
+    /* Como se hacía a mano: isMember + operator[] encadenados */
+    const Json::Value &(*chained)(const Json::Value &root);
+};
+
+static const Json::Value &chained_token(const Json::Value &root)
+{
+    return root.isMember("access_token") ? root["access_token"] : Json::Value::nullSingleton();
+}
+
+static const Json::Value &chained_city(const Json::Value &root)
+{
+    const Json::Value &detail = root["address_detail"];
+    return detail.isMember("city") ? detail["city"] : Json::Value::nullSingleton();
+}
+
+static const Json::Value &chained_co2(const Json::Value &root)
+{
+    const Json::Value &dias = root["dias"];
+    if (!dias.isArray() || dias.size() <= 3) return Json::Value::nullSingleton();
+    return dias[3]["ultimo"]["medidas"]["co2"];
+}
+
+int main()
+{
+    static const lookup_t k_lookups[] = {
+        { "access_token", k_securetoken, "/access_token", chained_token },
+        { "ciudad", k_unwiredlabs, "/address_detail/city", chained_city },
+        { "co2 (5 niveles)", k_nested, "/dias/3/ultimo/medidas/co2", chained_co2 },
+    };
+    std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+
+    bench_note();
+    printf("%-16s %10s %10s %10s | %12s %12s %12s\n", "árbol", "[] ns", "Pointer", "sin comp.", "texto: parse",
+           "findSpan", "find+parse");
+    for (const lookup_t &l : k_lookups) {
+        const Json::Value root = parse(l.doc);
+        const char *end = l.doc + strlen(l.doc);
+        const Json::Pointer ptr(l.pointer);
+
+        /* Los tres caminos dan el mismo valor */
+        const Json::Value *found = ptr.find(root);
+        CHECK(ptr.isValid() && found && *found == l.chained(root) && !found->isNull());
+        const char *vb = nullptr, *ve = nullptr;
+        CHECK(ptr.findSpan(l.doc, end, &vb, &ve));
+        Json::Value from_text;
+        CHECK(ptr.find(l.doc, end, *reader, &from_text) && from_text == *found);
+        CHECK(parse(std::string(vb, ve).c_str()) == *found);
+
+        const int iters = bench_iters(200000);
+        const int text_iters = bench_iters(20000);
+        volatile bool sink = false;
+        double t_chained = bench_ns(iters, [&] { sink = l.chained(root).isNull(); });
+        double t_ptr = bench_ns(iters, [&] { sink = ptr.find(root) == nullptr; });
+        double t_uncompiled = bench_ns(iters, [&] { sink = Json::Pointer(l.pointer).find(root) == nullptr; });
+        double t_parse = bench_ns(text_iters, [&] { Json::Value v; reader->parse(l.doc, end, &v, nullptr); sink = l.chained(v).isNull(); });
+        double t_span = bench_ns(text_iters, [&] { const char *b, *e; sink = ptr.findSpan(l.doc, end, &b, &e); });
+        double t_find = bench_ns(text_iters, [&] { Json::Value v; sink = ptr.find(l.doc, end, *reader, &v); });
+        (void)sink;
+        printf("%-16s %10.0f %10.0f %10.0f | %12.0f %12.0f %12.0f\n", l.name, t_chained, t_ptr, t_uncompiled, t_parse,
+               t_span, t_find);
+    }
+
+    /* Rutas que no existen o no valen: nullptr / false, nunca un null creado al vuelo */
+    const Json::Value root = parse(k_nested);
+    CHECK(!Json::Pointer("/dias/9/fecha").find(root));
+    CHECK(!Json::Pointer("/dias/x").find(root));
+    CHECK(!Json::Pointer("dias").isValid());
+    CHECK(!Json::Pointer("/a~2b").isValid());
+    const char *b, *e;
+    CHECK(!Json::Pointer("/dias/3/ultimo/lluvia").findSpan(k_nested, k_nested + strlen(k_nested), &b, &e));
+    return test_result("bench_json_pointer");
+}
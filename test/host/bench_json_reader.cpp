@@ -0,0 +1,97 @@
+/* Lector strict-trusted frente a Features::all() (Json::Reader) y a CharReaderBuilder por
+ * defecto, con las respuestas reales que parsea el firmware */
+#include <string.h>
+#include <memory>
+#include <string>
+
+#include "json.h"
+#include "host_test.h"
+
+static const char *const k_payloads[][2] = {
+    { "securetoken",
+      "{\"access_token\":\"eyJhbGciOiJSUzI1NiIsImtpZCI6IjE2NzUwM2UwYWVjNTJkZGZiODk2NTIxYjkxN2ZiOGUyMGMxZjMzMDAiLCJ0eXAiOiJKV1QifQ."
+      "eyJpc3MiOiJodHRwczovL3NlY3VyZXRva2VuLmdvb2dsZS5jb20vZXNwMzItcHBwIiwiYXVkIjoiZXNwMzItcHBwIiwiYXV0aF90aW1lIjoxNzI5MjU3MjAwfQ."
+      "aGVsbG8td29ybGQtc2lnbmF0dXJlLWJ5dGVzLWZvci10aGUtYmVuY2htYXJrLW9ubHk\",\"expires_in\":\"3600\",\"token_type\":\"Bearer\","
+      "\"refresh_token\":\"AMf-vBxk3b9Q1m4lXkZ0Yf2p7qNwU5vJr8cT6eHdLsGaIoPzRnyKtWjMhVgFuCbDxEqAiSkOlBmNpQrStUvWxYz0123456789\","
+      "\"id_token\":\"eyJhbGciOiJSUzI1NiJ9.eyJ1c2VyX2lkIjoiYWJjIn0.c2ln\",\"user_id\":\"u1vK9aQ2bXcD3eF4gH5iJ6kL7mN8\","
+      "\"project_id\":\"123456789012\"}" },
+    { "signIn",
+      "{\"kind\":\"identitytoolkit#VerifyPasswordResponse\",\"localId\":\"u1vK9aQ2bXcD3eF4gH5iJ6kL7mN8\",\"email\":\"sensor@example.com\","
+      "\"displayName\":\"\",\"idToken\":\"eyJhbGciOiJSUzI1NiJ9.eyJ1c2VyX2lkIjoiYWJjIiwiZW1haWwiOiJzZW5zb3JAZXhhbXBsZS5jb20ifQ.c2ln\","
+      "\"registered\":true,\"refreshToken\":\"AMf-vBxk3b9Q1m4lXkZ0Yf2p7qNwU5vJr8cT6eHdLsGaIoPzRnyKtWjMhVgFuCbDxEqAiSkOlBmNpQrSt\","
+      "\"expiresIn\":\"3600\"}" },
+    { "unwiredlabs",
+      "{\"status\":\"ok\",\"balance\":4821,\"lat\":19.43260773,\"lon\":-99.13320541,\"accuracy\":612,"
+      "\"address\":\"Calle 5 de Mayo, Centro, Cuauhtémoc, Ciudad de México, 06000, México\","
+      "\"address_detail\":{\"road\":\"Calle 5 de Mayo\",\"neighbourhood\":\"Centro\",\"suburb\":\"Cuauhtémoc\","
+      "\"city\":\"Ciudad de México\",\"county\":\"Cuauhtémoc\",\"state\":\"Ciudad de México\",\"postal_code\":\"06000\","
+      "\"country\":\"México\",\"country_code\":\"MX\"},\"aged\":false,\"fallback\":null}" },
+    { "shallow",
+      "{\"24-10-01_12-00-00\":true,\"24-10-01_12-05-00\":true,\"24-10-01_12-10-00\":true,\"24-10-01_12-15-00\":true,"
+      "\"24-10-01_12-20-00\":true,\"24-10-01_12-25-00\":true,\"24-10-01_12-30-00\":true,\"24-10-01_12-35-00\":true,"
+      "\"24-10-01_12-40-00\":true,\"24-10-01_12-45-00\":true,\"24-10-01_12-50-00\":true,\"24-10-01_12-55-00\":true}" },
+    { "registro",
+      "{\"pm1p0\":3.21,\"pm2p5\":5.87,\"pm4p0\":7.02,\"pm10p0\":7.66,\"voc\":101.5,\"nox\":1.0,\"cTe\":23.46,\"cHu\":48.12,"
+      "\"co2\":612,\"fecha\":\"01-10-2024\",\"hora\":\"12:00:00\",\"ciudad\":\"Ciudad de México-Ciudad de México\","
+      "\"celda\":\"334-20-562-43790378\"}" },
+};
+
+static Json::CharReader *new_reader(bool strict_trusted)
+{
+    Json::CharReaderBuilder b;
+    if (strict_trusted) Json::CharReaderBuilder::strictTrustedMode(&b.settings_);
+    return b.newCharReader();
+}
+
+int main()
+{
+    std::unique_ptr<Json::CharReader> trusted(new_reader(true));
+    std::unique_ptr<Json::CharReader> runtime(new_reader(false));
+    Json::Reader legacy(Json::Features::all());
+
+    bench_note();
+    /* all()+com. = como llamaban los sitios antiguos: Features::all() recogiendo comentarios */
+    printf("%-12s %6s %12s %12s %12s %12s %8s\n", "payload", "B", "trusted ns", "runtime ns", "all() ns", "all()+com.",
+           "com/tr");
+    double sum_trusted = 0, sum_all = 0, sum_comments = 0;
+    for (const auto &p : k_payloads) {
+        const char *doc = p[1];
+        const char *end = doc + strlen(doc);
+
+        /* Mismo árbol con los tres lectores */
+        Json::Value a, b, c;
+        CHECK(trusted->parse(doc, end, &a, nullptr));
+        CHECK(runtime->parse(doc, end, &b, nullptr));
+        CHECK(legacy.parse(doc, end, c, false));
+        CHECK(a == b && a == c && a.isObject() && a.size() > 0);
+
+        const int iters = bench_iters(20000);
+        double t_trusted = bench_ns(iters, [&] { Json::Value v; trusted->parse(doc, end, &v, nullptr); });
+        double t_runtime = bench_ns(iters, [&] { Json::Value v; runtime->parse(doc, end, &v, nullptr); });
+        double t_all = bench_ns(iters, [&] { Json::Value v; legacy.parse(doc, end, v, false); });
+        double t_comments = bench_ns(iters, [&] { Json::Value v; legacy.parse(doc, end, v, true); });
+        printf("%-12s %6u %12.0f %12.0f %12.0f %12.0f %8.2f\n", p[0], (unsigned)(end - doc), t_trusted, t_runtime, t_all,
+               t_comments, t_comments / t_trusted);
+        sum_trusted += t_trusted;
+        sum_all += t_all;
+        sum_comments += t_comments;
+    }
+    printf("total: strict-trusted %.0f ns, Features::all() %.0f ns (x%.2f), con comentarios %.0f ns (x%.2f)\n",
+           sum_trusted, sum_all, sum_all / sum_trusted, sum_comments, sum_comments / sum_trusted);
+
+    /* Lo que strict-trusted rechaza y Features::all() acepta */
+    static const char *const k_extensions[] = {
+        "{\"a\":1 /* comentario */}",
+        "{\"a\":1,}",
+        "{'a':1}",
+        "{\"a\":NaN}",
+    };
+    for (const char *doc : k_extensions) {
+        Json::Value v;
+        CHECK(!trusted->parse(doc, doc + strlen(doc), &v, nullptr));
+    }
+    Json::Value v;
+    const char *commented = k_extensions[0];
+    CHECK(legacy.parse(commented, commented + strlen(commented), v, false) && v["a"].asInt() == 1);
+    return test_result("bench_json_reader");
+}
@@ -0,0 +1,109 @@
+#include "host_rtos.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+struct host_event_group {
+    EventBits_t bits;
+};
+
+static int64_t s_now_us;
+
+bool (*host_idle_hook)(int64_t until_us);
+
+void host_time_set_us(int64_t us)
+{
+    s_now_us = us;
+}
+
+void host_time_advance_ms(int ms)
+{
+    s_now_us += (int64_t)ms * 1000;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+    default:                    return "ESP_ERR";
+    }
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return calloc(1, sizeof(struct host_event_group));
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t eg, EventBits_t bits)
+{
+    eg->bits |= bits;
+    return eg->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t eg, EventBits_t bits)
+{
+    EventBits_t prev = eg->bits;
+    eg->bits &= ~bits;
+    return prev;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t eg)
+{
+    return eg->bits;
+}
+
+static bool satisfied(EventGroupHandle_t eg, EventBits_t bits, BaseType_t all)
+{
+    return all ? (eg->bits & bits) == bits : (eg->bits & bits) != 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t eg, EventBits_t bits, BaseType_t clear,
+                                BaseType_t all, TickType_t ticks)
+{
+    const int64_t until = ticks == portMAX_DELAY ? INT64_MAX : s_now_us + (int64_t)ticks * 1000;
+    while (!satisfied(eg, bits, all) && s_now_us < until) {
+        if (!host_idle_hook) {
+            if (ticks != portMAX_DELAY) s_now_us = until;
+            break;
+        }
+        if (!host_idle_hook(until)) break;     // el guion se agotó: nadie más va a poner bits
+    }
+    EventBits_t got = eg->bits;
+    if (clear && satisfied(eg, bits, all)) eg->bits &= ~bits;
+    return got;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf)
+{
+    return buf;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    (void)sem;
+    (void)ticks;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    (void)sem;
+    return pdTRUE;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* FreeRTOS/esp_timer mínimos para compilar módulos de main/ en el host: un solo hilo y reloj
+ * virtual que sólo avanza cuando el test (o una espera) lo mueve */
+
+void host_time_set_us(int64_t us);
+void host_time_advance_ms(int ms);
+
+/* Mientras xEventGroupWaitBits espera se llama con el instante límite: debe entregar lo que toque
+ * (p. ej. URC de un guion) y avanzar el reloj, sin pasar de until_us. false si ya no queda nada
+ * que entregar. Sin hook, la espera salta directamente al timeout */
+extern bool (*host_idle_hook)(int64_t until_us);
@@ -0,0 +1,45 @@
+#pragma once
+/* Comprobaciones y cronómetro compartidos por los tests y benchmarks de host en C++ */
+#include <stdio.h>
+#include <chrono>
+
+static int s_fails;
+#define CHECK(cond) do { if (!(cond)) { printf("FALLO %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fails++; } } while (0)
+
+/* ns por iteración de fn (mejor de 3 tandas: descarta el ruido del planificador) */
+template <typename F>
+static double bench_ns(int iters, F fn)
+{
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i) fn();
+        auto t1 = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+        if (round == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+/* Con sanitizers cada iteración cuesta ~10x: se mide menos para que ctest no se eternice */
+static inline int bench_iters(int n)
+{
+#ifdef HOST_SANITIZED
+    return n / 20 > 0 ? n / 20 : 1;
+#else
+    return n;
+#endif
+}
+
+static inline void bench_note(void)
+{
+#ifdef HOST_SANITIZED
+    printf("(con ASan/UBSan: las cifras absolutas no valen; -DHOST_SANITIZE=OFF para medir)\n");
+#endif
+}
+
+static inline int test_result(const char *name)
+{
+    printf("%s: %d fallos\n", name, s_fails);
+    return s_fails != 0;
+}
@@ -0,0 +1,230 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+#include "http_standin.h"
+
+static const char* reasonPhrase(int status)
+{
+    switch (status) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 307: return "Temporary Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 415: return "Unsupported Media Type";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Status";
+    }
+}
+
+static bool sendAll(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t w = send(fd, data, len, MSG_NOSIGNAL);
+        if (w <= 0) return false;
+        data += w;
+        len -= (size_t)w;
+    }
+    return true;
+}
+
+HttpStandin::HttpStandin(handler_t handler) : handler_(std::move(handler))
+{
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd_, 16) != 0) {
+        perror("standin: bind/listen");
+        abort();
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, (struct sockaddr*)&addr, &len);
+    port_ = ntohs(addr.sin_port);
+    acceptor_ = std::thread(&HttpStandin::acceptLoop, this);
+}
+
+HttpStandin::~HttpStandin()
+{
+    stop_ = true;
+    acceptor_.join();
+    close(listen_fd_);
+    {
+        // Despierta a los hilos bloqueados en recv()
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : fds_) shutdown(fd, SHUT_RDWR);
+    }
+    for (std::thread& t : workers_) t.join();
+}
+
+std::string HttpStandin::url(const std::string& path) const
+{
+    return "http://127.0.0.1:" + std::to_string(port_) + path;
+}
+
+void HttpStandin::acceptLoop()
+{
+    while (!stop_) {
+        struct pollfd p = { listen_fd_, POLLIN, 0 };
+        if (poll(&p, 1, 20) <= 0) continue;
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        connections_++;
+        std::lock_guard<std::mutex> lock(mutex_);
+        fds_.push_back(fd);
+        workers_.emplace_back(&HttpStandin::serve, this, fd);
+    }
+}
+
+// Espera ms (o hasta el cierre del servidor). false si el servidor se está parando
+bool HttpStandin::waitStop(int ms)
+{
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (!stop_ && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return !stop_;
+}
+
+void HttpStandin::serve(int fd)
+{
+    std::string in;
+    char buf[4096];
+    bool open = true;
+    // Cuándo llegó cada lectura (fin en bytes desde el inicio de la conexión): con latency_ms una
+    // petición segmentada cuenta desde que llegó al socket, no desde que se atendió la anterior
+    std::deque<std::pair<size_t, std::chrono::steady_clock::time_point>> arrivals;
+    size_t consumed = 0;
+    auto take = [&](int flags) {
+        ssize_t r = recv(fd, buf, sizeof(buf), flags);
+        if (r > 0) {
+            in.append(buf, (size_t)r);
+            arrivals.push_back({ consumed + in.size(), std::chrono::steady_clock::now() });
+        }
+        return r;
+    };
+    while (open && !stop_) {
+        // Cabecera completa (puede haber más peticiones detrás: segmentación)
+        size_t head_end;
+        while ((head_end = in.find("\r\n\r\n")) == std::string::npos) {
+            if (take(0) <= 0) { open = false; break; }
+        }
+        if (!open) break;
+
+        standin_request_t req;
+        size_t line_end = in.find("\r\n");
+        std::string line = in.substr(0, line_end);
+        size_t sp1 = line.find(' ');
+        size_t sp2 = line.find(' ', sp1 + 1);
+        req.method = line.substr(0, sp1);
+        req.path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        size_t pos = line_end + 2;
+        while (pos < head_end) {
+            size_t end = in.find("\r\n", pos);
+            std::string h = in.substr(pos, end - pos);
+            size_t colon = h.find(':');
+            if (colon != std::string::npos) {
+                std::string key = h.substr(0, colon);
+                std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+                size_t v = h.find_first_not_of(' ', colon + 1);
+                req.headers[key] = v == std::string::npos ? "" : h.substr(v);
+            }
+            pos = end + 2;
+        }
+        size_t body_len = req.headers.count("content-length") ? strtoul(req.headers["content-length"].c_str(), nullptr, 10) : 0;
+        in.erase(0, head_end + 4);
+        consumed += head_end + 4;
+        while (in.size() < body_len) {
+            if (take(0) <= 0) { open = false; break; }
+        }
+        if (!open) break;
+        req.body = in.substr(0, body_len);
+        in.erase(0, body_len);
+        consumed += body_len;
+        while (arrivals.front().first < consumed) arrivals.pop_front();
+        auto arrived = arrivals.front().second;
+
+        requests_++;
+        standin_response_t res = handler_(req);
+        if (res.delay_ms > 0 && !waitStop(res.delay_ms)) break;
+        if (res.latency_ms > 0) {
+            // Mientras, se sigue leyendo para fechar bien las peticiones que llegan detrás
+            auto until = arrived + std::chrono::milliseconds(res.latency_ms);
+            while (!stop_ && std::chrono::steady_clock::now() < until) {
+                while (take(MSG_DONTWAIT) > 0) {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (stop_) break;
+        }
+        if (res.stall) {
+            waitStop(24 * 3600 * 1000);
+            break;
+        }
+        if (res.drop) break;
+
+        std::string out = "HTTP/1.1 " + std::to_string(res.status) + " " + reasonPhrase(res.status) + "\r\n";
+        bool has_length = false;
+        for (const auto& h : res.headers) {
+            if (strcasecmp(h.first.c_str(), "Content-Length") == 0) has_length = true;
+            out += h.first + ": " + h.second + "\r\n";
+        }
+        bool streaming = !res.stream.empty();
+        if (!has_length && !streaming) out += "Content-Length: " + std::to_string(res.body.size()) + "\r\n";
+        if (res.close) out += "Connection: close\r\n";
+        out += "\r\n";
+        out += res.body;
+        if (!sendAll(fd, out.data(), out.size()) || (res.close && !streaming)) break;
+        if (streaming) {
+            bool sent = true;
+            for (const auto& piece : res.stream) {
+                if (!waitStop(piece.first) || !sendAll(fd, piece.second.data(), piece.second.size())) {
+                    sent = false;
+                    break;
+                }
+            }
+            if (sent && !res.close) waitStop(24 * 3600 * 1000);
+            break;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fds_.erase(std::find(fds_.begin(), fds_.end(), fd));
+    }
+    close(fd);
+}
+
+bool standinAuth(const standin_request_t& req, standin_response_t& res)
+{
+    if (req.path.find("/identitytoolkit.googleapis.com/") == 0) {
+        res.status = 200;
+        res.body = "{\"idToken\":\"id-host\",\"refreshToken\":\"refresh-host\",\"expiresIn\":\"3600\"}";
+        return true;
+    }
+    if (req.path.find("/securetoken.googleapis.com/") == 0) {
+        res.status = 200;
+        res.body = "{\"access_token\":\"token-host\",\"expires_in\":\"3600\",\"refresh_token\":\"refresh-host\"}";
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,67 @@
+#pragma once
+/* Servidor HTTP/1.1 local (127.0.0.1, puerto efímero) que hace de Firebase en los tests de host.
+ * Un hilo por conexión, keep-alive y peticiones segmentadas; el handler decide la respuesta y los
+ * fallos a inyectar (retraso, cuelgue, cierre sin responder) o un stream escrito por trozos */
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct standin_request_t {
+    std::string method;
+    std::string path;                              // con la query
+    std::map<std::string, std::string> headers;    // claves en minúsculas
+    std::string body;
+};
+
+struct standin_response_t {
+    int status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    int delay_ms = 0;       // antes de responder
+    int latency_ms = 0;     // desde que llegó la petición: un RTT que no se suma entre peticiones segmentadas
+    bool close = false;     // Connection: close y cierre tras responder
+    bool drop = false;      // cerrar sin responder
+    bool stall = false;     // no responder nunca (hasta que se pare el servidor)
+    // Stream (SSE): sin Content-Length; tras la cabecera se escribe cada trozo tal cual después de
+    // su retraso en ms. Al acabar se cierra con close o se deja abierta hasta parar el servidor
+    std::vector<std::pair<int, std::string>> stream;
+};
+
+class HttpStandin
+{
+public:
+    using handler_t = std::function<standin_response_t(const standin_request_t&)>;
+
+    explicit HttpStandin(handler_t handler);
+    ~HttpStandin();
+
+    int port() const { return port_; }
+    std::string url(const std::string& path) const;
+    int requests() const { return requests_; }
+    int connections() const { return connections_; }
+
+private:
+    void acceptLoop();
+    void serve(int fd);
+    bool waitStop(int ms);
+
+    handler_t handler_;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::atomic<int> requests_{0};
+    std::atomic<int> connections_{0};
+    std::thread acceptor_;
+    std::mutex mutex_;
+    std::vector<std::thread> workers_;
+    std::vector<int> fds_;
+};
+
+/* Identity Toolkit y Secure Token del emulador de Auth (FirebaseApp::useAuthEmulator con url("")):
+ * true si req era una de ellas, y res lleva la respuesta */
+bool standinAuth(const standin_request_t& req, standin_response_t& res);
@@ -0,0 +1,127 @@
+#include "mock_modem.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "host_rtos.h"
+
+static const mock_urc_t   *s_urc;
+static size_t              s_urc_count;
+static size_t              s_urc_next;
+static const mock_reply_t *s_replies;
+static size_t              s_reply_count;
+static size_t              s_chunk = 64;
+static int64_t             s_epoch_us;
+static int                 s_commands;
+static char                s_last_cmd[64];
+static esp_err_t         (*s_urc_cb)(uint8_t *data, size_t len);
+
+static int s_dce_tag;
+
+/* Entrega los bytes en trozos de s_chunk, como los lee la tarea del DTE */
+static esp_err_t deliver(const char *bytes, esp_err_t (*cb)(uint8_t *data, size_t len))
+{
+    esp_err_t r = ESP_OK;
+    size_t n = strlen(bytes);
+    for (size_t off = 0; off < n; off += s_chunk) {
+        size_t take = n - off < s_chunk ? n - off : s_chunk;
+        r = cb((uint8_t *)bytes + off, take);
+    }
+    return r;
+}
+
+static bool idle(int64_t until_us)
+{
+    if (s_urc_next < s_urc_count) {
+        const mock_urc_t *u = &s_urc[s_urc_next];
+        int64_t at = s_epoch_us + (int64_t)u->at_ms * 1000;
+        if (at <= until_us) {
+            if (at > esp_timer_get_time()) host_time_set_us(at);
+            s_urc_next++;
+            if (s_urc_cb) deliver(u->bytes, s_urc_cb);
+            return true;
+        }
+    }
+    if (until_us != INT64_MAX) host_time_set_us(until_us);
+    return false;
+}
+
+void mock_modem_reset(void)
+{
+    host_time_set_us(0);
+    s_epoch_us = 0;
+    s_urc = NULL;
+    s_urc_count = s_urc_next = 0;
+    s_replies = NULL;
+    s_reply_count = 0;
+    s_chunk = 64;
+    s_commands = 0;
+    s_last_cmd[0] = '\0';
+    host_idle_hook = idle;
+}
+
+void mock_modem_script(const mock_urc_t *urc, size_t count)
+{
+    s_epoch_us = esp_timer_get_time();
+    s_urc = urc;
+    s_urc_count = count;
+    s_urc_next = 0;
+}
+
+void mock_modem_replies(const mock_reply_t *replies, size_t count)
+{
+    s_replies = replies;
+    s_reply_count = count;
+}
+
+void mock_modem_set_chunk(size_t bytes)
+{
+    s_chunk = bytes ? bytes : 1;
+}
+
+esp_modem_dce_t *mock_modem_dce(void)
+{
+    return (esp_modem_dce_t *)&s_dce_tag;
+}
+
+int mock_modem_commands(void)
+{
+    return s_commands;
+}
+
+const char *mock_modem_last_command(void)
+{
+    return s_last_cmd;
+}
+
+esp_err_t esp_modem_set_urc(esp_modem_dce_t *dce, esp_err_t (*got_line)(uint8_t *data, size_t len))
+{
+    (void)dce;
+    s_urc_cb = got_line;
+    return ESP_OK;
+}
+
+/* Como el DTE real, el manejador de URC ve también las respuestas a comandos */
+esp_err_t esp_modem_command(esp_modem_dce_t *dce, const char *command, esp_modem_command_cb got_line, uint32_t timeout_ms)
+{
+    (void)dce;
+    s_commands++;
+    strncpy(s_last_cmd, command, sizeof(s_last_cmd) - 1);
+    s_last_cmd[sizeof(s_last_cmd) - 1] = '\0';
+
+    const char *reply = NULL;
+    for (size_t i = 0; i < s_reply_count; ++i) {
+        if (strncmp(command, s_replies[i].cmd, strlen(s_replies[i].cmd)) == 0) {
+            reply = s_replies[i].reply;
+            break;
+        }
+    }
+    if (reply) {
+        if (s_urc_cb) deliver(reply, s_urc_cb);
+        esp_err_t r = deliver(reply, got_line);
+        if (r != ESP_ERR_TIMEOUT) return r;
+    }
+    host_time_advance_ms((int)timeout_ms);
+    return ESP_ERR_TIMEOUT;
+}
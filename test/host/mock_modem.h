@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+
+#include "esp_modem_api.h"
+
+/* Módem simulado para los tests de host: implementa esp_modem_command/esp_modem_set_urc sobre el
+ * reloj virtual de host_rtos. Las URC de un guion llegan a modem_at_feed (vía el manejador que
+ * registra modem_at_init) en su instante y partidas en trozos, como las entrega el UART */
+
+typedef struct {
+    int         at_ms;      // instante desde mock_modem_script
+    const char *bytes;      // tal cual por el UART, con "\r\n"
+} mock_urc_t;
+
+typedef struct {
+    const char *cmd;        // prefijo del comando (p. ej. "AT+CPSI?")
+    const char *reply;      // respuesta completa, hasta OK/ERROR; NULL = el módem no contesta
+} mock_reply_t;
+
+/** Reloj a cero, sin guion ni respuestas, trozos de 64 bytes */
+void mock_modem_reset(void);
+
+/** Guion de URC (ordenado por at_ms, relativo a ahora); el array debe vivir mientras dure el test */
+void mock_modem_script(const mock_urc_t *urc, size_t count);
+
+/** Tabla de respuestas a comandos; un comando sin entrada agota su timeout */
+void mock_modem_replies(const mock_reply_t *replies, size_t count);
+
+/** Tamaño de los trozos en que se parte cada envío (1 = byte a byte) */
+void mock_modem_set_chunk(size_t bytes);
+
+/** DCE opaco para modem_at_init/modem_at_command */
+esp_modem_dce_t *mock_modem_dce(void);
+
+/** Comandos recibidos desde mock_modem_reset y el último de ellos */
+int         mock_modem_commands(void);
+const char *mock_modem_last_command(void);
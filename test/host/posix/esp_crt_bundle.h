@@ -0,0 +1,11 @@
+#pragma once
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* Sin TLS en el PC: no hace nada */
+esp_err_t esp_crt_bundle_attach(void *conf);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+
+/* En el PC no hay PSRAM: todo sale del heap normal */
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+
+static inline void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+static inline void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
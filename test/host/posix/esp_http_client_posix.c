@@ -0,0 +1,471 @@
+#define _GNU_SOURCE   /* strcasestr */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "esp_http_client.h"
+#include "esp_tls.h"
+
+#define MAX_HEADERS 16
+
+struct header {
+    char *key;
+    char *value;
+};
+
+struct esp_http_client {
+    /* Petición */
+    bool https;
+    char host[128];
+    int port;
+    char *path;                     /* ruta + query */
+    esp_http_client_method_t method;
+    struct header headers[MAX_HEADERS];
+    int n_headers;
+    const char *post_data;
+    int post_len;
+    int timeout_ms;
+    int buffer_size;
+    http_event_handle_cb handler;
+    void *user_data;
+
+    /* Conexión (abierta si tls != NULL) */
+    esp_tls_t *tls;
+    char conn_host[128];
+    int conn_port;
+    esp_err_t last_tls_error;
+    char rx[1024];
+    int rx_pos;
+    int rx_len;
+
+    /* Respuesta */
+    int status;
+    int64_t content_length;         /* -1 = hasta el cierre */
+    bool chunked;
+    bool keep_alive;
+    int64_t body_left;              /* del cuerpo o del chunk en curso */
+    bool body_done;
+    char location[256];
+};
+
+static void dispatch(esp_http_client_handle_t c, esp_http_client_event_id_t id, void *data, int len, char *key,
+                     char *value)
+{
+    if (!c->handler) return;
+    esp_http_client_event_t evt = { id, c, data, len, c->user_data, key, value };
+    c->handler(&evt);
+}
+
+static bool parse_url(esp_http_client_handle_t c, const char *url)
+{
+    const char *p;
+    if (strncmp(url, "http://", 7) == 0) { c->https = false; c->port = 80; p = url + 7; }
+    else if (strncmp(url, "https://", 8) == 0) { c->https = true; c->port = 443; p = url + 8; }
+    else return false;
+    size_t n = strcspn(p, ":/?");
+    if (n == 0 || n >= sizeof(c->host)) return false;
+    memcpy(c->host, p, n);
+    c->host[n] = '\0';
+    p += n;
+    if (*p == ':') {
+        c->port = atoi(p + 1);
+        p += 1 + strcspn(p + 1, "/?");
+    }
+    free(c->path);
+    if (*p == '/') {
+        c->path = strdup(p);
+    } else {
+        c->path = malloc(strlen(p) + 2);
+        sprintf(c->path, "/%s", p);
+    }
+    return true;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    if (!config->url || !parse_url(c, config->url)) {
+        free(c);
+        return NULL;
+    }
+    c->method = config->method;
+    c->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 5000;
+    c->buffer_size = config->buffer_size > 0 ? config->buffer_size : 512;
+    c->handler = config->event_handler;
+    c->user_data = config->user_data;
+    c->status = -1;
+    return c;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t c, const char *url)
+{
+    char old_host[sizeof(c->host)];
+    int old_port = c->port;
+    memcpy(old_host, c->host, sizeof(old_host));
+    if (!parse_url(c, url)) return ESP_ERR_INVALID_ARG;
+    /* Otro servidor: la conexión abierta ya no vale */
+    if (c->tls && (strcmp(old_host, c->host) != 0 || old_port != c->port)) esp_http_client_close(c);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t c, esp_http_client_method_t method)
+{
+    c->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t c, const char *data, int len)
+{
+    c->post_data = data;
+    c->post_len = data ? len : 0;
+    return ESP_OK;
+}
+
+static int find_header(esp_http_client_handle_t c, const char *key)
+{
+    for (int i = 0; i < c->n_headers; ++i) {
+        if (strcasecmp(c->headers[i].key, key) == 0) return i;
+    }
+    return -1;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t c, const char *key, const char *value)
+{
+    int i = find_header(c, key);
+    if (i < 0) {
+        if (c->n_headers == MAX_HEADERS) return ESP_ERR_NO_MEM;
+        i = c->n_headers++;
+        c->headers[i].key = strdup(key);
+    } else {
+        free(c->headers[i].value);
+    }
+    c->headers[i].value = strdup(value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t c, const char *key)
+{
+    int i = find_header(c, key);
+    if (i < 0) return ESP_OK;
+    free(c->headers[i].key);
+    free(c->headers[i].value);
+    c->headers[i] = c->headers[--c->n_headers];
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t c, int timeout_ms)
+{
+    c->timeout_ms = timeout_ms;
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t c)
+{
+    return c->status;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t c)
+{
+    return c->content_length;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t c)
+{
+    if (c->tls) {
+        esp_tls_conn_destroy(c->tls);
+        c->tls = NULL;
+        dispatch(c, HTTP_EVENT_DISCONNECTED, NULL, 0, NULL, NULL);
+    }
+    c->rx_pos = c->rx_len = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t c)
+{
+    if (!c) return ESP_FAIL;
+    esp_http_client_close(c);
+    for (int i = 0; i < c->n_headers; ++i) {
+        free(c->headers[i].key);
+        free(c->headers[i].value);
+    }
+    free(c->path);
+    free(c);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_get_and_clear_last_tls_error(esp_http_client_handle_t c, int *esp_tls_code,
+                                                       int *esp_tls_flags)
+{
+    esp_err_t err = c->last_tls_error;
+    c->last_tls_error = ESP_OK;
+    if (esp_tls_code) *esp_tls_code = 0;
+    if (esp_tls_flags) *esp_tls_flags = 0;
+    return err;
+}
+
+/* Fallo de E/S (el detalle ya está en last_tls_error): se cierra y el siguiente intento reconecta.
+ * IDF deja la máquina de estados a medias; por eso performRequest cierra tras un error */
+static void fail_io(esp_http_client_handle_t c)
+{
+    esp_http_client_close(c);
+}
+
+static esp_err_t connect_if_needed(esp_http_client_handle_t c)
+{
+    if (c->tls && strcmp(c->conn_host, c->host) == 0 && c->conn_port == c->port) return ESP_OK;
+    esp_http_client_close(c);
+    if (c->https) {
+        c->last_tls_error = ESP_ERR_ESP_TLS_UNSUPPORTED_PROTOCOL_FAMILY;
+        return ESP_ERR_HTTP_INVALID_TRANSPORT;
+    }
+    esp_tls_cfg_t cfg = { NULL, c->timeout_ms, true };
+    c->tls = esp_tls_init();
+    if (!c->tls) return ESP_ERR_NO_MEM;
+    if (esp_tls_conn_new_sync(c->host, (int)strlen(c->host), c->port, &cfg, c->tls) != 1) {
+        c->last_tls_error = esp_tls_get_and_clear_last_error(c->tls, NULL, NULL);
+        esp_tls_conn_destroy(c->tls);
+        c->tls = NULL;
+        dispatch(c, HTTP_EVENT_ERROR, NULL, 0, NULL, NULL);
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    snprintf(c->conn_host, sizeof(c->conn_host), "%s", c->host);
+    c->conn_port = c->port;
+    c->rx_pos = c->rx_len = 0;
+    dispatch(c, HTTP_EVENT_ON_CONNECTED, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+/* El timeout vigente se aplica en cada petición, no sólo al conectar */
+static void apply_timeout(esp_http_client_handle_t c)
+{
+    int fd = -1;
+    if (esp_tls_get_conn_sockfd(c->tls, &fd) != ESP_OK || fd < 0) return;
+    struct timeval tv = { c->timeout_ms / 1000, (c->timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static bool write_all(esp_http_client_handle_t c, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t w = esp_tls_conn_write(c->tls, data, len);
+        if (w <= 0) {
+            c->last_tls_error = esp_tls_get_and_clear_last_error(c->tls, NULL, NULL);
+            return false;
+        }
+        data += w;
+        len -= (size_t)w;
+    }
+    return true;
+}
+
+static const char *method_name(esp_http_client_method_t m)
+{
+    static const char *const names[] = { "GET", "POST", "PUT", "PATCH", "DELETE", "HEAD" };
+    return (unsigned)m < sizeof(names) / sizeof(names[0]) ? names[m] : "GET";
+}
+
+static esp_err_t send_head(esp_http_client_handle_t c, int write_len)
+{
+    size_t cap = 256 + strlen(c->path) + strlen(c->host);
+    for (int i = 0; i < c->n_headers; ++i) cap += strlen(c->headers[i].key) + strlen(c->headers[i].value) + 4;
+    char *head = malloc(cap);
+    if (!head) return ESP_ERR_NO_MEM;
+    int n = snprintf(head, cap, "%s %s HTTP/1.1\r\nHost: %s:%d\r\nUser-Agent: ESP32 HTTP Client/1.0\r\n",
+                     method_name(c->method), c->path, c->host, c->port);
+    for (int i = 0; i < c->n_headers; ++i) {
+        /* Content-Length lo pone el cliente según lo que se va a escribir, como en IDF */
+        if (strcasecmp(c->headers[i].key, "Content-Length") == 0) continue;
+        n += snprintf(head + n, cap - n, "%s: %s\r\n", c->headers[i].key, c->headers[i].value);
+    }
+    n += snprintf(head + n, cap - n, "Content-Length: %d\r\n\r\n", write_len);
+    apply_timeout(c);
+    c->status = -1;
+    bool ok = write_all(c, head, (size_t)n);
+    free(head);
+    if (!ok) {
+        esp_http_client_close(c);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    dispatch(c, HTTP_EVENT_HEADERS_SENT, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+static bool fill(esp_http_client_handle_t c)
+{
+    ssize_t r = esp_tls_conn_read(c->tls, c->rx, sizeof(c->rx));
+    if (r <= 0) {
+        c->last_tls_error = r == 0 ? ESP_ERR_ESP_TLS_TCP_CLOSED_FIN : esp_tls_get_and_clear_last_error(c->tls, NULL, NULL);
+        return false;
+    }
+    c->rx_pos = 0;
+    c->rx_len = (int)r;
+    return true;
+}
+
+/* Línea sin CRLF; false si la conexión se cortó o venció el timeout */
+static bool read_line(esp_http_client_handle_t c, char *line, size_t cap)
+{
+    size_t n = 0;
+    while (true) {
+        if (c->rx_pos == c->rx_len && !fill(c)) return false;
+        char ch = c->rx[c->rx_pos++];
+        if (ch == '\n') break;
+        if (n + 1 < cap) line[n++] = ch;
+    }
+    if (n > 0 && line[n - 1] == '\r') n--;
+    line[n] = '\0';
+    return true;
+}
+
+static void trim(char **s)
+{
+    while (**s == ' ' || **s == '\t') (*s)++;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t c)
+{
+    if (!c->tls) return ESP_FAIL;
+    char line[1024];
+    do {
+        if (!read_line(c, line, sizeof(line)) || strncmp(line, "HTTP/1.", 7) != 0 || strlen(line) < 12) {
+            fail_io(c);
+            return ESP_FAIL;
+        }
+        c->status = atoi(line + 9);
+        c->content_length = -1;
+        c->chunked = false;
+        c->keep_alive = line[7] == '1';
+        c->location[0] = '\0';
+        while (true) {
+            if (!read_line(c, line, sizeof(line))) {
+                fail_io(c);
+                return ESP_FAIL;
+            }
+            if (line[0] == '\0') break;
+            char *colon = strchr(line, ':');
+            if (!colon) continue;
+            *colon = '\0';
+            char *value = colon + 1;
+            trim(&value);
+            if (strcasecmp(line, "Content-Length") == 0) c->content_length = atoll(value);
+            else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasestr(value, "chunked")) c->chunked = true;
+            else if (strcasecmp(line, "Connection") == 0) c->keep_alive = strcasestr(value, "close") == NULL;
+            else if (strcasecmp(line, "Location") == 0) snprintf(c->location, sizeof(c->location), "%s", value);
+            if (c->status >= 200) dispatch(c, HTTP_EVENT_ON_HEADER, NULL, 0, line, value);
+        }
+    } while (c->status >= 100 && c->status < 200);   /* 1xx informativo */
+
+    c->body_done = c->status == 204 || c->status == 304 || c->method == HTTP_METHOD_HEAD || c->content_length == 0;
+    c->body_left = c->chunked ? 0 : c->content_length;
+    if (c->content_length < 0 && !c->chunked) c->keep_alive = false;   /* cuerpo hasta el cierre */
+    return c->chunked || c->content_length < 0 ? 0 : c->content_length;
+}
+
+/* Hasta len bytes del cuerpo (sin la codificación chunked): >0 datos, 0 fin del cuerpo, -1 error */
+static int read_body(esp_http_client_handle_t c, char *dst, int len)
+{
+    if (c->body_done) return 0;
+    if (c->chunked && c->body_left == 0) {
+        char line[64];
+        if (!read_line(c, line, sizeof(line))) return -1;
+        c->body_left = strtoll(line, NULL, 16);
+        if (c->body_left == 0) {
+            do {
+                if (!read_line(c, line, sizeof(line))) return -1;   /* trailers */
+            } while (line[0] != '\0');
+            c->body_done = true;
+            return 0;
+        }
+    }
+    if (c->rx_pos == c->rx_len && !fill(c)) {
+        if (c->content_length < 0 && !c->chunked && c->last_tls_error == ESP_ERR_ESP_TLS_TCP_CLOSED_FIN) {
+            c->body_done = true;   /* cuerpo hasta el cierre: el cierre es el final */
+            return 0;
+        }
+        return -1;
+    }
+    int n = c->rx_len - c->rx_pos;
+    if (n > len) n = len;
+    if (c->body_left >= 0 && n > c->body_left) n = (int)c->body_left;
+    memcpy(dst, c->rx + c->rx_pos, (size_t)n);
+    c->rx_pos += n;
+    if (c->body_left >= 0) {
+        c->body_left -= n;
+        if (c->body_left == 0) {
+            if (c->chunked) {
+                char crlf[4];
+                if (!read_line(c, crlf, sizeof(crlf))) return -1;
+            } else {
+                c->body_done = true;
+            }
+        }
+    }
+    return n;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t c, int write_len)
+{
+    esp_err_t err = connect_if_needed(c);
+    if (err != ESP_OK) return err;
+    return send_head(c, write_len);
+}
+
+int esp_http_client_write(esp_http_client_handle_t c, const char *buffer, int len)
+{
+    if (!c->tls) return -1;
+    return write_all(c, buffer, (size_t)len) ? len : -1;
+}
+
+/* Como en IDF: no vuelve hasta llenar len, acabar el cuerpo o fallar la lectura */
+int esp_http_client_read(esp_http_client_handle_t c, char *buffer, int len)
+{
+    int got = 0;
+    while (got < len) {
+        int n = read_body(c, buffer + got, len - got);
+        if (n < 0) {
+            if (got == 0) return ESP_FAIL;
+            break;
+        }
+        if (n == 0) break;
+        got += n;
+    }
+    return got;
+}
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t c)
+{
+    if (c->location[0] == '\0') return ESP_ERR_INVALID_ARG;
+    dispatch(c, HTTP_EVENT_REDIRECT, NULL, 0, NULL, NULL);
+    return esp_http_client_set_url(c, c->location);
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t c)
+{
+    esp_err_t err = connect_if_needed(c);
+    if (err != ESP_OK) return err;
+    err = send_head(c, c->post_len);
+    if (err != ESP_OK) return err;
+    if (c->post_len > 0 && !write_all(c, c->post_data, (size_t)c->post_len)) {
+        esp_http_client_close(c);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    if (esp_http_client_fetch_headers(c) < 0) return ESP_ERR_HTTP_FETCH_HEADER;
+
+    char *buf = malloc((size_t)c->buffer_size);
+    if (!buf) return ESP_ERR_NO_MEM;
+    int n;
+    while ((n = read_body(c, buf, c->buffer_size)) > 0) dispatch(c, HTTP_EVENT_ON_DATA, buf, n, NULL, NULL);
+    free(buf);
+    if (n < 0) {
+        fail_io(c);
+        return ESP_ERR_HTTP_INCOMPLETE_DATA;
+    }
+    dispatch(c, HTTP_EVENT_ON_FINISH, NULL, 0, NULL, NULL);
+    if (!c->keep_alive) esp_http_client_close(c);
+    return ESP_OK;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+#include <zlib.h>
+
+/* El CRC32 de la ROM es el mismo que el de zlib (polinomio reflejado, crc inicial 0) */
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    return (uint32_t)crc32(crc, buf, len);
+}
@@ -0,0 +1,61 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "esp_crt_bundle.h"
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_tls.h"
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static pthread_mutex_t s_random_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uint32_t esp_random(void)
+{
+    static unsigned short seed[3] = { 0x1234, 0x5678, 0x9abc };   /* fija: los tests se repiten igual */
+    pthread_mutex_lock(&s_random_lock);
+    uint32_t r = (uint32_t)jrand48(seed);
+    pthread_mutex_unlock(&s_random_lock);
+    return r;
+}
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+    return ESP_OK;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                                    return "ESP_OK";
+    case ESP_FAIL:                                  return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:                            return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:                       return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:                     return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:                      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:                         return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:                     return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:                           return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_HTTP_CONNECT:                      return "ESP_ERR_HTTP_CONNECT";
+    case ESP_ERR_HTTP_WRITE_DATA:                   return "ESP_ERR_HTTP_WRITE_DATA";
+    case ESP_ERR_HTTP_FETCH_HEADER:                 return "ESP_ERR_HTTP_FETCH_HEADER";
+    case ESP_ERR_HTTP_INVALID_TRANSPORT:            return "ESP_ERR_HTTP_INVALID_TRANSPORT";
+    case ESP_ERR_HTTP_EAGAIN:                       return "ESP_ERR_HTTP_EAGAIN";
+    case ESP_ERR_HTTP_INCOMPLETE_DATA:              return "ESP_ERR_HTTP_INCOMPLETE_DATA";
+    case ESP_ERR_ESP_TLS_CANNOT_RESOLVE_HOSTNAME:   return "ESP_ERR_ESP_TLS_CANNOT_RESOLVE_HOSTNAME";
+    case ESP_ERR_ESP_TLS_FAILED_CONNECT_TO_HOST:    return "ESP_ERR_ESP_TLS_FAILED_CONNECT_TO_HOST";
+    case ESP_ERR_ESP_TLS_CONNECTION_TIMEOUT:        return "ESP_ERR_ESP_TLS_CONNECTION_TIMEOUT";
+    case ESP_ERR_ESP_TLS_TCP_CLOSED_FIN:            return "ESP_ERR_ESP_TLS_TCP_CLOSED_FIN";
+    case ESP_TLS_ERR_SSL_WANT_READ:                 return "ESP_TLS_ERR_SSL_WANT_READ";
+    case ESP_TLS_ERR_SSL_WANT_WRITE:                return "ESP_TLS_ERR_SSL_WANT_WRITE";
+    default:                                        return "ESP_ERR";
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "esp_err.h"
+
+/* esp-tls sobre TCP plano (posix/esp_tls_posix.c): en el PC no hay TLS, sólo is_plain_tcp */
+
+#define ESP_ERR_ESP_TLS_BASE                        0x8000
+#define ESP_ERR_ESP_TLS_CANNOT_RESOLVE_HOSTNAME     (ESP_ERR_ESP_TLS_BASE + 0x01)
+#define ESP_ERR_ESP_TLS_CANNOT_CREATE_SOCKET        (ESP_ERR_ESP_TLS_BASE + 0x02)
+#define ESP_ERR_ESP_TLS_UNSUPPORTED_PROTOCOL_FAMILY (ESP_ERR_ESP_TLS_BASE + 0x03)
+#define ESP_ERR_ESP_TLS_FAILED_CONNECT_TO_HOST      (ESP_ERR_ESP_TLS_BASE + 0x04)
+#define ESP_ERR_ESP_TLS_SOCKET_SETOPT_FAILED        (ESP_ERR_ESP_TLS_BASE + 0x05)
+#define ESP_ERR_ESP_TLS_CONNECTION_TIMEOUT          (ESP_ERR_ESP_TLS_BASE + 0x06)
+#define ESP_ERR_ESP_TLS_TCP_CLOSED_FIN              (ESP_ERR_ESP_TLS_BASE + 0x07)
+
+/* Lectura/escritura que venció el timeout del socket (mbedTLS WANT_READ/WANT_WRITE) */
+#define ESP_TLS_ERR_SSL_WANT_READ   (-0x6900)
+#define ESP_TLS_ERR_SSL_WANT_WRITE  (-0x6880)
+
+typedef struct esp_tls esp_tls_t;
+
+typedef struct {
+    esp_err_t (*crt_bundle_attach)(void *conf);
+    int timeout_ms;
+    bool is_plain_tcp;
+} esp_tls_cfg_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+esp_tls_t *esp_tls_init(void);
+/* 1 conectado, -1 error (el detalle queda en esp_tls_get_and_clear_last_error) */
+int esp_tls_conn_new_sync(const char *hostname, int hostlen, int port, const esp_tls_cfg_t *cfg, esp_tls_t *tls);
+ssize_t esp_tls_conn_write(esp_tls_t *tls, const void *data, size_t datalen);
+ssize_t esp_tls_conn_read(esp_tls_t *tls, void *data, size_t datalen);
+int esp_tls_conn_destroy(esp_tls_t *tls);
+esp_err_t esp_tls_get_conn_sockfd(esp_tls_t *tls, int *sockfd);
+esp_err_t esp_tls_get_and_clear_last_error(esp_tls_t *tls, int *esp_tls_code, int *esp_tls_flags);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,132 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "esp_tls.h"
+
+struct esp_tls {
+    int fd;
+    esp_err_t last_error;
+};
+
+esp_tls_t *esp_tls_init(void)
+{
+    esp_tls_t *tls = calloc(1, sizeof(*tls));
+    if (tls) tls->fd = -1;
+    return tls;
+}
+
+/* connect() no bloqueante acotado por timeout_ms, como esp-tls con non_block + select */
+static esp_err_t connect_timeout(int fd, const struct sockaddr *addr, socklen_t len, int timeout_ms)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    int r = connect(fd, addr, len);
+    if (r != 0 && errno == EINPROGRESS) {
+        struct pollfd p = { fd, POLLOUT, 0 };
+        r = poll(&p, 1, timeout_ms > 0 ? timeout_ms : -1);
+        if (r == 0) return ESP_ERR_ESP_TLS_CONNECTION_TIMEOUT;
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+        r = (r > 0 && err == 0) ? 0 : -1;
+    }
+    fcntl(fd, F_SETFL, flags);
+    return r == 0 ? ESP_OK : ESP_ERR_ESP_TLS_FAILED_CONNECT_TO_HOST;
+}
+
+int esp_tls_conn_new_sync(const char *hostname, int hostlen, int port, const esp_tls_cfg_t *cfg, esp_tls_t *tls)
+{
+    if (!cfg->is_plain_tcp) {
+        tls->last_error = ESP_ERR_ESP_TLS_UNSUPPORTED_PROTOCOL_FAMILY;
+        return -1;
+    }
+    char host[256];
+    char service[8];
+    snprintf(host, sizeof(host), "%.*s", hostlen, hostname);
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints = { 0 };
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, service, &hints, &res) != 0 || !res) {
+        tls->last_error = ESP_ERR_ESP_TLS_CANNOT_RESOLVE_HOSTNAME;
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0) {
+        freeaddrinfo(res);
+        tls->last_error = ESP_ERR_ESP_TLS_CANNOT_CREATE_SOCKET;
+        return -1;
+    }
+    esp_err_t err = connect_timeout(fd, res->ai_addr, res->ai_addrlen, cfg->timeout_ms);
+    freeaddrinfo(res);
+    if (err != ESP_OK) {
+        close(fd);
+        tls->last_error = err;
+        return -1;
+    }
+    if (cfg->timeout_ms > 0) {
+        struct timeval tv = { cfg->timeout_ms / 1000, (cfg->timeout_ms % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+    tls->fd = fd;
+    return 1;
+}
+
+ssize_t esp_tls_conn_write(esp_tls_t *tls, const void *data, size_t datalen)
+{
+    ssize_t r = send(tls->fd, data, datalen, MSG_NOSIGNAL);
+    if (r >= 0) return r;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        tls->last_error = ESP_ERR_ESP_TLS_CONNECTION_TIMEOUT;
+        return ESP_TLS_ERR_SSL_WANT_WRITE;
+    }
+    tls->last_error = ESP_ERR_ESP_TLS_TCP_CLOSED_FIN;
+    return -1;
+}
+
+ssize_t esp_tls_conn_read(esp_tls_t *tls, void *data, size_t datalen)
+{
+    ssize_t r = recv(tls->fd, data, datalen, 0);
+    if (r >= 0) return r;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        tls->last_error = ESP_ERR_ESP_TLS_CONNECTION_TIMEOUT;
+        return ESP_TLS_ERR_SSL_WANT_READ;
+    }
+    tls->last_error = ESP_ERR_ESP_TLS_TCP_CLOSED_FIN;
+    return -1;
+}
+
+int esp_tls_conn_destroy(esp_tls_t *tls)
+{
+    if (!tls) return -1;
+    if (tls->fd >= 0) close(tls->fd);
+    free(tls);
+    return 0;
+}
+
+esp_err_t esp_tls_get_conn_sockfd(esp_tls_t *tls, int *sockfd)
+{
+    if (!tls || !sockfd) return ESP_ERR_INVALID_ARG;
+    *sockfd = tls->fd;
+    return ESP_OK;
+}
+
+esp_err_t esp_tls_get_and_clear_last_error(esp_tls_t *tls, int *esp_tls_code, int *esp_tls_flags)
+{
+    if (!tls) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = tls->last_error;
+    tls->last_error = ESP_OK;
+    if (esp_tls_code) *esp_tls_code = 0;
+    if (esp_tls_flags) *esp_tls_flags = 0;
+    return err;
+}
@@ -0,0 +1,274 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+/* Una tarea sólo se puede borrar desde fuera mientras espera en una primitiva de FreeRTOS (semáforo,
+ * notificación o vTaskDelay): fuera de ellas la cancelación está desactivada, así nunca se corta a
+ * mitad de una petición. Al cancelar se desenrolla la pila y corren los destructores C++ */
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    pthread_mutex_t m;
+    pthread_cond_t c;
+    uint32_t notify;
+};
+
+/* Mutex, recursivo, contador y binario son el mismo contador; owner/depth sólo cuentan en los mutex */
+struct host_sem {
+    pthread_mutex_t m;
+    pthread_cond_t c;
+    UBaseType_t count;
+    UBaseType_t max;
+    pthread_t owner;
+    UBaseType_t depth;
+};
+
+static __thread struct host_task *s_self;
+
+static void cond_init(pthread_cond_t *c)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(c, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void unlock_mutex(void *m)
+{
+    pthread_mutex_unlock((pthread_mutex_t *)m);
+}
+
+/* Espera en c hasta que ready(ctx) o venza ticks, con m tomado. false si venció */
+static bool wait_until(pthread_mutex_t *m, pthread_cond_t *c, bool (*ready)(void *), void *ctx, TickType_t ticks)
+{
+    const struct timespec until = deadline_after(ticks);
+    bool ok = true;
+    int old;
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old);
+    pthread_cleanup_push(unlock_mutex, m);
+    while (!ready(ctx)) {
+        if (ticks == 0) { ok = false; break; }
+        int r = ticks == portMAX_DELAY ? pthread_cond_wait(c, m) : pthread_cond_timedwait(c, m, &until);
+        if (r == ETIMEDOUT && !ready(ctx)) { ok = false; break; }
+    }
+    pthread_cleanup_pop(0);
+    pthread_setcancelstate(old, NULL);
+    return ok;
+}
+
+static struct host_task *task_new(TaskFunction_t fn, void *arg)
+{
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->fn = fn;
+    t->arg = arg;
+    pthread_mutex_init(&t->m, NULL);
+    cond_init(&t->c);
+    return t;
+}
+
+static void task_free(void *p)
+{
+    struct host_task *t = p;
+    pthread_mutex_destroy(&t->m);
+    pthread_cond_destroy(&t->c);
+    free(t);
+}
+
+static void *task_main(void *p)
+{
+    struct host_task *t = p;
+    s_self = t;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    pthread_cleanup_push(task_free, t);
+    t->fn(t->arg);
+    pthread_cleanup_pop(1);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                       TaskHandle_t *out)
+{
+    struct host_task *t = task_new(fn, arg);
+    if (!t) return pdFAIL;
+    if (out) *out = t;
+    if (pthread_create(&t->thread, NULL, task_main, t) != 0) {
+        task_free(t);
+        if (out) *out = NULL;
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task || task == s_self) {
+        pthread_detach(pthread_self());
+        pthread_exit(NULL);
+    }
+    /* Cancelar y esperar: al volver, la tarea ya no toca nada de quien la borra */
+    pthread_t thread = task->thread;
+    pthread_cancel(thread);
+    pthread_join(thread, NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = { ticks / 1000, (long)(ticks % 1000) * 1000000L };
+    int old;
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old);
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {
+    }
+    pthread_setcancelstate(old, NULL);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    /* Hilos que no creó xTaskCreate (main del test): se les da identidad al primer uso */
+    if (!s_self) {
+        s_self = task_new(NULL, NULL);
+        s_self->thread = pthread_self();
+    }
+    return s_self;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->m);
+    task->notify++;
+    pthread_cond_signal(&task->c);
+    pthread_mutex_unlock(&task->m);
+    return pdPASS;
+}
+
+static bool notified(void *ctx)
+{
+    return ((struct host_task *)ctx)->notify > 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct host_task *t = xTaskGetCurrentTaskHandle();
+    pthread_mutex_lock(&t->m);
+    wait_until(&t->m, &t->c, notified, t, ticks);
+    uint32_t value = t->notify;
+    if (value > 0) t->notify = clear ? 0 : value - 1;
+    pthread_mutex_unlock(&t->m);
+    return value;
+}
+
+static SemaphoreHandle_t sem_new(UBaseType_t max, UBaseType_t initial)
+{
+    struct host_sem *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    pthread_mutex_init(&s->m, NULL);
+    cond_init(&s->c);
+    s->max = max;
+    s->count = initial;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return sem_new(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return sem_new(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return sem_new(max, initial);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return sem_new(1, 0);
+}
+
+static bool available(void *ctx)
+{
+    return ((struct host_sem *)ctx)->count > 0;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    pthread_mutex_lock(&sem->m);
+    bool ok = wait_until(&sem->m, &sem->c, available, sem, ticks);
+    if (ok) {
+        sem->count--;
+        sem->owner = pthread_self();
+        sem->depth = 1;
+    }
+    pthread_mutex_unlock(&sem->m);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->m);
+    bool ok = sem->count < sem->max;
+    if (ok) {
+        sem->count++;
+        sem->depth = 0;
+        pthread_cond_signal(&sem->c);
+    }
+    pthread_mutex_unlock(&sem->m);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    pthread_mutex_lock(&sem->m);
+    if (sem->depth > 0 && pthread_equal(sem->owner, pthread_self())) {
+        sem->depth++;
+        pthread_mutex_unlock(&sem->m);
+        return pdTRUE;
+    }
+    pthread_mutex_unlock(&sem->m);
+    return xSemaphoreTake(sem, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->m);
+    if (sem->depth == 0 || !pthread_equal(sem->owner, pthread_self())) {
+        pthread_mutex_unlock(&sem->m);
+        return pdFALSE;
+    }
+    bool last = --sem->depth == 0;
+    pthread_mutex_unlock(&sem->m);
+    return last ? xSemaphoreGive(sem) : pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    if (!sem) return;
+    pthread_mutex_destroy(&sem->m);
+    pthread_cond_destroy(&sem->c);
+    free(sem);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Con HOST_LOG=1 en el entorno los logs salen por stdout; si no, sólo se comprueba el formato */
+#define HOST_LOG(level, tag, fmt, ...) \
+    do { if (getenv("HOST_LOG")) printf("%c (%s) " fmt "\n", level, tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG('E', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG('W', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG('I', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG('D', tag, fmt, ##__VA_ARGS__)
@@ -0,0 +1,9 @@
+#pragma once
+#include "esp_err.h"
+
+/* Lo justo de esp_modem para modem_at.c; el DCE es opaco */
+typedef struct esp_modem_dce_wrap esp_modem_dce_t;
+typedef esp_err_t (*esp_modem_command_cb)(uint8_t *data, size_t len);
+
+esp_err_t esp_modem_command(esp_modem_dce_t *dce, const char *command, esp_modem_command_cb got_line, uint32_t timeout_ms);
+esp_err_t esp_modem_set_urc(esp_modem_dce_t *dce, esp_err_t (*got_line)(uint8_t *data, size_t len));
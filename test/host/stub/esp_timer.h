@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* Reloj virtual de host_rtos.c, o real (monotónico) en posix/ */
+int64_t esp_timer_get_time(void);
+#ifdef __cplusplus
+}
+#endif
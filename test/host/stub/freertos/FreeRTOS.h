@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define portMAX_DELAY       0xffffffffu
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))     // tick de 1 ms
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+
+#define BIT0 0x01
+#define BIT1 0x02
+#define BIT2 0x04
+#define BIT3 0x08
+#define BIT4 0x10
+#define BIT5 0x20
+
+/* Un solo hilo: las secciones críticas no hacen nada */
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define taskENTER_CRITICAL(mux) (void)(mux)
+#define taskEXIT_CRITICAL(mux)  (void)(mux)
@@ -0,0 +1,3 @@
+#pragma once
+// Credenciales de mentira para compilar en el PC (ver main/Privado.example.h)
+#define DEVICE_ID "host-0001"
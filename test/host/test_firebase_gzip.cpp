@@ -0,0 +1,147 @@
+/* Compresión de cuerpos contra un servidor local que, como RTDB, no acepta Content-Encoding: gzip y
+ * responde 400. El cuerpo gzip se descomprime con zlib y debe ser idéntico al plano que se reenvía;
+ * tras el rechazo la compresión queda apagada, tanto por performRequest como en un lote segmentado */
+#include <zlib.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rtdb.h"
+#include "http_standin.h"
+#include "host_test.h"
+
+using namespace ESPFirebase;
+
+#define THRESHOLD 64
+#define BATCH 6
+
+struct seen_t {
+    std::string path;
+    bool gzip;
+    std::string body;   // descomprimido si iba en gzip
+};
+
+static std::mutex s_mutex;
+static std::vector<seen_t> s_seen;
+static int s_bad_gzip;
+
+static bool gunzip(const std::string& in, std::string& out)
+{
+    z_stream zs = {};
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) return false;
+    zs.next_in = (Bytef*)in.data();
+    zs.avail_in = (uInt)in.size();
+    char buf[4096];
+    int r;
+    do {
+        zs.next_out = (Bytef*)buf;
+        zs.avail_out = sizeof(buf);
+        r = inflate(&zs, Z_NO_FLUSH);
+        out.append(buf, sizeof(buf) - zs.avail_out);
+    } while (r == Z_OK);
+    inflateEnd(&zs);
+    return r == Z_STREAM_END && zs.avail_in == 0;
+}
+
+static standin_response_t handle(const standin_request_t& req)
+{
+    standin_response_t res;
+    if (standinAuth(req, res)) return res;
+
+    auto enc = req.headers.find("content-encoding");
+    seen_t seen = { req.path.substr(0, req.path.find('?')), enc != req.headers.end() && enc->second == "gzip", "" };
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (seen.gzip) {
+        if (!gunzip(req.body, seen.body)) s_bad_gzip++;
+        res.status = 400;
+        res.body = "{\"error\":\"Invalid data; couldn't parse JSON object, array, or value.\"}";
+    } else {
+        seen.body = req.body;
+        res.status = 204;
+    }
+    s_seen.push_back(seen);
+    return res;
+}
+
+/* Registro repetitivo, como un backlog de medidas: comprime bien y pasa del umbral */
+static std::string record(int n)
+{
+    std::string s = "{\"n\":" + std::to_string(n) + ",\"medidas\":[";
+    for (int i = 0; i < 12; ++i) s += std::string(i ? "," : "") + "{\"pm2p5\":5.87,\"co2\":612,\"temp\":21.4}";
+    return s + "]}";
+}
+
+/* Todo lo recibido para path (gzip descomprimido o plano) es body, y al final llegó plano */
+static void checkResent(const std::string& path, const std::string& body)
+{
+    int plain = 0;
+    for (const seen_t& s : s_seen) {
+        if (s.path != path) continue;
+        CHECK(s.body == body);
+        plain += !s.gzip;
+    }
+    CHECK(plain == 1);
+}
+
+int main(void)
+{
+    HttpStandin server(handle);
+    FirebaseApp app("host-key");
+    app.useAuthEmulator(server.url("").c_str());
+    CHECK(app.loginUserAccount({ "sensor@example.com", "secreto" }) == ESP_OK);
+    RTDB db(&app, server.url("").c_str());
+
+    /* performRequest: el 400 al gzip reenvía plano al momento y apaga la compresión */
+    app.setRequestCompression(THRESHOLD);
+    std::string body = record(0);
+    CHECK(db.putData("/lote/0", body.c_str()) == ESP_OK);
+    CHECK(db.putData("/lote/1", record(1).c_str()) == ESP_OK);
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        CHECK(s_seen.size() == 3);
+        if (s_seen.size() == 3) {
+            CHECK(s_seen[0].gzip && s_seen[0].path == "/lote/0.json");
+            CHECK(!s_seen[1].gzip && s_seen[1].path == "/lote/0.json");
+            CHECK(!s_seen[2].gzip && s_seen[2].path == "/lote/1.json");
+        }
+        checkResent("/lote/0.json", body);
+    }
+    compression_metrics_t m = app.getCompressionMetrics();
+    CHECK(m.compressed == 1 && m.rejected == 1);
+    printf("performRequest: %u B -> %u B en gzip, rechazado y reenviado plano\n", (unsigned)m.raw_bytes, (unsigned)m.wire_bytes);
+
+    /* Lote segmentado: las que iban comprimidas en vuelo reciben 400 y salen en serie sin gzip;
+     * las siguientes ya se escriben planas */
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_seen.clear();
+    }
+    app.setRequestCompression(THRESHOLD);
+    app.setPipelineWindow(4);
+    std::vector<std::string> paths(BATCH);
+    std::vector<std::string> bodies(BATCH);
+    std::vector<rtdb_write_item_t> items(BATCH);
+    for (int i = 0; i < BATCH; ++i) {
+        paths[i] = "/backlog/" + std::to_string(i);
+        bodies[i] = record(100 + i);
+        items[i] = { paths[i].c_str(), bodies[i].c_str(), ESP_FAIL };
+    }
+    CHECK(db.writeBatch(HTTP_METHOD_PUT, items.data(), items.size()) == BATCH);
+    int gzipped = 0;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        for (int i = 0; i < BATCH; ++i) checkResent(paths[i] + ".json", bodies[i]);
+        for (const seen_t& s : s_seen) gzipped += s.gzip;
+        CHECK(s_seen.size() == (size_t)(BATCH + gzipped));
+    }
+    /* Como mucho la ventana entera salió comprimida antes de leer el primer rechazo */
+    CHECK(gzipped >= 1 && gzipped <= 4);
+    m = app.getCompressionMetrics();
+    CHECK(m.rejected == 2);
+    pipeline_metrics_t pm = app.getPipelineMetrics();
+    CHECK(pm.serial == (uint32_t)gzipped);
+    printf("lote de %d: %d en gzip rechazadas y reenviadas en serie, %u segmentadas\n", BATCH, gzipped, (unsigned)pm.pipelined);
+
+    CHECK(s_bad_gzip == 0);
+    return test_result("firebase_gzip");
+}
@@ -0,0 +1,160 @@
+/* Varias tareas usan el mismo FirebaseApp a la vez: lecturas, subidas de medidas y borrados de
+ * retención contra el servidor local. Cada respuesta debe llegar entera a la tarea que la pidió y
+ * nunca debe haber más peticiones en vuelo que contextos en el pool */
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "rtdb.h"
+#include "http_standin.h"
+#include "host_test.h"
+
+using namespace ESPFirebase;
+
+#define REQUESTS_PER_TASK 30
+#define READERS 2
+
+static std::atomic<int> s_in_flight;
+static std::atomic<int> s_max_in_flight;
+static std::mutex s_store_mutex;
+static std::map<std::string, std::string> s_store;   // cuerpos de los PUT por ruta
+static std::atomic<int> s_deleted;
+
+/* /lecturas/<tarea>/<n>.json -> {"tarea":t,"n":n,"relleno":"..."} con un cuerpo de varios trozos */
+static std::string readingBody(int task, int n)
+{
+    return "{\"tarea\":" + std::to_string(task) + ",\"n\":" + std::to_string(n) + ",\"relleno\":\"" +
+           std::string((size_t)(n * 97 % 3000), (char)('a' + task)) + "\"}";
+}
+
+static standin_response_t handle(const standin_request_t& req)
+{
+    standin_response_t res;
+    if (standinAuth(req, res)) return res;
+
+    int now = ++s_in_flight;
+    int seen = s_max_in_flight;
+    while (now > seen && !s_max_in_flight.compare_exchange_weak(seen, now)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1 + (int)(req.path.size() % 4)));
+
+    std::string path = req.path.substr(0, req.path.find(".json"));
+    int task, n;
+    if (req.method == "GET" && sscanf(path.c_str(), "/lecturas/%d/%d", &task, &n) == 2) {
+        res.body = readingBody(task, n);
+    } else if (req.method == "PUT") {
+        std::lock_guard<std::mutex> lock(s_store_mutex);
+        s_store[path] = req.body;
+        res.status = 204;
+    } else if (req.method == "DELETE") {
+        s_deleted++;
+        res.body = "null";
+    } else {
+        res.status = 404;
+    }
+    s_in_flight--;
+    return res;
+}
+
+struct task_arg_t {
+    RTDB* db;
+    int index;
+    std::atomic<int> failures;
+    SemaphoreHandle_t done;
+};
+
+static void readerTask(void* p)
+{
+    task_arg_t* arg = static_cast<task_arg_t*>(p);
+    for (int n = 0; n < REQUESTS_PER_TASK; ++n) {
+        std::string path = "/lecturas/" + std::to_string(arg->index) + "/" + std::to_string(n);
+        Json::Value v = arg->db->getData(path.c_str());
+        std::string expected((size_t)(n * 97 % 3000), (char)('a' + arg->index));
+        if (v["tarea"].asInt() != arg->index || v["n"].asInt() != n || v["relleno"].asString() != expected) {
+            arg->failures++;
+        }
+    }
+    xSemaphoreGive(arg->done);
+    vTaskDelete(NULL);
+}
+
+static void uploaderTask(void* p)
+{
+    task_arg_t* arg = static_cast<task_arg_t*>(p);
+    for (int n = 0; n < REQUESTS_PER_TASK; ++n) {
+        Json::Value record(Json::objectValue);
+        record.emplace("n", Json::Value(n));
+        record.emplace("pm2p5", Json::Value(n * 0.5));
+        record.emplace("fecha", Json::Value("2024-10-01"));
+        std::string path = "/medidas/" + std::to_string(n);
+        if (arg->db->putData(path.c_str(), std::move(record)) != ESP_OK) arg->failures++;
+    }
+    xSemaphoreGive(arg->done);
+    vTaskDelete(NULL);
+}
+
+static void retentionTask(void* p)
+{
+    task_arg_t* arg = static_cast<task_arg_t*>(p);
+    for (int n = 0; n < REQUESTS_PER_TASK; ++n) {
+        std::string path = "/dias/2024-09-" + std::to_string(n);
+        if (arg->db->deleteData(path.c_str()) != ESP_OK) arg->failures++;
+    }
+    xSemaphoreGive(arg->done);
+    vTaskDelete(NULL);
+}
+
+int main(void)
+{
+    HttpStandin server(handle);
+    FirebaseApp app("host-key");
+    app.useAuthEmulator(server.url("").c_str());
+    CHECK(app.loginUserAccount({ "sensor@example.com", "secreto" }) == ESP_OK);
+    RTDB db(&app, server.url("").c_str());
+
+    const int tasks = READERS + 2;
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(tasks, 0);
+    task_arg_t args[tasks];
+    for (int i = 0; i < tasks; ++i) {
+        args[i].db = &db;
+        args[i].index = i;
+        args[i].failures = 0;
+        args[i].done = done;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < READERS; ++i) xTaskCreate(readerTask, "lector", 8192, &args[i], 5, NULL);
+    xTaskCreate(uploaderTask, "subida", 8192, &args[READERS], 5, NULL);
+    xTaskCreate(retentionTask, "retencion", 8192, &args[READERS + 1], 5, NULL);
+    int finished = 0;
+    while (finished < tasks && xSemaphoreTake(done, pdMS_TO_TICKS(60000)) == pdTRUE) finished++;
+    auto t1 = std::chrono::steady_clock::now();
+    CHECK(finished == tasks);
+
+    for (int i = 0; i < tasks; ++i) CHECK(args[i].failures == 0);
+    CHECK(s_deleted == REQUESTS_PER_TASK);
+    {
+        std::lock_guard<std::mutex> lock(s_store_mutex);
+        std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+        CHECK(s_store.size() == REQUESTS_PER_TASK);
+        for (int n = 0; n < REQUESTS_PER_TASK; ++n) {
+            const std::string& got = s_store["/medidas/" + std::to_string(n)];
+            Json::Value v;
+            CHECK(reader->parse(got.data(), got.data() + got.size(), &v, nullptr));
+            CHECK(v["n"].asInt() == n && v["pm2p5"].asDouble() == n * 0.5 && v["fecha"].asString() == "2024-10-01");
+        }
+    }
+    /* El pool limita la concurrencia, y con 4 tareas se llega a usar entero */
+    CHECK(s_max_in_flight <= FIREBASE_HTTP_POOL_SIZE);
+    CHECK(s_max_in_flight == FIREBASE_HTTP_POOL_SIZE);
+
+    printf("%d tareas x %d peticiones en %ld ms: %d conexiones, máximo %d en vuelo (pool de %d)\n", tasks,
+           REQUESTS_PER_TASK, (long)std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count(),
+           server.connections(), s_max_in_flight.load(), FIREBASE_HTTP_POOL_SIZE);
+    vSemaphoreDelete(done);
+    return test_result("firebase_pool");
+}
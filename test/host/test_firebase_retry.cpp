@@ -0,0 +1,176 @@
+/* Reintentos de FirebaseApp::performRequest contra un servidor local que inyecta fallos: 5xx, 4xx,
+ * 429 con Retry-After, cuelgues, cierres sin respuesta, conexión rechazada y DNS. Mide cuánto
+ * bloquea cada caso y comprueba que nunca pasa del presupuesto (deadline o timeout HTTP) */
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "app.h"
+#include "http_standin.h"
+#include "host_test.h"
+
+using namespace ESPFirebase;
+
+/* Margen sobre el presupuesto: planificador, connect y cierre de sockets en el PC */
+#define SLACK_MS 250
+
+static standin_response_t reply(int status, const char *body = "{}")
+{
+    standin_response_t r;
+    r.status = status;
+    r.body = body;
+    return r;
+}
+
+/* Responde el guion en orden; agotado, repite la última respuesta */
+static HttpStandin::handler_t scripted(std::vector<standin_response_t> script)
+{
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    return [script, next](const standin_request_t &) {
+        size_t i = (*next)++;
+        return script[i < script.size() ? i : script.size() - 1];
+    };
+}
+
+/* Puerto en el que nadie escucha: se enlaza uno efímero y se suelta */
+static int closedPort(void)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    getsockname(fd, (struct sockaddr *)&addr, &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+struct outcome_t {
+    http_ret_t ret;
+    long ms;
+};
+
+static outcome_t run(FirebaseApp &app, const std::string &url, esp_http_client_method_t method = HTTP_METHOD_GET,
+                     const std::string &body = "")
+{
+    auto t0 = std::chrono::steady_clock::now();
+    http_ret_t ret = app.performRequest(url.c_str(), method, body);
+    auto t1 = std::chrono::steady_clock::now();
+    return { ret, (long)std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() };
+}
+
+static long s_worst_over_ms = -1000000;
+
+static void report(const char *name, const outcome_t &o, int requests, int budget_ms)
+{
+    printf("%-28s status=%4d err=0x%04x peticiones=%d %5ld ms (presupuesto %d ms)\n", name, o.ret.status_code,
+           (unsigned)o.ret.err, requests, o.ms, budget_ms);
+    if (o.ms - budget_ms > s_worst_over_ms) s_worst_over_ms = o.ms - budget_ms;
+}
+
+int main(void)
+{
+    FirebaseApp app("host-key");
+    const retry_policy_t policy = { 5, 20, 200, 1500 };   // deadline 1,5 s
+    app.setRetryPolicy(policy);
+    app.setHttpTimeoutMs(400);
+    const int budget_ms = policy.deadline_ms;
+
+    {
+        HttpStandin server(scripted({ reply(503), reply(503), reply(200, "{\"ok\":1}") }));
+        outcome_t o = run(app, server.url("/a.json"));
+        report("503, 503, 200", o, server.requests(), budget_ms);
+        CHECK(o.ret.err == ESP_OK && o.ret.status_code == 200);
+        CHECK(o.ret.error_class == http_error_class_t::none);
+        CHECK(server.requests() == 3);
+        CHECK(strcmp(app.responseBuffer(), "{\"ok\":1}") == 0);
+    }
+    {
+        HttpStandin server(scripted({ reply(400, "{\"error\":\"bad\"}") }));
+        outcome_t o = run(app, server.url("/a.json"), HTTP_METHOD_PUT, "{\"v\":1}");
+        report("400 (sin reintento)", o, server.requests(), budget_ms);
+        CHECK(o.ret.status_code == 400 && o.ret.error_class == http_error_class_t::client_error);
+        CHECK(server.requests() == 1);
+    }
+    {
+        /* Retry-After manda sobre el backoff (20 ms): el segundo intento sale ~1 s después */
+        standin_response_t throttled = reply(429);
+        throttled.headers.push_back({ "Retry-After", "1" });
+        HttpStandin server(scripted({ throttled, reply(200) }));
+        outcome_t o = run(app, server.url("/a.json"));
+        report("429 Retry-After: 1", o, server.requests(), budget_ms);
+        CHECK(o.ret.status_code == 200 && server.requests() == 2);
+        CHECK(o.ms >= 1000);
+    }
+    {
+        /* Retry-After más largo que el presupuesto: no se espera para nada */
+        standin_response_t throttled = reply(429);
+        throttled.headers.push_back({ "Retry-After", "30" });
+        HttpStandin server(scripted({ throttled }));
+        outcome_t o = run(app, server.url("/a.json"));
+        report("429 Retry-After: 30", o, server.requests(), budget_ms);
+        CHECK(o.ret.error_class == http_error_class_t::throttled && server.requests() == 1);
+        CHECK(o.ms < 500);
+    }
+    {
+        standin_response_t stall;
+        stall.stall = true;
+        HttpStandin server(scripted({ stall }));
+        outcome_t o = run(app, server.url("/a.json"));
+        report("servidor colgado", o, server.requests(), budget_ms);
+        CHECK(o.ret.err != ESP_OK && o.ret.error_class == http_error_class_t::transport);
+        CHECK(server.requests() >= 3);   // 400 ms por intento dentro de 1,5 s
+        CHECK(o.ms <= budget_ms + SLACK_MS);
+    }
+    {
+        /* Responde tarde: más que el timeout, menos que el presupuesto */
+        standin_response_t slow = reply(200);
+        slow.delay_ms = 600;
+        HttpStandin server(scripted({ slow }));
+        outcome_t o = run(app, server.url("/a.json"));
+        report("respuesta a 600 ms", o, server.requests(), budget_ms);
+        CHECK(o.ret.err != ESP_OK);
+        CHECK(o.ms <= budget_ms + SLACK_MS);
+    }
+    {
+        standin_response_t drop;
+        drop.drop = true;
+        HttpStandin server(scripted({ drop, reply(200) }));
+        outcome_t o = run(app, server.url("/a.json"), HTTP_METHOD_PATCH, "{\"v\":2}");
+        report("cierre sin respuesta, 200", o, server.requests(), budget_ms);
+        CHECK(o.ret.status_code == 200 && server.requests() == 2);
+    }
+    {
+        std::string url = "http://127.0.0.1:" + std::to_string(closedPort()) + "/a.json";
+        outcome_t o = run(app, url);
+        report("conexión rechazada", o, 0, budget_ms);
+        CHECK(o.ret.err == ESP_ERR_HTTP_CONNECT && o.ret.error_class == http_error_class_t::transport);
+        CHECK(o.ms <= budget_ms + SLACK_MS);
+    }
+    {
+        outcome_t o = run(app, "http://firebase.invalid/a.json");
+        report("DNS", o, 0, budget_ms);
+        CHECK(o.ret.err == ESP_ERR_HTTP_CONNECT && o.ret.error_class == http_error_class_t::dns);
+        CHECK(o.ms <= budget_ms + SLACK_MS);
+    }
+    {
+        /* Timeout HTTP mayor que el deadline: manda el timeout (un intento completo) */
+        app.setHttpTimeoutMs(2000);
+        standin_response_t stall;
+        stall.stall = true;
+        HttpStandin server(scripted({ stall }));
+        outcome_t o = run(app, server.url("/a.json"));
+        report("colgado, timeout > deadline", o, server.requests(), 2000);
+        CHECK(server.requests() == 1);
+        CHECK(o.ms >= 1900 && o.ms <= 2000 + SLACK_MS);
+        app.setHttpTimeoutMs(400);
+    }
+
+    printf("peor caso: %+ld ms sobre el presupuesto\n", s_worst_over_ms);
+    return test_result("firebase_retry");
+}
@@ -0,0 +1,217 @@
+/* Corpus de respuestas AT reales (SIM7600/A7670, SIM800) para los parsers y los contextos de
+ * comando de modem_at.c. Sin IDF: host_rtos.c y los stubs de stub/ */
+#include <stdio.h>
+#include <string.h>
+
+#include "modem_at.h"
+
+static int s_fails;
+#define CHECK(cond) do { if (!(cond)) { printf("FALLO %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fails++; } } while (0)
+
+/* ===== esp_modem falso: entrega la respuesta en trozos de CHUNK bytes ===== */
+#define CHUNK 5
+
+static const char *s_reply;
+static bool        s_cumulative;   // algunas versiones de esp_modem pasan el buffer acumulado
+
+esp_err_t esp_modem_command(esp_modem_dce_t *dce, const char *command, esp_modem_command_cb got_line, uint32_t timeout_ms)
+{
+    (void)dce; (void)command; (void)timeout_ms;
+    size_t n = strlen(s_reply);
+    for (size_t end = CHUNK; ; end += CHUNK) {
+        if (end > n) end = n;
+        size_t start = s_cumulative ? 0 : (end - 1) / CHUNK * CHUNK;
+        esp_err_t r = got_line((uint8_t *)s_reply + start, end - start);
+        if (r != ESP_ERR_TIMEOUT) return r;
+        if (end == n) return ESP_ERR_TIMEOUT;
+    }
+}
+
+esp_err_t esp_modem_set_urc(esp_modem_dce_t *dce, esp_err_t (*got_line)(uint8_t *data, size_t len))
+{
+    (void)dce; (void)got_line;
+    return ESP_OK;
+}
+
+static void test_cpsi(void)
+{
+    modem_cpsi_t c;
+    CHECK(modem_at_parse_cpsi("AT+CPSI?\r\r\n+CPSI: LTE,Online,334-20,0x232,43790378,55,EUTRAN-BAND5,2525,5,5,-94,-1029,-726,15\r\n\r\nOK\r\n", &c));
+    CHECK(c.valid && c.online && c.rat == MODEM_RAT_LTE && c.mcc == 334 && c.mnc == 20);
+    CHECK(c.lac == 0x232 && c.cell_id == 43790378 && c.band == 5);
+    CHECK(c.pci == 55 && c.arfcn == 2525 && c.signal_dbm == -102);
+
+    CHECK(modem_at_parse_cpsi("+CPSI: GSM,Online,334-20,0x19,31925,733 PCS 1900,-72,0,30-30", &c));
+    CHECK(c.valid && c.rat == MODEM_RAT_GSM && c.lac == 0x19 && c.cell_id == 31925);
+    CHECK(c.pci == -1 && c.arfcn == 733 && c.signal_dbm == -72);
+
+    CHECK(modem_at_parse_cpsi("+CPSI: WCDMA,Online,310-260,0xA1B,12345678,WCDMA IMT 2000,288,10713,0,10.5,66,13,11,500", &c));
+    CHECK(c.valid && c.rat == MODEM_RAT_WCDMA && c.mcc == 310 && c.mnc == 260);
+    CHECK(c.pci == 288 && c.arfcn == 10713 && c.signal_dbm == -66);
+
+    /* Truncada tras la banda: válida, sin PCI extra */
+    CHECK(modem_at_parse_cpsi("+CPSI: LTE,Online,334-20,0x232,43790378,55,EUTRAN-BAND5", &c));
+    CHECK(c.valid && c.pci == 55 && c.arfcn == -1 && c.signal_dbm == 0);
+
+    /* Sin servicio, banda 0 o MCC nulo: se parsea pero no es válida */
+    CHECK(modem_at_parse_cpsi("+CPSI: NO SERVICE,Online", &c) && !c.valid);
+    CHECK(modem_at_parse_cpsi("+CPSI: LTE,Online,334-20,0x232,43790378,55,EUTRAN-BAND0,0", &c) && !c.valid);
+    CHECK(!modem_at_parse_cpsi("+CPSI: LTE,Online,000-00,0x0,0,0,EUTRAN-BAND5", &c) || !c.valid);
+    CHECK(!modem_at_parse_cpsi("OK", &c));
+    CHECK(!modem_at_parse_cpsi("", &c));
+}
+
+static void test_csq(void)
+{
+    modem_csq_t q;
+    CHECK(modem_at_parse_csq("\r\n+CSQ: 21,99\r\n\r\nOK\r\n", &q) && q.rssi == 21 && q.ber == 99 && q.dbm == -71);
+    CHECK(modem_at_parse_csq("+CSQ: 0,0", &q) && q.dbm == -113);
+    CHECK(modem_at_parse_csq("+CSQ: 99,99", &q) && q.dbm == 0);
+    CHECK(!modem_at_parse_csq("+CSQ:", &q));
+    CHECK(!modem_at_parse_csq("ERROR", &q));
+}
+
+static void test_cereg(void)
+{
+    modem_cereg_t r;
+    /* URC (sin <n>) */
+    CHECK(modem_at_parse_cereg("+CEREG: 5", &r) && r.n == -1 && r.stat == 5 && r.tac == 0 && r.act == -1);
+    CHECK(modem_at_parse_cereg("+CEREG: 1,\"0232\",\"029C3A2A\",7", &r));
+    CHECK(r.n == -1 && r.stat == 1 && r.tac == 0x232 && r.ci == 0x29C3A2A && r.act == 7);
+    /* Respuestas a AT+CEREG? con n = 0, 1 y 2 */
+    CHECK(modem_at_parse_cereg("\r\n+CEREG: 0,1\r\n\r\nOK\r\n", &r) && r.n == 0 && r.stat == 1);
+    CHECK(modem_at_parse_cereg("+CEREG: 1,2", &r) && r.n == 1 && r.stat == 2);
+    CHECK(modem_at_parse_cereg("+CEREG: 2,1,\"0232\",\"029C3A2A\",7", &r));
+    CHECK(r.n == 2 && r.stat == 1 && r.tac == 0x232 && r.ci == 0x29C3A2A && r.active_time_s == -1);
+    /* n = 4: temporizadores PSM concedidos (10 s activo, TAU 1 h) */
+    CHECK(modem_at_parse_cereg("\r\n+CEREG: 4,1,\"0232\",\"029C3A2A\",7,,,\"00000101\",\"00100001\"\r\n\r\nOK\r\n", &r));
+    CHECK(r.n == 4 && r.stat == 1 && r.act == 7 && r.active_time_s == 10 && r.periodic_tau_s == 3600);
+    CHECK(modem_at_parse_cereg("+CEREG: 4,1,\"0232\",\"029C3A2A\",7,,,\"11100000\",\"11100000\"", &r));
+    CHECK(r.active_time_s == -1 && r.periodic_tau_s == -1);
+    CHECK(!modem_at_parse_cereg("+CREG: 0,1", &r));
+}
+
+static void test_cops(void)
+{
+    modem_cops_t o;
+    CHECK(modem_at_parse_cops("+COPS: 0,0,\"Telcel\",7", &o) && o.mode == 0 && o.format == 0 && !strcmp(o.oper, "Telcel") && o.act == 7);
+    CHECK(modem_at_parse_cops("+COPS: 0,2,\"33420\",7", &o) && o.format == 2 && !strcmp(o.oper, "33420"));
+    CHECK(modem_at_parse_cops("+COPS: 0", &o) && o.format == -1 && o.act == -1);
+    CHECK(modem_at_parse_cops("+COPS: 0,0,\"Un operador con un nombre demasiado largo\",7", &o) && strlen(o.oper) < sizeof(o.oper));
+}
+
+static void test_ceng(void)
+{
+    modem_neighbors_t nb;
+    const char *sim800 =
+        "AT+CENG?\r\r\n+CENG: 1,1\r\n\r\n"
+        "+CENG: 0,\"0024,43,00,334,020,35,0a7b,05,05,0019,0\"\r\n"
+        "+CENG: 1,\"0021,32,34,0a7c,334,020,0019\"\r\n"
+        "+CENG: 2,\"0030,21,12,1b2d,334,050,001a\"\r\n"
+        "+CENG: 3,\"0000,00,00,ffff,000,000,0000\"\r\n"
+        "+CENG: 4,\"0025,28,35,0a7b,334,020,0019\"\r\n\r\nOK\r\n";
+    CHECK(modem_at_parse_ceng(sim800, &nb) && nb.count == 3 && nb.seen == 3);
+    CHECK(nb.cell[0].rat == MODEM_RAT_GSM && nb.cell[0].cell_id == 0x0a7c && nb.cell[0].lac == 0x19);
+    CHECK(nb.cell[0].mcc == 334 && nb.cell[0].mnc == 20 && nb.cell[0].signal_dbm == -78);
+    CHECK(nb.cell[1].mnc == 50 && nb.cell[1].lac == 0x1a);
+
+    const char *lte =
+        "\r\n+CENG: 1,1,2,LTE\r\n"
+        "+CENG: 0,\"2525,55,-102,-72,-9,15,0232,029C3A2A,334,20,23\"\r\n"
+        "+CENG: 1,\"2525,120,-110,-80,-13\"\r\n"
+        "+CENG: 2,\"2525,612,-110,-80,-13\"\r\n\r\nOK\r\n";
+    CHECK(modem_at_parse_ceng(lte, &nb) && nb.count == 1);
+    CHECK(nb.cell[0].rat == MODEM_RAT_LTE && nb.cell[0].pci == 120 && nb.cell[0].cell_id == 0 && nb.cell[0].signal_dbm == -110);
+
+    CHECK(!modem_at_parse_ceng("\r\nOK\r\n", &nb) && nb.count == 0);
+    CHECK(modem_at_parse_ceng("+CENG: 1,1\r\nOK", &nb) && nb.count == 0);
+
+    char many[1024] = "+CENG: 1,1\r\n";
+    for (int i = 1; i <= 9; ++i) {
+        char line[64];
+        snprintf(line, sizeof(line), "+CENG: %d,\"0021,32,34,0a%02x,334,020,0019\"\r\n", i, i);
+        strcat(many, line);
+    }
+    CHECK(modem_at_parse_ceng(many, &nb) && nb.count == MODEM_MAX_NEIGHBORS && nb.seen == 9);
+}
+
+static void test_psm_bits(void)
+{
+    char b[MODEM_PSM_BITS_LEN], e[MODEM_EDRX_BITS_LEN];
+    const uint32_t tau[] = { 60, 3600, 86400, 10 * 3600 };
+    for (size_t i = 0; i < sizeof(tau) / sizeof(tau[0]); ++i) {
+        modem_at_psm_tau_bits(tau[i], b);
+        CHECK(strlen(b) == 8 && modem_at_psm_timer_s(b, 8, false) == (int)tau[i]);
+    }
+    modem_at_psm_tau_bits(4000000000u, b);
+    CHECK(!strcmp(b, "11011111"));                     // tope: 31 x 320 h
+    modem_at_psm_active_bits(10, b);
+    CHECK(!strcmp(b, "00000101") && modem_at_psm_timer_s(b, 8, true) == 10);
+    modem_at_psm_active_bits(61, b);
+    CHECK(modem_at_psm_timer_s(b, 8, true) >= 61);    // redondeo hacia arriba
+    modem_at_psm_active_bits(0, b);
+    CHECK(modem_at_psm_timer_s(b, 8, true) == 0);
+    CHECK(modem_at_psm_timer_s("11100000", 8, true) == -1);
+    CHECK(modem_at_psm_timer_s("0010", 4, true) == -1);
+
+    modem_at_edrx_bits(20480, e);
+    CHECK(!strcmp(e, "0010"));
+    modem_at_edrx_bits(1000, e);
+    CHECK(!strcmp(e, "0000"));
+    modem_at_edrx_bits(81920, e);
+    CHECK(!strcmp(e, "0101"));
+    modem_at_edrx_bits(100000000, e);
+    CHECK(!strcmp(e, "1111"));
+}
+
+static void test_command(void)
+{
+    esp_modem_dce_t *dce = (esp_modem_dce_t *)1;
+    CHECK(modem_at_init(dce) == ESP_OK);
+    for (int cumulative = 0; cumulative < 2; ++cumulative) {
+        s_cumulative = cumulative;
+        char buf[128];
+        modem_at_rsp_t rsp = MODEM_AT_RSP(buf);
+
+        s_reply = "\r\n+CPSI: LTE,Online,334-20,0x232,43790378,55,EUTRAN-BAND5\r\n\r\nOK\r\n";
+        CHECK(modem_at_command(dce, "AT+CPSI?\r", &rsp, 1000) == ESP_OK);
+        CHECK(strstr(buf, "EUTRAN-BAND5") && strstr(buf, "OK") && rsp.used == strlen(s_reply));
+
+        s_reply = "\r\n+CME ERROR: SIM not inserted\r\n";
+        CHECK(modem_at_command(dce, "AT+CPSI?\r", &rsp, 1000) == ESP_FAIL);
+        s_reply = "\r\n+CMS ERROR: 500\r\n";
+        CHECK(modem_at_command(dce, "AT+CMGS\r", &rsp, 1000) == ESP_FAIL);
+        s_reply = "\r\nERROR\r\n";
+        CHECK(modem_at_command(dce, "AT\r", &rsp, 1000) == ESP_FAIL);
+
+        /* No cabe: se trunca terminada en '\0' y se avisa */
+        char small[16];
+        modem_at_rsp_t trunc = MODEM_AT_RSP(small);
+        s_reply = "\r\n+CPSI: LTE,Online,334-20,0x232\r\n\r\nOK\r\n";
+        CHECK(modem_at_command(dce, "AT+CPSI?\r", &trunc, 1000) == ESP_ERR_INVALID_SIZE);
+        CHECK(strlen(small) == sizeof(small) - 1 && trunc.seen == strlen(s_reply));
+
+        /* Sin código final: timeout */
+        s_reply = "\r\n+CSQ: 21,99\r\n";
+        CHECK(modem_at_command(dce, "AT+CSQ\r", &rsp, 1000) == ESP_ERR_TIMEOUT);
+
+        /* "OK" dentro de una línea no cierra la respuesta */
+        s_reply = "\r\n+COPS: 0,0,\"OK MOBILE\",7\r\n\r\nOK\r\n";
+        CHECK(modem_at_command(dce, "AT+COPS?\r", &rsp, 1000) == ESP_OK && strstr(buf, "OK MOBILE"));
+    }
+    modem_at_rsp_t bad = { 0 };
+    CHECK(modem_at_command(dce, "AT\r", &bad, 1000) == ESP_ERR_INVALID_ARG);
+}
+
+int main(void)
+{
+    test_cpsi();
+    test_csq();
+    test_cereg();
+    test_cops();
+    test_ceng();
+    test_psm_bits();
+    test_command();
+    printf("test_modem_at: %d fallos\n", s_fails);
+    return s_fails != 0;
+}
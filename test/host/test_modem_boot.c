@@ -0,0 +1,148 @@
+/* Arranque guiado por URC contra el módem simulado (mock_modem.c): tiempos de cada evento,
+ * líneas partidas entre trozos del UART y bits que se borran al perder SIM o registro */
+#include <stdio.h>
+#include <string.h>
+
+#include "modem_at.h"
+#include "mock_modem.h"
+#include "host_rtos.h"
+#include "esp_timer.h"
+
+static int s_fails;
+#define CHECK(cond) do { if (!(cond)) { printf("FALLO %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fails++; } } while (0)
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/* SIM7600 en frío: RDY a los ~8 s, SIM y agenda después, búsqueda y registro LTE */
+static const mock_urc_t k_boot[] = {
+    {  8000, "\r\nRDY\r\n" },
+    {  9500, "\r\n+CPIN: READY\r\n" },
+    { 11000, "\r\nSMS DONE\r\n" },
+    { 12000, "\r\nPB DONE\r\n" },
+    { 13000, "\r\n+CEREG: 2\r\n" },
+    { 15500, "\r\n+CEREG: 1,\"0232\",\"029C3A2A\",7\r\n" },
+};
+
+static void start(const mock_urc_t *urc, size_t count, size_t chunk)
+{
+    mock_modem_reset();
+    mock_modem_set_chunk(chunk);
+    CHECK(modem_at_init(mock_modem_dce()) == ESP_OK && modem_at_urc_enabled());
+    modem_at_mark_boot();
+    mock_modem_script(urc, count);
+}
+
+static void test_boot(size_t chunk)
+{
+    start(k_boot, COUNT(k_boot), chunk);
+    CHECK(modem_at_wait(MODEM_AT_EV_RDY, true, 5000) == 0);       // aún no: timeout a los 5 s
+    CHECK(esp_timer_get_time() == 5000 * 1000);
+    CHECK(modem_at_wait(MODEM_AT_EV_RDY, true, 20000) == MODEM_AT_EV_RDY);
+    CHECK(modem_at_elapsed_ms(MODEM_AT_EV_RDY) == 8000 && esp_timer_get_time() == 8000 * 1000);
+
+    const EventBits_t sim = MODEM_AT_EV_SIM_READY | MODEM_AT_EV_PB_DONE;
+    CHECK(modem_at_wait(sim, true, 10000) == sim);
+    CHECK(modem_at_elapsed_ms(MODEM_AT_EV_SIM_READY) == 9500 && modem_at_elapsed_ms(MODEM_AT_EV_PB_DONE) == 12000);
+
+    /* "+CEREG: 2" (buscando) no registra */
+    CHECK(modem_at_wait(MODEM_AT_EV_REGISTERED, true, 1000) == 0);
+    CHECK(modem_at_cereg_stat(NULL, NULL) == 2);
+    CHECK(modem_at_wait(MODEM_AT_EV_REGISTERED, true, 30000) == MODEM_AT_EV_REGISTERED);
+    CHECK(modem_at_elapsed_ms(MODEM_AT_EV_REGISTERED) == 15500 && modem_at_elapsed_ms(MODEM_AT_EV_CELL) == 15500);
+
+    uint32_t tac = 0, ci = 0;
+    CHECK(modem_at_cereg_stat(&tac, &ci) == 1 && tac == 0x232 && ci == 0x29C3A2A);
+}
+
+static void test_sim_removed(void)
+{
+    static const mock_urc_t urc[] = {
+        { 100, "RDY\r\n+CPIN: READY\r\n" },
+        { 900, "\r\n+CPIN: NOT INSERTED\r\n" },
+    };
+    start(urc, COUNT(urc), 3);
+    CHECK(modem_at_wait(MODEM_AT_EV_SIM_READY, true, 500) == MODEM_AT_EV_SIM_READY);
+    CHECK(modem_at_wait(MODEM_AT_EV_ALL, true, 2000) == 0);
+    CHECK(!(modem_at_wait(MODEM_AT_EV_SIM_READY | MODEM_AT_EV_RDY, false, 0) & MODEM_AT_EV_SIM_READY));
+    CHECK(modem_at_elapsed_ms(MODEM_AT_EV_SIM_READY) == 100);     // la marca es la primera llegada
+}
+
+static void test_deregistration(void)
+{
+    static const mock_urc_t urc[] = {
+        {  200, "\r\n+CEREG: 5,\"0232\",\"029C3A2A\",7\r\n" },      // roaming cuenta como registrado
+        { 5000, "\r\n+CEREG: 2\r\n" },
+        { 6000, "\r\n+CEREG: 1,\"0233\",\"029C3A2B\",7\r\n" },
+    };
+    start(urc, COUNT(urc), 7);
+    CHECK(modem_at_wait(MODEM_AT_EV_REGISTERED, true, 1000) == MODEM_AT_EV_REGISTERED);
+    modem_at_clear(MODEM_AT_EV_CELL);
+    CHECK(modem_at_wait(MODEM_AT_EV_CELL, true, 4000) == 0);      // sin URC nueva no hay CELL
+    CHECK(modem_at_wait(MODEM_AT_EV_REGISTERED, true, 0) == MODEM_AT_EV_REGISTERED);
+    host_time_advance_ms(600);
+    CHECK(modem_at_wait(MODEM_AT_EV_CELL, true, 500) == 0);       // entrega +CEREG: 2
+    CHECK(modem_at_wait(MODEM_AT_EV_REGISTERED, true, 0) == 0);
+    CHECK(modem_at_wait(MODEM_AT_EV_CELL, true, 2000) == MODEM_AT_EV_CELL);
+    uint32_t tac = 0, ci = 0;
+    CHECK(modem_at_cereg_stat(&tac, &ci) == 1 && tac == 0x233 && ci == 0x29C3A2B);
+    CHECK(modem_at_elapsed_ms(MODEM_AT_EV_REGISTERED) == 200);
+}
+
+static void test_noise(void)
+{
+    /* Línea larga (descartada entera), restos binarios y líneas vacías alrededor de las URC */
+    static char longline[400];
+    memset(longline, 'X', sizeof(longline) - 3);
+    memcpy(longline + sizeof(longline) - 3, "\r\n", 3);
+    const mock_urc_t urc[] = {
+        {  10, longline },
+        {  20, "\r\n\r\n\n\rRDY\n" },
+        {  30, "+CEREG: 1,\"0232\"" },                                 // sin fin de línea...
+        {  40, ",\"029C3A2A\",7\r\n" },                                // ...hasta el siguiente envío
+    };
+    start(urc, COUNT(urc), 16);
+    CHECK(modem_at_wait(MODEM_AT_EV_RDY | MODEM_AT_EV_CELL, true, 1000) == (MODEM_AT_EV_RDY | MODEM_AT_EV_CELL));
+    CHECK(modem_at_elapsed_ms(MODEM_AT_EV_CELL) == 40);
+}
+
+static void test_commands(void)
+{
+    static const mock_reply_t replies[] = {
+        { "AT+CEREG?", "\r\n+CEREG: 2,5,\"0232\",\"029C3A2A\",7\r\n\r\nOK\r\n" },
+        { "AT+CPSI?",  "\r\n+CPSI: LTE,Online,334-20,0x232,43790378,55,EUTRAN-BAND5,2525,5,5,-94,-1029,-726,15\r\n\r\nOK\r\n" },
+        { "AT+CENG=",  "\r\nERROR\r\n" },
+        { "AT+CSCLK",  NULL },
+    };
+    start(NULL, 0, 5);
+    mock_modem_replies(replies, COUNT(replies));
+
+    /* La respuesta a AT+CEREG? también pasa por el motor de URC y publica el registro */
+    char buf[256];
+    modem_at_rsp_t rsp = MODEM_AT_RSP(buf);
+    CHECK(modem_at_command(mock_modem_dce(), "AT+CEREG?\r", &rsp, 1000) == ESP_OK);
+    CHECK(modem_at_wait(MODEM_AT_EV_REGISTERED | MODEM_AT_EV_CELL, true, 0) == (MODEM_AT_EV_REGISTERED | MODEM_AT_EV_CELL));
+
+    modem_cpsi_t c;
+    CHECK(modem_at_command(mock_modem_dce(), "AT+CPSI?\r", &rsp, 1000) == ESP_OK);
+    CHECK(modem_at_parse_cpsi(buf, &c) && c.valid && c.cell_id == 43790378);
+
+    CHECK(modem_at_command(mock_modem_dce(), "AT+CENG=4,1\r", &rsp, 1000) == ESP_FAIL);
+
+    int64_t t0 = esp_timer_get_time();
+    CHECK(modem_at_command(mock_modem_dce(), "AT+CSCLK=1\r", &rsp, 3000) == ESP_ERR_TIMEOUT);
+    CHECK(esp_timer_get_time() - t0 == 3000 * 1000);
+    CHECK(mock_modem_commands() == 4 && !strcmp(mock_modem_last_command(), "AT+CSCLK=1\r"));
+}
+
+int main(void)
+{
+    test_boot(64);
+    test_boot(1);
+    test_boot(4);
+    test_sim_removed();
+    test_deregistration();
+    test_noise();
+    test_commands();
+    printf("test_modem_boot: %d fallos\n", s_fails);
+    return s_fails != 0;
+}
@@ -0,0 +1,157 @@
+/* Cuenta las reservas de operator new al armar un registro de 20 campos con Value::emplace y al
+ * enviarlo con RTDB::putData(Value&&) contra el servidor local: ni el árbol ni sus cadenas se
+ * copian en profundidad */
+#include <stdlib.h>
+#include <new>
+#include <string>
+
+#include "rtdb.h"
+#include "http_standin.h"
+#include "host_test.h"
+
+using namespace ESPFirebase;
+
+/* Sólo cuenta el hilo del test (el servidor local reserva en los suyos) y sólo mientras mide.
+ * jsoncpp reserva claves y cadenas con malloc: se cuenta con -Wl,--wrap=malloc además de new */
+static thread_local bool s_counting;
+static thread_local size_t s_allocs;
+
+extern "C" void* __real_malloc(size_t size);
+
+extern "C" void* __wrap_malloc(size_t size)
+{
+    if (s_counting) s_allocs++;
+    return __real_malloc(size);
+}
+
+void* operator new(size_t size)
+{
+    if (s_counting) s_allocs++;
+    void* p = __real_malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    if (s_counting) s_allocs++;
+    return __real_malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    free(p);
+}
+
+template <typename F>
+static size_t count_allocs(F fn)
+{
+    s_allocs = 0;
+    s_counting = true;
+    fn();
+    s_counting = false;
+    return s_allocs;
+}
+
+#define FIELDS 20
+#define STRING_FIELDS 4
+
+static const char* const k_keys[FIELDS] = {
+    "pm1p0", "pm2p5", "pm4p0", "pm10p0", "voc", "nox", "co2", "temp_scd", "hum_scd", "temp_sen",
+    "hum_sen", "presion", "lat", "lon", "bateria", "rssi", "fecha", "hora", "ciudad", "operador",
+};
+
+/* Los 4 últimos son cadenas (jsoncpp siempre las reserva en el heap), el resto números */
+static Json::Value fieldValue(int i)
+{
+    static const char* const strings[STRING_FIELDS] = { "2024-10-01", "12:00:00", "Ciudad de México", "Telcel" };
+    if (i >= FIELDS - STRING_FIELDS) return Json::Value(strings[i - (FIELDS - STRING_FIELDS)]);
+    return Json::Value(i * 1.25);
+}
+
+static Json::Value buildEmplace(void)
+{
+    Json::Value record(Json::objectValue);
+    for (int i = 0; i < FIELDS; ++i) record.emplace(k_keys[i], fieldValue(i));
+    return record;
+}
+
+int main(void)
+{
+    HttpStandin server([](const standin_request_t& req) {
+        standin_response_t res;
+        if (!standinAuth(req, res)) res.status = 204;
+        return res;
+    });
+    FirebaseApp app("host-key");
+    app.useAuthEmulator(server.url("").c_str());
+    CHECK(app.loginUserAccount({ "sensor@example.com", "secreto" }) == ESP_OK);
+    RTDB db(&app, server.url("").c_str());
+
+    /* Armado: emplace mueve cada valor al nodo; con operator[] + asignación se duplican las cadenas */
+    Json::Value record;
+    size_t build_emplace = count_allocs([&] { record = buildEmplace(); });
+    size_t build_assign = count_allocs([&] {
+        Json::Value r(Json::objectValue);
+        for (int i = 0; i < FIELDS; ++i) {
+            Json::Value v = fieldValue(i);
+            r[k_keys[i]] = v;
+        }
+    });
+    /* El mapa y, por campo, la clave y su nodo; más la cadena si lo es. Nada más */
+    CHECK(build_emplace <= 1 + 2 * FIELDS + STRING_FIELDS);
+    CHECK(build_assign >= build_emplace + STRING_FIELDS);
+
+    /* Colgar el registro de otro árbol: moverlo cuesta el mapa de la raíz, la clave y el nodo; copiarlo,
+     * además, el árbol entero */
+    size_t nest_move_only = count_allocs([&] {
+        Json::Value root(Json::objectValue);
+        s_counting = false;
+        Json::Value sub = buildEmplace();
+        s_counting = true;
+        root.emplace("ultimo", std::move(sub));
+    });
+    size_t nest_copy_only = count_allocs([&] {
+        Json::Value root(Json::objectValue);
+        s_counting = false;
+        Json::Value sub = buildEmplace();
+        s_counting = true;
+        root["ultimo"] = sub;
+    });
+    CHECK(nest_move_only <= 3);
+    CHECK(nest_copy_only >= nest_move_only + build_emplace);
+
+    /* Envío: mismo cuerpo como texto (coste de la petición), como árbol prestado y como árbol cedido.
+     * Cedido sólo suma la serialización; una copia del árbol sumaría otras build_emplace */
+    Json::FastWriter writer;
+    std::string body;
+    size_t serialize = count_allocs([&] { body = writer.write(record); });
+    db.putData("/calentar", body.c_str());   // primera petición: buffers del contexto ya hechos
+    size_t send_text = count_allocs([&] { CHECK(db.putData("/texto", body.c_str()) == ESP_OK); });
+    size_t send_ref = count_allocs([&] { CHECK(db.putData("/prestado", record) == ESP_OK); });
+    size_t send_owned = count_allocs([&] { CHECK(db.putData("/cedido", std::move(record)) == ESP_OK); });
+    CHECK(record.isNull());   // el árbol se lo quedó putData y ya se liberó
+    CHECK(send_owned <= send_ref);
+    CHECK(send_owned <= send_text + serialize);
+
+    printf("registro de %d campos (%d cadenas), reservas (malloc + operator new):\n", FIELDS, STRING_FIELDS);
+    printf("  armar con emplace            %3zu\n", build_emplace);
+    printf("  armar con operator[] + copia %3zu\n", build_assign);
+    printf("  colgar con emplace(move)     %3zu\n", nest_move_only);
+    printf("  colgar con operator[] + copia%3zu\n", nest_copy_only);
+    printf("  FastWriter::write            %3zu\n", serialize);
+    printf("  putData(texto)               %3zu\n", send_text);
+    printf("  putData(const Value&)        %3zu\n", send_ref);
+    printf("  putData(Value&&)             %3zu\n", send_owned);
+    return test_result("rtdb_alloc");
+}
@@ -0,0 +1,149 @@
+/* RTDB::listen contra un stream SSE del servidor local: redirección 307 a otro nodo, eventos
+ * pequeños que deben llegar al callback en cuanto se escriben (sin esperar a llenar un buffer ni
+ * al keep-alive), un evento partido en dos escrituras, auth_revoked con renovación y reconexión,
+ * y un segundo stream con Transfer-Encoding: chunked */
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rtdb.h"
+#include "http_standin.h"
+#include "host_test.h"
+
+using namespace ESPFirebase;
+
+/* Un evento de pocos bytes debe llegar en este margen desde que se escribe */
+#define EVENT_LATENCY_MS 150
+#define PATCH_DELAY_MS 300
+
+typedef std::chrono::steady_clock clock_type;
+
+struct event_t {
+    std::string event;
+    std::string path;
+    std::string data;
+    clock_type::time_point at;
+};
+
+static int s_port;
+static std::atomic<int> s_redirects;
+static std::atomic<int> s_streams;
+static std::atomic<int> s_refreshes;
+static std::mutex s_mutex;
+static std::vector<event_t> s_events;
+static clock_type::time_point s_first_stream_at;
+
+static std::string chunk(const std::string& data)
+{
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", data.size());
+    return size + data + "\r\n";
+}
+
+static standin_response_t handle(const standin_request_t& req)
+{
+    standin_response_t res;
+    if (req.path.find("/securetoken.googleapis.com/") == 0) s_refreshes++;
+    if (standinAuth(req, res)) return res;
+
+    if (req.path.find("/sensor/config.json") == 0) {
+        // El stream vive en otro nodo, como los 307 de Firebase
+        s_redirects++;
+        res.status = 307;
+        res.headers.push_back({ "Location", "http://127.0.0.1:" + std::to_string(s_port) + "/nodo2" + req.path });
+        return res;
+    }
+    auto accept = req.headers.find("accept");
+    if (req.path.find("/nodo2/sensor/config.json") != 0 || accept == req.headers.end() || accept->second != "text/event-stream") {
+        res.status = 404;
+        return res;
+    }
+    int n = ++s_streams;
+    if (n == 1) {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_first_stream_at = clock_type::now();
+    }
+    res.headers.push_back({ "Content-Type", "text/event-stream" });
+    if (n == 1) {
+        res.stream.push_back({ 0, "event: put\ndata: {\"path\":\"/\",\"data\":{\"intervalo\":30}}\n\n" });
+        res.stream.push_back({ PATCH_DELAY_MS, "event: patch\ndata: {\"path\":\"/\",\"da" });
+        res.stream.push_back({ 40, "ta\":{\"intervalo\":60}}\n\n" });
+        res.stream.push_back({ PATCH_DELAY_MS, "event: auth_revoked\ndata: credential is no longer valid\n\n" });
+    } else if (n == 2) {
+        res.headers.push_back({ "Transfer-Encoding", "chunked" });
+        res.stream.push_back({ 0, chunk("event: put\ndata: {\"path\":\"/intervalo\",") });
+        res.stream.push_back({ 20, chunk("\"data\":90}\n\n") + "0\r\n\r\n" });
+        res.close = true;
+    } else {
+        res.stall = true;   // el listener se queda esperando hasta el final del test
+    }
+    return res;
+}
+
+static void onChange(const char* event, const char* path, const char* data, size_t data_len, void*)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_events.push_back({ event, path, std::string(data, data_len), clock_type::now() });
+}
+
+static bool waitFor(int ms, bool (*cond)(void))
+{
+    auto until = clock_type::now() + std::chrono::milliseconds(ms);
+    while (!cond()) {
+        if (clock_type::now() > until) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+static long msSinceFirstStream(clock_type::time_point t)
+{
+    return (long)std::chrono::duration_cast<std::chrono::milliseconds>(t - s_first_stream_at).count();
+}
+
+int main(void)
+{
+    std::unique_ptr<HttpStandin> server(new HttpStandin(handle));
+    s_port = server->port();
+    std::unique_ptr<FirebaseApp> app(new FirebaseApp("host-key"));
+    app->useAuthEmulator(server->url("").c_str());
+    CHECK(app->loginUserAccount({ "sensor@example.com", "secreto" }) == ESP_OK);
+    int refreshes_at_login = s_refreshes;
+    std::unique_ptr<RTDB> db(new RTDB(app.get(), server->url("").c_str()));
+
+    rtdb_listener_t* listener = db->listen("/sensor/config", onChange);
+    CHECK(listener != nullptr);
+
+    CHECK(waitFor(5000, [] { return s_streams >= 3; }));
+    CHECK(waitFor(1000, [] { std::lock_guard<std::mutex> lock(s_mutex); return s_events.size() >= 3; }));
+
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        CHECK(s_events.size() == 3);
+        if (s_events.size() == 3) {
+            long put_ms = msSinceFirstStream(s_events[0].at);
+            long patch_ms = msSinceFirstStream(s_events[1].at);
+            printf("put a %ld ms del stream, patch a %ld ms (escrito a %d ms)\n", put_ms, patch_ms, PATCH_DELAY_MS + 40);
+            CHECK(s_events[0].event == "put" && s_events[0].path == "/" && s_events[0].data == "{\"intervalo\":30}");
+            CHECK(put_ms < EVENT_LATENCY_MS);
+            CHECK(s_events[1].event == "patch" && s_events[1].data == "{\"intervalo\":60}");
+            CHECK(patch_ms >= PATCH_DELAY_MS + 40 && patch_ms < PATCH_DELAY_MS + 40 + EVENT_LATENCY_MS);
+            CHECK(s_events[2].event == "put" && s_events[2].path == "/intervalo" && s_events[2].data == "90");
+        }
+        /* Cada conexión pasa por la redirección; tras auth_revoked se renueva el token */
+        CHECK(s_redirects == s_streams);
+        CHECK(s_refreshes > refreshes_at_login);
+    }
+
+    /* La tarea del listener sale al cortarse la conexión colgada; app y db deben seguir vivos hasta entonces */
+    db->unlisten(listener);
+    server.reset();
+    vTaskDelay(pdMS_TO_TICKS(200));
+    db.reset();
+    app.reset();
+    return test_result("rtdb_listen");
+}
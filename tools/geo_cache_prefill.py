@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Precarga de la caché de celdas (main/geo_cache.c) desde un CSV.
+
+Entrada (con cabecera; accuracy y stored_at son opcionales):
+    mcc,mnc,tac,cid,lat,lon,city,state,accuracy,stored_at
+    334,20,0x232,43790378,19.43261,-99.13321,Ciudad de México,CDMX,1000,
+
+Salida: CSV para nvs_partition_gen.py de ESP-IDF con el namespace "geocache" y un blob
+"cNN" por celda, con el mismo formato que escribe el firmware. Con --bin genera además la
+imagen de la partición:
+
+    python tools/geo_cache_prefill.py celdas.csv -o geocache_nvs.csv --bin nvs.bin
+    esptool.py write_flash 0x9000 nvs.bin
+
+La imagen sustituye la partición NVS completa (offset y tamaño de la tabla por defecto:
+0x9000, 0x6000). Sin fecha en el CSV, las entradas cuentan como guardadas al generar.
+"""
+import argparse
+import csv
+import os
+import struct
+import subprocess
+import sys
+import time
+
+# Deben coincidir con geo_cache.h / geo_cache.c
+NAMESPACE = "geocache"
+SLOTS = 32
+ENTRY_VERSION = 1
+TEXT = 40
+HEADER = struct.Struct("<BBHHHIIiiIII")
+assert HEADER.size + 2 * TEXT == 116
+
+
+def text_field(value, name, row):
+    raw = value.encode("utf-8")
+    if len(raw) >= TEXT:
+        cut = raw[:TEXT - 1].decode("utf-8", "ignore").encode("utf-8")
+        print(f"aviso: fila {row}: {name} recortado a {len(cut)} bytes", file=sys.stderr)
+        raw = cut
+    return raw.ljust(TEXT, b"\0")
+
+
+def encode(rec, seq, row, default_stored_at):
+    stored_at = int(rec.get("stored_at") or default_stored_at)
+    hdr = HEADER.pack(
+        ENTRY_VERSION, 0,
+        int(rec["mcc"]), int(rec["mnc"]), 0,
+        int(rec["tac"], 0), int(rec["cid"], 0),
+        round(float(rec["lat"]) * 1e7), round(float(rec["lon"]) * 1e7),
+        int(float(rec.get("accuracy") or 0)),
+        stored_at, seq)
+    return hdr + text_field(rec["city"], "city", row) + text_field(rec["state"], "state", row)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("bundle", help="CSV de celdas")
+    ap.add_argument("-o", "--output", default="geocache_nvs.csv", help="CSV para nvs_partition_gen.py")
+    ap.add_argument("--bin", help="genera también la imagen NVS (requiere IDF_PATH)")
+    ap.add_argument("--size", default="0x6000", help="tamaño de la partición NVS")
+    args = ap.parse_args()
+
+    now = int(time.time())
+    cells = {}
+    with open(args.bundle, newline="", encoding="utf-8") as f:
+        for row, rec in enumerate(csv.DictReader(f), start=2):
+            try:
+                key = (int(rec["mcc"]), int(rec["mnc"]), int(rec["tac"], 0), int(rec["cid"], 0))
+                if key[0] <= 0 or key[3] == 0:
+                    raise ValueError("MCC o CID nulos")
+                cells[key] = (row, rec)     # la última fila de una celda repetida gana
+            except (KeyError, TypeError, ValueError) as e:
+                sys.exit(f"fila {row}: {e}")
+
+    if len(cells) > SLOTS:
+        print(f"aviso: {len(cells)} celdas y sólo {SLOTS} huecos; se quedan las {SLOTS} primeras",
+              file=sys.stderr)
+    chosen = list(cells.values())[:SLOTS]
+
+    with open(args.output, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["key", "type", "encoding", "value"])
+        w.writerow([NAMESPACE, "namespace", "", ""])
+        # Secuencia LRU: las primeras del CSV son las más recientes (las últimas en salir)
+        for i, (row, rec) in enumerate(chosen):
+            blob = encode(rec, len(chosen) - i, row, now)
+            w.writerow([f"c{i:02d}", "data", "hex2bin", blob.hex()])
+    print(f"{len(chosen)} celdas -> {args.output}")
+
+    if args.bin:
+        idf = os.environ.get("IDF_PATH")
+        if not idf:
+            sys.exit("IDF_PATH no definido; genera la imagen a mano con nvs_partition_gen.py")
+        gen = os.path.join(idf, "components", "nvs_flash", "nvs_partition_generator", "nvs_partition_gen.py")
+        subprocess.run([sys.executable, gen, "generate", args.output, args.bin, args.size], check=True)
+
+
+if __name__ == "__main__":
+    main()